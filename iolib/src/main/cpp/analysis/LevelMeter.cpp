@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+
+#include "../../../../../oboemusicplayer/oboe/src/flowgraph/FlowgraphSimd.h"
+#include "LevelMeter.h"
+
+#if FLOWGRAPH_SIMD_NEON
+#include <arm_neon.h>
+#elif FLOWGRAPH_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+namespace iolib {
+
+/**
+ * The four phases of the ITU-R BS.1770-4 Annex 2 interpolation filter, arranged by tap,
+ * so that one tap of every phase can be applied with one vector multiply-add.
+ * Tap 0 is applied to the newest sample.
+ */
+alignas(16) static const float kCoefficients[LevelMeter::kTapsPerPhase]
+                                            [LevelMeter::kOversampling] = {
+        {  0.0017089843750f, -0.0291748046875f, -0.0189208984375f, -0.0083007812500f },
+        {  0.0109863281250f,  0.0292968750000f,  0.0330810546875f,  0.0148925781250f },
+        { -0.0196533203125f, -0.0517578125000f, -0.0582275390625f, -0.0266113281250f },
+        {  0.0332031250000f,  0.0891113281250f,  0.1015625000000f,  0.0476074218750f },
+        { -0.0594482421875f, -0.1665039062500f, -0.2003173828125f, -0.1022949218750f },
+        {  0.1373291015625f,  0.4650878906250f,  0.7797851562500f,  0.9721679687500f },
+        {  0.9721679687500f,  0.7797851562500f,  0.4650878906250f,  0.1373291015625f },
+        { -0.1022949218750f, -0.2003173828125f, -0.1665039062500f, -0.0594482421875f },
+        {  0.0476074218750f,  0.1015625000000f,  0.0891113281250f,  0.0332031250000f },
+        { -0.0266113281250f, -0.0582275390625f, -0.0517578125000f, -0.0196533203125f },
+        {  0.0148925781250f,  0.0330810546875f,  0.0292968750000f,  0.0109863281250f },
+        { -0.0083007812500f, -0.0189208984375f, -0.0291748046875f,  0.0017089843750f },
+};
+
+void LevelMeter::reset() {
+    clear();
+    memset(mHistory, 0, sizeof(mHistory));
+    mHistoryIndex = 0;
+}
+
+void LevelMeter::clear() {
+    mLevels.reset();
+    for (int32_t channel = 0; channel < kMaxChannels; channel++) {
+        mTruePeak[channel] = 0.0f;
+    }
+}
+
+void LevelMeter::process(const float *frames, int32_t channelCount, int32_t numFrames) {
+    int32_t numChannels = std::min(channelCount, kMaxChannels);
+    int32_t index = mHistoryIndex;
+    for (int32_t channel = 0; channel < numChannels; channel++) {
+        float *history = mHistory[channel];
+        float peak = mLevels.peak[channel];
+        float sumSquares = mLevels.sumSquares[channel];
+        index = mHistoryIndex;
+#if FLOWGRAPH_SIMD_NEON
+        float32x4_t truePeak = vdupq_n_f32(0.0f);
+#elif FLOWGRAPH_SIMD_SSE
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        __m128 truePeak = _mm_setzero_ps();
+#else
+        float truePeak = 0.0f;
+#endif
+        for (int32_t frame = 0; frame < numFrames; frame++) {
+            float sample = frames[frame * channelCount + channel];
+            peak = std::max(peak, std::fabs(sample));
+            sumSquares += sample * sample;
+
+            index = (index == 0 ? kTapsPerPhase : index) - 1;
+            history[index] = sample;
+            history[index + kTapsPerPhase] = sample;
+            const float *window = history + index;
+#if FLOWGRAPH_SIMD_NEON
+            float32x4_t sum = vmulq_f32(vld1q_f32(kCoefficients[0]), vdupq_n_f32(window[0]));
+            for (int32_t tap = 1; tap < kTapsPerPhase; tap++) {
+                sum = vfmaq_f32(sum, vld1q_f32(kCoefficients[tap]), vdupq_n_f32(window[tap]));
+            }
+            truePeak = vmaxq_f32(truePeak, vabsq_f32(sum));
+#elif FLOWGRAPH_SIMD_SSE
+            __m128 sum = _mm_mul_ps(_mm_load_ps(kCoefficients[0]), _mm_set1_ps(window[0]));
+            for (int32_t tap = 1; tap < kTapsPerPhase; tap++) {
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(kCoefficients[tap]),
+                                                 _mm_set1_ps(window[tap])));
+            }
+            truePeak = _mm_max_ps(truePeak, _mm_andnot_ps(signMask, sum));
+#else
+            for (int32_t phase = 0; phase < kOversampling; phase++) {
+                float sum = 0.0f;
+                for (int32_t tap = 0; tap < kTapsPerPhase; tap++) {
+                    sum += kCoefficients[tap][phase] * window[tap];
+                }
+                truePeak = std::max(truePeak, std::fabs(sum));
+            }
+#endif
+        }
+
+#if FLOWGRAPH_SIMD_NEON
+        float blockTruePeak = vmaxvq_f32(truePeak);
+#elif FLOWGRAPH_SIMD_SSE
+        truePeak = _mm_max_ps(truePeak, _mm_movehl_ps(truePeak, truePeak));
+        truePeak = _mm_max_ss(truePeak, _mm_shuffle_ps(truePeak, truePeak, 1));
+        float blockTruePeak = _mm_cvtss_f32(truePeak);
+#else
+        float blockTruePeak = truePeak;
+#endif
+        mLevels.peak[channel] = peak;
+        mLevels.sumSquares[channel] = sumSquares;
+        mTruePeak[channel] = std::max(mTruePeak[channel], std::max(blockTruePeak, peak));
+    }
+    mHistoryIndex = index;
+}
+
+} // namespace iolib
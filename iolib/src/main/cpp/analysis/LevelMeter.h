@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ANALYSIS_LEVELMETER_H_
+#define _ANALYSIS_LEVELMETER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace iolib {
+
+/**
+ * Sample peak and sum of squares per channel, added to one sample at a time.
+ * A SampleSource keeps one for the audio it mixes, so that it is measured in the same loop
+ * that mixes it.
+ */
+struct LevelAccumulator {
+    static constexpr int32_t kMaxChannels = 2;
+
+    float peak[kMaxChannels];
+    float sumSquares[kMaxChannels];
+
+    void reset() {
+        for (int32_t channel = 0; channel < kMaxChannels; channel++) {
+            peak[channel] = 0.0f;
+            sumSquares[channel] = 0.0f;
+        }
+    }
+
+    void add(int32_t channel, float sample) {
+        peak[channel] = std::max(peak[channel], std::fabs(sample));
+        sumSquares[channel] += sample * sample;
+    }
+};
+
+/**
+ * Measures the sample peak, the sum of squares and the true peak of each channel of a mix.
+ *
+ * The true peak also catches the peaks between the samples, which a DAC or a lossy encoder
+ * would clip. It is estimated by oversampling four times with the interpolation filter of
+ * ITU-R BS.1770-4 Annex 2.
+ *
+ * process() does not allocate or lock, so it can be called from the data callback.
+ */
+class LevelMeter {
+public:
+    static constexpr int32_t kMaxChannels = LevelAccumulator::kMaxChannels;
+    static constexpr int32_t kOversampling = 4;
+    static constexpr int32_t kTapsPerPhase = 12;
+
+    LevelMeter() { reset(); }
+
+    // Forget all audio, for example when a new stream is opened.
+    void reset();
+
+    // Start a new measurement. The filter keeps its history so the true peak is continuous.
+    void clear();
+
+    /**
+     * Measure interleaved frames. Channels past kMaxChannels are not measured.
+     */
+    void process(const float *frames, int32_t channelCount, int32_t numFrames);
+
+    // Measured since clear().
+    const LevelAccumulator &getLevels() const { return mLevels; }
+
+    // At least the sample peak.
+    float getTruePeak(int32_t channel) const { return mTruePeak[channel]; }
+
+private:
+    LevelAccumulator mLevels;
+    float mTruePeak[kMaxChannels];
+
+    // The newest kTapsPerPhase samples of each channel are always contiguous from
+    // mHistoryIndex, because each sample is stored twice, kTapsPerPhase apart.
+    float mHistory[kMaxChannels][2 * kTapsPerPhase];
+    int32_t mHistoryIndex;
+};
+
+} // namespace iolib
+
+#endif //_ANALYSIS_LEVELMETER_H_
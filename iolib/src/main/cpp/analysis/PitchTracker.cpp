@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "../../../../../oboemusicplayer/oboe/src/flowgraph/FlowgraphSimd.h"
+#include "PitchTracker.h"
+
+#if FLOWGRAPH_SIMD_NEON
+#include <arm_neon.h>
+#elif FLOWGRAPH_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+namespace iolib {
+
+/**
+ * Sum of a[i] * b[i], which is where the analysis spends nearly all of its time.
+ */
+static float dotProduct(const float *a, const float *b, int32_t numSamples) {
+    int32_t i = 0;
+    float sum = 0.0f;
+#if FLOWGRAPH_SIMD_NEON
+    // Two accumulators so consecutive multiply-adds do not wait for each other.
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= numSamples; i += 8) {
+        sum0 = vfmaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vfmaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(sum0, sum1));
+#elif FLOWGRAPH_SIMD_SSE
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (; i + 8 <= numSamples; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 total = _mm_add_ps(sum0, sum1);
+    total = _mm_add_ps(total, _mm_movehl_ps(total, total));
+    total = _mm_add_ss(total, _mm_shuffle_ps(total, total, 1));
+    sum = _mm_cvtss_f32(total);
+#endif
+    for (; i < numSamples; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+PitchTracker::~PitchTracker() {
+    std::lock_guard<std::mutex> lock(mLock);
+    stopWorker();
+}
+
+void PitchTracker::configure(int32_t channelCount, int32_t sampleRate) {
+    std::lock_guard<std::mutex> lock(mLock);
+    stopWorker();
+    mChannelCount = channelCount;
+    mSampleRate = sampleRate;
+
+    int32_t inputFrames = std::max(1, sampleRate * kInputFifoMillis / 1000);
+    mInput = std::make_unique<oboe::FifoBuffer>(sizeof(float), inputFrames);
+    mEstimates = std::make_unique<oboe::FifoBuffer>(sizeof(PitchEstimate), kMaxEstimates);
+    mFramesDropped.store(0);
+    mAnchor.store(Anchor{});
+
+    // The difference function compares a window of one period of the lowest frequency with
+    // the same window shifted by up to that period. One more lag is needed to interpolate.
+    mMinLag = std::max(2, static_cast<int32_t>(sampleRate / kMaxFrequency));
+    mMaxLag = static_cast<int32_t>(std::ceil(sampleRate / kMinFrequency));
+    mHopFrames = std::max(1, sampleRate * kHopMillis / 1000);
+    mWindow.assign(2 * mMaxLag + 1, 0.0f);
+    mEnergy.assign(mWindow.size() + 1, 0.0);
+    mDifference.assign(mMaxLag + 2, 1.0f);
+
+    if (mWanted) {
+        startWorker();
+    }
+}
+
+void PitchTracker::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mWanted = enabled;
+    if (!enabled) {
+        stopWorker();
+    } else if (mInput) {
+        startWorker();
+    }
+}
+
+void PitchTracker::startWorker() {
+    if (mWorker.joinable()) {
+        return;
+    }
+    mRunning.store(true, std::memory_order_release);
+    mWorker = std::thread(&PitchTracker::run, this);
+    mActive.store(true, std::memory_order_release);
+}
+
+void PitchTracker::stopWorker() {
+    mActive.store(false, std::memory_order_release);
+    if (mWorker.joinable()) {
+        mRunning.store(false, std::memory_order_release);
+        mWorker.join();
+    }
+}
+
+void PitchTracker::write(const float *frames, int32_t numFrames, int64_t framePosition) {
+    if (!mActive.load(std::memory_order_acquire)) {
+        return;
+    }
+    // Write all of it or nothing, so the worker never sees a gap inside a block.
+    oboe::FifoBuffer::Regions regions;
+    if (mInput->prepareToWrite(numFrames, regions) < numFrames) {
+        mFramesDropped.fetch_add(numFrames, std::memory_order_relaxed);
+        return;
+    }
+    const float scale = 1.0f / mChannelCount;
+    for (const oboe::FifoBuffer::Region &region : {regions.first, regions.second}) {
+        auto mono = reinterpret_cast<float *>(region.data);
+        for (int32_t i = 0; i < region.numFrames; i++) {
+            float sum = 0.0f;
+            for (int32_t channel = 0; channel < mChannelCount; channel++) {
+                sum += *frames++;
+            }
+            mono[i] = sum * scale;
+        }
+    }
+    mInput->finishWrite(numFrames);
+    mAnchor.store(Anchor{mInput->getWriteCounter(), framePosition + numFrames});
+}
+
+int32_t PitchTracker::readEstimates(PitchEstimate *estimates, int32_t maxEstimates) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (!mEstimates) {
+        return 0;
+    }
+    return mEstimates->read(estimates, maxEstimates);
+}
+
+void PitchTracker::run() {
+    const auto windowFrames = static_cast<int32_t>(mWindow.size());
+    int32_t framesInWindow = 0;
+    int64_t framesDropped = -1;
+
+    while (mRunning.load(std::memory_order_acquire)) {
+        // Anything that was left over, or from before frames were dropped, is stale.
+        int64_t framesDroppedNow = mFramesDropped.load(std::memory_order_relaxed);
+        if (framesDroppedNow != framesDropped) {
+            framesDropped = framesDroppedNow;
+            mInput->finishRead(mInput->getFullFramesAvailable());
+            framesInWindow = 0;
+        }
+
+        int32_t framesNeeded = (framesInWindow < windowFrames)
+                ? windowFrames - framesInWindow : mHopFrames;
+        if (static_cast<int32_t>(mInput->getFullFramesAvailable()) < framesNeeded) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(kHopMillis / 2));
+            continue;
+        }
+        if (framesInWindow == windowFrames) {
+            memmove(mWindow.data(), mWindow.data() + mHopFrames,
+                    (windowFrames - mHopFrames) * sizeof(float));
+            framesInWindow -= mHopFrames;
+        }
+        mInput->read(mWindow.data() + framesInWindow, framesNeeded);
+        framesInWindow += framesNeeded;
+
+        // The anchor may be a little older or newer than the frames just read,
+        // the counters are consecutive either way.
+        Anchor anchor = mAnchor.load();
+        int64_t endPosition = anchor.framePosition
+                + static_cast<int64_t>(mInput->getReadCounter() - anchor.writeCounter);
+        analyze(endPosition - windowFrames / 2);
+    }
+}
+
+void PitchTracker::analyze(int64_t framePosition) {
+    const float *window = mWindow.data();
+    const int32_t numSamples = mMaxLag;
+    PitchEstimate estimate{framePosition, 0.0f, 0.0f};
+
+    // Running sums of squares give the energy of every shifted window in one pass.
+    for (size_t i = 0; i < mWindow.size(); i++) {
+        mEnergy[i + 1] = mEnergy[i] + window[i] * window[i];
+    }
+    const double energy = mEnergy[numSamples];
+    if (energy < kSilenceMeanSquare * numSamples) {
+        mEstimates->write(&estimate, 1);
+        return;
+    }
+
+    // Difference function with cumulative mean normalization, from the YIN paper.
+    // The sum of (x[i] - x[i + lag])^2 is expanded into the energies and a dot product.
+    double sum = 0.0;
+    mDifference[0] = 1.0f;
+    for (int32_t lag = 1; lag <= mMaxLag + 1; lag++) {
+        double shiftedEnergy = mEnergy[lag + numSamples] - mEnergy[lag];
+        double difference = energy + shiftedEnergy
+                - 2.0 * dotProduct(window, window + lag, numSamples);
+        difference = std::max(difference, 0.0);
+        sum += difference;
+        mDifference[lag] = (sum > 0.0) ? static_cast<float>(difference * lag / sum) : 1.0f;
+    }
+
+    // Take the first dip below the threshold, which avoids picking a multiple of the
+    // period, or else the deepest dip, which is reported as unvoiced.
+    int32_t bestLag = -1;
+    for (int32_t lag = mMinLag; lag <= mMaxLag; lag++) {
+        if (mDifference[lag] < kVoicedThreshold) {
+            while (lag < mMaxLag && mDifference[lag + 1] < mDifference[lag]) {
+                lag++;
+            }
+            bestLag = lag;
+            break;
+        }
+    }
+    const bool voiced = bestLag > 0;
+    if (!voiced) {
+        bestLag = static_cast<int32_t>(
+                std::min_element(mDifference.begin() + mMinLag,
+                                 mDifference.begin() + mMaxLag + 1) - mDifference.begin());
+    }
+
+    estimate.confidence = std::max(0.0f, std::min(1.0f, 1.0f - mDifference[bestLag]));
+    if (voiced) {
+        // Fit a parabola through the dip for a lag between samples.
+        float before = mDifference[bestLag - 1];
+        float at = mDifference[bestLag];
+        float after = mDifference[bestLag + 1];
+        float curvature = before - 2.0f * at + after;
+        float lag = bestLag;
+        if (curvature > 0.0f) {
+            lag += 0.5f * (before - after) / curvature;
+        }
+        estimate.frequency = mSampleRate / lag;
+    }
+    mEstimates->write(&estimate, 1);
+}
+
+} // namespace iolib
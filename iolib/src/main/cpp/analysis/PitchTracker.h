@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ANALYSIS_PITCHTRACKER_H_
+#define _ANALYSIS_PITCHTRACKER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <oboe/FifoBuffer.h>
+
+#include "../player/SeqLock.h"
+
+namespace iolib {
+
+/**
+ * One pitch measurement.
+ */
+struct PitchEstimate {
+    // Frame position of the middle of the analysis window, in the frames passed to write().
+    int64_t framePosition;
+    // Fundamental frequency in Hz, or 0 if the window is not voiced.
+    float frequency;
+    // From 0 to 1, how periodic the window is. Also set for unvoiced windows.
+    float confidence;
+};
+
+/**
+ * Estimates the pitch of a voice with the YIN algorithm, for example for karaoke scoring.
+ *
+ * The audio thread passes the microphone to write(), which mixes it down to mono into a
+ * lock-free FIFO and never blocks. A worker thread analyzes a window every kHopMillis and
+ * puts a PitchEstimate into a second FIFO, which the app drains with readEstimates().
+ * So only a few numbers per hop leave the native code instead of the audio itself.
+ *
+ * If the worker falls so far behind that the FIFO fills up, the audio thread drops what
+ * does not fit and the worker starts again from the newest audio.
+ */
+class PitchTracker {
+public:
+    static constexpr float kMinFrequency = 70.0f;
+    static constexpr float kMaxFrequency = 1100.0f;
+    static constexpr int32_t kHopMillis = 10;
+    // Threshold on the normalized difference for a window to count as voiced.
+    static constexpr float kVoicedThreshold = 0.15f;
+    // Windows quieter than this, about -60 dBFS, are not analyzed.
+    static constexpr float kSilenceMeanSquare = 1.0e-6f;
+    static constexpr int32_t kInputFifoMillis = 1000;
+    static constexpr int32_t kMaxEstimates = 256;
+
+    PitchTracker() = default;
+    ~PitchTracker();
+
+    /**
+     * Set the format of the audio that write() gets.
+     * Only call when write() is not running, for example before the stream is started.
+     */
+    void configure(int32_t channelCount, int32_t sampleRate);
+
+    /**
+     * Start or stop the analysis. May be called at any time from the control thread.
+     * While it is off, write() returns immediately.
+     */
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return mActive.load(std::memory_order_acquire); }
+
+    int32_t getSampleRate() const { return mSampleRate; }
+
+    /**
+     * Pass interleaved frames to the analysis without blocking. For the audio thread.
+     *
+     * @param framePosition position of the first frame, consecutive calls should follow on
+     */
+    void write(const float *frames, int32_t numFrames, int64_t framePosition);
+
+    /**
+     * Take the estimates made since the last call, oldest first.
+     * Only call from one thread at a time.
+     *
+     * @return number of estimates copied
+     */
+    int32_t readEstimates(PitchEstimate *estimates, int32_t maxEstimates);
+
+    // Input frames dropped because the worker fell behind.
+    int64_t getFramesDropped() const { return mFramesDropped.load(std::memory_order_relaxed); }
+
+private:
+    // Maps the write counter of the input FIFO to frame positions.
+    struct Anchor {
+        uint64_t writeCounter;
+        int64_t framePosition;
+    };
+
+    // These need mLock.
+    void startWorker();
+    void stopWorker();
+
+    void run();
+    void analyze(int64_t framePosition);
+
+    std::mutex mLock;
+    bool mWanted = false;
+    int32_t mChannelCount = 0;
+    int32_t mSampleRate = 0;
+    std::unique_ptr<oboe::FifoBuffer> mInput;
+    std::unique_ptr<oboe::FifoBuffer> mEstimates;
+    std::thread mWorker;
+
+    std::atomic<bool> mActive{false};
+    std::atomic<bool> mRunning{false};
+    std::atomic<int64_t> mFramesDropped{0};
+    SeqLock<Anchor> mAnchor;
+
+    // Only used by the worker.
+    int32_t mMinLag = 0;
+    int32_t mMaxLag = 0;
+    int32_t mHopFrames = 0;
+    std::vector<float> mWindow;
+    std::vector<double> mEnergy;
+    std::vector<float> mDifference;
+};
+
+} // namespace iolib
+
+#endif //_ANALYSIS_PITCHTRACKER_H_
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "../../../../../oboemusicplayer/oboe/src/flowgraph/FlowgraphSimd.h"
+#include "WaveformOverview.h"
+
+#if FLOWGRAPH_SIMD_NEON
+#include <arm_neon.h>
+#elif FLOWGRAPH_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+namespace iolib {
+
+namespace {
+
+// What is measured for each channel of a bin, before it is scaled to int16.
+struct Stats {
+    float minimum;
+    float maximum;
+    float sumSquares;
+};
+
+/**
+ * Measure each channel of interleaved frames into stats, which must be initialized.
+ * The vector loops need the channels to repeat every four samples, so they only handle
+ * mono and stereo.
+ */
+void measureFrames(const float *samples, int32_t numFrames, int32_t channelCount,
+                   Stats *stats) {
+    int32_t i = 0;
+#if FLOWGRAPH_SIMD_NEON || FLOWGRAPH_SIMD_SSE
+    if (channelCount == 1 || channelCount == 2) {
+        int32_t numSamples = numFrames * channelCount;
+        float lanes[3][4];
+#if FLOWGRAPH_SIMD_NEON
+        // Two sets of accumulators so consecutive loads do not wait for each other.
+        float32x4_t minimum0 = vdupq_n_f32(FLT_MAX);
+        float32x4_t minimum1 = minimum0;
+        float32x4_t maximum0 = vdupq_n_f32(-FLT_MAX);
+        float32x4_t maximum1 = maximum0;
+        float32x4_t squares0 = vdupq_n_f32(0.0f);
+        float32x4_t squares1 = squares0;
+        for (; i + 8 <= numSamples; i += 8) {
+            float32x4_t a = vld1q_f32(samples + i);
+            float32x4_t b = vld1q_f32(samples + i + 4);
+            minimum0 = vminq_f32(minimum0, a);
+            minimum1 = vminq_f32(minimum1, b);
+            maximum0 = vmaxq_f32(maximum0, a);
+            maximum1 = vmaxq_f32(maximum1, b);
+            squares0 = vfmaq_f32(squares0, a, a);
+            squares1 = vfmaq_f32(squares1, b, b);
+        }
+        vst1q_f32(lanes[0], vminq_f32(minimum0, minimum1));
+        vst1q_f32(lanes[1], vmaxq_f32(maximum0, maximum1));
+        vst1q_f32(lanes[2], vaddq_f32(squares0, squares1));
+#else
+        __m128 minimum0 = _mm_set1_ps(FLT_MAX);
+        __m128 minimum1 = minimum0;
+        __m128 maximum0 = _mm_set1_ps(-FLT_MAX);
+        __m128 maximum1 = maximum0;
+        __m128 squares0 = _mm_setzero_ps();
+        __m128 squares1 = squares0;
+        for (; i + 8 <= numSamples; i += 8) {
+            __m128 a = _mm_loadu_ps(samples + i);
+            __m128 b = _mm_loadu_ps(samples + i + 4);
+            minimum0 = _mm_min_ps(minimum0, a);
+            minimum1 = _mm_min_ps(minimum1, b);
+            maximum0 = _mm_max_ps(maximum0, a);
+            maximum1 = _mm_max_ps(maximum1, b);
+            squares0 = _mm_add_ps(squares0, _mm_mul_ps(a, a));
+            squares1 = _mm_add_ps(squares1, _mm_mul_ps(b, b));
+        }
+        _mm_storeu_ps(lanes[0], _mm_min_ps(minimum0, minimum1));
+        _mm_storeu_ps(lanes[1], _mm_max_ps(maximum0, maximum1));
+        _mm_storeu_ps(lanes[2], _mm_add_ps(squares0, squares1));
+#endif
+        if (i > 0) {
+            for (int32_t lane = 0; lane < 4; lane++) {
+                Stats &channelStats = stats[lane % channelCount];
+                channelStats.minimum = std::min(channelStats.minimum, lanes[0][lane]);
+                channelStats.maximum = std::max(channelStats.maximum, lanes[1][lane]);
+                channelStats.sumSquares += lanes[2][lane];
+            }
+        }
+    }
+#endif
+    // i is a whole number of frames.
+    for (int32_t frame = i / channelCount; frame < numFrames; frame++) {
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            float sample = samples[frame * channelCount + channel];
+            Stats &channelStats = stats[channel];
+            channelStats.minimum = std::min(channelStats.minimum, sample);
+            channelStats.maximum = std::max(channelStats.maximum, sample);
+            channelStats.sumSquares += sample * sample;
+        }
+    }
+}
+
+void resetStats(Stats *stats, int32_t count) {
+    for (int32_t i = 0; i < count; i++) {
+        stats[i] = {FLT_MAX, -FLT_MAX, 0.0f};
+    }
+}
+
+int16_t toInt16(float value) {
+    return static_cast<int16_t>(std::lrint(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f));
+}
+
+} // namespace
+
+int32_t WaveformOverview::getFramesPerBin(int32_t level) {
+    int32_t framesPerBin = kFramesPerBin;
+    for (int32_t i = 0; i < level; i++) {
+        framesPerBin *= kLevelRatio;
+    }
+    return framesPerBin;
+}
+
+void WaveformOverview::build(const float *samples, int32_t numFrames, int32_t channelCount) {
+    mBlock.clear();
+    if (samples == nullptr || numFrames <= 0 || channelCount <= 0) {
+        return;
+    }
+
+    // Measure the finest level from the samples. The bins are split between threads.
+    int32_t numBins[kNumLevels];
+    std::vector<Stats> stats[kNumLevels];
+    for (int32_t level = 0; level < kNumLevels; level++) {
+        int32_t framesPerBin = getFramesPerBin(level);
+        numBins[level] = (numFrames + framesPerBin - 1) / framesPerBin;
+        stats[level].resize(static_cast<size_t>(numBins[level]) * channelCount);
+        resetStats(stats[level].data(), static_cast<int32_t>(stats[level].size()));
+    }
+
+    auto measureBins = [&](int32_t firstBin, int32_t endBin) {
+        for (int32_t bin = firstBin; bin < endBin; bin++) {
+            int32_t firstFrame = bin * kFramesPerBin;
+            int32_t binFrames = std::min(kFramesPerBin, numFrames - firstFrame);
+            measureFrames(samples + static_cast<size_t>(firstFrame) * channelCount, binFrames,
+                          channelCount, &stats[0][static_cast<size_t>(bin) * channelCount]);
+        }
+    };
+    int32_t numThreads = std::max(1, std::min(kMaxThreads, numFrames / kMinFramesPerThread));
+    int32_t binsPerThread = (numBins[0] + numThreads - 1) / numThreads;
+    std::vector<std::thread> threads;
+    for (int32_t index = 1; index < numThreads; index++) {
+        int32_t firstBin = index * binsPerThread;
+        threads.emplace_back(measureBins, firstBin,
+                             std::min(numBins[0], firstBin + binsPerThread));
+    }
+    measureBins(0, std::min(numBins[0], binsPerThread));
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    // Each coarser level combines kLevelRatio bins of the one before.
+    for (int32_t level = 1; level < kNumLevels; level++) {
+        for (int32_t bin = 0; bin < numBins[level - 1]; bin++) {
+            for (int32_t channel = 0; channel < channelCount; channel++) {
+                const Stats &from = stats[level - 1][static_cast<size_t>(bin) * channelCount
+                                                     + channel];
+                Stats &to = stats[level][static_cast<size_t>(bin / kLevelRatio) * channelCount
+                                         + channel];
+                to.minimum = std::min(to.minimum, from.minimum);
+                to.maximum = std::max(to.maximum, from.maximum);
+                to.sumSquares += from.sumSquares;
+            }
+        }
+    }
+
+    // Write the block.
+    size_t size = kHeaderSize;
+    int32_t offsets[kNumLevels];
+    for (int32_t level = 0; level < kNumLevels; level++) {
+        offsets[level] = static_cast<int32_t>(size);
+        size += stats[level].size() * kValuesPerChannel * sizeof(int16_t);
+    }
+    mBlock.assign(size, 0);
+
+    int32_t header[kHeaderSize / sizeof(int32_t)] = {};
+    header[0] = static_cast<int32_t>(kVersion);
+    header[1] = channelCount;
+    header[2] = numFrames;
+    header[3] = kNumLevels;
+    for (int32_t level = 0; level < kNumLevels; level++) {
+        header[4 + level * 4] = getFramesPerBin(level);
+        header[4 + level * 4 + 1] = numBins[level];
+        header[4 + level * 4 + 2] = offsets[level];
+    }
+    memcpy(mBlock.data(), header, sizeof(header));
+
+    for (int32_t level = 0; level < kNumLevels; level++) {
+        int32_t framesPerBin = getFramesPerBin(level);
+        auto *values = reinterpret_cast<int16_t *>(mBlock.data() + offsets[level]);
+        for (int32_t bin = 0; bin < numBins[level]; bin++) {
+            int32_t binFrames = std::min(framesPerBin, numFrames - bin * framesPerBin);
+            for (int32_t channel = 0; channel < channelCount; channel++) {
+                const Stats &binStats = stats[level][static_cast<size_t>(bin) * channelCount
+                                                     + channel];
+                *values++ = toInt16(binStats.minimum);
+                *values++ = toInt16(binStats.maximum);
+                *values++ = toInt16(std::sqrt(binStats.sumSquares / binFrames));
+            }
+        }
+    }
+}
+
+} // namespace iolib
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ANALYSIS_WAVEFORMOVERVIEW_H_
+#define _ANALYSIS_WAVEFORMOVERVIEW_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace iolib {
+
+/**
+ * The minimum, maximum and RMS of each channel of some audio, over bins of a few sizes,
+ * so that a waveform can be drawn at any zoom without reading the samples.
+ *
+ * All of it is kept in one block of memory, which Java can wrap in a direct ByteBuffer and
+ * which could be written to a file as it is. The block starts with a 64 byte header:
+ *
+ *     offset 0   uint32 kVersion
+ *     offset 4   int32  channel count
+ *     offset 8   int32  number of frames
+ *     offset 12  int32  kNumLevels
+ *     offset 16  for each level, four int32: frames per bin, number of bins,
+ *                offset of the first bin from the start of the block, 0
+ *
+ * A bin has an int16 minimum, maximum and RMS for each channel, in that order, scaled so
+ * that 32767 is 1.0. The last bin of a level may cover fewer frames. All fields are
+ * little endian and naturally aligned, and must match WaveformOverview.kt.
+ */
+class WaveformOverview {
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr int32_t kNumLevels = 3;
+    // Each level has kLevelRatio times fewer bins than the one before.
+    static constexpr int32_t kFramesPerBin = 256;
+    static constexpr int32_t kLevelRatio = 16;
+    static constexpr int32_t kHeaderSize = 16 + kNumLevels * 16;
+    // Values per channel in a bin.
+    static constexpr int32_t kValuesPerChannel = 3;
+
+    // Audio shorter than this is measured on one thread.
+    static constexpr int32_t kMinFramesPerThread = 1 << 18;
+    static constexpr int32_t kMaxThreads = 4;
+
+    /**
+     * Measure interleaved frames, replacing the previous overview.
+     * Takes a few milliseconds for a song, so call it where the audio is loaded.
+     */
+    void build(const float *samples, int32_t numFrames, int32_t channelCount);
+
+    void clear() { mBlock.clear(); }
+
+    // The block described above, or nullptr if there is no audio.
+    const uint8_t *getData() const { return mBlock.empty() ? nullptr : mBlock.data(); }
+    size_t getSize() const { return mBlock.size(); }
+
+    static int32_t getFramesPerBin(int32_t level);
+
+private:
+    std::vector<uint8_t> mBlock;
+};
+
+} // namespace iolib
+
+#endif //_ANALYSIS_WAVEFORMOVERVIEW_H_
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <android/log.h>
+
+#include "VocalEffectChain.h"
+
+using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
+
+static const char* TAG = "VocalEffectChain";
+
+namespace iolib {
+
+void VocalEffectChain::configure(int32_t channelCount, int32_t sampleRate) {
+    std::lock_guard<std::mutex> lock(mLock);
+    mChannelCount = channelCount;
+    mSampleRate = sampleRate;
+
+    // process() is not running so nothing can be using the old nodes.
+    mTopology.store(Topology{});
+    mConnected = false;
+    mRetired.clear();
+
+    mSource = std::make_unique<SourceFloat>(channelCount);
+    mSink = std::make_unique<SinkFloat>(channelCount);
+    for (Slot &slot : mSlots) {
+        VocalEffectParameters parameters = slot.effect->getParameters();
+        slot.effect = VocalEffect::create(slot.type, channelCount, sampleRate);
+        slot.effect->setParameters(parameters);
+    }
+    publish();
+}
+
+int32_t VocalEffectChain::addEffect(VocalEffectType type) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mSlots.size() >= kMaxEffects) {
+        __android_log_print(ANDROID_LOG_WARN, TAG, "Chain is full");
+        return -1;
+    }
+    // Before configure() the effect is made for mono at 48000 and recreated later.
+    std::unique_ptr<VocalEffect> effect = VocalEffect::create(
+            type, std::max(mChannelCount, 1), mSampleRate > 0 ? mSampleRate : 48000);
+    if (!effect) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "Unknown effect type %d",
+                            static_cast<int>(type));
+        return -1;
+    }
+    int32_t id = mNextId++;
+    mSlots.push_back(Slot{id, type, true, std::move(effect)});
+    publish();
+    return id;
+}
+
+bool VocalEffectChain::removeEffect(int32_t id) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = std::find_if(mSlots.begin(), mSlots.end(),
+                           [id](const Slot &slot) { return slot.id == id; });
+    if (it == mSlots.end()) {
+        return false;
+    }
+    std::unique_ptr<VocalEffect> effect = std::move(it->effect);
+    mSlots.erase(it);
+    publish();
+    retire(std::move(effect));
+    return true;
+}
+
+bool VocalEffectChain::moveEffect(int32_t id, int32_t index) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = std::find_if(mSlots.begin(), mSlots.end(),
+                           [id](const Slot &slot) { return slot.id == id; });
+    if (it == mSlots.end() || index < 0 || index >= static_cast<int32_t>(mSlots.size())) {
+        return false;
+    }
+    auto from = static_cast<int32_t>(it - mSlots.begin());
+    if (from < index) {
+        std::rotate(it, it + 1, mSlots.begin() + index + 1);
+    } else if (from > index) {
+        std::rotate(mSlots.begin() + index, it, it + 1);
+    }
+    publish();
+    return true;
+}
+
+bool VocalEffectChain::setEffectEnabled(int32_t id, bool enabled) {
+    std::lock_guard<std::mutex> lock(mLock);
+    Slot *slot = findSlot(id);
+    if (slot == nullptr) {
+        return false;
+    }
+    if (slot->enabled != enabled) {
+        slot->enabled = enabled;
+        publish();
+    }
+    return true;
+}
+
+bool VocalEffectChain::setEffectParameters(int32_t id, const VocalEffectParameters &parameters) {
+    std::lock_guard<std::mutex> lock(mLock);
+    Slot *slot = findSlot(id);
+    if (slot == nullptr) {
+        return false;
+    }
+    // Picked up by the audio thread without a new topology.
+    slot->effect->setParameters(parameters);
+    return true;
+}
+
+void VocalEffectChain::clear() {
+    std::lock_guard<std::mutex> lock(mLock);
+    std::vector<Slot> slots = std::move(mSlots);
+    mSlots.clear();
+    publish();
+    for (Slot &slot : slots) {
+        retire(std::move(slot.effect));
+    }
+}
+
+VocalEffectChain::Slot *VocalEffectChain::findSlot(int32_t id) {
+    for (Slot &slot : mSlots) {
+        if (slot.id == id) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void VocalEffectChain::retire(std::unique_ptr<VocalEffect> effect) {
+    mRetired.push_back(Retired{std::move(effect), mGeneration});
+}
+
+void VocalEffectChain::publish() {
+    deleteRetired();
+    Topology topology{};
+    topology.source = mSource.get();
+    topology.sink = mSink.get();
+    for (Slot &slot : mSlots) {
+        if (slot.enabled) {
+            topology.effects[topology.numEffects++] = slot.effect.get();
+        }
+    }
+    topology.generation = ++mGeneration;
+    mTopology.store(topology);
+}
+
+void VocalEffectChain::deleteRetired() {
+    uint32_t applied = mAppliedGeneration.load(std::memory_order_acquire);
+    // The generations wrap around, so compare the difference.
+    mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+                                  [applied](const Retired &retired) {
+                                      return static_cast<int32_t>(applied - retired.generation) >= 0;
+                                  }),
+                   mRetired.end());
+}
+
+void VocalEffectChain::process(float *buffer, int32_t numFrames) {
+    Topology topology = mTopology.load();
+    if (topology.source == nullptr || topology.sink == nullptr) {
+        return;
+    }
+
+    if (!mConnected || topology.generation != mConnectedGeneration) {
+        // Only connect what is in this topology. An input that is left connected to a
+        // removed effect is reconnected before it is pulled again.
+        FlowGraphPortFloatOutput *previous = &topology.source->output;
+        for (int32_t i = 0; i < topology.numEffects; i++) {
+            previous->connect(&topology.effects[i]->input);
+            previous = &topology.effects[i]->output;
+        }
+        previous->connect(&topology.sink->input);
+        mConnected = true;
+        mConnectedGeneration = topology.generation;
+        mAppliedGeneration.store(topology.generation, std::memory_order_release);
+    }
+
+    if (topology.numEffects == 0) {
+        return;
+    }
+    for (int32_t i = 0; i < topology.numEffects; i++) {
+        topology.effects[i]->prepareBlock();
+    }
+    // The source copies each chunk before the sink writes it back, so this works in place.
+    topology.source->setData(buffer, numFrames);
+    topology.sink->read(buffer, numFrames);
+}
+
+} // namespace iolib
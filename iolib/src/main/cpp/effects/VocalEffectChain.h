@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _EFFECTS_VOCALEFFECTCHAIN_H_
+#define _EFFECTS_VOCALEFFECTCHAIN_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../../../../../oboemusicplayer/oboe/src/flowgraph/SinkFloat.h"
+#include "../../../../../oboemusicplayer/oboe/src/flowgraph/SourceFloat.h"
+#include "VocalEffects.h"
+
+namespace iolib {
+
+/**
+ * An ordered chain of VocalEffects that processes the microphone in a data callback.
+ *
+ * The effects are added, removed, reordered and adjusted from the control thread, which
+ * takes a mutex that the audio thread never takes. Each change publishes a new topology,
+ * the list of enabled effects, through a SeqLock. The audio thread picks it up at the
+ * start of the next callback and reconnects the flowgraph there, so it never waits for
+ * the control thread.
+ *
+ * A removed effect may still be running on the audio thread, so it is only deleted once
+ * the audio thread has applied a topology without it.
+ */
+class VocalEffectChain {
+public:
+    static constexpr int32_t kMaxEffects = 8;
+
+    VocalEffectChain() = default;
+    ~VocalEffectChain() = default;
+
+    /**
+     * Set the format of the audio that process() gets. The effects are recreated for it
+     * and keep their order and parameters.
+     * Only call when process() is not running, for example before the stream is started.
+     */
+    void configure(int32_t channelCount, int32_t sampleRate);
+
+    // The functions below are for the control thread.
+
+    /**
+     * Add an effect with the default parameters to the end of the chain.
+     * @return the id of the effect, or -1 if the chain is full or the type is unknown
+     */
+    int32_t addEffect(VocalEffectType type);
+    bool removeEffect(int32_t id);
+    // Move the effect to index in the chain, counting the disabled effects.
+    bool moveEffect(int32_t id, int32_t index);
+    bool setEffectEnabled(int32_t id, bool enabled);
+    bool setEffectParameters(int32_t id, const VocalEffectParameters &parameters);
+    void clear();
+
+    /**
+     * Apply the enabled effects, in place. For the audio thread.
+     * Does nothing until configure() has been called.
+     */
+    void process(float *buffer, int32_t numFrames);
+
+private:
+    struct Slot {
+        int32_t id;
+        VocalEffectType type;
+        bool enabled;
+        std::unique_ptr<VocalEffect> effect;
+    };
+
+    struct Retired {
+        std::unique_ptr<VocalEffect> effect;
+        // Safe to delete once the audio thread has applied this generation.
+        uint32_t generation;
+    };
+
+    struct Topology {
+        FLOWGRAPH_OUTER_NAMESPACE::flowgraph::SourceFloat *source;
+        FLOWGRAPH_OUTER_NAMESPACE::flowgraph::SinkFloat *sink;
+        VocalEffect *effects[kMaxEffects];
+        int32_t numEffects;
+        uint32_t generation;
+    };
+
+    // These need mLock.
+    Slot *findSlot(int32_t id);
+    void retire(std::unique_ptr<VocalEffect> effect);
+    void publish();
+    void deleteRetired();
+
+    std::mutex mLock;
+    std::vector<Slot> mSlots;
+    std::vector<Retired> mRetired;
+    int32_t mNextId = 1;
+    uint32_t mGeneration = 0;
+    int32_t mChannelCount = 0;
+    int32_t mSampleRate = 0;
+    std::unique_ptr<FLOWGRAPH_OUTER_NAMESPACE::flowgraph::SourceFloat> mSource;
+    std::unique_ptr<FLOWGRAPH_OUTER_NAMESPACE::flowgraph::SinkFloat> mSink;
+
+    SeqLock<Topology> mTopology;
+    std::atomic<uint32_t> mAppliedGeneration{0};
+
+    // Only used by process().
+    bool mConnected = false;
+    uint32_t mConnectedGeneration = 0;
+};
+
+} // namespace iolib
+
+#endif //_EFFECTS_VOCALEFFECTCHAIN_H_
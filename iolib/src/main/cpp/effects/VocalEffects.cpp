@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include "VocalEffects.h"
+
+namespace iolib {
+
+static constexpr float kTwoPi = static_cast<float>(M_PI * 2);
+
+std::unique_ptr<VocalEffect> VocalEffect::create(VocalEffectType type,
+                                                 int32_t channelCount, int32_t sampleRate) {
+    std::unique_ptr<VocalEffect> effect;
+    switch (type) {
+        case VocalEffectType::Gain:
+            effect = std::make_unique<GainEffect>(channelCount, sampleRate);
+            break;
+        case VocalEffectType::Echo:
+            effect = std::make_unique<EchoVocalEffect>(channelCount, sampleRate);
+            break;
+        case VocalEffectType::Slapback:
+            effect = std::make_unique<SlapbackVocalEffect>(channelCount, sampleRate);
+            break;
+        case VocalEffectType::Flanger:
+            effect = std::make_unique<FlangerVocalEffect>(channelCount, sampleRate);
+            break;
+        case VocalEffectType::Vibrato:
+            effect = std::make_unique<VibratoVocalEffect>(channelCount, sampleRate);
+            break;
+        case VocalEffectType::WhiteChorus:
+            effect = std::make_unique<WhiteChorusVocalEffect>(channelCount, sampleRate);
+            break;
+        case VocalEffectType::Doubling:
+            effect = std::make_unique<DoublingVocalEffect>(channelCount, sampleRate);
+            break;
+        case VocalEffectType::Tremolo:
+            effect = std::make_unique<TremoloVocalEffect>(channelCount, sampleRate);
+            break;
+        case VocalEffectType::Overdrive:
+            effect = std::make_unique<DriveVocalEffect>(channelCount, sampleRate, false);
+            break;
+        case VocalEffectType::Distortion:
+            effect = std::make_unique<DriveVocalEffect>(channelCount, sampleRate, true);
+            break;
+        default:
+            return nullptr;
+    }
+    effect->setParameters(getDefaultParameters(type));
+    return effect;
+}
+
+VocalEffectParameters VocalEffect::getDefaultParameters(VocalEffectType type) {
+    switch (type) {
+        case VocalEffectType::Echo:        return {{0.5f, 100.0f, 0.0f}};
+        case VocalEffectType::Slapback:    return {{0.5f, 50.0f, 0.0f}};
+        case VocalEffectType::Flanger:     return {{1.0f, 0.2f, 0.7071f}};
+        case VocalEffectType::Vibrato:     return {{1.0f, 1.0f, 0.0f}};
+        case VocalEffectType::WhiteChorus: return {{10.0f, 10.0f, 4.0f}};
+        case VocalEffectType::Doubling:    return {{40.0f, 40.0f, 4.0f}};
+        case VocalEffectType::Tremolo:     return {{2.0f, 0.25f, 0.0f}};
+        case VocalEffectType::Gain:
+        case VocalEffectType::Overdrive:
+        case VocalEffectType::Distortion:
+        default:
+            return {{0.0f, 0.0f, 0.0f}};
+    }
+}
+
+// Gain ---------------------------------------------------------------
+
+void GainEffect::applyParameters(const VocalEffectParameters &parameters) {
+    // Same scale as the fxlab Gain effect.
+    float target = powf(2.0f, parameters.values[0] / 10);
+    if (target != mTargetGain) {
+        mTargetGain = target;
+        mGainStep = (mTargetGain - mGain) / kRampFrames;
+        mRampFramesLeft = kRampFrames;
+    }
+}
+
+int32_t GainEffect::onProcess(int32_t numFrames) {
+    const float *inputBuffer = input.getBuffer();
+    float *outputBuffer = output.getBuffer();
+    int32_t channelCount = output.getSamplesPerFrame();
+    for (int i = 0; i < numFrames; i++) {
+        if (mRampFramesLeft > 0) {
+            mGain = (--mRampFramesLeft == 0) ? mTargetGain : mGain + mGainStep;
+        }
+        for (int channel = 0; channel < channelCount; channel++) {
+            *outputBuffer++ = *inputBuffer++ * mGain;
+        }
+    }
+    return numFrames;
+}
+
+// Delay line ---------------------------------------------------------
+
+DelayLineVocalEffect::DelayLineVocalEffect(int32_t channelCount, int32_t sampleRate,
+                                           float maxDelayMillis, float maxDepthMillis)
+        : VocalEffect(channelCount, sampleRate)
+        , mChannelCount(channelCount)
+        // The tap is delay + depth and the modulation swings by depth around it, plus one
+        // frame for the interpolation and one so the oldest frame is not overwritten.
+        , mCapacityFrames(millisToFrames(maxDelayMillis) + 2 * millisToFrames(maxDepthMillis) + 3)
+        , mDelayLine(new float[mCapacityFrames * channelCount]())
+        , mPreviousInterpolated(new float[channelCount]()) {
+}
+
+void DelayLineVocalEffect::setSettings(const Settings &settings) {
+    int32_t maxDepth = (mCapacityFrames - 3) / 2;
+    mSettings = settings;
+    mSettings.depthFrames = std::max(0, std::min(settings.depthFrames, maxDepth));
+    mSettings.delayFrames = std::max(0, std::min(settings.delayFrames,
+                                                 mCapacityFrames - 3 - 2 * mSettings.depthFrames));
+    mSettings.noisePeriodFrames = std::max(1, settings.noisePeriodFrames);
+    mNoiseCounter = std::min(mNoiseCounter, mSettings.noisePeriodFrames - 1);
+    mPhaseIncrement = kTwoPi * settings.sineFrequency / mSampleRate;
+}
+
+float DelayLineVocalEffect::nextModulation() {
+    switch (mSettings.modulator) {
+        case Modulator::Sine:
+            mPhase += mPhaseIncrement;
+            if (mPhase >= kTwoPi) mPhase -= kTwoPi;
+            return sinf(mPhase);
+        case Modulator::Noise: {
+            // Like fxlab's WhiteNoise but without rand() and static state.
+            if (mNoiseCounter == 0) {
+                mNoiseStart = mNoiseEnd;
+                mRandomSeed = mRandomSeed * 1664525u + 1013904223u;
+                mNoiseEnd = (mRandomSeed >> 8) * (2.0f / (1 << 24)) - 1.0f;
+            }
+            float value = mNoiseStart + mNoiseCounter * (mNoiseEnd - mNoiseStart)
+                    / mSettings.noisePeriodFrames;
+            if (++mNoiseCounter == mSettings.noisePeriodFrames) mNoiseCounter = 0;
+            return std::max(-0.99f, std::min(value, 0.99f));
+        }
+        case Modulator::None:
+        default:
+            return 0.0f;
+    }
+}
+
+int32_t DelayLineVocalEffect::onProcess(int32_t numFrames) {
+    const float *inputBuffer = input.getBuffer();
+    float *outputBuffer = output.getBuffer();
+    const int32_t tap = mSettings.delayFrames + mSettings.depthFrames;
+    for (int i = 0; i < numFrames; i++) {
+        float variableDelay = nextModulation() * mSettings.depthFrames + tap;
+        int32_t index = std::max(1, static_cast<int32_t>(variableDelay));
+        float fractionComplement = 1 - (variableDelay - index);
+        for (int channel = 0; channel < mChannelCount; channel++) {
+            float delayInput = inputBuffer[channel] + mSettings.feedBack * read(tap, channel);
+            // All-pass interpolation.
+            float interpolated = fractionComplement * read(index, channel)
+                    + read(index + 1, channel)
+                    - fractionComplement * mPreviousInterpolated[channel];
+            mPreviousInterpolated[channel] = interpolated;
+            mDelayLine[mWriteIndex * mChannelCount + channel] = delayInput;
+            outputBuffer[channel] = interpolated * mSettings.feedForward
+                    + mSettings.blend * delayInput;
+        }
+        if (++mWriteIndex == mCapacityFrames) mWriteIndex = 0;
+        inputBuffer += mChannelCount;
+        outputBuffer += mChannelCount;
+    }
+    return numFrames;
+}
+
+void EchoVocalEffect::applyParameters(const VocalEffectParameters &parameters) {
+    Settings settings;
+    settings.blend = 1.0f;
+    settings.feedBack = parameters.values[0];
+    settings.delayFrames = millisToFrames(parameters.values[1]);
+    setSettings(settings);
+}
+
+void SlapbackVocalEffect::applyParameters(const VocalEffectParameters &parameters) {
+    Settings settings;
+    settings.blend = 1.0f;
+    settings.feedForward = parameters.values[0];
+    settings.delayFrames = millisToFrames(parameters.values[1]);
+    setSettings(settings);
+}
+
+void FlangerVocalEffect::applyParameters(const VocalEffectParameters &parameters) {
+    float feedback = parameters.values[2];
+    Settings settings;
+    settings.blend = feedback;
+    settings.feedForward = feedback;
+    settings.feedBack = feedback;
+    settings.depthFrames = millisToFrames(parameters.values[0]);
+    settings.modulator = Modulator::Sine;
+    settings.sineFrequency = parameters.values[1];
+    setSettings(settings);
+}
+
+void VibratoVocalEffect::applyParameters(const VocalEffectParameters &parameters) {
+    Settings settings;
+    settings.feedForward = 1.0f;
+    settings.delayFrames = 1;
+    settings.depthFrames = millisToFrames(parameters.values[0]);
+    settings.modulator = Modulator::Sine;
+    settings.sineFrequency = parameters.values[1];
+    setSettings(settings);
+}
+
+void WhiteChorusVocalEffect::applyParameters(const VocalEffectParameters &parameters) {
+    Settings settings;
+    settings.blend = 0.7071f;
+    settings.feedForward = 1.0f;
+    settings.feedBack = -0.7071f;
+    settings.depthFrames = millisToFrames(parameters.values[0]);
+    settings.delayFrames = millisToFrames(parameters.values[1]);
+    settings.modulator = Modulator::Noise;
+    settings.noisePeriodFrames = noisePassToFrames(parameters.values[2]);
+    setSettings(settings);
+}
+
+void DoublingVocalEffect::applyParameters(const VocalEffectParameters &parameters) {
+    Settings settings;
+    settings.blend = 0.7071f;
+    settings.feedForward = 0.7071f;
+    settings.depthFrames = millisToFrames(parameters.values[0]);
+    settings.delayFrames = millisToFrames(parameters.values[1]);
+    settings.modulator = Modulator::Noise;
+    settings.noisePeriodFrames = noisePassToFrames(parameters.values[2]);
+    setSettings(settings);
+}
+
+// Tremolo ------------------------------------------------------------
+
+void TremoloVocalEffect::applyParameters(const VocalEffectParameters &parameters) {
+    mPhaseIncrement = kTwoPi * parameters.values[0] / mSampleRate;
+    mHeight = parameters.values[1];
+    mCenter = 1 - mHeight;
+}
+
+int32_t TremoloVocalEffect::onProcess(int32_t numFrames) {
+    const float *inputBuffer = input.getBuffer();
+    float *outputBuffer = output.getBuffer();
+    int32_t channelCount = output.getSamplesPerFrame();
+    for (int i = 0; i < numFrames; i++) {
+        mPhase += mPhaseIncrement;
+        if (mPhase >= kTwoPi) mPhase -= kTwoPi;
+        float gain = mHeight * sinf(mPhase) + mCenter;
+        for (int channel = 0; channel < channelCount; channel++) {
+            *outputBuffer++ = *inputBuffer++ * gain;
+        }
+    }
+    return numFrames;
+}
+
+// Drive --------------------------------------------------------------
+
+void DriveVocalEffect::applyParameters(const VocalEffectParameters &parameters) {
+    mScale = powf(2.0f, parameters.values[0] / 10);
+    mInverseScale = 1 / mScale;
+}
+
+static inline float overdrive(float x) {
+    constexpr float third = 1.0f / 3.0f;
+    float abs = std::abs(x);
+    if (abs <= third) {
+        return x * 2;
+    } else if (abs <= 2 * third) {
+        return std::copysign((3 - (2 - 3 * abs) * (2 - 3 * abs)) * third, x);
+    } else {
+        return std::copysign(1.0f, x);
+    }
+}
+
+static inline float distortion(float x) {
+    return std::copysign(-std::expm1(-std::abs(x)), x);
+}
+
+int32_t DriveVocalEffect::onProcess(int32_t numFrames) {
+    const float *inputBuffer = input.getBuffer();
+    float *outputBuffer = output.getBuffer();
+    int32_t numSamples = numFrames * output.getSamplesPerFrame();
+    if (mDistortion) {
+        for (int i = 0; i < numSamples; i++) {
+            outputBuffer[i] = distortion(inputBuffer[i] * mScale) * mInverseScale;
+        }
+    } else {
+        for (int i = 0; i < numSamples; i++) {
+            outputBuffer[i] = overdrive(inputBuffer[i] * mScale) * mInverseScale;
+        }
+    }
+    return numFrames;
+}
+
+} // namespace iolib
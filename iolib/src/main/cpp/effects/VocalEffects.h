@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _EFFECTS_VOCALEFFECTS_H_
+#define _EFFECTS_VOCALEFFECTS_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "../../../../../oboemusicplayer/oboe/src/flowgraph/FlowGraphNode.h"
+#include "../player/SeqLock.h"
+
+namespace iolib {
+
+/**
+ * The effects of the fxlab app, as flowgraph nodes for the vocal chain.
+ * The values must match NativeMusicPlayer.VOCAL_EFFECT_*
+ */
+enum class VocalEffectType : int32_t {
+    Gain = 0,
+    Echo,
+    Slapback,
+    Flanger,
+    Vibrato,
+    WhiteChorus,
+    Doubling,
+    Tremolo,
+    Overdrive,
+    Distortion,
+};
+
+constexpr int32_t kNumVocalEffectTypes = static_cast<int32_t>(VocalEffectType::Distortion) + 1;
+
+/**
+ * Parameters in the order and units of the fxlab effect descriptions,
+ * for example Echo is {feedback, delay (ms)}. Unused values are ignored.
+ */
+struct VocalEffectParameters {
+    static constexpr int32_t kMaxParameters = 3;
+    std::array<float, kMaxParameters> values;
+};
+
+/**
+ * Base class for the vocal effects.
+ *
+ * The parameters may be set from any non-audio thread, but only one thread at a time,
+ * because the SeqLock they are published through has a single writer. VocalEffectChain
+ * serializes its callers with its mLock. The audio thread picks the parameters up in
+ * prepareBlock(), so a parameter change never blocks or allocates on the audio thread.
+ * Anything that depends on a parameter, such as a delay line, is allocated in the
+ * constructor for the largest value of that parameter.
+ */
+class VocalEffect : public FLOWGRAPH_OUTER_NAMESPACE::flowgraph::FlowGraphFilter {
+public:
+    VocalEffect(int32_t channelCount, int32_t sampleRate)
+            : FlowGraphFilter(channelCount)
+            , mSampleRate(sampleRate) {}
+
+    virtual ~VocalEffect() = default;
+
+    /**
+     * Create an effect with the default parameters. Allocates, so do not call on
+     * the audio thread.
+     */
+    static std::unique_ptr<VocalEffect> create(VocalEffectType type,
+                                               int32_t channelCount, int32_t sampleRate);
+
+    // The defaults of the fxlab effect descriptions.
+    static VocalEffectParameters getDefaultParameters(VocalEffectType type);
+
+    // Calls must not overlap; VocalEffectChain makes them under its mLock.
+    void setParameters(const VocalEffectParameters &parameters) {
+        mParameters.store(parameters);
+    }
+
+    VocalEffectParameters getParameters() const {
+        return mParameters.load();
+    }
+
+    /**
+     * Pick up the latest parameters. Called on the audio thread before each callback.
+     */
+    void prepareBlock() {
+        applyParameters(mParameters.load());
+    }
+
+protected:
+    // Convert the parameters to what onProcess() uses. Must not allocate.
+    virtual void applyParameters(const VocalEffectParameters &parameters) = 0;
+
+    int32_t millisToFrames(float millis) const {
+        return static_cast<int32_t>(millis * mSampleRate / 1000);
+    }
+
+    const int32_t mSampleRate;
+
+private:
+    SeqLock<VocalEffectParameters> mParameters;
+};
+
+/**
+ * Scales the signal, in dB.
+ */
+class GainEffect : public VocalEffect {
+public:
+    GainEffect(int32_t channelCount, int32_t sampleRate)
+            : VocalEffect(channelCount, sampleRate) {}
+
+    int32_t onProcess(int32_t numFrames) override;
+
+    const char *getName() override {
+        return "GainEffect";
+    }
+
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+
+private:
+    float mGain = 1.0f;
+    float mTargetGain = 1.0f;
+    // The gain moves to the target over this many frames to avoid zipper noise.
+    float mGainStep = 0.0f;
+    int32_t mRampFramesLeft = 0;
+    static constexpr int32_t kRampFrames = 256;
+};
+
+/**
+ * The modulated delay line of fxlab's DelayLineEffect, which makes the echo, slapback,
+ * flanger, vibrato, chorus and doubling effects with different settings.
+ *
+ * Each channel has its own delay line. They share the modulator.
+ */
+class DelayLineVocalEffect : public VocalEffect {
+public:
+    enum class Modulator {
+        None,
+        Sine,
+        Noise,
+    };
+
+    /**
+     * @param maxDelayMillis largest delay that the parameters can ask for
+     * @param maxDepthMillis largest modulation depth that the parameters can ask for
+     */
+    DelayLineVocalEffect(int32_t channelCount, int32_t sampleRate,
+                         float maxDelayMillis, float maxDepthMillis);
+
+    int32_t onProcess(int32_t numFrames) override;
+
+protected:
+    // Weights, delays and modulation, in frames.
+    struct Settings {
+        float blend = 0.0f;
+        float feedForward = 0.0f;
+        float feedBack = 0.0f;
+        int32_t delayFrames = 0;
+        int32_t depthFrames = 0;
+        Modulator modulator = Modulator::None;
+        float sineFrequency = 0.0f;
+        // fxlab's WhiteNoise moves to a new random value every this many frames.
+        int32_t noisePeriodFrames = 1;
+    };
+
+    void setSettings(const Settings &settings);
+
+    // fxlab's WhiteNoise period at 48000 Hz, scaled to the sample rate.
+    int32_t noisePassToFrames(float noisePass) const {
+        return std::max(1, static_cast<int32_t>(4800 * noisePass * mSampleRate / 48000));
+    }
+
+private:
+    float nextModulation();
+
+    float read(int32_t framesAgo, int32_t channel) const {
+        int32_t index = mWriteIndex - framesAgo;
+        if (index < 0) index += mCapacityFrames;
+        return mDelayLine[index * mChannelCount + channel];
+    }
+
+    const int32_t mChannelCount;
+    const int32_t mCapacityFrames;
+    std::unique_ptr<float[]> mDelayLine;
+    // For the all-pass interpolation, one per channel.
+    std::unique_ptr<float[]> mPreviousInterpolated;
+    int32_t mWriteIndex = 0;
+
+    Settings mSettings;
+
+    // Modulator state.
+    float mPhase = 0.0f;
+    float mPhaseIncrement = 0.0f;
+    uint32_t mRandomSeed = 12345;
+    float mNoiseStart = 0.0f;
+    float mNoiseEnd = 0.0f;
+    int32_t mNoiseCounter = 0;
+};
+
+// {feedback, delay (ms)}
+class EchoVocalEffect : public DelayLineVocalEffect {
+public:
+    EchoVocalEffect(int32_t channelCount, int32_t sampleRate)
+            : DelayLineVocalEffect(channelCount, sampleRate, 500.0f, 0.0f) {}
+    const char *getName() override { return "EchoVocalEffect"; }
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+};
+
+// {feedforward, delay (ms)}
+class SlapbackVocalEffect : public DelayLineVocalEffect {
+public:
+    SlapbackVocalEffect(int32_t channelCount, int32_t sampleRate)
+            : DelayLineVocalEffect(channelCount, sampleRate, 100.0f, 0.0f) {}
+    const char *getName() override { return "SlapbackVocalEffect"; }
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+};
+
+// {depth (ms), frequency, feedback}
+class FlangerVocalEffect : public DelayLineVocalEffect {
+public:
+    FlangerVocalEffect(int32_t channelCount, int32_t sampleRate)
+            : DelayLineVocalEffect(channelCount, sampleRate, 0.0f, 2.0f) {}
+    const char *getName() override { return "FlangerVocalEffect"; }
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+};
+
+// {depth (ms), frequency}
+class VibratoVocalEffect : public DelayLineVocalEffect {
+public:
+    VibratoVocalEffect(int32_t channelCount, int32_t sampleRate)
+            : DelayLineVocalEffect(channelCount, sampleRate, 0.0f, 3.0f) {}
+    const char *getName() override { return "VibratoVocalEffect"; }
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+};
+
+// {depth (ms), delay (ms), noise pass}
+class WhiteChorusVocalEffect : public DelayLineVocalEffect {
+public:
+    WhiteChorusVocalEffect(int32_t channelCount, int32_t sampleRate)
+            : DelayLineVocalEffect(channelCount, sampleRate, 30.0f, 30.0f) {}
+    const char *getName() override { return "WhiteChorusVocalEffect"; }
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+};
+
+// {depth (ms), delay (ms), noise pass}
+class DoublingVocalEffect : public DelayLineVocalEffect {
+public:
+    DoublingVocalEffect(int32_t channelCount, int32_t sampleRate)
+            : DelayLineVocalEffect(channelCount, sampleRate, 100.0f, 100.0f) {}
+    const char *getName() override { return "DoublingVocalEffect"; }
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+};
+
+// {frequency, height}
+class TremoloVocalEffect : public VocalEffect {
+public:
+    TremoloVocalEffect(int32_t channelCount, int32_t sampleRate)
+            : VocalEffect(channelCount, sampleRate) {}
+
+    int32_t onProcess(int32_t numFrames) override;
+
+    const char *getName() override {
+        return "TremoloVocalEffect";
+    }
+
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+
+private:
+    float mCenter = 1.0f;
+    float mHeight = 0.0f;
+    float mPhase = 0.0f;
+    float mPhaseIncrement = 0.0f;
+};
+
+/**
+ * fxlab's DriveControl around the overdrive or distortion shaper. {drive (dB)}
+ */
+class DriveVocalEffect : public VocalEffect {
+public:
+    DriveVocalEffect(int32_t channelCount, int32_t sampleRate, bool distortion)
+            : VocalEffect(channelCount, sampleRate)
+            , mDistortion(distortion) {}
+
+    int32_t onProcess(int32_t numFrames) override;
+
+    const char *getName() override {
+        return mDistortion ? "DistortionVocalEffect" : "OverdriveVocalEffect";
+    }
+
+protected:
+    void applyParameters(const VocalEffectParameters &parameters) override;
+
+private:
+    const bool mDistortion;
+    float mScale = 1.0f;
+    float mInverseScale = 1.0f;
+};
+
+} // namespace iolib
+
+#endif //_EFFECTS_VOCALEFFECTS_H_
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <android/log.h>
+
+#include "BufferSizeTuner.h"
+
+static const char* TAG = "BufferSizeTuner";
+
+using namespace oboe;
+
+namespace iolib {
+
+void BufferSizeTuner::setLimits(int32_t minimumBursts, int32_t maximumBursts,
+                                int32_t quietPeriodMillis) {
+    mMinimumBursts = std::max(1, minimumBursts);
+    mMaximumBursts = std::max(0, maximumBursts);
+    mQuietPeriodMillis = std::max(0, quietPeriodMillis);
+}
+
+Result BufferSizeTuner::start(AudioStream &stream) {
+    stop();
+
+    int32_t framesPerBurst = stream.getFramesPerBurst();
+    int32_t maximumBufferSize = stream.getBufferCapacityInFrames();
+    if (mMaximumBursts > 0) {
+        maximumBufferSize = std::min(maximumBufferSize, mMaximumBursts * framesPerBurst);
+    }
+    mMinimumBufferSize = std::min(mMinimumBursts * framesPerBurst, maximumBufferSize);
+    mBufferSizeIncrement = framesPerBurst;
+    mQuietPeriodFrames = static_cast<int64_t>(mQuietPeriodMillis) * stream.getSampleRate() / 1000;
+    mQuietFrames = 0;
+
+    mLatencyTuner.emplace(stream, maximumBufferSize);
+    mLatencyTuner->setMinimumBufferSize(mMinimumBufferSize);
+    mLatencyTuner->setBufferSizeIncrement(mBufferSizeIncrement);
+
+    mXRunCount = 0;
+    mGrowCount = 0;
+    mShrinkCount = 0;
+
+    // Note: this will fail with ErrorUnimplemented if we are using a callback with OpenSL ES
+    // See oboe::AudioStreamBuffered::setBufferSizeInFrames
+    auto result = stream.setBufferSizeInFrames(mMinimumBufferSize);
+    mBufferSizeInFrames = stream.getBufferSizeInFrames();
+    if (!result) {
+        __android_log_print(ANDROID_LOG_WARN, TAG,
+                            "Buffer size tuning not supported. Error: %s",
+                            convertToText(result.error()));
+        mLatencyTuner.reset();
+        return result.error();
+    }
+
+    __android_log_print(ANDROID_LOG_INFO, TAG,
+                        "start() buffer size %d, limits %d to %d frames",
+                        mBufferSizeInFrames.load(), mMinimumBufferSize, maximumBufferSize);
+    mActive.store(true, std::memory_order_release);
+    return Result::OK;
+}
+
+void BufferSizeTuner::stop() {
+    mActive.store(false, std::memory_order_release);
+}
+
+void BufferSizeTuner::onAudioReady(AudioStream &stream, int32_t numFrames) {
+    if (!mActive.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // Grows the buffer by one burst if there was an underrun.
+    if (mLatencyTuner->tune() != Result::OK) {
+        mActive.store(false, std::memory_order_relaxed);
+        return;
+    }
+
+    int32_t bufferSize = stream.getBufferSizeInFrames();
+    if (bufferSize > mBufferSizeInFrames.load(std::memory_order_relaxed)) {
+        mGrowCount++;
+    }
+
+    bool hadXRun = false;
+    auto xRunCountResult = stream.getXRunCount();
+    if (xRunCountResult && xRunCountResult.value() != mXRunCount.load(std::memory_order_relaxed)) {
+        mXRunCount.store(xRunCountResult.value());
+        hadXRun = true;
+    }
+
+    if (hadXRun) {
+        mQuietFrames = 0;
+    } else if (bufferSize > mMinimumBufferSize) {
+        mQuietFrames += numFrames;
+        if (mQuietFrames >= mQuietPeriodFrames) {
+            mQuietFrames = 0;
+            if (mLatencyTuner->isAtMaximumBufferSize()) {
+                // The LatencyTuner stops growing the buffer once it is at the maximum.
+                // Reset it so it can grow again. The reset drops the buffer to the minimum
+                // size, which is then overridden below.
+                mLatencyTuner->requestReset();
+                mLatencyTuner->tune();
+            }
+            int32_t requestedSize = std::max(mMinimumBufferSize,
+                                             bufferSize - mBufferSizeIncrement);
+            auto result = stream.setBufferSizeInFrames(requestedSize);
+            if (result) {
+                bufferSize = result.value();
+                mShrinkCount++;
+            }
+        }
+    } else {
+        mQuietFrames = 0;
+    }
+
+    mBufferSizeInFrames.store(bufferSize);
+}
+
+} // namespace iolib
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_BUFFERSIZETUNER_H_
+#define _PLAYER_BUFFERSIZETUNER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+#include <oboe/Oboe.h>
+
+namespace iolib {
+
+/**
+ * Adapts the buffer size of an output stream to the lowest size that plays without glitches.
+ *
+ * The buffer starts at the minimum size. oboe::LatencyTuner grows it by one burst
+ * whenever the stream reports an underrun. After a quiet period without underruns the
+ * buffer is shrunk again by one burst, so a single glitch does not cost latency forever.
+ *
+ * setLimits() and the getters may be called from any thread.
+ * start() must be called after the stream is opened and before it is started,
+ * and stop() before the stream is closed.
+ * onAudioReady() must be called from the data callback, just before it returns.
+ */
+class BufferSizeTuner {
+public:
+    static constexpr int32_t kDefaultMinimumBursts = 1;
+    static constexpr int32_t kDefaultMaximumBursts = 0; // use the buffer capacity
+    static constexpr int32_t kDefaultQuietPeriodMillis = 10 * 1000;
+
+    /**
+     * Set the limits used the next time start() is called.
+     *
+     * @param minimumBursts smallest buffer size, in bursts
+     * @param maximumBursts largest buffer size, in bursts, or zero for the buffer capacity
+     * @param quietPeriodMillis how long to play without underruns before shrinking the buffer
+     */
+    void setLimits(int32_t minimumBursts, int32_t maximumBursts, int32_t quietPeriodMillis);
+
+    /**
+     * Start tuning a newly opened stream. Sets the buffer size to the minimum.
+     *
+     * @return OK, or ErrorUnimplemented if the buffer size cannot be changed, as is the case
+     * for OpenSL ES streams with a callback
+     */
+    oboe::Result start(oboe::AudioStream &stream);
+
+    /**
+     * Stop tuning. Call this before the stream is closed.
+     */
+    void stop();
+
+    /**
+     * Tune the buffer size. Does not allocate or block.
+     */
+    void onAudioReady(oboe::AudioStream &stream, int32_t numFrames);
+
+    int32_t getBufferSizeInFrames() const { return mBufferSizeInFrames.load(); }
+    int32_t getXRunCount() const { return mXRunCount.load(); }
+    // number of times the buffer was grown because of underruns
+    int32_t getGrowCount() const { return mGrowCount.load(); }
+    // number of times the buffer was shrunk after a quiet period
+    int32_t getShrinkCount() const { return mShrinkCount.load(); }
+
+private:
+    // Only accessed from the callback thread once started.
+    std::optional<oboe::LatencyTuner> mLatencyTuner;
+    std::atomic<bool> mActive{false};
+    int32_t mMinimumBufferSize = 0;
+    int32_t mBufferSizeIncrement = 0;
+    int64_t mQuietPeriodFrames = 0;
+    int64_t mQuietFrames = 0;
+
+    std::atomic<int32_t> mMinimumBursts{kDefaultMinimumBursts};
+    std::atomic<int32_t> mMaximumBursts{kDefaultMaximumBursts};
+    std::atomic<int32_t> mQuietPeriodMillis{kDefaultQuietPeriodMillis};
+
+    std::atomic<int32_t> mBufferSizeInFrames{0};
+    std::atomic<int32_t> mXRunCount{0};
+    std::atomic<int32_t> mGrowCount{0};
+    std::atomic<int32_t> mShrinkCount{0};
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_BUFFERSIZETUNER_H_
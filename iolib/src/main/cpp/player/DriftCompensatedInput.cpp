@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <android/log.h>
+
+#include "DriftCompensatedInput.h"
+#include "../analysis/PitchTracker.h"
+#include "../effects/VocalEffectChain.h"
+#include "../../../../../oboemusicplayer/oboe/src/common/AudioClock.h"
+
+static const char* TAG = "DriftCompensatedInput";
+
+using namespace oboe;
+
+namespace iolib {
+
+bool DriftCompensatedInput::open(AudioStream &inputStream, AudioStream &outputStream) {
+    if (inputStream.getSampleRate() != outputStream.getSampleRate()
+            || inputStream.getChannelCount() != outputStream.getChannelCount()
+            || inputStream.getFormat() != AudioFormat::Float
+            || outputStream.getFormat() != AudioFormat::Float) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "input and output streams do not match");
+        return false;
+    }
+    mOpen.store(false, std::memory_order_release);
+    mChannelCount = outputStream.getChannelCount();
+    mSampleRate = outputStream.getSampleRate();
+    mInputFramesPerBurst = inputStream.getFramesPerBurst();
+    mOutputFramesPerBurst = outputStream.getFramesPerBurst();
+    mQuietPeriodFrames = static_cast<int64_t>(kQuietPeriodMillis) * mSampleRate / 1000;
+    mQuietFrames = 0;
+    mMinimumSpareFrames = INT32_MAX;
+
+    int32_t targetFrames = getTargetFrames(mCushionBursts.load());
+    // Room for a whole input buffer on top of the largest target, in case the output stalls.
+    int32_t maxTargetFrames = getTargetFrames(kMaxCushionBursts);
+    int32_t capacityFrames = std::max(2 * maxTargetFrames,
+            maxTargetFrames + inputStream.getBufferCapacityInFrames());
+    mConverter = std::make_unique<AsyncSampleRateConverter>(mChannelCount, mSampleRate,
+                                                            targetFrames, capacityFrames);
+
+    int32_t bufferFrames = std::max(inputStream.getBufferCapacityInFrames(),
+                                    outputStream.getBufferCapacityInFrames());
+    if (bufferFrames > mBufferFrames) {
+        size_t numSamples = static_cast<size_t>(bufferFrames) * mChannelCount;
+        mPullBuffer = std::make_unique<float[]>(numSamples);
+        mMixBuffer = std::make_unique<float[]>(numSamples);
+        mBufferFrames = bufferFrames;
+    }
+    mStarted = false;
+    mTargetFrames.store(targetFrames, std::memory_order_relaxed);
+    mBacklogFrames.store(0, std::memory_order_relaxed);
+    mCorrectionPpm.store(0.0, std::memory_order_relaxed);
+    mUnderflowCount.store(0, std::memory_order_relaxed);
+    mFramesDropped.store(0, std::memory_order_relaxed);
+    mOpen.store(true, std::memory_order_release);
+    return true;
+}
+
+int32_t DriftCompensatedInput::getTargetFrames(int32_t cushionBursts) const {
+    return mInputFramesPerBurst + mOutputFramesPerBurst + (cushionBursts * mInputFramesPerBurst);
+}
+
+void DriftCompensatedInput::tuneCushion(int32_t spareFrames, int32_t numFrames,
+                                        bool underflowed) {
+    int32_t cushionBursts = mCushionBursts.load(std::memory_order_relaxed);
+    if (underflowed) {
+        if (cushionBursts < kMaxCushionBursts) {
+            cushionBursts++;
+            mConverter->setTargetFillFrames(getTargetFrames(cushionBursts));
+            mCushionBursts.store(cushionBursts, std::memory_order_relaxed);
+        }
+        mQuietFrames = 0;
+        mMinimumSpareFrames = INT32_MAX;
+        return;
+    }
+
+    mMinimumSpareFrames = std::min(mMinimumSpareFrames, spareFrames);
+    mQuietFrames += numFrames;
+    if (mQuietFrames < mQuietPeriodFrames) {
+        return;
+    }
+    if (cushionBursts > 0 && mMinimumSpareFrames >= mInputFramesPerBurst) {
+        // A whole burst was never needed. The converter drains it without a glitch.
+        cushionBursts--;
+        mConverter->setTargetFillFrames(getTargetFrames(cushionBursts));
+        mCushionBursts.store(cushionBursts, std::memory_order_relaxed);
+    }
+    mQuietFrames = 0;
+    mMinimumSpareFrames = INT32_MAX;
+}
+
+int64_t DriftCompensatedInput::getLastFrameTimeNanos(AudioStream &inputStream) {
+    // Extrapolate from the timestamp to the newest frame that has been read.
+    ResultWithValue<FrameTimestamp> timestamp = inputStream.getTimestamp(CLOCK_MONOTONIC);
+    if (timestamp) {
+        int64_t framesAfterTimestamp = inputStream.getFramesRead() - 1
+                - timestamp.value().position;
+        return timestamp.value().timestamp
+                + (framesAfterTimestamp * kNanosPerSecond / mSampleRate);
+    }
+    return AudioClock::getNanoseconds();
+}
+
+ResultWithValue<int32_t> DriftCompensatedInput::pull(AudioStream &inputStream) {
+    int32_t totalFramesRead = 0;
+    int32_t framesRead = 0;
+    do {
+        ResultWithValue<int32_t> result = inputStream.read(mPullBuffer.get(), mBufferFrames,
+                                                           0 /* timeout */);
+        if (!result) {
+            return result;
+        }
+        framesRead = result.value();
+        if (framesRead > 0 && mStarted) {
+            mConverter->write(mPullBuffer.get(), framesRead,
+                              getLastFrameTimeNanos(inputStream));
+        }
+        totalFramesRead += framesRead;
+    } while (framesRead == mBufferFrames);
+    mFramesDropped.store(mConverter->getOverflowCount(), std::memory_order_relaxed);
+    return ResultWithValue<int32_t>(totalFramesRead);
+}
+
+int32_t DriftCompensatedInput::read(float *output, int32_t numFrames) {
+    mStarted = true;
+    int32_t spareFrames = mConverter->getFillFrames() - numFrames;
+    int32_t underflowCount = mConverter->getUnderflowCount();
+    int32_t framesConverted = mConverter->read(output, numFrames, AudioClock::getNanoseconds());
+    bool underflowed = mConverter->getUnderflowCount() != underflowCount;
+    // Nothing is converted while waiting for the FIFO to fill, so there is nothing to learn.
+    if (framesConverted > 0 || underflowed) {
+        tuneCushion(spareFrames, numFrames, underflowed);
+    }
+    mTargetFrames.store(mConverter->getTargetFillFrames(), std::memory_order_relaxed);
+    mBacklogFrames.store(mConverter->getFillFrames(), std::memory_order_relaxed);
+    mCorrectionPpm.store(mConverter->getCorrectionPpm(), std::memory_order_relaxed);
+    mUnderflowCount.store(mConverter->getUnderflowCount(), std::memory_order_relaxed);
+    return framesConverted;
+}
+
+int32_t DriftCompensatedInput::mix(float *output, int32_t numFrames,
+                                   VocalEffectChain *effects,
+                                   PitchTracker *pitchTracker, int64_t framePosition) {
+    numFrames = std::min(numFrames, mBufferFrames);
+    int32_t framesConverted = read(mMixBuffer.get(), numFrames);
+    if (pitchTracker != nullptr) {
+        pitchTracker->write(mMixBuffer.get(), numFrames, framePosition);
+    }
+    if (effects != nullptr) {
+        effects->process(mMixBuffer.get(), numFrames);
+    }
+    // Add all of it, the resampler fades out to silence if the input ran dry.
+    int32_t numSamples = numFrames * mChannelCount;
+    for (int32_t i = 0; i < numSamples; i++) {
+        output[i] += mMixBuffer[i];
+    }
+    return framesConverted;
+}
+
+} // namespace iolib
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_DRIFTCOMPENSATEDINPUT_H_
+#define _PLAYER_DRIFTCOMPENSATEDINPUT_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include <oboe/Oboe.h>
+
+#include "../../../../../oboemusicplayer/oboe/src/common/AsyncSampleRateConverter.h"
+
+namespace iolib {
+
+class PitchTracker;
+class VocalEffectChain;
+
+/**
+ * Carries an input stream into the callback of an output stream that runs on a different
+ * clock, keeping the latency between them constant.
+ *
+ * The output callback calls pull() to take everything the input stream has captured,
+ * then read() or mix() to get exactly one callback worth of frames. The frames pass
+ * through an oboe::AsyncSampleRateConverter, which follows the drift between the two
+ * clocks instead of letting the backlog grow or run dry.
+ *
+ * Input pulled before the first read() or mix() is discarded, so the startup drain done
+ * by oboe::FullDuplexStream does not fill the FIFO.
+ *
+ * The latency is the input burst plus the output burst plus a cushion of whole input bursts.
+ * The cushion grows by one burst whenever the input runs dry, and shrinks by one burst after
+ * a quiet period in which at least one burst of it was never needed. getCushionBursts() can
+ * be saved and passed to setCushionBursts() in a later session so it starts at the value
+ * that was stable on this device.
+ */
+class DriftCompensatedInput {
+public:
+    static constexpr int32_t kDefaultCushionBursts = 1;
+    static constexpr int32_t kMaxCushionBursts = 8;
+    static constexpr int32_t kQuietPeriodMillis = 5000;
+
+    /**
+     * Set the cushion to start with the next time open() is called.
+     * May be called from any thread.
+     */
+    void setCushionBursts(int32_t numBursts) {
+        mCushionBursts.store(std::max(0, std::min(numBursts, kMaxCushionBursts)));
+    }
+
+    // The current cushion, in input bursts.
+    int32_t getCushionBursts() const { return mCushionBursts.load(); }
+
+    /**
+     * Allocate the converter for a pair of streams. They must have the same sample rate,
+     * channel count and Float format. Do not call while the output callback is running.
+     *
+     * @return false if the streams do not match
+     */
+    bool open(oboe::AudioStream &inputStream, oboe::AudioStream &outputStream);
+
+    /**
+     * Read everything that is available from the input stream without blocking.
+     * Only call from the output callback.
+     *
+     * @return number of frames read, or the error from the input stream
+     */
+    oboe::ResultWithValue<int32_t> pull(oboe::AudioStream &inputStream);
+
+    /**
+     * Write exactly numFrames frames to the output, silence where there is no input.
+     *
+     * @return number of frames that came from the input stream
+     */
+    int32_t read(float *output, int32_t numFrames);
+
+    /**
+     * Add exactly numFrames frames to the output, after running them through the
+     * effects if there are any. The pitch tracker gets the frames before the effects.
+     *
+     * @param framePosition output position of the first frame, for the pitch tracker
+     * @return number of frames that came from the input stream
+     */
+    int32_t mix(float *output, int32_t numFrames, VocalEffectChain *effects = nullptr,
+                PitchTracker *pitchTracker = nullptr, int64_t framePosition = 0);
+
+    /*
+     * The getters below may be called from any thread. They read copies that the output
+     * callback publishes, never the converter, which open() replaces.
+     */
+    bool isOpen() const { return mOpen.load(std::memory_order_acquire); }
+
+    // Latency added by the converter.
+    int32_t getTargetFrames() const { return mTargetFrames.load(std::memory_order_relaxed); }
+    // Frames waiting in the converter.
+    int32_t getBacklogFrames() const { return mBacklogFrames.load(std::memory_order_relaxed); }
+    // Positive when the input clock runs faster than the output clock.
+    double getCorrectionPpm() const { return mCorrectionPpm.load(std::memory_order_relaxed); }
+    // Number of times the input ran dry, each of which is a glitch.
+    int32_t getUnderflowCount() const {
+        return mUnderflowCount.load(std::memory_order_relaxed);
+    }
+    // Input frames that did not fit, for example after the output stalled.
+    int64_t getFramesDropped() const { return mFramesDropped.load(std::memory_order_relaxed); }
+
+private:
+    int64_t getLastFrameTimeNanos(oboe::AudioStream &inputStream);
+    int32_t getTargetFrames(int32_t cushionBursts) const;
+    void tuneCushion(int32_t spareFrames, int32_t numFrames, bool underflowed);
+
+    std::unique_ptr<oboe::AsyncSampleRateConverter> mConverter;
+    std::unique_ptr<float[]> mPullBuffer;
+    std::unique_ptr<float[]> mMixBuffer;
+    int32_t mBufferFrames = 0;
+    int32_t mChannelCount = 0;
+    int32_t mSampleRate = 0;
+    int32_t mInputFramesPerBurst = 0;
+    int32_t mOutputFramesPerBurst = 0;
+    bool    mStarted = false;
+    std::atomic<bool>    mOpen{false};
+    std::atomic<int32_t> mTargetFrames{0};
+    std::atomic<int32_t> mBacklogFrames{0};
+    std::atomic<double>  mCorrectionPpm{0.0};
+    std::atomic<int32_t> mUnderflowCount{0};
+    std::atomic<int64_t> mFramesDropped{0};
+    std::atomic<int32_t> mCushionBursts{kDefaultCushionBursts};
+
+    // Only used by the output callback.
+    int64_t mQuietFrames = 0;
+    int64_t mQuietPeriodFrames = 0;
+    int32_t mMinimumSpareFrames = INT32_MAX;
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_DRIFTCOMPENSATEDINPUT_H_
@@ -23,6 +23,15 @@
 namespace iolib {
 
 void OneShotSampleSource::mixAudio(float* outBuff, int numChannels, int32_t numFrames) {
+    if (mIsMetering) {
+        mixFrames<true>(outBuff, numChannels, numFrames);
+    } else {
+        mixFrames<false>(outBuff, numChannels, numFrames);
+    }
+}
+
+template <bool kMeter>
+void OneShotSampleSource::mixFrames(float* outBuff, int numChannels, int32_t numFrames) {
     int32_t numSamples = mSampleBuffer->getNumSamples();
     int32_t sampleChannels = mSampleBuffer->getProperties().channelCount;
     int32_t samplesLeft = numSamples - mCurSampleIndex;
@@ -35,28 +44,45 @@ void OneShotSampleSource::mixAudio(float* outBuff, int numChannels, int32_t numF
         if ((sampleChannels == 1) && (numChannels == 1)) {
             // MONO output from MONO samples
             for (int32_t frameIndex = 0; frameIndex < numWriteFrames; frameIndex++) {
-                outBuff[frameIndex] += data[mCurSampleIndex++] * mGain;
+                float value = data[mCurSampleIndex++] * mGain;
+                outBuff[frameIndex] += value;
+                if (kMeter) mLevels.add(0, value);
             }
         } else if ((sampleChannels == 1) && (numChannels == 2)) {
             // STEREO output from MONO samples
             int dstSampleIndex = 0;
             for (int32_t frameIndex = 0; frameIndex < numWriteFrames; frameIndex++) {
-                outBuff[dstSampleIndex++] += data[mCurSampleIndex] * mLeftGain;
-                outBuff[dstSampleIndex++] += data[mCurSampleIndex++] * mRightGain;
+                float left = data[mCurSampleIndex] * mLeftGain;
+                float right = data[mCurSampleIndex++] * mRightGain;
+                outBuff[dstSampleIndex++] += left;
+                outBuff[dstSampleIndex++] += right;
+                if (kMeter) {
+                    mLevels.add(0, left);
+                    mLevels.add(1, right);
+                }
             }
         } else if ((sampleChannels == 2) && (numChannels == 1)) {
             // MONO output from STEREO samples
             int dstSampleIndex = 0;
             for (int32_t frameIndex = 0; frameIndex < numWriteFrames; frameIndex++) {
-                outBuff[dstSampleIndex++] += data[mCurSampleIndex++] * mLeftGain +
-                                             data[mCurSampleIndex++] * mRightGain;
+                float value = data[mCurSampleIndex] * mLeftGain
+                              + data[mCurSampleIndex + 1] * mRightGain;
+                mCurSampleIndex += 2;
+                outBuff[dstSampleIndex++] += value;
+                if (kMeter) mLevels.add(0, value);
             }
         } else if ((sampleChannels == 2) && (numChannels == 2)) {
             // STEREO output from STEREO samples
             int dstSampleIndex = 0;
             for (int32_t frameIndex = 0; frameIndex < numWriteFrames; frameIndex++) {
-                outBuff[dstSampleIndex++] += data[mCurSampleIndex++] * mLeftGain;
-                outBuff[dstSampleIndex++] += data[mCurSampleIndex++] * mRightGain;
+                float left = data[mCurSampleIndex++] * mLeftGain;
+                float right = data[mCurSampleIndex++] * mRightGain;
+                outBuff[dstSampleIndex++] += left;
+                outBuff[dstSampleIndex++] += right;
+                if (kMeter) {
+                    mLevels.add(0, left);
+                    mLevels.add(1, right);
+                }
             }
         }
 
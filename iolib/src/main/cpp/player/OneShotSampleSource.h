@@ -31,6 +31,11 @@ public:
     virtual ~OneShotSampleSource() {};
 
     virtual void mixAudio(float* outBuff, int numChannels, int32_t numFrames);
+
+private:
+    // With kMeter, also measure what is mixed into mLevels.
+    template <bool kMeter>
+    void mixFrames(float* outBuff, int numChannels, int32_t numFrames);
 };
 
 } // namespace iolib
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <unistd.h>
+
+#include <android/log.h>
+
+#include "PerformanceHint.h"
+#include "../../../../../oboemusicplayer/oboe/src/common/AudioClock.h"
+
+static const char* TAG = "PerformanceHint";
+
+using namespace oboe;
+
+namespace iolib {
+
+void VoiceCostEstimator::addMeasurement(int64_t durationNanos, int32_t activeVoices) {
+    if (activeVoices == 0) {
+        mBaseNanos = (mBaseNanos == 0) ? durationNanos : static_cast<int64_t>(
+                mBaseNanos + kSmoothing * (durationNanos - mBaseNanos));
+    } else {
+        int64_t voiceNanos = std::max<int64_t>(0, durationNanos - mBaseNanos) / activeVoices;
+        mNanosPerVoice = (mNanosPerVoice == 0) ? voiceNanos : static_cast<int64_t>(
+                mNanosPerVoice + kSmoothing * (voiceNanos - mNanosPerVoice));
+    }
+}
+
+int64_t VoiceCostEstimator::estimateNanos(int32_t activeVoices) const {
+    return (mNanosPerVoice > 0) ? mBaseNanos + mNanosPerVoice * activeVoices : 0;
+}
+
+void VoiceCostEstimator::reset() {
+    mBaseNanos = 0;
+    mNanosPerVoice = 0;
+}
+
+void PerformanceHint::onBeginCallback(int32_t framesPerBurst, int32_t sampleRate) {
+    if (!mOpenAttempted.load(std::memory_order_acquire)) {
+        mFramesPerBurst = framesPerBurst;
+        int64_t targetDurationNanos = static_cast<int64_t>(framesPerBurst) * kNanosPerSecond
+                / sampleRate;
+        // This has to be called from the callback thread so we get the right TID.
+        int result = mAdpfWrapper.open(gettid(), targetDurationNanos);
+        if (result < 0) {
+            __android_log_print(ANDROID_LOG_WARN, TAG, "ADPF not supported, %d", result);
+        }
+        mOpenAttempted.store(true, std::memory_order_release);
+    }
+    if (!isOpen()) {
+        return;
+    }
+
+    // The hint is reported here rather than by hintActiveVoices(), so that only this thread
+    // reports to the session. An estimate is only given once a voice has been measured.
+    int32_t requestedVoices = mRequestedVoices.exchange(kNoRequest);
+    if (requestedVoices > mActiveVoices) {
+        int64_t expectedNanos = mVoiceCost.estimateNanos(requestedVoices);
+        if (expectedNanos > 0) {
+            mAdpfWrapper.reportActualDuration(expectedNanos);
+        }
+    }
+    mBeginNanos = AudioClock::getNanoseconds();
+}
+
+void PerformanceHint::onEndCallback(int32_t numFrames, int32_t activeVoices) {
+    if (!isOpen() || numFrames <= 0) {
+        return;
+    }
+    // Normalize the measured duration to a full burst.
+    double durationScaler = static_cast<double>(mFramesPerBurst) / numFrames;
+    // Skip very short callbacks, which happen when buffers wrap around.
+    if (durationScaler >= 2.0) {
+        return;
+    }
+    int64_t durationNanos = static_cast<int64_t>(
+            (AudioClock::getNanoseconds() - mBeginNanos) * durationScaler);
+    mAdpfWrapper.reportActualDuration(durationNanos);
+    mVoiceCost.addMeasurement(durationNanos, activeVoices);
+    mActiveVoices = activeVoices;
+}
+
+void PerformanceHint::hintActiveVoices(int32_t activeVoices) {
+    mRequestedVoices.store(activeVoices);
+}
+
+void PerformanceHint::close() {
+    mAdpfWrapper.close();
+    mOpenAttempted.store(false, std::memory_order_release);
+    mRequestedVoices = kNoRequest;
+    mActiveVoices = 0;
+    mVoiceCost.reset();
+}
+
+} // namespace iolib
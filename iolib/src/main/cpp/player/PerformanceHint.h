@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_PERFORMANCEHINT_H_
+#define _PLAYER_PERFORMANCEHINT_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include <oboe/Oboe.h>
+
+#include "../../../../../oboemusicplayer/oboe/src/common/AdpfWrapper.h"
+
+namespace iolib {
+
+/**
+ * Running estimate of the duration of a burst as a fixed part plus a part per voice.
+ * Measurements with no voices update the fixed part, the others the part per voice.
+ */
+class VoiceCostEstimator {
+public:
+    void addMeasurement(int64_t durationNanos, int32_t activeVoices);
+
+    /**
+     * @return expected duration of a burst with this many voices,
+     *         or 0 if the cost of a voice has not been measured yet
+     */
+    int64_t estimateNanos(int32_t activeVoices) const;
+
+    void reset();
+
+private:
+    // Weight of the newest measurement in the running averages.
+    static constexpr double kSmoothing = 0.1;
+
+    int64_t mBaseNanos = 0;
+    int64_t mNanosPerVoice = 0;
+};
+
+/**
+ * Reports the duration of the mixing work in a data callback to ADPF, so that the
+ * CPU governor can move the callback thread to a faster core before it glitches.
+ *
+ * Only the engine's own work between onBeginCallback() and onEndCallback() is measured,
+ * not the format conversion done by Oboe. The cost per voice is tracked so that
+ * hintActiveVoices() can report an expected jump in workload before it happens,
+ * for example just before several stems start at once.
+ *
+ * On platforms other than Android, AdpfWrapper reports to a stub that records the hints,
+ * which the host tests in iolib/src/test/cpp check.
+ */
+class PerformanceHint {
+public:
+    /**
+     * Call at the start of the data callback. Opens the hint session on the first callback,
+     * because the session is tied to the calling thread.
+     */
+    void onBeginCallback(oboe::AudioStream &stream) {
+        onBeginCallback(stream.getFramesPerBurst(), stream.getSampleRate());
+    }
+
+    void onBeginCallback(int32_t framesPerBurst, int32_t sampleRate);
+
+    /**
+     * Call at the end of the data callback.
+     *
+     * @param numFrames frames rendered by this callback
+     * @param activeVoices number of sources that were mixed
+     */
+    void onEndCallback(int32_t numFrames, int32_t activeVoices);
+
+    /**
+     * Give an advance hint that the number of voices is about to change.
+     * If it is going up, the expected duration of a burst is reported at the start of the
+     * next callback. May be called from any thread.
+     */
+    void hintActiveVoices(int32_t activeVoices);
+
+    /**
+     * Close the session. Call after the stream has been stopped, or before reopening it.
+     */
+    void close();
+
+    bool isOpen() const { return mAdpfWrapper.isOpen(); }
+
+private:
+    static constexpr int32_t kNoRequest = -1;
+
+    AdpfWrapper          mAdpfWrapper;
+    std::atomic<bool>    mOpenAttempted{false};
+    std::atomic<int32_t> mRequestedVoices{kNoRequest};
+
+    // Only used by the callback thread, or while the stream is stopped.
+    int32_t              mFramesPerBurst = 0;
+    int64_t              mBeginNanos = 0;
+    int32_t              mActiveVoices = 0;
+    VoiceCostEstimator   mVoiceCost;
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_PERFORMANCEHINT_H_
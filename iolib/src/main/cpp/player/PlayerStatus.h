@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_PLAYERSTATUS_H_
+#define _PLAYER_PLAYERSTATUS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace iolib {
+
+/**
+ * The state of a player, written by its data callback into memory that Java reads directly
+ * through a direct ByteBuffer, so polling it does not call into native code.
+ *
+ * The block starts with a header that does not change:
+ *
+ *     offset 0   uint32 sequence, odd while a write is in progress
+ *     offset 4   uint32 version of the layout, kVersion
+ *     offset 8   uint32 size of the block in bytes
+ *     offset 12  uint32 kMaxSources
+ *
+ * It is followed by Values at kValuesOffset. All fields are little endian and naturally
+ * aligned. The offsets are checked below and must match PlayerStatus.kt, and kVersion must
+ * change when they do.
+ *
+ * The values are published like a SeqLock: a reader copies them and tries again if the
+ * sequence was odd or changed in the meantime. publish() never waits.
+ */
+class PlayerStatus {
+public:
+    static constexpr uint32_t kVersion = 2;
+    static constexpr int32_t kMaxSources = 16;
+    static constexpr int32_t kMaxChannels = 2;
+
+    // Bits of Source::flags
+    static constexpr int32_t kSourcePlaying = 1;
+
+    struct Source {
+        int64_t positionFrames;     // next frame to be mixed
+        int64_t numFrames;
+        int32_t flags;
+        int32_t reserved;
+        // What the source added to each output channel in the last metering window.
+        float   peak[kMaxChannels];
+        float   rms[kMaxChannels];
+    };
+
+    struct Values {
+        int64_t callbackCount;
+        int64_t framesWritten;          // output frames written up to the end of the callback
+        int64_t framesWrittenTimeNanos; // CLOCK_MONOTONIC time that frame is heard, or -1
+        int64_t callbackTimeNanos;      // CLOCK_MONOTONIC time of the callback
+        double  framesPerSecond;        // measured by TransportClock, 0 without a timestamp
+        int32_t sampleRate;
+        int32_t channelCount;
+        int32_t bufferSizeInFrames;
+        int32_t xRunCount;
+        int32_t activeVoices;
+        int32_t numSources;             // entries of sources that are used
+        // Metering windows completed. The levels below change when it does.
+        int64_t meterCount;
+        // Levels of the output in the last metering window, 0 while metering is off.
+        float   peak[kMaxChannels];
+        float   rms[kMaxChannels];
+        float   truePeak[kMaxChannels];
+        Source  sources[kMaxSources];
+    };
+
+    static constexpr size_t kValuesOffset = 16;
+
+    PlayerStatus() {
+        mBlock.version = kVersion;
+        mBlock.size = sizeof(Block);
+        mBlock.maxSources = kMaxSources;
+        publish(Values{});
+    }
+
+    // Only call from one thread at a time, normally the data callback.
+    void publish(const Values &values) {
+        uint64_t words[kNumWords];
+        memcpy(words, &values, sizeof(Values));
+
+        uint32_t sequence = mBlock.sequence.load(std::memory_order_relaxed);
+        mBlock.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kNumWords; i++) {
+            mBlock.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        mBlock.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // For native readers. May be called from any thread.
+    Values load() const {
+        uint64_t words[kNumWords];
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = mBlock.sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kNumWords; i++) {
+                words[i] = mBlock.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = mBlock.sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        Values values;
+        memcpy(&values, words, sizeof(Values));
+        return values;
+    }
+
+    /**
+     * Copy a consistent snapshot of the block, with the layout above and a sequence of 0,
+     * for Java readers that cannot order their own loads. May be called from any thread.
+     *
+     * @return false if size is smaller than getBlockSize()
+     */
+    bool copyTo(void *dest, size_t size) const {
+        if (dest == nullptr || size < sizeof(Block)) {
+            return false;
+        }
+        Values values = load();
+        uint32_t header[kValuesOffset / sizeof(uint32_t)] = {
+                0, mBlock.version, mBlock.size, mBlock.maxSources};
+        auto *bytes = static_cast<uint8_t *>(dest);
+        memcpy(bytes, header, sizeof(header));
+        memcpy(bytes + kValuesOffset, &values, sizeof(Values));
+        return true;
+    }
+
+    // The memory to wrap in a direct ByteBuffer. It lives as long as this object.
+    void *getBlock() { return &mBlock; }
+    size_t getBlockSize() const { return sizeof(Block); }
+
+private:
+    static_assert(std::is_trivially_copyable<Values>::value, "Values must be plain data");
+    static_assert(sizeof(Values) % sizeof(uint64_t) == 0, "Values must be whole words");
+    static_assert(offsetof(Values, framesPerSecond) == 32, "Layout must match PlayerStatus.kt");
+    static_assert(offsetof(Values, sampleRate) == 40, "Layout must match PlayerStatus.kt");
+    static_assert(offsetof(Values, meterCount) == 64, "Layout must match PlayerStatus.kt");
+    static_assert(offsetof(Values, truePeak) == 88, "Layout must match PlayerStatus.kt");
+    static_assert(offsetof(Values, sources) == 96, "Layout must match PlayerStatus.kt");
+    static_assert(offsetof(Source, peak) == 24, "Layout must match PlayerStatus.kt");
+    static_assert(sizeof(Source) == 40, "Layout must match PlayerStatus.kt");
+
+    static constexpr size_t kNumWords = sizeof(Values) / sizeof(uint64_t);
+
+    // Java reads the words as plain memory.
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t)
+                  && std::atomic<uint64_t>::is_always_lock_free, "Words must be plain memory");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t)
+                  && std::atomic<uint32_t>::is_always_lock_free, "Sequence must be plain memory");
+
+    struct Block {
+        std::atomic<uint32_t> sequence{0};
+        uint32_t version;
+        uint32_t size;
+        uint32_t maxSources;
+        std::atomic<uint64_t> words[kNumWords];
+    };
+    static_assert(offsetof(Block, words) == kValuesOffset, "Layout must match PlayerStatus.kt");
+
+    Block mBlock;
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_PLAYERSTATUS_H_
@@ -16,12 +16,13 @@
 
 #include "SampleBuffer.h"
 
+#include <algorithm>
+#include <vector>
+
 // Resampler Includes
 #include <resampler/MultiChannelResampler.h>
 #include <android/log.h>
 
-#include "wav/WavStreamReader.h"
-
 using namespace RESAMPLER_OUTER_NAMESPACE::resampler;
 
 namespace iolib {
@@ -44,21 +45,42 @@ float* SampleBuffer::getPointerToFrame(int32_t frameOffset) const {
     return mSampleData + (frameOffset * mAudioProperties.channelCount);
 }
 
-void SampleBuffer::loadSampleData(parselib::WavStreamReader* reader) {
-    __android_log_print(ANDROID_LOG_ERROR, "SampleBuffer", "loadSampleData called");
-//    __android_log_print(ANDROID_LOG_ERROR, "SampleBuffer",
-//                        "%s", reinterpret_cast<const char *>(reader->getNumChannels()));
-//    __android_log_print(ANDROID_LOG_ERROR, "SampleBuffer",
-//                        "%s", reinterpret_cast<const char *>(reader->getSampleRate()));
+void SampleBuffer::loadSampleData(parselib::AudioDecoder* reader) {
     mAudioProperties.channelCount = reader->getNumChannels();
     mAudioProperties.sampleRate = reader->getSampleRate();
+    mAudioProperties.channelMask = reader->getChannelMask();
 
     reader->positionToAudio();
 
-    mNumSamples = reader->getNumSampleFrames() * reader->getNumChannels();
+    // The samples are held in memory, so they are far fewer than 2^31.
+    int32_t channelCount = mAudioProperties.channelCount;
+    auto numFrames = static_cast<int32_t>(reader->getNumSampleFrames());
+    if (numFrames > 0) {
+        mNumSamples = numFrames * channelCount;
+        mSampleData = new float[mNumSamples];
+        mNumSamples = std::max(0, reader->getDataFloat(mSampleData, numFrames)) * channelCount;
+        return;
+    }
+
+    // The stream does not give its length, so decode until the end.
+    static constexpr int32_t kFramesPerRead = 4096;
+    std::vector<float> samples;
+    int32_t framesRead;
+    do {
+        size_t offset = samples.size();
+        samples.resize(offset + kFramesPerRead * channelCount);
+        framesRead = std::max(0, reader->getDataFloat(samples.data() + offset, kFramesPerRead));
+        samples.resize(offset + framesRead * channelCount);
+    } while (framesRead == kFramesPerRead);
+    mNumSamples = static_cast<int32_t>(samples.size());
     mSampleData = new float[mNumSamples];
+    std::copy(samples.begin(), samples.end(), mSampleData);
+}
 
-    reader->getDataFloat(mSampleData, reader->getNumSampleFrames());
+void SampleBuffer::buildWaveformOverview() {
+    int32_t channelCount = mAudioProperties.channelCount;
+    mWaveformOverview.build(mSampleData, channelCount > 0 ? mNumSamples / channelCount : 0,
+                            channelCount);
 }
 
 void SampleBuffer::unloadSampleData() {
@@ -67,6 +89,7 @@ void SampleBuffer::unloadSampleData() {
         mSampleData = nullptr;
     }
     mNumSamples = 0;
+    mWaveformOverview.clear();
 }
 
 class ResampleBlock {
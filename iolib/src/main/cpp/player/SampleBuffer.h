@@ -17,7 +17,9 @@
 #ifndef _PLAYER_SAMPLEBUFFER_
 #define _PLAYER_SAMPLEBUFFER_
 
-#include <wav/WavStreamReader.h>
+#include <decoder/AudioDecoder.h>
+
+#include "../analysis/WaveformOverview.h"
 
 namespace iolib {
 
@@ -27,6 +29,8 @@ namespace iolib {
 struct AudioProperties {
     int32_t channelCount;
     int32_t sampleRate;
+    // WAVE_FORMAT_EXTENSIBLE speaker positions of the channels, 0 if the source has none.
+    uint32_t channelMask;
 };
 
 class SampleBuffer {
@@ -35,7 +39,7 @@ public:
     ~SampleBuffer() { unloadSampleData(); }
 
     // Data load/unload
-    void loadSampleData(parselib::WavStreamReader* reader);
+    void loadSampleData(parselib::AudioDecoder* reader);
     void unloadSampleData();
 
     void resampleData(int sampleRate);
@@ -50,11 +54,22 @@ public:
 
     int64_t getTotalSamples();
 
+    /**
+     * Measure the min, max and RMS of the samples at a few zoom levels, for drawing the
+     * waveform. The bins are in frames, so call it once the samples are at their final rate,
+     * after resampleData(). Takes a few milliseconds for a song.
+     */
+    void buildWaveformOverview();
+    // Empty until buildWaveformOverview() is called.
+    const WaveformOverview &getWaveformOverview() const { return mWaveformOverview; }
+
 protected:
     AudioProperties mAudioProperties;
 
     float*  mSampleData;
     int32_t mNumSamples;
+
+    WaveformOverview mWaveformOverview;
 };
 
 }
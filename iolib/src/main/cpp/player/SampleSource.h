@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <android/log.h>
 
+#include "../analysis/LevelMeter.h"
 #include "DataSource.h"
 
 #include "SampleBuffer.h"
@@ -40,8 +41,10 @@ public:
     static constexpr float PAN_CENTER = 0.0f;
 
     SampleSource(SampleBuffer *sampleBuffer, float pan)
-     : mSampleBuffer(sampleBuffer), mCurSampleIndex(0), mIsPlaying(false), mGain(1.0f) {
+     : mSampleBuffer(sampleBuffer), mCurSampleIndex(0), mIsPlaying(false), mGain(1.0f),
+       mIsMetering(false) {
         setPan(pan);
+        mLevels.reset();
     }
     virtual ~SampleSource() {}
 
@@ -94,6 +97,25 @@ public:
                             "seekToFrame: Successfully set to frame %d", frameOffset);
     }
 
+    /**
+     * Measure the audio that mixAudio() adds to the output, per output channel, while it
+     * mixes it. Only call these from the thread that mixes.
+     */
+    void setMetering(bool enabled) { mIsMetering = enabled; }
+    const LevelAccumulator &getLevels() const { return mLevels; }
+    void resetLevels() { mLevels.reset(); }
+
+    // The next frame to be mixed. Only exact when called from the thread that mixes.
+    int64_t getPositionInFrames() const {
+        int32_t channelCount = mSampleBuffer->getProperties().channelCount;
+        return channelCount > 0 ? mCurSampleIndex / channelCount : 0;
+    }
+
+    int64_t getNumFrames() const {
+        return mSampleBuffer->getProperties().channelCount > 0
+               ? mSampleBuffer->getFrameCount() : 0;
+    }
+
     int64_t getCurrentPositionInMillis(int32_t sampleRate, int32_t channelCount) const {
         if (!mSampleBuffer) {
             __android_log_print(ANDROID_LOG_ERROR, "SampleSource", "getCurrentPositionInMillis: Sample buffer is null");
@@ -159,6 +181,9 @@ protected:
     // Overall gain
     float mGain;
 
+    bool mIsMetering;
+    LevelAccumulator mLevels;
+
 private:
     void calcGainFactors() {
         // useful panning information: http://www.cs.cmu.edu/~music/icm-online/readings/panlaws/
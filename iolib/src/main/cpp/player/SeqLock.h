@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_SEQLOCK_H_
+#define _PLAYER_SEQLOCK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace iolib {
+
+/**
+ * Publishes a small value from one writer thread to any number of reader threads.
+ *
+ * The writer never waits, so it may be an audio callback. A reader copies the value and
+ * tries again if the writer changed it in the meantime, which is rare when the value is
+ * written a few times per second.
+ *
+ * The value is copied through atomic words so that a torn read is never undefined behavior,
+ * it is only detected and discarded.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a plain value");
+
+public:
+    SeqLock() {
+        store(T{});
+    }
+
+    // Only call from one thread at a time.
+    void store(const T &value) {
+        uint64_t words[kNumWords] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+        // An odd sequence tells the readers that a write is in progress.
+        mSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kNumWords; i++) {
+            mWords[i].store(words[i], std::memory_order_relaxed);
+        }
+        mSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // May be called from any thread.
+    T load() const {
+        uint64_t words[kNumWords];
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = mSequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kNumWords; i++) {
+                words[i] = mWords[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = mSequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t kNumWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> mSequence{0};
+    std::atomic<uint64_t> mWords[kNumWords];
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_SEQLOCK_H_
@@ -35,8 +35,6 @@ using namespace parselib;
 
 namespace iolib {
 
-constexpr int32_t kBufferSizeInBursts = 2; // Use 2 bursts as the buffer size (double buffer)
-
 SimpleMultiPlayer::SimpleMultiPlayer()
   : mChannelCount(0), mOutputReset(false), mSampleRate(0), mNumSampleBuffers(0)
 {}
@@ -68,17 +66,23 @@ DataCallbackResult SimpleMultiPlayer::MyDataCallback::onAudioReady(AudioStream *
         return DataCallbackResult::Continue;
     }
 
+    mParent->mTelemetry.onBeginCallback(*oboeStream);
+
     memset(audioData, 0, static_cast<size_t>(numFrames) * static_cast<size_t>
             (mParent->mChannelCount) * sizeof(float));
 
     // OneShotSampleSource* sources = mSampleSources.get();
+    int32_t activeVoices = 0;
     for(int32_t index = 0; index < mParent->mNumSampleBuffers; index++) {
         if (mParent->mSampleSources[index]->isPlaying()) {
             mParent->mSampleSources[index]->mixAudio((float*)audioData, mParent->mChannelCount,
                                                      numFrames);
+            activeVoices++;
         }
     }
 
+    mParent->mBufferSizeTuner.onAudioReady(*oboeStream, numFrames);
+    mParent->mTelemetry.onEndCallback(*oboeStream, numFrames, activeVoices);
     return DataCallbackResult::Continue;
 }
 
@@ -162,17 +166,8 @@ bool SimpleMultiPlayer::openStream() {
         return false;
     }
 
-    // Reduce stream latency by setting the buffer size to a multiple of the burst size
-    // Note: this will fail with ErrorUnimplemented if we are using a callback with OpenSL ES
-    // See oboe::AudioStreamBuffered::setBufferSizeInFrames
-    result = mAudioStream->setBufferSizeInFrames(
-            mAudioStream->getFramesPerBurst() * kBufferSizeInBursts);
-    if (result != Result::OK) {
-        __android_log_print(
-                ANDROID_LOG_WARN,
-                TAG,
-                "setBufferSizeInFrames failed. Error: %s", convertToText(result));
-    }
+    // Start with the lowest latency and let the tuner grow the buffer if it glitches.
+    mBufferSizeTuner.start(*mAudioStream);
 
     mSampleRate = mAudioStream->getSampleRate();
 
@@ -218,6 +213,7 @@ void SimpleMultiPlayer::setupAudioStream(int32_t channelCount) {
 void SimpleMultiPlayer::teardownAudioStream() {
     __android_log_print(ANDROID_LOG_INFO, TAG, "teardownAudioStream()");
     this->firstFrameHit = false;
+    mBufferSizeTuner.stop();
     // tear down the player
     if (mAudioStream) {
         mAudioStream->stop();
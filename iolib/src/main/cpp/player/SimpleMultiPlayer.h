@@ -21,8 +21,10 @@
 
 #include <oboe/Oboe.h>
 
+#include "BufferSizeTuner.h"
 #include "OneShotSampleSource.h"
 #include "SampleBuffer.h"
+#include "StreamTelemetry.h"
 
 namespace iolib {
 
@@ -79,6 +81,21 @@ public:
     int64_t presentationTime = 0;
     int getAudioSessionId();
 
+    // Adaptive buffer sizing, see BufferSizeTuner.
+    // The limits are used the next time the stream is opened.
+    void setBufferTuningLimits(int32_t minimumBursts, int32_t maximumBursts,
+                               int32_t quietPeriodMillis) {
+        mBufferSizeTuner.setLimits(minimumBursts, maximumBursts, quietPeriodMillis);
+    }
+    int32_t getBufferSizeInFrames() { return mBufferSizeTuner.getBufferSizeInFrames(); }
+    int32_t getXRunCount() { return mBufferSizeTuner.getXRunCount(); }
+    int32_t getBufferGrowCount() { return mBufferSizeTuner.getGrowCount(); }
+    int32_t getBufferShrinkCount() { return mBufferSizeTuner.getShrinkCount(); }
+
+    // Callback timing and glitch statistics, see StreamTelemetry.
+    void getTelemetry(StreamTelemetry::Snapshot &snapshot) { mTelemetry.getSnapshot(snapshot); }
+    void resetTelemetry() { mTelemetry.requestReset(); }
+
 private:
     class MyDataCallback : public oboe::AudioStreamDataCallback {
     public:
@@ -123,6 +140,8 @@ private:
     std::shared_ptr<MyDataCallback> mDataCallback;
     std::shared_ptr<MyErrorCallback> mErrorCallback;
     bool mIsStreamPaused;
+    BufferSizeTuner mBufferSizeTuner;
+    StreamTelemetry mTelemetry;
 };
 
 }
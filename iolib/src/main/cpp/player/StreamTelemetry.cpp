@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+#include "StreamTelemetry.h"
+#include "../../../../../oboemusicplayer/oboe/src/common/AudioClock.h"
+
+using namespace oboe;
+
+namespace iolib {
+
+int32_t TelemetryHistogram::getBucketIndex(int64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<int32_t>(std::max<int64_t>(value, 0));
+    }
+    int32_t exponent = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+    if (exponent > kMaxExponent) {
+        return kNumBuckets - 1;
+    }
+    int32_t shift = exponent - kSubBucketBits;
+    int32_t subBucket = static_cast<int32_t>(value >> shift) - kSubBuckets;
+    return (shift + 1) * kSubBuckets + subBucket;
+}
+
+int64_t TelemetryHistogram::getBucketLowerValue(int32_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int32_t shift = (index / kSubBuckets) - 1;
+    int32_t subBucket = index % kSubBuckets;
+    return static_cast<int64_t>(kSubBuckets + subBucket) << shift;
+}
+
+int64_t TelemetryHistogram::getBucketUpperValue(int32_t index) {
+    if (index < kSubBuckets) {
+        return index;
+    }
+    int32_t shift = (index / kSubBuckets) - 1;
+    return getBucketLowerValue(index) + (static_cast<int64_t>(1) << shift) - 1;
+}
+
+int64_t TelemetryHistogram::getValueAtPercentile(const Counts &counts, double percentile) {
+    uint64_t total = 0;
+    for (uint32_t count : counts) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    // Rank of the requested sample, starting at 1.
+    uint64_t rank = static_cast<uint64_t>(std::clamp(percentile, 0.0, 100.0) * total / 100.0 + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, total);
+    uint64_t seen = 0;
+    for (int32_t i = 0; i < kNumBuckets; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return getBucketUpperValue(i);
+        }
+    }
+    return getBucketUpperValue(kNumBuckets - 1);
+}
+
+void TelemetryHistogram::copyCounts(Counts &counts) const {
+    for (int32_t i = 0; i < kNumBuckets; i++) {
+        counts[i] = mCounts[i].load(std::memory_order_relaxed);
+    }
+}
+
+void TelemetryHistogram::clear() {
+    for (auto &count : mCounts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void StreamTelemetry::onBeginCallback(AudioStream &stream) {
+    if (mResetRequested.exchange(false)) {
+        reset();
+    }
+
+    mBeginNanos = AudioClock::getNanoseconds();
+    if (mPreviousBeginNanos > 0 && mPreviousPeriodNanos > 0) {
+        // How far this callback is from where it would be with perfectly regular callbacks.
+        int64_t jitterNanos = std::abs((mBeginNanos - mPreviousBeginNanos) - mPreviousPeriodNanos);
+        mJitterHistogram.record(jitterNanos);
+        if (jitterNanos > mMaxJitterNanos.load(std::memory_order_relaxed)) {
+            mMaxJitterNanos.store(jitterNanos, std::memory_order_relaxed);
+        }
+    }
+    mPreviousBeginNanos = mBeginNanos;
+    (void) stream;
+}
+
+void StreamTelemetry::onEndCallback(AudioStream &stream, int32_t numFrames, int32_t activeVoices) {
+    int64_t durationNanos = AudioClock::getNanoseconds() - mBeginNanos;
+    mDurationHistogram.record(durationNanos);
+    if (durationNanos > mMaxDurationNanos.load(std::memory_order_relaxed)) {
+        mMaxDurationNanos.store(durationNanos, std::memory_order_relaxed);
+    }
+
+    int32_t sampleRate = stream.getSampleRate();
+    mPreviousPeriodNanos = (sampleRate > 0)
+            ? static_cast<int64_t>(numFrames) * kNanosPerSecond / sampleRate
+            : 0;
+
+    mFramesRendered.store(mFramesRendered.load(std::memory_order_relaxed) + numFrames,
+                          std::memory_order_relaxed);
+    if (activeVoices > mMaxActiveVoices.load(std::memory_order_relaxed)) {
+        mMaxActiveVoices.store(activeVoices, std::memory_order_relaxed);
+    }
+    auto xRunCountResult = stream.getXRunCount();
+    if (xRunCountResult) {
+        mXRunCount.store(xRunCountResult.value(), std::memory_order_relaxed);
+    }
+    // Published last so a reader that sees the count also sees the counters above.
+    mCallbackCount.store(mCallbackCount.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_release);
+}
+
+void StreamTelemetry::reset() {
+    mDurationHistogram.clear();
+    mJitterHistogram.clear();
+    mFramesRendered.store(0, std::memory_order_relaxed);
+    mMaxActiveVoices.store(0, std::memory_order_relaxed);
+    mMaxDurationNanos.store(0, std::memory_order_relaxed);
+    mMaxJitterNanos.store(0, std::memory_order_relaxed);
+    mCallbackCount.store(0, std::memory_order_release);
+    // The xrun count comes from the stream so it is not cleared.
+    mPreviousBeginNanos = 0;
+    mPreviousPeriodNanos = 0;
+}
+
+void StreamTelemetry::getSnapshot(Snapshot &snapshot) const {
+    snapshot.callbackCount = mCallbackCount.load(std::memory_order_acquire);
+    snapshot.framesRendered = mFramesRendered.load(std::memory_order_relaxed);
+    snapshot.xRunCount = mXRunCount.load(std::memory_order_relaxed);
+    snapshot.maxActiveVoices = mMaxActiveVoices.load(std::memory_order_relaxed);
+    snapshot.maxDurationNanos = mMaxDurationNanos.load(std::memory_order_relaxed);
+    snapshot.maxJitterNanos = mMaxJitterNanos.load(std::memory_order_relaxed);
+    mDurationHistogram.copyCounts(snapshot.durationCounts);
+    mJitterHistogram.copyCounts(snapshot.jitterCounts);
+}
+
+static void appendHistogramJson(std::string &json, const char *name,
+                                const TelemetryHistogram::Counts &counts, int64_t maxNanos) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer),
+             "\"%s\":{\"p50\":%" PRId64 ",\"p90\":%" PRId64 ",\"p99\":%" PRId64
+             ",\"p999\":%" PRId64 ",\"max\":%" PRId64 ",\"buckets\":[",
+             name,
+             TelemetryHistogram::getValueAtPercentile(counts, 50.0),
+             TelemetryHistogram::getValueAtPercentile(counts, 90.0),
+             TelemetryHistogram::getValueAtPercentile(counts, 99.0),
+             TelemetryHistogram::getValueAtPercentile(counts, 99.9),
+             maxNanos);
+    json += buffer;
+    bool first = true;
+    for (int32_t i = 0; i < TelemetryHistogram::kNumBuckets; i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        snprintf(buffer, sizeof(buffer), "%s[%" PRId64 ",%u]",
+                 first ? "" : ",", TelemetryHistogram::getBucketLowerValue(i), counts[i]);
+        json += buffer;
+        first = false;
+    }
+    json += "]}";
+}
+
+std::string StreamTelemetry::toJson(const Snapshot &snapshot) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "{\"callbacks\":%" PRId64 ",\"frames\":%" PRId64
+             ",\"xruns\":%d,\"maxActiveVoices\":%d,",
+             snapshot.callbackCount, snapshot.framesRendered,
+             snapshot.xRunCount, snapshot.maxActiveVoices);
+    std::string json(buffer);
+    appendHistogramJson(json, "durationNanos", snapshot.durationCounts,
+                        snapshot.maxDurationNanos);
+    json += ",";
+    appendHistogramJson(json, "jitterNanos", snapshot.jitterCounts, snapshot.maxJitterNanos);
+    json += "}";
+    return json;
+}
+
+} // namespace iolib
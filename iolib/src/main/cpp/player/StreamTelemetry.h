@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_STREAMTELEMETRY_H_
+#define _PLAYER_STREAMTELEMETRY_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <oboe/Oboe.h>
+
+namespace iolib {
+
+/**
+ * A histogram with log-linear buckets, in the style of HdrHistogram.
+ * Each power of two range is split into kSubBuckets linear buckets, so the
+ * relative error of any recorded value is less than 1 / kSubBuckets.
+ *
+ * record() may be called by one writer thread. It does not block or allocate.
+ * Other threads may read the counts at any time. The counts are read individually
+ * so a snapshot taken while the writer is active may be off by a few events.
+ */
+class TelemetryHistogram {
+public:
+    static constexpr int32_t kSubBucketBits = 4;
+    static constexpr int32_t kSubBuckets = 1 << kSubBucketBits;
+    // Values of 2^(kMaxExponent + 1) and above are counted in the last bucket.
+    static constexpr int32_t kMaxExponent = 33; // about 8.6 seconds in nanoseconds
+    static constexpr int32_t kNumBuckets = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets;
+
+    using Counts = std::array<uint32_t, kNumBuckets>;
+
+    static int32_t getBucketIndex(int64_t value);
+
+    /**
+     * @return the smallest value that is recorded in the bucket
+     */
+    static int64_t getBucketLowerValue(int32_t index);
+
+    /**
+     * @return the largest value that is recorded in the bucket
+     */
+    static int64_t getBucketUpperValue(int32_t index);
+
+    /**
+     * @param counts from copyCounts()
+     * @param percentile between 0.0 and 100.0
+     * @return upper value of the bucket that contains the percentile, or 0 if there are no counts
+     */
+    static int64_t getValueAtPercentile(const Counts &counts, double percentile);
+
+    void record(int64_t value) {
+        std::atomic<uint32_t> &bucket = mCounts[getBucketIndex(value)];
+        // Only one thread writes so a load and store is enough.
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void copyCounts(Counts &counts) const;
+
+    void clear();
+
+private:
+    std::array<std::atomic<uint32_t>, kNumBuckets> mCounts{};
+};
+
+/**
+ * Timing and glitch statistics for the data callback of one stream.
+ *
+ * onBeginCallback() and onEndCallback() are called from the data callback and are real-time safe.
+ * getSnapshot(), toJson() and requestReset() may be called from any other thread.
+ */
+class StreamTelemetry {
+public:
+    struct Snapshot {
+        int64_t callbackCount = 0;
+        int64_t framesRendered = 0;
+        int32_t xRunCount = 0;
+        int32_t maxActiveVoices = 0;
+        int64_t maxDurationNanos = 0;
+        int64_t maxJitterNanos = 0;
+        TelemetryHistogram::Counts durationCounts{}; // callback duration in nanoseconds
+        TelemetryHistogram::Counts jitterCounts{}; // deviation from the nominal period in nanos
+    };
+
+    void onBeginCallback(oboe::AudioStream &stream);
+
+    /**
+     * @param numFrames frames rendered by this callback
+     * @param activeVoices number of sources that were mixed
+     */
+    void onEndCallback(oboe::AudioStream &stream, int32_t numFrames, int32_t activeVoices);
+
+    /**
+     * Clear the statistics. This is done by the callback thread at the next callback.
+     */
+    void requestReset() { mResetRequested = true; }
+
+    void getSnapshot(Snapshot &snapshot) const;
+
+    /**
+     * Format a snapshot as a JSON object. The histograms are included as lists of
+     * [bucketLowerNanos, count] pairs for the buckets that are not empty,
+     * so that they can be merged across devices.
+     */
+    static std::string toJson(const Snapshot &snapshot);
+
+private:
+    void reset();
+
+    TelemetryHistogram   mDurationHistogram;
+    TelemetryHistogram   mJitterHistogram;
+
+    std::atomic<bool>    mResetRequested{false};
+    std::atomic<int64_t> mCallbackCount{0};
+    std::atomic<int64_t> mFramesRendered{0};
+    std::atomic<int32_t> mXRunCount{0};
+    std::atomic<int32_t> mMaxActiveVoices{0};
+    std::atomic<int64_t> mMaxDurationNanos{0};
+    std::atomic<int64_t> mMaxJitterNanos{0};
+
+    // Only used by the callback thread.
+    int64_t mBeginNanos = 0;
+    int64_t mPreviousBeginNanos = 0;
+    int64_t mPreviousPeriodNanos = 0;
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_STREAMTELEMETRY_H_
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "TransportClock.h"
+#include "../../../../../oboemusicplayer/oboe/src/common/AudioClock.h"
+
+using namespace oboe;
+
+namespace iolib {
+
+// Fraction of the timestamp jitter that moves the clock.
+static constexpr double kTimeSmoothing = 0.125;
+// Fraction of each rate measurement that is applied.
+static constexpr double kRateSmoothing = 0.25;
+
+void TransportClock::reset(int32_t sampleRate) {
+    mSampleRate = sampleRate;
+    mNextUpdateNanos = 0;
+    mCurrent = Anchor{0, 0, static_cast<double>(sampleRate), false};
+    mRateStart = FrameTimestamp{0, 0};
+    mAnchor.store(Anchor{0, 0, 0.0, false});
+}
+
+void TransportClock::update(AudioStream &stream) {
+    int64_t nowNanos = AudioClock::getNanoseconds();
+    if (nowNanos < mNextUpdateNanos) {
+        return;
+    }
+    mNextUpdateNanos = nowNanos + kUpdatePeriodMillis * kNanosPerMillisecond;
+
+    ResultWithValue<FrameTimestamp> result = stream.getTimestamp(CLOCK_MONOTONIC);
+    if (!result) {
+        return;
+    }
+    FrameTimestamp timestamp = result.value();
+
+    if (mCurrent.valid) {
+        auto framesSinceAnchor = static_cast<double>(timestamp.position - mCurrent.position);
+        int64_t predictedNanos = mCurrent.timeNanos + static_cast<int64_t>(
+                framesSinceAnchor * kNanosPerSecond / mCurrent.framesPerSecond);
+        int64_t errorNanos = timestamp.timestamp - predictedNanos;
+        if (std::abs(errorNanos) <= kMaxJitterMillis * kNanosPerMillisecond) {
+            mCurrent.position = timestamp.position;
+            mCurrent.timeNanos = predictedNanos + static_cast<int64_t>(errorNanos * kTimeSmoothing);
+
+            int64_t windowNanos = timestamp.timestamp - mRateStart.timestamp;
+            if (windowNanos >= kRateWindowMillis * kNanosPerMillisecond) {
+                double measuredRate = static_cast<double>(timestamp.position - mRateStart.position)
+                        * kNanosPerSecond / windowNanos;
+                double maxDeviation = mSampleRate * kMaxDriftPpm * 1.0e-6;
+                measuredRate = std::max(mSampleRate - maxDeviation,
+                                        std::min(measuredRate, mSampleRate + maxDeviation));
+                mCurrent.framesPerSecond += (measuredRate - mCurrent.framesPerSecond)
+                        * kRateSmoothing;
+                mRateStart = timestamp;
+            }
+            mAnchor.store(mCurrent);
+            return;
+        }
+    }
+
+    // The first timestamp, or the stream jumped, for example after it was paused.
+    // Keep the measured rate, the clock has not changed.
+    mCurrent.position = timestamp.position;
+    mCurrent.timeNanos = timestamp.timestamp;
+    mCurrent.valid = true;
+    mRateStart = timestamp;
+    mAnchor.store(mCurrent);
+}
+
+bool TransportClock::getTimeNanosAtPosition(int64_t position, int64_t *timeNanos) const {
+    Anchor anchor = mAnchor.load();
+    if (!anchor.valid) {
+        return false;
+    }
+    auto framesSinceAnchor = static_cast<double>(position - anchor.position);
+    *timeNanos = anchor.timeNanos + static_cast<int64_t>(
+            std::llround(framesSinceAnchor * kNanosPerSecond / anchor.framesPerSecond));
+    return true;
+}
+
+bool TransportClock::getPositionAtTimeNanos(int64_t timeNanos, int64_t *position) const {
+    Anchor anchor = mAnchor.load();
+    if (!anchor.valid) {
+        return false;
+    }
+    auto nanosSinceAnchor = static_cast<double>(timeNanos - anchor.timeNanos);
+    *position = anchor.position + static_cast<int64_t>(
+            std::llround(nanosSinceAnchor * anchor.framesPerSecond / kNanosPerSecond));
+    return true;
+}
+
+int64_t TransportClock::getCurrentPosition() const {
+    int64_t position = -1;
+    if (!getPositionAtTimeNanos(AudioClock::getNanoseconds(), &position)) {
+        return -1;
+    }
+    return std::max<int64_t>(position, 0);
+}
+
+} // namespace iolib
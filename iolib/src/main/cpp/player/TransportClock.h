@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_TRANSPORTCLOCK_H_
+#define _PLAYER_TRANSPORTCLOCK_H_
+
+#include <cstdint>
+
+#include <oboe/Oboe.h>
+
+#include "SeqLock.h"
+
+namespace iolib {
+
+/**
+ * Maps the frame positions of a stream to CLOCK_MONOTONIC nanoseconds, from
+ * AudioStream::getTimestamp(). For an output stream the time is when the frame is heard,
+ * for an input stream it is when the frame was captured.
+ *
+ * The thread that owns the stream calls update(), from the data callback or from the
+ * read loop. It smooths the jitter of the timestamps and measures the actual frame rate,
+ * which differs from the nominal rate by the drift of the audio clock. The result is
+ * published through a SeqLock so any thread can convert positions and times without
+ * locking and without calling into the stream.
+ */
+class TransportClock {
+public:
+    static constexpr int64_t kUpdatePeriodMillis = 100;
+    // Long enough for the timestamp jitter to be small compared to the drift.
+    static constexpr int64_t kRateWindowMillis = 2000;
+    // Timestamps further off than this are taken as a discontinuity, not jitter.
+    static constexpr int64_t kMaxJitterMillis = 5;
+    static constexpr double  kMaxDriftPpm = 1000.0;
+
+    /**
+     * Forget the old stream. The clock is invalid until the new stream has a timestamp.
+     * Do not call while update() may be running.
+     */
+    void reset(int32_t sampleRate);
+
+    /**
+     * Take a timestamp from the stream if kUpdatePeriodMillis has passed since the last one.
+     * Only call from the thread that reads or writes the stream.
+     */
+    void update(oboe::AudioStream &stream);
+
+    // The functions below may be called from any thread.
+
+    bool isValid() const { return mAnchor.load().valid; }
+
+    /**
+     * @return false if there is no timestamp yet
+     */
+    bool getTimeNanosAtPosition(int64_t position, int64_t *timeNanos) const;
+    bool getPositionAtTimeNanos(int64_t timeNanos, int64_t *position) const;
+
+    /**
+     * @return the frame being heard or captured now, or -1 if there is no timestamp yet
+     */
+    int64_t getCurrentPosition() const;
+
+    // Measured frames per second, or 0 if there is no timestamp yet.
+    double getFrameRate() const { return mAnchor.load().framesPerSecond; }
+
+private:
+    struct Anchor {
+        int64_t position;
+        int64_t timeNanos;
+        double  framesPerSecond;
+        bool    valid;
+    };
+
+    SeqLock<Anchor> mAnchor;
+
+    // Only used by update().
+    int32_t mSampleRate = 0;
+    int64_t mNextUpdateNanos = 0;
+    Anchor  mCurrent{};
+    oboe::FrameTimestamp mRateStart{};
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_TRANSPORTCLOCK_H_
@@ -22,46 +22,95 @@ using namespace oboe;
 using namespace parselib;
 
 namespace iolib{
-    constexpr int32_t kBufferSizeInBursts = 2; // Use 2 bursts as the buffer size (double buffer)
     VocalMusicPlayer::VocalMusicPlayer() :
     mChannelCount(0),
     mOutputReset(false),
     mSampleRate(0),
-    mNumSampleBuffers(0),
-    mMicRingBuffer(2048, 2), // example: stereo, capacity 2048 frames
-    mRunning(false)
+    mNumSampleBuffers(0)
     {}
 
+    bool VocalMusicPlayer::MicDuplexStream::prepare() {
+        mFramesMixed = 0;
+        if (!mInput.open(*getInputStream(), *getOutputStream())) {
+            return false;
+        }
+        mEffects.configure(getOutputStream()->getChannelCount(),
+                           getOutputStream()->getSampleRate());
+        mPitchTracker.configure(getOutputStream()->getChannelCount(),
+                                getOutputStream()->getSampleRate());
+        return true;
+    }
+
+    ResultWithValue<int32_t> VocalMusicPlayer::MicDuplexStream::readInput(int32_t /*numFrames*/) {
+        // Take everything the input has captured. The drift compensation holds the backlog
+        // at a constant level, whichever clock runs faster.
+        return mInput.pull(*getInputStream());
+    }
+
+    oboe::DataCallbackResult VocalMusicPlayer::MicDuplexStream::onBothStreamsReady(
+            const void * /*inputData*/,
+            int /*numInputFrames*/,
+            void *outputData,
+            int numOutputFrames) {
+        // The input was already passed to mInput by readInput(). The frames of this
+        // callback have not been counted as written yet.
+        mFramesMixed = mInput.mix(static_cast<float *>(outputData), numOutputFrames, &mEffects,
+                                  &mPitchTracker, getOutputStream()->getFramesWritten());
+        return DataCallbackResult::Continue;
+    }
+
     oboe::DataCallbackResult VocalMusicPlayer::MyDataCallback::onAudioReady(
             oboe::AudioStream *oboeStream,
             void *audioData,
             int32_t numFrames) {
+        mParent->mTelemetry.onBeginCallback(*oboeStream);
+        mParent->mPerformanceHint.onBeginCallback(*oboeStream);
+
         float *out = static_cast<float*>(audioData);
-        memset(out, 0, numFrames * mParent->mChannelCount * sizeof(float));
+        int32_t activeVoices = 0;
+
+        // The duplex stream clears the output and then adds the microphone, once the input
+        // has settled. Until then it only drains the input. The sources are mixed on top.
+        if (mParent->mMicActive.load(std::memory_order_acquire)) {
+            MicDuplexStream &duplexStream = mParent->mDuplexStream;
+            duplexStream.clearFramesMixed();
+            if (duplexStream.onAudioReady(oboeStream, audioData, numFrames)
+                    == DataCallbackResult::Stop) {
+                // The input failed and has been stopped. Keep playing the backing track.
+                __android_log_print(ANDROID_LOG_WARN, TAG, "microphone stopped");
+                mParent->mMicActive.store(false, std::memory_order_release);
+            }
+            if (duplexStream.getFramesMixed() > 0) {
+                activeVoices++; // the microphone
+            }
+        } else {
+            memset(out, 0, numFrames * mParent->mChannelCount * sizeof(float));
+        }
 
         // Mix sample sources
         for (int32_t i = 0; i < mParent->mNumSampleBuffers; i++) {
             if (mParent->mSampleSources[i]->isPlaying()) {
                 mParent->mSampleSources[i]->mixAudio(out, mParent->mChannelCount, numFrames);
+                activeVoices++;
             }
         }
 
-        std::vector<float> micData(numFrames * mParent->mChannelCount, 0.0f);
-        int framesRead = mParent->mMicRingBuffer.read(micData.data(), numFrames);
-        for (int i = 0; i < framesRead * mParent->mChannelCount; i++) {
-            out[i] += micData[i];
-        }
-
+        mParent->mPerformanceHint.onEndCallback(numFrames, activeVoices);
+        mParent->mBufferSizeTuner.onAudioReady(*oboeStream, numFrames);
+        mParent->mTelemetry.onEndCallback(*oboeStream, numFrames, activeVoices);
         return DataCallbackResult::Continue;
     }
 
     bool VocalMusicPlayer::openOutputStream() {
+        // The hint session belongs to the old callback thread.
+        mPerformanceHint.close();
         mDataCallback = std::make_shared<MyDataCallback>(this);
         mErrorCallback = std::make_shared<MyErrorCallback>(this);
 
         AudioStreamBuilder builder;
         builder.setDirection(oboe::Direction::Output)
                 ->setChannelCount(mChannelCount)
+                ->setFormat(oboe::AudioFormat::Float) // the mix is done in float
                 ->setDataCallback(mDataCallback)
                 ->setErrorCallback(mErrorCallback)
                 ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
@@ -73,18 +122,27 @@ namespace iolib{
                     return false;
         }
 
+        // Start with the lowest latency and let the tuner grow the buffer if it glitches.
+        mBufferSizeTuner.start(*mOutputStream);
+
         mSampleRate = mOutputStream->getSampleRate();
         return true;
     }
 
     bool VocalMusicPlayer::openInputStream() {
+        // The input is read from the output callback so it has no callback of its own.
+        // It must match the output format, channel count and rate so it can be added
+        // to the output directly, so let Oboe convert if the device cannot.
         AudioStreamBuilder builder;
         builder.setDirection(oboe::Direction::Input)
                 ->setChannelCount(mChannelCount)
                 ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
                 ->setSharingMode(oboe::SharingMode::Shared)
-                ->setSampleRate(mSampleRate) // match output if possible
-                ->setFormat(oboe::AudioFormat::Float);
+                ->setSampleRate(mSampleRate)
+                ->setFormat(oboe::AudioFormat::Float)
+                ->setFormatConversionAllowed(true)
+                ->setChannelConversionAllowed(true)
+                ->setSampleRateConversionQuality(SampleRateConversionQuality::Medium);
         auto result = builder.openStream(mInputStream);
         if (result != oboe::Result::OK) {
                     __android_log_print(ANDROID_LOG_ERROR, TAG, "openInputStream failed");
@@ -102,8 +160,14 @@ namespace iolib{
     void VocalMusicPlayer::MyErrorCallback::onErrorAfterClose(oboe::AudioStream *oboeStream,
                                                               oboe::Result error) {
         mParent->resetAll();
-        if (mParent->openStream() && mParent->startStream()) {
-            mParent->mOutputReset = true;
+        // The microphone is read by the output callback, so it is reopened with the output
+        // rather than left running on the old device.
+        mParent->closeInputStream();
+        if (mParent->openOutputStream()) {
+            mParent->openInputStream();
+            if (mParent->startStream()) {
+                mParent->mOutputReset = true;
+            }
         }
     }
 
@@ -149,49 +213,6 @@ namespace iolib{
     int VocalMusicPlayer::getAudioSessionId() {
         return mOutputStream->getSessionId();
     }
-    bool VocalMusicPlayer::openStream() {
-        __android_log_print(ANDROID_LOG_INFO, TAG, "openStream()");
-
-        // Use shared_ptr to prevent use of a deleted callback.
-        mDataCallback = std::make_shared<MyDataCallback>(this);
-        mErrorCallback = std::make_shared<MyErrorCallback>(this);
-
-        // Create an audio stream
-        AudioStreamBuilder builder;
-        builder.setChannelCount(mChannelCount);
-        // we will resample source data to device rate, so take default sample rate
-        builder.setDataCallback(mDataCallback);
-        builder.setErrorCallback(mErrorCallback);
-        builder.setPerformanceMode(PerformanceMode::LowLatency);
-        builder.setSharingMode(SharingMode::Shared);
-        builder.setSampleRateConversionQuality(SampleRateConversionQuality::Medium);
-
-        Result result = builder.openStream(mOutputStream);
-        if (result != Result::OK){
-            __android_log_print(
-                    ANDROID_LOG_ERROR,
-                    TAG,
-                    "openStream failed. Error: %s", convertToText(result));
-            return false;
-        }
-
-        // Reduce stream latency by setting the buffer size to a multiple of the burst size
-        // Note: this will fail with ErrorUnimplemented if we are using a callback with OpenSL ES
-        // See oboe::AudioStreamBuffered::setBufferSizeInFrames
-        result = mOutputStream->setBufferSizeInFrames(
-                mOutputStream->getFramesPerBurst() * kBufferSizeInBursts);
-        if (result != Result::OK) {
-            __android_log_print(
-                    ANDROID_LOG_WARN,
-                    TAG,
-                    "setBufferSizeInFrames failed. Error: %s", convertToText(result));
-        }
-
-        mSampleRate = mOutputStream->getSampleRate();
-
-        return true;
-    }
-
 // Just
 // trying to open the stream if it is not already open.
 //    bool VocalMusicPlayer::startStream() {
@@ -227,48 +248,68 @@ namespace iolib{
 //    }
 
     bool VocalMusicPlayer::startStream() {
-        if (mOutputStream && mOutputStream->requestStart() != oboe::Result::OK) {
-                __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to start output stream");
+        if (!mOutputStream) {
+            return false;
+        }
+        if (mInputStream) {
+            mMicActive.store(false, std::memory_order_release);
+            mDuplexStream.setSharedInputStream(mInputStream);
+            mDuplexStream.setSharedOutputStream(mOutputStream);
+            if (!mDuplexStream.prepare()) {
+                __android_log_print(ANDROID_LOG_ERROR, TAG, "Microphone does not match output");
                 return false;
             }
-        if (mInputStream && mInputStream->requestStart() != oboe::Result::OK) {
-                __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to start input stream");
+            mMicActive.store(true, std::memory_order_release);
+            // Starts the input first so it is running by the first output callback.
+            if (mDuplexStream.start() != oboe::Result::OK) {
+                __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to start duplex streams");
+                mMicActive.store(false, std::memory_order_release);
                 return false;
             }
-        mRunning = true;
-        mInputThread = std::thread(&VocalMusicPlayer::readInputLoop, this);
+            return true;
+        }
+        if (mOutputStream->requestStart() != oboe::Result::OK) {
+            __android_log_print(ANDROID_LOG_ERROR, TAG, "Failed to start output stream");
+            return false;
+        }
         return true;
     }
 
     void VocalMusicPlayer::stopStreams() {
-        mRunning = false;
-        if (mInputThread.joinable()) {
-                    mInputThread.join();
-        }
+        mMicActive.store(false, std::memory_order_release);
         if (mInputStream) {
             mInputStream->requestStop();
             mInputStream->close();
             mInputStream.reset();
         }
         if (mOutputReset){
+            mBufferSizeTuner.stop();
             mOutputStream->requestStop();
             mOutputStream->close();
             mOutputStream.reset();
+            mPerformanceHint.close();
         }
     }
 
-    void VocalMusicPlayer::readInputLoop() {
-        int32_t bufferSize = 256;
-        std::vector<float> inputBuffer(bufferSize * mChannelCount, 0.0f);
-        while (mRunning) {
-                auto result = mInputStream->read(inputBuffer.data(), bufferSize, 1000000L);
-                if (result.value() > 0) {
-                        mMicRingBuffer.write(inputBuffer.data(), result.value());
-                    }
-            }
-    }
+    double VocalMusicPlayer::getRoundTripLatencyMillis() {
+        if (!mOutputStream || !mInputStream || !mMicActive.load(std::memory_order_acquire)) {
+            return -1.0;
+        }
+        double framesPerMilli = mOutputStream->getSampleRate() / 1000.0;
 
+        auto outputLatency = mOutputStream->calculateLatencyMillis();
+        double outputMillis = outputLatency
+                ? outputLatency.value()
+                : mOutputStream->getBufferSizeInFrames() / framesPerMilli;
 
+        auto inputLatency = mInputStream->calculateLatencyMillis();
+        double inputMillis = inputLatency
+                ? inputLatency.value()
+                : mInputStream->getFramesPerBurst() / framesPerMilli;
+        double compensationMillis = mDuplexStream.getInput().getTargetFrames() / framesPerMilli;
+
+        return inputMillis + compensationMillis + outputMillis;
+    }
 
     void VocalMusicPlayer::setupAudioStream(int32_t channelCount) {
         __android_log_print(ANDROID_LOG_INFO, TAG, "setupAudioStream()");
@@ -278,15 +319,27 @@ namespace iolib{
         openInputStream();
     }
 
+    void VocalMusicPlayer::closeInputStream() {
+        mMicActive.store(false, std::memory_order_release);
+        if (mInputStream) {
+            mInputStream->stop();
+            mInputStream->close();
+            mInputStream.reset();
+        }
+    }
+
     void VocalMusicPlayer::teardownAudioStream() {
         __android_log_print(ANDROID_LOG_INFO, TAG, "teardownAudioStream()");
         this->firstFrameHit = false;
+        mBufferSizeTuner.stop();
+        closeInputStream();
         // tear down the player
         if (mOutputStream) {
             mOutputStream->stop();
             mOutputStream->close();
             mOutputStream.reset();
         }
+        mPerformanceHint.close();
     }
 
     void VocalMusicPlayer::pauseStream(){
@@ -343,10 +396,27 @@ namespace iolib{
             __android_log_print(ANDROID_LOG_INFO, TAG, "timestamp at triggerDown(): %lld", currentTimeMillis);
             __android_log_print(ANDROID_LOG_INFO, TAG, "triggerDown(%d)", index);
 
+            if (!mSampleSources[index]->isPlaying()) {
+                hintUpcomingVoices(getActiveVoiceCount() + 1);
+            }
             mSampleSources[index]->setPlayMode();
         }
     }
 
+    int32_t VocalMusicPlayer::getActiveVoiceCount() {
+        int32_t activeVoices = 0;
+        for (int32_t index = 0; index < mNumSampleBuffers; index++) {
+            if (mSampleSources[index]->isPlaying()) {
+                activeVoices++;
+            }
+        }
+        return activeVoices;
+    }
+
+    void VocalMusicPlayer::hintUpcomingVoices(int32_t numVoices) {
+        mPerformanceHint.hintActiveVoices(numVoices);
+    }
+
     void VocalMusicPlayer::triggerUp(int32_t index) {
         this->firstFrameHit = false;
         if (index < mNumSampleBuffers) {
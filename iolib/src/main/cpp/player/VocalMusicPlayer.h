@@ -10,9 +10,13 @@
 #include <oboe/Oboe.h>
 #include "OneShotSampleSource.h"
 #include "SampleBuffer.h"
-#include "AudioRingBuffer.h"
+#include "BufferSizeTuner.h"
+#include "DriftCompensatedInput.h"
+#include "PerformanceHint.h"
+#include "StreamTelemetry.h"
+#include "../analysis/PitchTracker.h"
+#include "../effects/VocalEffectChain.h"
 #include <atomic>
-#include <thread>
 
 namespace iolib{
 
@@ -22,7 +26,6 @@ public:
     void setupAudioStream(int32_t channelCount);
     void teardownAudioStream();
 
-    bool openStream();
     bool startStream();
     bool firstFrameHit = false;
 
@@ -32,6 +35,13 @@ public:
     void triggerDown(int32_t index);
     void triggerUp(int32_t index);
 
+    /**
+     * Tell the CPU governor that this many voices are about to play, for example
+     * just before starting several stems together. triggerDown() does this for one voice.
+     */
+    void hintUpcomingVoices(int32_t numVoices);
+    int32_t getActiveVoiceCount();
+
     void resetAll();
 
     bool getOutputReset() { return mOutputReset; }
@@ -53,12 +63,96 @@ public:
     int64_t presentationTime = 0;
     int getAudioSessionId();
 
+    // Adaptive buffer sizing, see BufferSizeTuner.
+    // The limits are used the next time the stream is opened.
+    void setBufferTuningLimits(int32_t minimumBursts, int32_t maximumBursts,
+                               int32_t quietPeriodMillis) {
+        mBufferSizeTuner.setLimits(minimumBursts, maximumBursts, quietPeriodMillis);
+    }
+    int32_t getBufferSizeInFrames() { return mBufferSizeTuner.getBufferSizeInFrames(); }
+    int32_t getXRunCount() { return mBufferSizeTuner.getXRunCount(); }
+    int32_t getBufferGrowCount() { return mBufferSizeTuner.getGrowCount(); }
+    int32_t getBufferShrinkCount() { return mBufferSizeTuner.getShrinkCount(); }
+
+    // Callback timing and glitch statistics for the output stream, see StreamTelemetry.
+    void getTelemetry(StreamTelemetry::Snapshot &snapshot) { mTelemetry.getSnapshot(snapshot); }
+    void resetTelemetry() { mTelemetry.requestReset(); }
+
     // New changes
     bool openOutputStream();
     bool openInputStream();
     void stopStreams();
 
+    /**
+     * Estimate the time from the microphone to the speaker, using the stream timestamps
+     * when they are available and the buffer sizes when they are not.
+     * The input side includes the latency held by the drift compensation.
+     *
+     * @return latency in milliseconds, or -1 if the microphone is not running
+     */
+    double getRoundTripLatencyMillis();
+    // Frames waiting in the drift compensation FIFO after the last callback.
+    int32_t getMicBacklogFrames() { return mDuplexStream.getInput().getBacklogFrames(); }
+    // Input frames dropped because the FIFO was full.
+    int64_t getMicFramesDropped() { return mDuplexStream.getInput().getFramesDropped(); }
+    // Correction applied to the microphone for the clock drift, in parts per million.
+    double getMicDriftPpm() { return mDuplexStream.getInput().getCorrectionPpm(); }
+    // Number of times the microphone ran dry.
+    int32_t getMicUnderflowCount() { return mDuplexStream.getInput().getUnderflowCount(); }
+    // Input bursts kept as a cushion against the microphone running dry, tuned at runtime.
+    // Save it per device and set it before startStream() in the next session.
+    int32_t getMicCushionBursts() { return mDuplexStream.getInput().getCushionBursts(); }
+    void setMicCushionBursts(int32_t numBursts) {
+        mDuplexStream.getInput().setCushionBursts(numBursts);
+    }
+
+    // Effects applied to the microphone before it is mixed. May be changed while playing.
+    VocalEffectChain &getVocalEffects() { return mDuplexStream.getEffects(); }
+
+    // Pitch of the microphone before the effects, for scoring. Off until enabled.
+    PitchTracker &getPitchTracker() { return mDuplexStream.getPitchTracker(); }
+
 private:
+    // Stop and close the microphone, which is only read by the output callback.
+    void closeInputStream();
+
+    /**
+     * Reads the microphone without blocking from within the output callback and
+     * adds it to the output buffer. The backing track is mixed on top by MyDataCallback.
+     */
+    class MicDuplexStream : public oboe::FullDuplexStream {
+    public:
+        /**
+         * Allocate the drift compensation, the effects and the pitch tracker for the
+         * current streams.
+         * Call before start().
+         */
+        bool prepare();
+
+        oboe::ResultWithValue<int32_t> readInput(int32_t numFrames) override;
+
+        oboe::DataCallbackResult onBothStreamsReady(
+                const void *inputData,
+                int numInputFrames,
+                void *outputData,
+                int numOutputFrames) override;
+
+        // Frames mixed by the last callback, only valid on the callback thread.
+        int32_t getFramesMixed() const { return mFramesMixed; }
+        void clearFramesMixed() { mFramesMixed = 0; }
+
+        DriftCompensatedInput &getInput() { return mInput; }
+        VocalEffectChain &getEffects() { return mEffects; }
+        PitchTracker &getPitchTracker() { return mPitchTracker; }
+
+    private:
+        // The input and output clocks drift apart, so the input is resampled to follow.
+        DriftCompensatedInput mInput;
+        VocalEffectChain mEffects;
+        PitchTracker mPitchTracker;
+        int32_t mFramesMixed = 0;
+    };
+
     class MyDataCallback : public oboe::AudioStreamDataCallback{
     public:
         MyDataCallback(VocalMusicPlayer *parent): mParent(parent){}
@@ -100,10 +194,12 @@ private:
     std::shared_ptr<MyDataCallback> mDataCallback;
     std::shared_ptr<MyErrorCallback> mErrorCallback;
     bool mIsStreamPaused;
-    AudioRingBuffer mMicRingBuffer;
-    std::atomic_bool mRunning;
-    std::thread mInputThread;
-    void readInputLoop();
+    BufferSizeTuner mBufferSizeTuner;
+    PerformanceHint mPerformanceHint;
+    StreamTelemetry mTelemetry;
+    MicDuplexStream mDuplexStream;
+    // True while the callback should read the microphone through mDuplexStream.
+    std::atomic<bool> mMicActive{false};
 };
 };
 
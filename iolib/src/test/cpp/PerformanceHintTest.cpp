@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks the voice cost estimate of PerformanceHint, and that the advance hints from
+ * hintActiveVoices() reach the ADPF session from the callback thread only. On a host,
+ * AdpfWrapper records the hints in a stub instead of reporting them.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "common/AudioClock.h"
+#include "player/PerformanceHint.h"
+
+using namespace iolib;
+
+namespace {
+
+int sFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            sFailures++; \
+        } \
+    } while (false)
+
+constexpr int32_t kFramesPerBurst = 192;
+constexpr int32_t kSampleRate = 48000;
+constexpr int64_t kBaseNanos = 200 * 1000;
+constexpr int64_t kNanosPerVoice = 300 * 1000;
+
+size_t numReports() {
+    return AdpfWrapper::getHostStubRecord().actualDurationsNanos.size();
+}
+
+int64_t lastReport() {
+    return AdpfWrapper::getHostStubRecord().actualDurationsNanos.back();
+}
+
+// Stands in for the mixing, which takes longer with more voices.
+void runCallback(PerformanceHint &hint, int32_t activeVoices,
+                 int32_t numFrames = kFramesPerBurst) {
+    hint.onBeginCallback(kFramesPerBurst, kSampleRate);
+    int64_t end = oboe::AudioClock::getNanoseconds() + kBaseNanos + kNanosPerVoice * activeVoices;
+    while (oboe::AudioClock::getNanoseconds() < end) {
+    }
+    hint.onEndCallback(numFrames, activeVoices);
+}
+
+void checkEstimator() {
+    printf("estimator\n");
+    VoiceCostEstimator estimator;
+    CHECK(estimator.estimateNanos(4) == 0);
+    estimator.addMeasurement(1000, 0);
+    // Nothing is known about a voice yet, so there is no estimate to give.
+    CHECK(estimator.estimateNanos(4) == 0);
+    estimator.addMeasurement(3000, 2);
+    CHECK(estimator.estimateNanos(4) == 1000 + 4 * 1000);
+    // Later measurements are smoothed.
+    estimator.addMeasurement(5000, 2);
+    CHECK(estimator.estimateNanos(4) == 1000 + 4 * 1100);
+    estimator.addMeasurement(2000, 0);
+    CHECK(estimator.estimateNanos(4) == 1100 + 4 * 1100);
+    // A measurement below the fixed part does not make a voice free.
+    estimator.addMeasurement(500, 1);
+    CHECK(estimator.estimateNanos(1) == 1100 + 990);
+    estimator.reset();
+    CHECK(estimator.estimateNanos(4) == 0);
+}
+
+void checkAdvanceHints() {
+    printf("advance hints\n");
+    AdpfWrapper::resetHostStubRecord();
+    PerformanceHint hint;
+    // Fed the same measurements as the estimator in hint, to know what it should report.
+    VoiceCostEstimator expected;
+    auto measure = [&](int32_t activeVoices) {
+        runCallback(hint, activeVoices);
+        expected.addMeasurement(lastReport(), activeVoices);
+    };
+
+    measure(0);
+    CHECK(hint.isOpen());
+    CHECK(AdpfWrapper::getHostStubRecord().openCount == 1);
+    CHECK(AdpfWrapper::getHostStubRecord().targetDurationNanos
+            == kFramesPerBurst * oboe::kNanosPerSecond / kSampleRate);
+    CHECK(numReports() == 1);
+
+    // The UI thread only leaves the request. Before a voice has been measured, the next
+    // callback has nothing to base a hint on.
+    std::thread([&hint]() { hint.hintActiveVoices(4); }).join();
+    CHECK(numReports() == 1);
+    measure(1);
+    CHECK(numReports() == 2);
+    // On a busy host the first voice may not have measured more than the fixed part.
+    for (int i = 0; i < 100 && expected.estimateNanos(8) == 0; i++) {
+        measure(1);
+    }
+
+    size_t numBefore = numReports();
+    std::thread([&hint]() { hint.hintActiveVoices(8); }).join();
+    CHECK(numReports() == numBefore);
+    runCallback(hint, 8);
+    AdpfWrapper::HostStubRecord record = AdpfWrapper::getHostStubRecord();
+    int64_t expectedNanos = expected.estimateNanos(8);
+    CHECK(record.actualDurationsNanos.size() == numBefore + (expectedNanos > 0 ? 2 : 1));
+    if (expectedNanos > 0 && record.actualDurationsNanos.size() == numBefore + 2) {
+        CHECK(record.actualDurationsNanos[numBefore] == expectedNanos);
+    }
+
+    // A request is only applied once, and fewer voices need no hint.
+    numBefore = numReports();
+    runCallback(hint, 8);
+    CHECK(numReports() == numBefore + 1);
+    hint.hintActiveVoices(2);
+    runCallback(hint, 2);
+    CHECK(numReports() == numBefore + 2);
+
+    // A short callback is not reported, its duration would be scaled up too far.
+    runCallback(hint, 2, kFramesPerBurst / 4);
+    CHECK(numReports() == numBefore + 2);
+
+    // Closing forgets the costs, so a new session starts without hints.
+    hint.close();
+    CHECK(!hint.isOpen());
+    CHECK(AdpfWrapper::getHostStubRecord().closeCount == 1);
+    hint.hintActiveVoices(8);
+    runCallback(hint, 0);
+    CHECK(AdpfWrapper::getHostStubRecord().openCount == 2);
+    CHECK(numReports() == numBefore + 3);
+    hint.close();
+}
+
+} // namespace
+
+int main() {
+    checkEstimator();
+    checkAdvanceHints();
+
+    if (sFailures > 0) {
+        printf("%d checks failed\n", sFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -118,7 +118,11 @@ class NativeKaraokePlayer(private val context: Context) : DefaultLifecycleObserv
         nativePlayer.setGain(0, volume)
     }
 
-    fun getCurrentPosition(): Long = nativePlayer.getPosition(0, 44100, 1)
+    fun getCurrentPosition(): Long {
+        val status = nativePlayer.getPlayerStatus() ?: return 0
+        status.read()
+        return status.getSourcePositionMillis(0)
+    }
 
     fun getTotalDuration(): Long = totalDuration
 
@@ -129,8 +133,11 @@ class NativeKaraokePlayer(private val context: Context) : DefaultLifecycleObserv
 
     private val progressUpdateRunnable = object : Runnable {
         override fun run() {
-            currentPosition = getCurrentPosition()
-            totalDuration = nativePlayer.getDuration(44100, 1) // Assuming this is available
+            val status = nativePlayer.getPlayerStatus()
+            if (status != null && status.read()) {
+                currentPosition = status.getSourcePositionMillis(0)
+                totalDuration = status.getSourceDurationMillis(0)
+            }
             updateState()
             handler.postDelayed(this, PROGRESS_UPDATE_DELAY)
         }
@@ -24,17 +24,17 @@ class PreviewActivityNativePlayer {
     private var player1fileUri = "";
     private var player2fileUri = "";
 
-    fun getCurrentPosition(index: Int): Long = nativePlayer.getPosition(index, 44100, 1)
+    fun getCurrentPosition(index: Int): Long {
+        val status = nativePlayer.getPlayerStatus() ?: return 0
+        status.read()
+        return status.getSourcePositionMillis(index)
+    }
 
-    fun getTotalDuration(playerNumber: Int): Long{
-        var totalDuration = 0L;
-        if (playerNumber == 1){
-            totalDuration = nativePlayer1.getDuration(44100, 1)
-        }
-        if (playerNumber == 2){
-            totalDuration = nativePlayer2.getDuration(44100, 1)
-        }
-        return totalDuration
+    fun getTotalDuration(playerNumber: Int): Long {
+        // Player 1 loads source 0 and player 2 loads source 1.
+        val status = nativePlayer.getPlayerStatus() ?: return 0
+        status.read()
+        return status.getSourceDurationMillis(playerNumber - 1)
     }
 
 
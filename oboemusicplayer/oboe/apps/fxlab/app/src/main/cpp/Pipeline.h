@@ -0,0 +1,94 @@
+/*
+ * Copyright  2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FXLAB_PIPELINE_H
+#define ANDROID_FXLAB_PIPELINE_H
+
+#include <algorithm>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+
+// A chain of effects fixed at compile time, for example
+// Pipeline<GainEffect, BiquadEffect, DelayEffect, LimiterEffect>
+// Unlike FunctionList there is no indirect call per effect. When every stage can process
+// one sample (operator()(sample &)), the stages are fused into a single loop over the buffer
+// which the compiler can inline. Otherwise the stages run one after the other over short
+// blocks, so each block stays in the cache between stages.
+// Stages are called in order and retain state, so a Pipeline must be used sequentially.
+template <class... Stages>
+class Pipeline {
+public:
+    static constexpr size_t kNumStages = sizeof...(Stages);
+    static constexpr int kBlockSize = 64;
+
+    explicit Pipeline(Stages... stages): mStages(std::move(stages)...) { }
+
+    template <class iter_type>
+    void operator () (iter_type begin, iter_type end) {
+        using reference = typename std::iterator_traits<iter_type>::reference;
+        if (muted) {
+            std::fill(begin, end, 0);
+            return;
+        }
+        if constexpr ((isPerSample<Stages, reference>() && ...)) {
+            for (; begin != end; ++begin) {
+                reference x = *begin;
+                std::apply([&x](auto &... stage) { (stage(x), ...); }, mStages);
+            }
+        } else {
+            while (begin != end) {
+                auto blockEnd = std::next(begin, std::min<typename std::iterator_traits<
+                        iter_type>::difference_type>(kBlockSize, std::distance(begin, end)));
+                std::apply([begin, blockEnd](auto &... stage) {
+                    (runBlock(stage, begin, blockEnd), ...);
+                }, mStages);
+                begin = blockEnd;
+            }
+        }
+    }
+
+    template <size_t I>
+    auto &getStage() {
+        return std::get<I>(mStages);
+    }
+
+    void mute(bool toMute) {
+        muted = toMute;
+    }
+
+private:
+    template <class Stage, class reference>
+    static constexpr bool isPerSample() {
+        return std::is_invocable<Stage &, reference>::value;
+    }
+
+    template <class Stage, class iter_type>
+    static void runBlock(Stage &stage, iter_type begin, iter_type end) {
+        if constexpr (isPerSample<Stage, typename std::iterator_traits<iter_type>::reference>()) {
+            for (; begin != end; ++begin) {
+                stage(*begin);
+            }
+        } else {
+            stage(begin, end);
+        }
+    }
+
+    std::tuple<Stages...> mStages;
+    bool muted = false;
+};
+
+#endif //ANDROID_FXLAB_PIPELINE_H
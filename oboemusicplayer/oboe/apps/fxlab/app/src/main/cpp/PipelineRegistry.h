@@ -0,0 +1,92 @@
+/*
+ * Copyright  2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FXLAB_PIPELINEREGISTRY_H
+#define ANDROID_FXLAB_PIPELINEREGISTRY_H
+
+#include <array>
+#include <functional>
+#include <string_view>
+
+#include "Pipeline.h"
+#include "effects/Effects.h"
+#include "effects/BiquadEffect.h"
+#include "effects/DelayEffect.h"
+#include "effects/GainEffect.h"
+#include "effects/LimiterEffect.h"
+
+// Common chains compiled as Pipelines, selected by name at runtime.
+// A chain is a single std::function, so it can be added to a FunctionList
+// and costs one indirect call per buffer instead of one per effect.
+namespace PipelineRegistry {
+
+    template<class iter_type>
+    struct Chain {
+        std::string_view name;
+        _ef<iter_type> (*build)();
+    };
+
+    template<class iter_type>
+    _ef<iter_type> buildVocal() {
+        return Pipeline {
+            BiquadEffect::highPass(100, 0.7071, SAMPLE_RATE),
+            BiquadEffect::peaking(3000, 1, 3, SAMPLE_RATE),
+            GainEffect(3),
+            LimiterEffect()
+        };
+    }
+
+    template<class iter_type>
+    _ef<iter_type> buildEcho() {
+        return Pipeline {
+            GainEffect(-3),
+            DelayEffect(0.5, 100 * SAMPLE_RATE / 1000),
+            LimiterEffect()
+        };
+    }
+
+    template<class iter_type>
+    _ef<iter_type> buildTelephone() {
+        return Pipeline {
+            BiquadEffect::highPass(300, 0.7071, SAMPLE_RATE),
+            BiquadEffect::lowPass(3400, 0.7071, SAMPLE_RATE),
+            GainEffect(6),
+            LimiterEffect()
+        };
+    }
+
+    template<class iter_type>
+    const std::array<Chain<iter_type>, 3> &getChains() {
+        static const std::array<Chain<iter_type>, 3> chains {{
+            {"Vocal", &buildVocal<iter_type>},
+            {"Echo", &buildEcho<iter_type>},
+            {"Telephone", &buildTelephone<iter_type>},
+        }};
+        return chains;
+    }
+
+    // Returns an empty function if there is no chain with this name
+    template<class iter_type>
+    _ef<iter_type> buildChain(std::string_view name) {
+        for (auto &chain : getChains<iter_type>()) {
+            if (chain.name == name) return chain.build();
+        }
+        return _ef<iter_type>();
+    }
+
+} // namespace PipelineRegistry
+
+#endif //ANDROID_FXLAB_PIPELINEREGISTRY_H
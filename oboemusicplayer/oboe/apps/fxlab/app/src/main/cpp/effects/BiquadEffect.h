@@ -0,0 +1,80 @@
+/*
+ * Copyright  2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FXLAB_BIQUADEFFECT_H
+#define ANDROID_FXLAB_BIQUADEFFECT_H
+
+#include <cmath>
+
+#include "utils/SampleClamp.h"
+
+// Second order IIR filter in transposed direct form II
+// Coefficients are normalized so a0 = 1, the factories follow the RBJ audio EQ cookbook
+class BiquadEffect {
+public:
+    BiquadEffect(float b0, float b1, float b2, float a1, float a2):
+        kB0(b0), kB1(b1), kB2(b2), kA1(a1), kA2(a2) { }
+
+    static BiquadEffect lowPass(float frequency, float q, int sampleRate) {
+        auto [cosW, alpha] = prewarp(frequency, q, sampleRate);
+        return normalize((1 - cosW) / 2, 1 - cosW, (1 - cosW) / 2,
+                         1 + alpha, -2 * cosW, 1 - alpha);
+    }
+    static BiquadEffect highPass(float frequency, float q, int sampleRate) {
+        auto [cosW, alpha] = prewarp(frequency, q, sampleRate);
+        return normalize((1 + cosW) / 2, -(1 + cosW), (1 + cosW) / 2,
+                         1 + alpha, -2 * cosW, 1 - alpha);
+    }
+    static BiquadEffect peaking(float frequency, float q, float gainDb, int sampleRate) {
+        auto [cosW, alpha] = prewarp(frequency, q, sampleRate);
+        float a = std::pow(10.0f, gainDb / 40);
+        return normalize(1 + alpha * a, -2 * cosW, 1 - alpha * a,
+                         1 + alpha / a, -2 * cosW, 1 - alpha / a);
+    }
+
+    template <class numeric_type>
+    void operator () (numeric_type &x) {
+        float in = x;
+        float out = kB0 * in + s1;
+        s1 = kB1 * in - kA1 * out + s2;
+        s2 = kB2 * in - kA2 * out;
+        x = clampToSample<numeric_type>(out);
+    }
+    template <class iter_type>
+    void operator () (iter_type begin, iter_type end) {
+        for (; begin != end; ++begin) {
+            operator()(*begin);
+        }
+    }
+private:
+    struct Prewarped {
+        float cosW;
+        float alpha;
+    };
+    static Prewarped prewarp(float frequency, float q, int sampleRate) {
+        float w = 2 * static_cast<float>(M_PI) * frequency / sampleRate;
+        return {std::cos(w), std::sin(w) / (2 * q)};
+    }
+    static BiquadEffect normalize(float b0, float b1, float b2, float a0, float a1, float a2) {
+        return BiquadEffect(b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0);
+    }
+
+    const float kB0, kB1, kB2, kA1, kA2;
+    // State
+    float s1 = 0;
+    float s2 = 0;
+};
+#endif //ANDROID_FXLAB_BIQUADEFFECT_H
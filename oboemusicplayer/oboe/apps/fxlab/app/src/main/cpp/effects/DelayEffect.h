@@ -0,0 +1,49 @@
+/*
+ * Copyright  2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FXLAB_DELAYEFFECT_H
+#define ANDROID_FXLAB_DELAYEFFECT_H
+
+#include "utils/DelayLine.h"
+#include "utils/SampleClamp.h"
+
+// A fixed echo, y[n] = x[n] + feedback * y[n - delay]
+// It matches EchoEffect without the per sample modulation call, so it can be inlined
+class DelayEffect {
+public:
+    // delay > 0 in samples
+    DelayEffect(float feedback, int delay):
+        kFeedback(feedback),
+        kDelay(delay) { }
+
+    template <class numeric_type>
+    void operator () (numeric_type &x) {
+        float y = x + kFeedback * delayLine[kDelay];
+        delayLine.push(y);
+        x = clampToSample<numeric_type>(y);
+    }
+    template <class iter_type>
+    void operator () (iter_type begin, iter_type end) {
+        for (; begin != end; ++begin) {
+            operator()(*begin);
+        }
+    }
+private:
+    const float kFeedback;
+    const int kDelay;
+    DelayLine<float> delayLine {static_cast<size_t>(kDelay + 1)};
+};
+#endif //ANDROID_FXLAB_DELAYEFFECT_H
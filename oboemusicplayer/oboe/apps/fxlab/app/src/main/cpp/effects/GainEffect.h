@@ -0,0 +1,42 @@
+/*
+ * Copyright  2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FXLAB_GAINEFFECT_H
+#define ANDROID_FXLAB_GAINEFFECT_H
+
+#include <cmath>
+
+#include "utils/SampleClamp.h"
+
+// Same scale as the Gain description, so it can be used as a Pipeline stage
+class GainEffect {
+public:
+    GainEffect(float gainDb): kGain(std::pow(2.0f, gainDb / 10)) { }
+
+    template <class numeric_type>
+    void operator () (numeric_type &x) {
+        x = clampToSample<numeric_type>(x * kGain);
+    }
+    template <class iter_type>
+    void operator () (iter_type begin, iter_type end) {
+        for (; begin != end; ++begin) {
+            operator()(*begin);
+        }
+    }
+private:
+    const float kGain;
+};
+#endif //ANDROID_FXLAB_GAINEFFECT_H
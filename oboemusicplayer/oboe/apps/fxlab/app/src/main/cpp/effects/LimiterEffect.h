@@ -0,0 +1,53 @@
+/*
+ * Copyright  2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FXLAB_LIMITEREFFECT_H
+#define ANDROID_FXLAB_LIMITEREFFECT_H
+
+#include <cmath>
+#include <type_traits>
+
+#include "utils/SampleClamp.h"
+
+// Soft limiter with the spline of oboe's flowgraph Limiter:
+// unity up to full scale, then a smooth curve to a ceiling 3 dB above it.
+// Integer samples have no headroom, so they saturate at full scale instead.
+class LimiterEffect {
+public:
+    template <class numeric_type>
+    void operator () (numeric_type &x) {
+        constexpr float kFullScale = std::is_floating_point<numeric_type>::value ? 1 : 32767;
+        float in = x / kFullScale;
+        float abs = std::abs(in);
+        if (abs <= 1) return;
+        float out = (abs < kXWhenYis3Decibels)
+                ? (kSplineA * abs + kSplineB) * abs + kSplineC
+                : static_cast<float>(M_SQRT2);
+        x = clampToSample<numeric_type>(std::copysign(out, in) * kFullScale);
+    }
+    template <class iter_type>
+    void operator () (iter_type begin, iter_type end) {
+        for (; begin != end; ++begin) {
+            operator()(*begin);
+        }
+    }
+private:
+    static constexpr float kSplineA = -0.6035533905; // -(1+sqrt(2))/4
+    static constexpr float kSplineB = 2.2071067811; // (3+sqrt(2))/2
+    static constexpr float kSplineC = -0.6035533905; // -(1+sqrt(2))/4
+    static constexpr float kXWhenYis3Decibels = 1.8284271247; // -1+2sqrt(2)
+};
+#endif //ANDROID_FXLAB_LIMITEREFFECT_H
@@ -0,0 +1,36 @@
+/*
+ * Copyright  2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FXLAB_SAMPLECLAMP_H
+#define ANDROID_FXLAB_SAMPLECLAMP_H
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+// Convert a float result back to the sample type of a Pipeline stage.
+// Integer samples saturate at full scale instead of wrapping around.
+template <class numeric_type>
+numeric_type clampToSample(float x) {
+    if constexpr (std::is_integral<numeric_type>::value) {
+        constexpr float kMin = std::numeric_limits<numeric_type>::min();
+        constexpr float kMax = std::numeric_limits<numeric_type>::max();
+        return static_cast<numeric_type>(std::clamp(x, kMin, kMax));
+    } else {
+        return x;
+    }
+}
+#endif //ANDROID_FXLAB_SAMPLECLAMP_H
@@ -0,0 +1,192 @@
+/*
+ * Copyright  2019 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_FXLAB_PIPELINETEST_H
+#define ANDROID_FXLAB_PIPELINETEST_H
+
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../effects/Effects.h"
+#include "../FunctionList.h"
+#include "../Pipeline.h"
+#include "../PipelineRegistry.h"
+#include "BenchmarkUtilities.h"
+
+
+namespace {
+    std::vector<float> makeSignal(size_t size) {
+        std::vector<float> signal(size);
+        for (size_t i = 0; i < size; i++) {
+            signal[i] = 1.5f * std::sin(i * 0.05f) + 0.25f * std::sin(i * 0.71f);
+        }
+        return signal;
+    }
+
+    // The way the descriptions build effects, one loop over the buffer per effect
+    template <class Stage>
+    _ef<float*> asFunction(Stage stage) {
+        return [stage](float *begin, float *end) mutable {
+            for (; begin != end; ++begin) stage(*begin);
+        };
+    }
+
+    auto makeEightStages() {
+        return std::make_tuple(
+                GainEffect(3),
+                BiquadEffect::highPass(100, 0.7071, SAMPLE_RATE),
+                BiquadEffect::peaking(3000, 1, 3, SAMPLE_RATE),
+                BiquadEffect::lowPass(8000, 0.7071, SAMPLE_RATE),
+                DelayEffect(0.5, 4800),
+                TremoloEffect(2, 0.25),
+                GainEffect(-3),
+                LimiterEffect());
+    }
+
+    TEST(PipelineTest, MatchesFunctionList) {
+        auto stages = makeEightStages();
+        FunctionList<float*> list;
+        std::apply([&list](auto &... stage) { (list.addEffect(asFunction(stage)), ...); },
+                   stages);
+        auto pipeline = std::make_from_tuple<Pipeline<GainEffect, BiquadEffect, BiquadEffect,
+                BiquadEffect, DelayEffect, TremoloEffect, GainEffect, LimiterEffect>>(stages);
+
+        auto expected = makeSignal(9600);
+        auto actual = expected;
+        for (size_t i = 0; i < expected.size(); i += 192) {
+            list(expected.data() + i, expected.data() + i + 192);
+            pipeline(actual.data() + i, actual.data() + i + 192);
+        }
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_FLOAT_EQ(expected[i], actual[i]) << "i = " << i;
+        }
+    }
+
+    TEST(PipelineTest, DelayMatchesEcho) {
+        EchoEffect<float*> echo {0.5, 100};
+        Pipeline<DelayEffect> delay {DelayEffect(0.5, 100 * SAMPLE_RATE / 1000)};
+        auto expected = makeSignal(4096);
+        auto actual = expected;
+        echo(expected.data(), expected.data() + expected.size());
+        delay(actual.data(), actual.data() + actual.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_FLOAT_EQ(expected[i], actual[i]) << "i = " << i;
+        }
+    }
+
+    TEST(PipelineTest, BlockStage) {
+        // A stage without a per sample operator forces the blocked loop
+        int blocks = 0;
+        auto halve = [&blocks](float *begin, float *end) {
+            blocks++;
+            for (; begin != end; ++begin) *begin *= 0.5f;
+        };
+        Pipeline<GainEffect, decltype(halve)> pipeline {GainEffect(10), halve};
+        std::vector<float> data(200, 1.0f);
+        pipeline(data.data(), data.data() + data.size());
+        EXPECT_EQ(blocks, 4);
+        for (float x : data) EXPECT_FLOAT_EQ(x, 1.0f);
+
+        pipeline.mute(true);
+        pipeline(data.data(), data.data() + data.size());
+        EXPECT_EQ(data[0], 0);
+    }
+
+    TEST(PipelineTest, Registry) {
+        for (auto &chain : PipelineRegistry::getChains<float*>()) {
+            auto f = PipelineRegistry::buildChain<float*>(chain.name);
+            ASSERT_TRUE(f) << chain.name;
+            auto data = makeSignal(1024);
+            f(data.data(), data.data() + data.size());
+            for (float x : data) {
+                ASSERT_TRUE(std::isfinite(x)) << chain.name;
+                ASSERT_LE(std::abs(x), M_SQRT2 + 1e-6) << chain.name;
+            }
+        }
+        EXPECT_TRUE(PipelineRegistry::buildChain<int16_t*>("Vocal"));
+        EXPECT_FALSE(PipelineRegistry::buildChain<float*>("Nope"));
+    }
+
+    TEST(PipelineTest, RegistryInt16Saturates) {
+        // The chain has gain, so a near full scale int16 signal must clip, not wrap around
+        auto vocal = PipelineRegistry::buildChain<int16_t*>("Vocal");
+        ASSERT_TRUE(vocal);
+        std::vector<int16_t> input(4800);
+        for (size_t i = 0; i < input.size(); i++) {
+            input[i] = static_cast<int16_t>(30000 * std::sin(2 * M_PI * 1000 * i / SAMPLE_RATE));
+        }
+        auto output = input;
+        for (size_t i = 0; i < output.size(); i += 192) {
+            vocal(output.data() + i, output.data() + std::min(i + 192, output.size()));
+        }
+        int clipped = 0;
+        // Skip the start while the filters settle
+        for (size_t i = 480; i < input.size(); i++) {
+            if (std::abs(input[i]) < 25000) continue;
+            ASSERT_EQ(input[i] > 0, output[i] > 0) << "i = " << i;
+            ASSERT_GT(std::abs(output[i]), 25000) << "i = " << i;
+            if (output[i] == 32767 || output[i] == -32768) clipped++;
+        }
+        EXPECT_GT(clipped, 0);
+    }
+
+    // Compares a FunctionList of N effects with the same N stages as a Pipeline.
+    // See oboe/tests/BenchmarkUtilities.h.
+    class PipelineBenchmark : public ::testing::Test {
+    protected:
+        static constexpr size_t kFramesPerBurst = 192;
+        static constexpr int kNumBursts = 20000;
+
+        // Every burst starts from the same input. Processing one buffer in place over and
+        // over would run it up to inf through the gain stages and time that instead.
+        template <class Function>
+        double measure(Function &process) {
+            const auto input = makeSignal(kFramesPerBurst);
+            std::vector<float> signal(input.size());
+            double nanos = benchmarkNanosPerCall(kNumBursts, [&]() {
+                std::copy(input.begin(), input.end(), signal.begin());
+                process(signal.data(), signal.data() + signal.size());
+            }) / kFramesPerBurst;
+            for (float x : signal) {
+                EXPECT_TRUE(std::isfinite(x));
+            }
+            return nanos;
+        }
+
+        template <size_t... I>
+        void compare(std::index_sequence<I...>) {
+            auto stages = makeEightStages();
+            FunctionList<float*> list;
+            (list.addEffect(asFunction(std::get<I>(stages))), ...);
+            Pipeline<std::tuple_element_t<I, decltype(stages)>...> pipeline {
+                    std::get<I>(stages)...};
+            double listNanos = measure(list);
+            double pipelineNanos = measure(pipeline);
+            printf("%zu effects: FunctionList %6.2f ns/sample, Pipeline %6.2f ns/sample\n",
+                   sizeof...(I), listNanos, pipelineNanos);
+        }
+    };
+
+    TEST_F(PipelineBenchmark, DISABLED_Benchmark) {
+        compare(std::make_index_sequence<1>());
+        compare(std::make_index_sequence<4>());
+        compare(std::make_index_sequence<8>());
+    }
+}
+#endif //ANDROID_FXLAB_PIPELINETEST_H
@@ -20,6 +20,7 @@
 #include "DelayLineTest.h"
 #include "DelayLineEffectTest.h"
 #include "TypeTests.h"
+#include "PipelineTest.h"
 // This is the runner for the various unit tests in the test directory
 // Currently it is designed to be run on the development machine via CMAKE
 // Since this tests effects, it should be independent of Android, and simply test locally
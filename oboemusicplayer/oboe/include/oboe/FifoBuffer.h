@@ -26,8 +26,46 @@
 
 namespace oboe {
 
+/**
+ * A circular buffer of audio frames for one reader thread and one writer thread.
+ *
+ * read() and write() are wait-free as long as there is only one reader and one writer.
+ * Neither side ever blocks, spins or takes a lock.
+ *
+ * If the capacity is a power of two then the buffer indices are calculated with masks
+ * instead of a 64-bit modulo, which is cheaper on every read and write.
+ * Use roundUpToPowerOfTwo() to pick such a capacity.
+ */
 class FifoBuffer {
 public:
+    /**
+     * A contiguous block of frames in the storage.
+     */
+    struct Region {
+        uint8_t *data = nullptr;
+        int32_t numFrames = 0;
+    };
+
+    /**
+     * The frames that can be accessed in place.
+     * The frames may wrap around the end of the storage, so they are in up to two regions.
+     * The second region is empty if the frames do not wrap.
+     */
+    struct Regions {
+        Region first;
+        Region second;
+
+        int32_t getTotalFrames() const {
+            return first.numFrames + second.numFrames;
+        }
+    };
+
+    /**
+     * @param numFrames requested capacity
+     * @return the smallest power of two that is greater than or equal to numFrames
+     */
+    static uint32_t roundUpToPowerOfTwo(uint32_t numFrames);
+
 	/**
 	 * Construct a `FifoBuffer`.
 	 *
@@ -79,6 +117,42 @@ public:
 	 */
     int32_t write(const void *source, int32_t framesToWrite);
 
+    /**
+     * Get the frames that can be read in place, without copying them.
+     * Nothing is consumed until finishRead() is called.
+     * This should only be called by the reader thread.
+     *
+     * @param numFrames maximum number of frames wanted
+     * @param regions set to the frames that are available, up to numFrames
+     * @return total number of frames in the regions
+     */
+    int32_t prepareToRead(int32_t numFrames, Regions &regions);
+
+    /**
+     * Consume frames after they were accessed using prepareToRead().
+     *
+     * @param numFrames must not be more than prepareToRead() returned
+     */
+    void finishRead(int32_t numFrames);
+
+    /**
+     * Get the empty frames that can be written in place, without copying.
+     * Nothing becomes readable until finishWrite() is called.
+     * This should only be called by the writer thread.
+     *
+     * @param numFrames maximum number of frames wanted
+     * @param regions set to the space that is available, up to numFrames
+     * @return total number of frames in the regions
+     */
+    int32_t prepareToWrite(int32_t numFrames, Regions &regions);
+
+    /**
+     * Make frames readable after they were written using prepareToWrite().
+     *
+     * @param numFrames must not be more than prepareToWrite() returned
+     */
+    void finishWrite(int32_t numFrames);
+
 	/**
 	 * Get the buffer capacity in frames.
 	 *
@@ -151,6 +225,8 @@ public:
     }
 
 private:
+    void getRegions(uint32_t index, uint32_t numFrames, Regions &regions);
+
     uint32_t mBytesPerFrame;
     uint8_t* mStorage;
     bool     mStorageOwned; // did this object allocate the storage?
@@ -29,6 +29,12 @@ namespace oboe {
  * may wrap around from the end to the beginning of the buffer. In that
  * case the data must be read or written in at least two blocks of frames.
  *
+ * If the capacity is a power of two then the indices are calculated with a mask
+ * instead of a 64-bit modulo. The results are the same either way.
+ *
+ * The controller is intended for a single reader thread and a single writer thread.
+ * Each thread only ever advances its own counter and reads the other one, so neither
+ * side waits for, or takes a lock held by, the other side.
  */
 
 class FifoControllerBase {
@@ -96,6 +102,11 @@ public:
 	 */
     uint32_t getFrameCapacity() const { return mTotalFrames; }
 
+    /**
+     * @return true if the capacity is a power of two and the indices are masked
+     */
+    bool isPowerOfTwo() const { return mFrameMask != 0; }
+
     virtual uint64_t getReadCounter() const = 0;
     virtual void setReadCounter(uint64_t n) = 0;
     virtual void incrementReadCounter(uint64_t n) = 0;
@@ -104,7 +115,16 @@ public:
     virtual void incrementWriteCounter(uint64_t n) = 0;
 
 private:
+    uint32_t indexFromCounter(uint64_t counter) const {
+        if (mFrameMask != 0) {
+            return static_cast<uint32_t>(counter) & mFrameMask;
+        }
+        // % works with non-power of two sizes
+        return static_cast<uint32_t>(counter % mTotalFrames);
+    }
+
     uint32_t mTotalFrames;
+    uint32_t mFrameMask = 0; // capacity - 1, or zero if the capacity is not a power of two
 };
 
 } // namespace oboe
@@ -304,6 +304,24 @@ public:
         return mNumInputBurstsCushion;
     }
 
+    /**
+     * Estimate the time from the input to the output, based on the timestamps of both streams.
+     * This includes the cushion, which is waiting in the input stream.
+     *
+     * @return round trip latency in milliseconds, or an error if a timestamp is not available
+     */
+    ResultWithValue<double> calculateRoundTripLatencyMillis() {
+        ResultWithValue<double> inputLatency = getInputStream()->calculateLatencyMillis();
+        if (!inputLatency) {
+            return inputLatency;
+        }
+        ResultWithValue<double> outputLatency = getOutputStream()->calculateLatencyMillis();
+        if (!outputLatency) {
+            return outputLatency;
+        }
+        return ResultWithValue<double>(inputLatency.value() + outputLatency.value());
+    }
+
     /**
      * Minimum number of frames in the input stream buffer before calling readInput().
      *
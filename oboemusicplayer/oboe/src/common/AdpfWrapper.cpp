@@ -20,7 +20,10 @@
 
 #include "AdpfWrapper.h"
 #include "AudioClock.h"
+#ifdef __ANDROID__
+// OboeDebug.h needs android/log.h, which host builds do not have.
 #include "OboeDebug.h"
+#endif
 
 typedef APerformanceHintManager* (*APH_getManager)();
 typedef APerformanceHintSession* (*APH_createSession)(APerformanceHintManager*, const int32_t*,
@@ -34,9 +37,57 @@ static APH_createSession gAPH_createSessionFn = nullptr;
 static APH_reportActualWorkDuration gAPH_reportActualWorkDurationFn = nullptr;
 static APH_closeSession gAPH_closeSessionFn = nullptr;
 
+#ifndef __ANDROID__
+// There is no libandroid.so on the host, so record the calls instead.
+static std::mutex gHostStubLock;
+static AdpfWrapper::HostStubRecord gHostStubRecord;
+static int gHostStubManager;
+static int gHostStubSession;
+
+static APerformanceHintManager* hostStubGetManager() {
+    return reinterpret_cast<APerformanceHintManager*>(&gHostStubManager);
+}
+
+static APerformanceHintSession* hostStubCreateSession(APerformanceHintManager*, const int32_t*,
+                                                      size_t, int64_t targetDurationNanos) {
+    std::lock_guard<std::mutex> lock(gHostStubLock);
+    gHostStubRecord.openCount++;
+    gHostStubRecord.targetDurationNanos = targetDurationNanos;
+    return reinterpret_cast<APerformanceHintSession*>(&gHostStubSession);
+}
+
+static void hostStubReportActualWorkDuration(APerformanceHintSession*, int64_t durationNanos) {
+    std::lock_guard<std::mutex> lock(gHostStubLock);
+    gHostStubRecord.actualDurationsNanos.push_back(durationNanos);
+}
+
+static void hostStubCloseSession(APerformanceHintSession*) {
+    std::lock_guard<std::mutex> lock(gHostStubLock);
+    gHostStubRecord.closeCount++;
+}
+
+AdpfWrapper::HostStubRecord AdpfWrapper::getHostStubRecord() {
+    std::lock_guard<std::mutex> lock(gHostStubLock);
+    return gHostStubRecord;
+}
+
+void AdpfWrapper::resetHostStubRecord() {
+    std::lock_guard<std::mutex> lock(gHostStubLock);
+    gHostStubRecord = HostStubRecord();
+}
+#endif // __ANDROID__
+
 static int loadAphFunctions() {
     if (gAPerformanceHintBindingInitialized) return true;
 
+#ifndef __ANDROID__
+    gAPH_getManagerFn = hostStubGetManager;
+    gAPH_createSessionFn = hostStubCreateSession;
+    gAPH_reportActualWorkDurationFn = hostStubReportActualWorkDuration;
+    gAPH_closeSessionFn = hostStubCloseSession;
+    gAPerformanceHintBindingInitialized = true;
+    return 0;
+#else
     void* handle_ = dlopen("libandroid.so", RTLD_NOW | RTLD_NODELETE);
     if (handle_ == nullptr) {
         return -1000;
@@ -65,6 +116,7 @@ static int loadAphFunctions() {
 
     gAPerformanceHintBindingInitialized = true;
     return 0;
+#endif // __ANDROID__
 }
 
 bool AdpfWrapper::sUseAlternativeHack = false; // TODO remove hack
@@ -23,6 +23,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <mutex>
+#include <vector>
 
 struct APerformanceHintManager;
 struct APerformanceHintSession;
@@ -75,6 +76,22 @@ public:
      */
     void reportActualDuration(int64_t actualDurationNanos);
 
+#ifndef __ANDROID__
+    /**
+     * Host builds have no ADPF, so sessions are opened on a stub that records the hints.
+     * These are only for tests.
+     */
+    struct HostStubRecord {
+        int32_t openCount = 0;
+        int32_t closeCount = 0;
+        int64_t targetDurationNanos = 0;
+        std::vector<int64_t> actualDurationsNanos;
+    };
+
+    static HostStubRecord getHostStubRecord();
+    static void resetHostStubRecord();
+#endif
+
 private:
     std::mutex               mLock;
     APerformanceHintSession* mHintSession = nullptr;
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include "AsyncSampleRateConverter.h"
+
+using namespace oboe;
+using namespace resampler;
+
+// The fill level jumps by a whole burst every time either side runs.
+// Average that out before the controller sees it, or the ratio would wobble.
+static constexpr double kSmoothingTimeSeconds = 0.25;
+// Time constant of the control loop. Slower loops change the pitch less abruptly
+// but let the fill level wander further from the target while they catch up.
+static constexpr double kLoopTimeSeconds = 4.0;
+
+AsyncSampleRateConverter::AsyncSampleRateConverter(int32_t channelCount,
+                                                   int32_t sampleRate,
+                                                   int32_t targetFillFrames,
+                                                   int32_t capacityInFrames,
+                                                   MultiChannelResampler::Quality quality)
+        : mChannelCount(channelCount)
+        , mSampleRate(sampleRate)
+        , mTargetFillFrames(targetFillFrames)
+        , mFifo(static_cast<uint32_t>(channelCount) * sizeof(float),
+                FifoBuffer::roundUpToPowerOfTwo(static_cast<uint32_t>(capacityInFrames)))
+        , mResampler(MultiChannelResampler::make(channelCount, sampleRate, sampleRate, quality,
+                                                 true /* variableRatio */))
+        , mSilence(std::make_unique<float[]>(channelCount)) {
+    // A critically damped second order loop, in units of frames.
+    const double naturalFrequency = 1.0 / (kLoopTimeSeconds * sampleRate);
+    mProportionalGain = 2.0 * naturalFrequency;
+    mIntegralGain = naturalFrequency * naturalFrequency;
+    mSmoothingPerFrame = 1.0 / (kSmoothingTimeSeconds * sampleRate);
+}
+
+int32_t AsyncSampleRateConverter::write(const float *buffer, int32_t numFrames,
+                                        int64_t lastFrameTimeNanos) {
+    int32_t framesWritten = std::max(0, mFifo.write(buffer, numFrames));
+    mLastWriteFrames.store(numFrames, std::memory_order_relaxed);
+    mLastFrameTimeNanos.store(lastFrameTimeNanos, std::memory_order_release);
+    if (framesWritten < numFrames) {
+        mOverflowCount.store(mOverflowCount.load(std::memory_order_relaxed)
+                             + (numFrames - framesWritten), std::memory_order_relaxed);
+    }
+    return framesWritten;
+}
+
+const float *AsyncSampleRateConverter::getInputFrame(const FifoBuffer::Regions &regions,
+                                                     int32_t index) const {
+    const FifoBuffer::Region &region = (index < regions.first.numFrames)
+            ? regions.first : regions.second;
+    if (index >= regions.first.numFrames) {
+        index -= regions.first.numFrames;
+    }
+    return reinterpret_cast<const float *>(region.data) + index * mChannelCount;
+}
+
+double AsyncSampleRateConverter::getPendingFrames(int64_t timeNanos) const {
+    int64_t lastFrameTimeNanos = mLastFrameTimeNanos.load(std::memory_order_acquire);
+    if (lastFrameTimeNanos == 0) {
+        return 0.0;
+    }
+    double pendingFrames = (timeNanos - lastFrameTimeNanos) * 1.0e-9 * mSampleRate;
+    // More than one write late means the producer has stalled, not that frames are pending.
+    double maxPendingFrames = mLastWriteFrames.load(std::memory_order_relaxed);
+    return std::max(0.0, std::min(pendingFrames, maxPendingFrames));
+}
+
+void AsyncSampleRateConverter::updateCorrection(double fillFrames, int32_t numFrames) {
+    double smoothedFillFrames = mSmoothedFillFrames.load(std::memory_order_relaxed);
+    double smoothing = std::min(1.0, mSmoothingPerFrame * numFrames);
+    smoothedFillFrames += smoothing * (fillFrames - smoothedFillFrames);
+    mSmoothedFillFrames.store(smoothedFillFrames, std::memory_order_relaxed);
+
+    // A positive error means the producer is ahead so the input must be consumed faster.
+    double error = smoothedFillFrames - getTargetFillFrames();
+    double integral = mIntegral + (error * numFrames);
+    double correction = (mProportionalGain * error) + (mIntegralGain * integral);
+    if (correction > kMaxCorrection) {
+        correction = kMaxCorrection;
+    } else if (correction < -kMaxCorrection) {
+        correction = -kMaxCorrection;
+    } else {
+        // Only integrate while not limited so the integral does not wind up.
+        mIntegral = integral;
+    }
+    mCorrection.store(correction, std::memory_order_relaxed);
+    mResampler->setRatio(1.0 + correction);
+}
+
+int32_t AsyncSampleRateConverter::read(float *buffer, int32_t numFrames, int64_t timeNanos) {
+    int32_t fifoFrames = getFillFrames();
+    double fillFrames = fifoFrames + getPendingFrames(timeNanos);
+    const int32_t targetFillFrames = getTargetFillFrames();
+    if (!mPrimed) {
+        if (fillFrames < targetFillFrames) {
+            memset(buffer, 0, static_cast<size_t>(numFrames) * mChannelCount * sizeof(float));
+            return 0;
+        }
+        // Skip the frames above the target so the controller starts without an error.
+        int32_t excessFrames = std::min(fifoFrames,
+                static_cast<int32_t>(fillFrames) - targetFillFrames);
+        mFifo.finishRead(excessFrames);
+        fifoFrames -= excessFrames;
+        fillFrames -= excessFrames;
+        mPrimed = true;
+        mSmoothedFillFrames.store(fillFrames, std::memory_order_relaxed);
+    }
+    updateCorrection(fillFrames, numFrames);
+
+    FifoBuffer::Regions regions;
+    const int32_t framesAvailable = mFifo.prepareToRead(fifoFrames, regions);
+    int32_t framesConsumed = 0;
+    int32_t framesConverted = numFrames;
+    float *output = buffer;
+    for (int32_t i = 0; i < numFrames; i++) {
+        while (mResampler->isWriteNeeded()) {
+            if (framesConsumed < framesAvailable) {
+                mResampler->writeNextFrame(getInputFrame(regions, framesConsumed++));
+            } else {
+                if (mPrimed) {
+                    // Wait for the target level again so the latency is restored.
+                    mPrimed = false;
+                    framesConverted = i;
+                    mUnderflowCount.store(mUnderflowCount.load(std::memory_order_relaxed) + 1,
+                                          std::memory_order_relaxed);
+                }
+                mResampler->writeNextFrame(mSilence.get());
+            }
+        }
+        mResampler->readNextFrame(output);
+        output += mChannelCount;
+    }
+    mFifo.finishRead(framesConsumed);
+    return framesConverted;
+}
+
+void AsyncSampleRateConverter::reset() {
+    mFifo.setReadCounter(mFifo.getWriteCounter());
+    mPrimed = false;
+    mIntegral = 0.0;
+    mLastFrameTimeNanos.store(0, std::memory_order_relaxed);
+    mSmoothedFillFrames.store(0.0, std::memory_order_relaxed);
+    mCorrection.store(0.0, std::memory_order_relaxed);
+    mResampler->setRatio(1.0);
+}
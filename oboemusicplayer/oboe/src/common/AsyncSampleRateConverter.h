@@ -0,0 +1,182 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_ASYNC_SAMPLE_RATE_CONVERTER_H
+#define OBOE_ASYNC_SAMPLE_RATE_CONVERTER_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+#include "oboe/FifoBuffer.h"
+#include "flowgraph/resampler/MultiChannelResampler.h"
+
+namespace oboe {
+
+/**
+ * Carries audio between two streams that run on independent clocks, for example
+ * a microphone stream and a speaker stream.
+ *
+ * The producer writes frames into a FIFO at the rate of its own clock. The consumer reads
+ * them through a MultiChannelResampler. A PI controller watches the fill level of the FIFO
+ * and adjusts the resampling ratio so that the fill level, and so the latency, stays at
+ * the target. Clock drift is absorbed by the resampler instead of by dropping or
+ * repeating frames.
+ *
+ * The FIFO level alone only changes in whole bursts, so two streams with the same burst
+ * size and nearly the same rate can drift for many seconds before it moves. The fill level
+ * therefore also counts the frames the producer has captured since the last frame it wrote,
+ * estimated from the timestamps passed to write() and read().
+ *
+ * There may be one producer thread calling write() and one consumer thread calling read().
+ * They may also be the same thread. Neither call blocks or allocates.
+ */
+class AsyncSampleRateConverter {
+public:
+    // Largest correction that the controller will apply, in either direction.
+    static constexpr double kMaxCorrection = 0.002; // 2000 ppm
+
+    /**
+     * @param channelCount samples per frame
+     * @param sampleRate nominal sample rate of both streams
+     * @param targetFillFrames FIFO level to hold, which is the latency that is added.
+     *        To avoid underflows this should be the producer burst plus the consumer burst
+     *        plus a margin of a few dozen frames.
+     * @param capacityInFrames FIFO size, must be larger than the target plus one write
+     * @param quality resampler quality, Fastest uses linear interpolation
+     */
+    AsyncSampleRateConverter(int32_t channelCount,
+                             int32_t sampleRate,
+                             int32_t targetFillFrames,
+                             int32_t capacityInFrames,
+                             resampler::MultiChannelResampler::Quality quality =
+                                     resampler::MultiChannelResampler::Quality::Medium);
+
+    /**
+     * Write frames from the producer. Frames that do not fit in the FIFO are dropped
+     * and counted by getOverflowCount().
+     *
+     * @param lastFrameTimeNanos CLOCK_MONOTONIC time at which the last frame was captured,
+     *                           or the current time if that is not known
+     * @return number of frames written
+     */
+    int32_t write(const float *buffer, int32_t numFrames, int64_t lastFrameTimeNanos);
+
+    /**
+     * Read exactly numFrames frames for the consumer.
+     *
+     * Silence is returned until the FIFO first reaches the target level. Any frames above
+     * the target at that point are skipped. If the FIFO runs dry the rest is filled with
+     * silence and the converter waits for the target level again, which is counted by
+     * getUnderflowCount().
+     *
+     * @param timeNanos current CLOCK_MONOTONIC time
+     * @return number of frames that came from the producer, the rest are silence
+     */
+    int32_t read(float *buffer, int32_t numFrames, int64_t timeNanos);
+
+    /**
+     * Empty the FIFO and reset the controller. Only call this from the consumer thread,
+     * or while neither side is running.
+     */
+    void reset();
+
+    int32_t getChannelCount() const {
+        return mChannelCount;
+    }
+
+    int32_t getTargetFillFrames() const {
+        return mTargetFillFrames.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Change the latency while running. The controller moves the fill level to the new
+     * target by resampling, so this does not glitch. Only call from the consumer thread.
+     *
+     * @param targetFillFrames new FIFO level, must leave room for one write in the FIFO
+     */
+    void setTargetFillFrames(int32_t targetFillFrames) {
+        mTargetFillFrames.store(targetFillFrames, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return frames currently in the FIFO
+     */
+    int32_t getFillFrames() {
+        return static_cast<int32_t>(mFifo.getFullFramesAvailable());
+    }
+
+    /**
+     * @return the low pass filtered fill level that the controller acts on,
+     * including the frames the producer has captured but not written yet
+     */
+    double getSmoothedFillFrames() const {
+        return mSmoothedFillFrames.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return current ratio correction in parts per million,
+     * positive when the producer clock is running faster than the consumer clock
+     */
+    double getCorrectionPpm() const {
+        return mCorrection.load(std::memory_order_relaxed) * 1.0e6;
+    }
+
+    /**
+     * @return number of times the FIFO ran dry after it was first filled
+     */
+    int32_t getUnderflowCount() const {
+        return mUnderflowCount.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return number of frames that were dropped because the FIFO was full
+     */
+    int64_t getOverflowCount() const {
+        return mOverflowCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    const float *getInputFrame(const FifoBuffer::Regions &regions, int32_t index) const;
+    double getPendingFrames(int64_t timeNanos) const;
+    void updateCorrection(double fillFrames, int32_t numFrames);
+
+    const int32_t mChannelCount;
+    const int32_t mSampleRate;
+    std::atomic<int32_t> mTargetFillFrames;
+    FifoBuffer    mFifo;
+    std::unique_ptr<resampler::MultiChannelResampler> mResampler;
+    std::unique_ptr<float[]> mSilence;
+
+    // PI controller gains, per frame of error and per frame of error per frame.
+    double  mProportionalGain = 0.0;
+    double  mIntegralGain = 0.0;
+    // How much of the new fill level is blended in per frame.
+    double  mSmoothingPerFrame = 0.0;
+    double  mIntegral = 0.0;
+    bool    mPrimed = false;
+
+    std::atomic<int64_t> mLastFrameTimeNanos{0};
+    std::atomic<int32_t> mLastWriteFrames{0};
+    std::atomic<double>  mSmoothedFillFrames{0.0};
+    std::atomic<double>  mCorrection{0.0};
+    std::atomic<int32_t> mUnderflowCount{0};
+    std::atomic<int64_t> mOverflowCount{0};
+};
+
+} // namespace oboe
+
+#endif //OBOE_ASYNC_SAMPLE_RATE_CONVERTER_H
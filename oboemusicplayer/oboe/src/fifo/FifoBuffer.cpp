@@ -66,88 +66,97 @@ int32_t FifoBuffer::convertFramesToBytes(int32_t frames) {
     return frames * mBytesPerFrame;
 }
 
-int32_t FifoBuffer::read(void *buffer, int32_t numFrames) {
+uint32_t FifoBuffer::roundUpToPowerOfTwo(uint32_t numFrames) {
+    uint32_t powerOfTwo = 1;
+    while (powerOfTwo < numFrames) {
+        powerOfTwo <<= 1;
+    }
+    return powerOfTwo;
+}
+
+void FifoBuffer::getRegions(uint32_t index, uint32_t numFrames, Regions &regions) {
+    // index ranges 0 to capacity
+    uint32_t framesToEnd = mFifo->getFrameCapacity() - index;
+    regions.first.data = &mStorage[static_cast<size_t>(index) * mBytesPerFrame];
+    if (numFrames > framesToEnd) {
+        // wraps around, second part is at the beginning of mStorage
+        regions.first.numFrames = static_cast<int32_t>(framesToEnd);
+        regions.second.data = &mStorage[0];
+        regions.second.numFrames = static_cast<int32_t>(numFrames - framesToEnd);
+    } else {
+        regions.first.numFrames = static_cast<int32_t>(numFrames);
+        regions.second.data = nullptr;
+        regions.second.numFrames = 0;
+    }
+}
+
+int32_t FifoBuffer::prepareToRead(int32_t numFrames, Regions &regions) {
     if (numFrames <= 0) {
+        regions = Regions();
         return 0;
     }
     // safe because numFrames is guaranteed positive
-    uint32_t framesToRead = static_cast<uint32_t>(numFrames);
-    uint32_t framesAvailable = mFifo->getFullFramesAvailable();
-    framesToRead = std::min(framesToRead, framesAvailable);
+    uint32_t framesToRead = std::min(static_cast<uint32_t>(numFrames),
+                                     mFifo->getFullFramesAvailable());
+    getRegions(mFifo->getReadIndex(), framesToRead, regions);
+    return static_cast<int32_t>(framesToRead);
+}
 
-    uint32_t readIndex = mFifo->getReadIndex(); // ranges 0 to capacity
-    uint8_t *destination = reinterpret_cast<uint8_t *>(buffer);
-    uint8_t *source = &mStorage[convertFramesToBytes(readIndex)];
-    if ((readIndex + framesToRead) > mFifo->getFrameCapacity()) {
-        // read in two parts, first part here is at the end of the mStorage buffer
-        int32_t frames1 = static_cast<int32_t>(mFifo->getFrameCapacity() - readIndex);
-        int32_t numBytes = convertFramesToBytes(frames1);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
-        destination += numBytes;
-        // read second part, which is at the beginning of mStorage
-        source = &mStorage[0];
-        int32_t frames2 = static_cast<uint32_t>(framesToRead - frames1);
-        numBytes = convertFramesToBytes(frames2);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
-    } else {
-        // just read in one shot
-        int32_t numBytes = convertFramesToBytes(framesToRead);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
+void FifoBuffer::finishRead(int32_t numFrames) {
+    if (numFrames > 0) {
+        mFifo->advanceReadIndex(static_cast<uint32_t>(numFrames));
     }
-    mFifo->advanceReadIndex(framesToRead);
-
-    return framesToRead;
 }
 
-int32_t FifoBuffer::write(const void *buffer, int32_t numFrames) {
+int32_t FifoBuffer::prepareToWrite(int32_t numFrames, Regions &regions) {
     if (numFrames <= 0) {
+        regions = Regions();
         return 0;
     }
     // Guaranteed positive.
-    uint32_t framesToWrite = static_cast<uint32_t>(numFrames);
-    uint32_t framesAvailable = mFifo->getEmptyFramesAvailable();
-    framesToWrite = std::min(framesToWrite, framesAvailable);
+    uint32_t framesToWrite = std::min(static_cast<uint32_t>(numFrames),
+                                      mFifo->getEmptyFramesAvailable());
+    getRegions(mFifo->getWriteIndex(), framesToWrite, regions);
+    return static_cast<int32_t>(framesToWrite);
+}
 
-    uint32_t writeIndex = mFifo->getWriteIndex();
-    int byteIndex = convertFramesToBytes(writeIndex);
-    const uint8_t *source = reinterpret_cast<const uint8_t *>(buffer);
-    uint8_t *destination = &mStorage[byteIndex];
-    if ((writeIndex + framesToWrite) > mFifo->getFrameCapacity()) {
-        // write in two parts, first part here
-        int32_t frames1 = static_cast<uint32_t>(mFifo->getFrameCapacity() - writeIndex);
-        int32_t numBytes = convertFramesToBytes(frames1);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
-        // read second part
-        source += convertFramesToBytes(frames1);
-        destination = &mStorage[0];
-        int frames2 = static_cast<uint32_t>(framesToWrite - frames1);
-        numBytes = convertFramesToBytes(frames2);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
-    } else {
-        // just write in one shot
-        int32_t numBytes = convertFramesToBytes(framesToWrite);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
+void FifoBuffer::finishWrite(int32_t numFrames) {
+    if (numFrames > 0) {
+        mFifo->advanceWriteIndex(static_cast<uint32_t>(numFrames));
     }
-    mFifo->advanceWriteIndex(framesToWrite);
+}
 
+int32_t FifoBuffer::read(void *buffer, int32_t numFrames) {
+    Regions regions;
+    int32_t framesToRead = prepareToRead(numFrames, regions);
+    if (framesToRead == 0) {
+        return 0;
+    }
+    uint8_t *destination = reinterpret_cast<uint8_t *>(buffer);
+    size_t numBytes1 = static_cast<size_t>(regions.first.numFrames) * mBytesPerFrame;
+    memcpy(destination, regions.first.data, numBytes1);
+    if (regions.second.numFrames > 0) {
+        memcpy(destination + numBytes1, regions.second.data,
+               static_cast<size_t>(regions.second.numFrames) * mBytesPerFrame);
+    }
+    finishRead(framesToRead);
+    return framesToRead;
+}
+
+int32_t FifoBuffer::write(const void *buffer, int32_t numFrames) {
+    Regions regions;
+    int32_t framesToWrite = prepareToWrite(numFrames, regions);
+    if (framesToWrite == 0) {
+        return 0;
+    }
+    const uint8_t *source = reinterpret_cast<const uint8_t *>(buffer);
+    size_t numBytes1 = static_cast<size_t>(regions.first.numFrames) * mBytesPerFrame;
+    memcpy(regions.first.data, source, numBytes1);
+    if (regions.second.numFrames > 0) {
+        memcpy(regions.second.data, source + numBytes1,
+               static_cast<size_t>(regions.second.numFrames) * mBytesPerFrame);
+    }
+    finishWrite(framesToWrite);
     return framesToWrite;
 }
 
@@ -26,6 +26,10 @@ namespace oboe {
 
 /**
  * A FifoControllerBase with counters contained in the class.
+ *
+ * Each counter is only incremented by one thread, the reader or the writer,
+ * so the increment is a plain load and store rather than a read-modify-write.
+ * That keeps both sides wait-free, even on CPUs where an atomic add is a retry loop.
  */
 class FifoController : public FifoControllerBase
 {
@@ -40,7 +44,8 @@ public:
         mReadCounter.store(n, std::memory_order_release);
     }
     virtual void incrementReadCounter(uint64_t n) override {
-        mReadCounter.fetch_add(n, std::memory_order_acq_rel);
+        mReadCounter.store(mReadCounter.load(std::memory_order_relaxed) + n,
+                           std::memory_order_release);
     }
     virtual uint64_t getWriteCounter() const override {
         return mWriteCounter.load(std::memory_order_acquire);
@@ -49,7 +54,8 @@ public:
         mWriteCounter.store(n, std::memory_order_release);
     }
     virtual void incrementWriteCounter(uint64_t n) override {
-        mWriteCounter.fetch_add(n, std::memory_order_acq_rel);
+        mWriteCounter.store(mWriteCounter.load(std::memory_order_relaxed) + n,
+                            std::memory_order_release);
     }
 
 private:
@@ -27,6 +27,11 @@ FifoControllerBase::FifoControllerBase(uint32_t capacityInFrames)
 {
     // Avoid ridiculously large buffers and the arithmetic wraparound issues that can follow.
     assert(capacityInFrames <= (UINT32_MAX / 4));
+    // A capacity of one is a power of two but would give a mask of zero.
+    // The modulo is just as good in that case.
+    if (capacityInFrames > 1 && (capacityInFrames & (capacityInFrames - 1)) == 0) {
+        mFrameMask = capacityInFrames - 1;
+    }
 }
 
 uint32_t FifoControllerBase::getFullFramesAvailable() const {
@@ -44,8 +49,7 @@ uint32_t FifoControllerBase::getFullFramesAvailable() const {
 }
 
 uint32_t FifoControllerBase::getReadIndex() const {
-    // % works with non-power of two sizes
-    return static_cast<uint32_t>(getReadCounter() % mTotalFrames);
+    return indexFromCounter(getReadCounter());
 }
 
 void FifoControllerBase::advanceReadIndex(uint32_t numFrames) {
@@ -57,8 +61,7 @@ uint32_t FifoControllerBase::getEmptyFramesAvailable() const {
 }
 
 uint32_t FifoControllerBase::getWriteIndex() const {
-    // % works with non-power of two sizes
-    return static_cast<uint32_t>(getWriteCounter() % mTotalFrames);
+    return indexFromCounter(getWriteCounter());
 }
 
 void FifoControllerBase::advanceWriteIndex(uint32_t numFrames) {
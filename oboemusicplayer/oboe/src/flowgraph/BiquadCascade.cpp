@@ -0,0 +1,284 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include "FlowGraphNode.h"
+#include "FlowgraphSimd.h"
+#include "BiquadCascade.h"
+
+#if FLOWGRAPH_SIMD_NEON
+#include <arm_neon.h>
+#elif FLOWGRAPH_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
+
+namespace {
+
+struct Prewarped {
+    float cosW;
+    float alpha;
+};
+
+Prewarped prewarp(float frequency, float q, int32_t sampleRate) {
+    float w = 2.0f * static_cast<float>(M_PI) * frequency / sampleRate;
+    return {cosf(w), sinf(w) / (2.0f * q)};
+}
+
+BiquadCoefficients normalize(float b0, float b1, float b2, float a0, float a1, float a2) {
+    return {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+}
+
+} // namespace
+
+BiquadCoefficients BiquadCoefficients::lowPass(float frequency, float q, int32_t sampleRate) {
+    Prewarped p = prewarp(frequency, q, sampleRate);
+    return normalize((1 - p.cosW) / 2, 1 - p.cosW, (1 - p.cosW) / 2,
+                     1 + p.alpha, -2 * p.cosW, 1 - p.alpha);
+}
+
+BiquadCoefficients BiquadCoefficients::highPass(float frequency, float q, int32_t sampleRate) {
+    Prewarped p = prewarp(frequency, q, sampleRate);
+    return normalize((1 + p.cosW) / 2, -(1 + p.cosW), (1 + p.cosW) / 2,
+                     1 + p.alpha, -2 * p.cosW, 1 - p.alpha);
+}
+
+BiquadCoefficients BiquadCoefficients::peaking(float frequency, float q, float gainDb,
+                                               int32_t sampleRate) {
+    Prewarped p = prewarp(frequency, q, sampleRate);
+    float a = powf(10.0f, gainDb / 40);
+    return normalize(1 + p.alpha * a, -2 * p.cosW, 1 - p.alpha * a,
+                     1 + p.alpha / a, -2 * p.cosW, 1 - p.alpha / a);
+}
+
+BiquadCoefficients BiquadCoefficients::lowShelf(float frequency, float q, float gainDb,
+                                                int32_t sampleRate) {
+    Prewarped p = prewarp(frequency, q, sampleRate);
+    float a = powf(10.0f, gainDb / 40);
+    float twoRootAAlpha = 2 * sqrtf(a) * p.alpha;
+    return normalize(a * ((a + 1) - (a - 1) * p.cosW + twoRootAAlpha),
+                     2 * a * ((a - 1) - (a + 1) * p.cosW),
+                     a * ((a + 1) - (a - 1) * p.cosW - twoRootAAlpha),
+                     (a + 1) + (a - 1) * p.cosW + twoRootAAlpha,
+                     -2 * ((a - 1) + (a + 1) * p.cosW),
+                     (a + 1) + (a - 1) * p.cosW - twoRootAAlpha);
+}
+
+BiquadCoefficients BiquadCoefficients::highShelf(float frequency, float q, float gainDb,
+                                                 int32_t sampleRate) {
+    Prewarped p = prewarp(frequency, q, sampleRate);
+    float a = powf(10.0f, gainDb / 40);
+    float twoRootAAlpha = 2 * sqrtf(a) * p.alpha;
+    return normalize(a * ((a + 1) + (a - 1) * p.cosW + twoRootAAlpha),
+                     -2 * a * ((a - 1) + (a + 1) * p.cosW),
+                     a * ((a + 1) + (a - 1) * p.cosW - twoRootAAlpha),
+                     (a + 1) - (a - 1) * p.cosW + twoRootAAlpha,
+                     2 * ((a - 1) - (a + 1) * p.cosW),
+                     (a + 1) - (a - 1) * p.cosW - twoRootAAlpha);
+}
+
+BiquadCascade::BiquadCascade(int32_t channelCount, int32_t numBands, int32_t rampFrames)
+        : FlowGraphFilter(channelCount)
+        , mNumBands(std::max(1, std::min(numBands, kMaxBands)))
+        , mRampFrames(std::max(1, rampFrames))
+        , mNumLanes((channelCount + kLanes - 1) / kLanes * kLanes) {
+    int32_t numCoefficients = mNumBands * kNumCoefficients * mNumLanes;
+    mCurrent.resize(numCoefficients);
+    mDelta.resize(numCoefficients);
+    mState.resize(mNumBands * kNumStates * mNumLanes);
+    mWork.resize(output.getFramesPerBuffer() * mNumLanes);
+    // Pass through, including the padding lanes, which only ever see silence.
+    for (int32_t band = 0; band < mNumBands; band++) {
+        for (int32_t lane = 0; lane < mNumLanes; lane++) {
+            mCurrent[coefficientIndex(band, 0, lane)] = 1.0f;
+        }
+    }
+    mTarget = mCurrent;
+    mPending = mCurrent;
+}
+
+void BiquadCascade::setBand(int32_t band, const BiquadCoefficients &coefficients) {
+    std::lock_guard<std::mutex> lock(mPendingLock);
+    for (int32_t channel = 0; channel < output.getSamplesPerFrame(); channel++) {
+        storeBand(band, channel, coefficients);
+    }
+    mPendingChanged.store(true, std::memory_order_release);
+}
+
+void BiquadCascade::setBand(int32_t band, int32_t channel,
+                            const BiquadCoefficients &coefficients) {
+    std::lock_guard<std::mutex> lock(mPendingLock);
+    storeBand(band, channel, coefficients);
+    mPendingChanged.store(true, std::memory_order_release);
+}
+
+void BiquadCascade::storeBand(int32_t band, int32_t channel,
+                              const BiquadCoefficients &coefficients) {
+    if (band < 0 || band >= mNumBands
+            || channel < 0 || channel >= output.getSamplesPerFrame()) {
+        return;
+    }
+    mPending[coefficientIndex(band, 0, channel)] = coefficients.b0;
+    mPending[coefficientIndex(band, 1, channel)] = coefficients.b1;
+    mPending[coefficientIndex(band, 2, channel)] = coefficients.b2;
+    mPending[coefficientIndex(band, 3, channel)] = coefficients.a1;
+    mPending[coefficientIndex(band, 4, channel)] = coefficients.a2;
+}
+
+void BiquadCascade::reset() {
+    FlowGraphFilter::reset();
+    std::fill(mState.begin(), mState.end(), 0.0f);
+    {
+        std::lock_guard<std::mutex> lock(mPendingLock);
+        mTarget = mPending;
+        mPendingChanged.store(false, std::memory_order_relaxed);
+    }
+    mCurrent = mTarget;
+    mRampFramesLeft = 0;
+}
+
+void BiquadCascade::updateCoefficients(int32_t numFrames) {
+    // Take new coefficients without waiting. If setBand() holds the lock, try next time.
+    if (mPendingChanged.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(mPendingLock, std::try_to_lock);
+        if (lock.owns_lock()) {
+            memcpy(mTarget.data(), mPending.data(), mTarget.size() * sizeof(float));
+            mPendingChanged.store(false, std::memory_order_relaxed);
+            lock.unlock();
+            for (size_t i = 0; i < mCurrent.size(); i++) {
+                mDelta[i] = (mTarget[i] - mCurrent[i]) / mRampFrames;
+            }
+            mRampFramesLeft = mRampFrames;
+        }
+    }
+    if (mRampFramesLeft == 0) {
+        return;
+    }
+    // The coefficients are held for the block. The blocks are short so this is smooth.
+    int32_t framesToStep = std::min(numFrames, mRampFramesLeft);
+    mRampFramesLeft -= framesToStep;
+    if (mRampFramesLeft == 0) {
+        mCurrent = mTarget;
+    } else {
+        for (size_t i = 0; i < mCurrent.size(); i++) {
+            mCurrent[i] += mDelta[i] * framesToStep;
+        }
+    }
+}
+
+int32_t BiquadCascade::onProcess(int32_t numFrames) {
+    const float *inputBuffer = input.getBuffer();
+    float *outputBuffer = output.getBuffer();
+    const int32_t channelCount = output.getSamplesPerFrame();
+
+    updateCoefficients(numFrames);
+
+    // Pad each frame to a whole number of vector registers.
+    float *work = mWork.data();
+    for (int32_t i = 0; i < numFrames; i++) {
+        memcpy(&work[i * mNumLanes], &inputBuffer[i * channelCount],
+               channelCount * sizeof(float));
+    }
+
+    int32_t lane = FlowgraphSimd::isEnabled() ? processVector(numFrames) : 0;
+    processScalar(lane, numFrames);
+
+    for (int32_t i = 0; i < numFrames; i++) {
+        memcpy(&outputBuffer[i * channelCount], &work[i * mNumLanes],
+               channelCount * sizeof(float));
+    }
+    return numFrames;
+}
+
+void BiquadCascade::processScalar(int32_t firstLane, int32_t numFrames) {
+    float *work = mWork.data();
+    // The padding lanes are silent, so only the real channels need filtering.
+    const int32_t channelCount = output.getSamplesPerFrame();
+    for (int32_t lane = firstLane; lane < channelCount; lane++) {
+        for (int32_t band = 0; band < mNumBands; band++) {
+            const float b0 = mCurrent[coefficientIndex(band, 0, lane)];
+            const float b1 = mCurrent[coefficientIndex(band, 1, lane)];
+            const float b2 = mCurrent[coefficientIndex(band, 2, lane)];
+            const float a1 = mCurrent[coefficientIndex(band, 3, lane)];
+            const float a2 = mCurrent[coefficientIndex(band, 4, lane)];
+            float *state = &mState[band * kNumStates * mNumLanes + lane];
+            float s1 = state[0];
+            float s2 = state[mNumLanes];
+            for (int32_t i = 0; i < numFrames; i++) {
+                float x = work[i * mNumLanes + lane];
+                float y = b0 * x + s1;
+                s1 = b1 * x - a1 * y + s2;
+                s2 = b2 * x - a2 * y;
+                work[i * mNumLanes + lane] = y;
+            }
+            state[0] = s1;
+            state[mNumLanes] = s2;
+        }
+    }
+}
+
+int32_t BiquadCascade::processVector(int32_t numFrames) {
+    int32_t lane = 0;
+#if FLOWGRAPH_SIMD_NEON || FLOWGRAPH_SIMD_SSE
+    float *work = mWork.data();
+    for (; lane + kLanes <= mNumLanes; lane += kLanes) {
+        for (int32_t band = 0; band < mNumBands; band++) {
+            float *state = &mState[band * kNumStates * mNumLanes + lane];
+#if FLOWGRAPH_SIMD_NEON
+            const float32x4_t b0 = vld1q_f32(&mCurrent[coefficientIndex(band, 0, lane)]);
+            const float32x4_t b1 = vld1q_f32(&mCurrent[coefficientIndex(band, 1, lane)]);
+            const float32x4_t b2 = vld1q_f32(&mCurrent[coefficientIndex(band, 2, lane)]);
+            const float32x4_t a1 = vld1q_f32(&mCurrent[coefficientIndex(band, 3, lane)]);
+            const float32x4_t a2 = vld1q_f32(&mCurrent[coefficientIndex(band, 4, lane)]);
+            float32x4_t s1 = vld1q_f32(&state[0]);
+            float32x4_t s2 = vld1q_f32(&state[mNumLanes]);
+            for (int32_t i = 0; i < numFrames; i++) {
+                float *frame = &work[i * mNumLanes + lane];
+                float32x4_t x = vld1q_f32(frame);
+                float32x4_t y = vaddq_f32(vmulq_f32(b0, x), s1);
+                s1 = vaddq_f32(vsubq_f32(vmulq_f32(b1, x), vmulq_f32(a1, y)), s2);
+                s2 = vsubq_f32(vmulq_f32(b2, x), vmulq_f32(a2, y));
+                vst1q_f32(frame, y);
+            }
+            vst1q_f32(&state[0], s1);
+            vst1q_f32(&state[mNumLanes], s2);
+#else
+            const __m128 b0 = _mm_loadu_ps(&mCurrent[coefficientIndex(band, 0, lane)]);
+            const __m128 b1 = _mm_loadu_ps(&mCurrent[coefficientIndex(band, 1, lane)]);
+            const __m128 b2 = _mm_loadu_ps(&mCurrent[coefficientIndex(band, 2, lane)]);
+            const __m128 a1 = _mm_loadu_ps(&mCurrent[coefficientIndex(band, 3, lane)]);
+            const __m128 a2 = _mm_loadu_ps(&mCurrent[coefficientIndex(band, 4, lane)]);
+            __m128 s1 = _mm_loadu_ps(&state[0]);
+            __m128 s2 = _mm_loadu_ps(&state[mNumLanes]);
+            for (int32_t i = 0; i < numFrames; i++) {
+                float *frame = &work[i * mNumLanes + lane];
+                __m128 x = _mm_loadu_ps(frame);
+                __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), s1);
+                s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), s2);
+                s2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+                _mm_storeu_ps(frame, y);
+            }
+            _mm_storeu_ps(&state[0], s1);
+            _mm_storeu_ps(&state[mNumLanes], s2);
+#endif
+        }
+    }
+#endif
+    return lane;
+}
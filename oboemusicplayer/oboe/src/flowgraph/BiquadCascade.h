@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOWGRAPH_BIQUAD_CASCADE_H
+#define FLOWGRAPH_BIQUAD_CASCADE_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "FlowGraphNode.h"
+
+namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph {
+
+/**
+ * Coefficients of a second order section, normalized so that a0 is 1.
+ * The factories follow the RBJ Audio EQ Cookbook.
+ */
+struct BiquadCoefficients {
+    float b0 = 1.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float a1 = 0.0f;
+    float a2 = 0.0f;
+
+    static BiquadCoefficients lowPass(float frequency, float q, int32_t sampleRate);
+    static BiquadCoefficients highPass(float frequency, float q, int32_t sampleRate);
+    static BiquadCoefficients peaking(float frequency, float q, float gainDb, int32_t sampleRate);
+    static BiquadCoefficients lowShelf(float frequency, float q, float gainDb, int32_t sampleRate);
+    static BiquadCoefficients highShelf(float frequency, float q, float gainDb, int32_t sampleRate);
+};
+
+/**
+ * A cascade of biquad filters in transposed direct form II, for example an EQ.
+ *
+ * Every channel has its own coefficients for each band, so several mono streams can be
+ * combined with a ManyToMultiConverter and filtered by one node, one channel per stream.
+ * The channels are processed four at a time in the lanes of a NEON or SSE register.
+ * The bands of a channel depend on each other so they always run in series.
+ *
+ * The coefficients may be set from any thread. The audio thread picks them up at the
+ * start of the next onProcess() without blocking and moves to them linearly over the
+ * ramp, so a change does not click.
+ */
+class BiquadCascade : public FlowGraphFilter {
+public:
+    static constexpr int32_t kMaxBands = 10;
+    static constexpr int32_t kDefaultRampFrames = 256;
+
+    /**
+     * All bands start as pass through.
+     *
+     * @param channelCount number of interleaved channels
+     * @param numBands number of filters in series, up to kMaxBands
+     * @param rampFrames frames over which to move to new coefficients
+     */
+    BiquadCascade(int32_t channelCount, int32_t numBands,
+                  int32_t rampFrames = kDefaultRampFrames);
+
+    int32_t getNumBands() const { return mNumBands; }
+
+    /**
+     * Set one band of every channel. May be called from any thread.
+     */
+    void setBand(int32_t band, const BiquadCoefficients &coefficients);
+
+    /**
+     * Set one band of one channel. May be called from any thread.
+     */
+    void setBand(int32_t band, int32_t channel, const BiquadCoefficients &coefficients);
+
+    int32_t onProcess(int32_t numFrames) override;
+
+    /**
+     * Clear the filter history and jump to the latest coefficients.
+     */
+    void reset() override;
+
+    const char *getName() override {
+        return "BiquadCascade";
+    }
+
+private:
+    // Coefficients are stored band by band, then b0, b1, b2, a1, a2, then one per lane.
+    static constexpr int32_t kNumCoefficients = 5;
+    // State is stored band by band, then s1, s2, then one per lane.
+    static constexpr int32_t kNumStates = 2;
+    static constexpr int32_t kLanes = 4;
+
+    int32_t coefficientIndex(int32_t band, int32_t coefficient, int32_t lane) const {
+        return (band * kNumCoefficients + coefficient) * mNumLanes + lane;
+    }
+
+    void storeBand(int32_t band, int32_t channel, const BiquadCoefficients &coefficients);
+    void updateCoefficients(int32_t numFrames);
+    void processScalar(int32_t firstLane, int32_t numFrames);
+    /**
+     * @return number of lanes that were processed with vector instructions,
+     *         the caller handles the remainder
+     */
+    int32_t processVector(int32_t numFrames);
+
+    const int32_t mNumBands;
+    const int32_t mRampFrames;
+    // Channel count rounded up to a whole number of vector registers.
+    const int32_t mNumLanes;
+
+    std::vector<float> mCurrent;
+    std::vector<float> mTarget;
+    std::vector<float> mDelta;
+    std::vector<float> mState;
+    // The frames being filtered, padded to mNumLanes samples per frame.
+    std::vector<float> mWork;
+    int32_t mRampFramesLeft = 0;
+
+    // Written by setBand(), copied to mTarget by the audio thread.
+    std::mutex mPendingLock;
+    std::vector<float> mPending;
+    std::atomic<bool> mPendingChanged{false};
+};
+
+} /* namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph */
+
+#endif //FLOWGRAPH_BIQUAD_CASCADE_H
@@ -18,6 +18,7 @@
 #include <unistd.h>
 #include "FlowGraphNode.h"
 #include "ClipToRange.h"
+#include "FlowgraphSimd.h"
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
@@ -30,9 +31,7 @@ int32_t ClipToRange::onProcess(int32_t numFrames) {
     float *outputBuffer = output.getBuffer();
 
     int32_t numSamples = numFrames * output.getSamplesPerFrame();
-    for (int32_t i = 0; i < numSamples; i++) {
-        *outputBuffer++ = std::min(mMaximum, std::max(mMinimum, *inputBuffer++));
-    }
+    FlowgraphSimd::clipToRange(inputBuffer, outputBuffer, numSamples, mMinimum, mMaximum);
 
     return numFrames;
 }
@@ -0,0 +1,469 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+
+#include "FlowGraphNode.h"
+#include "FlowgraphUtilities.h"
+#include "FlowgraphSimd.h"
+
+#if FLOWGRAPH_SIMD_NEON
+#include <arm_neon.h>
+#elif FLOWGRAPH_SIMD_SSE
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#endif
+
+using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
+
+static std::atomic<bool> sSimdEnabled{true};
+
+static constexpr int kBytesPerI24Packed = 3;
+static constexpr float kScaleI16ToFloat = 1.0f / 32768;
+static constexpr float kScaleP24ToFloat = 1.0 / (1UL << 31);
+static constexpr float kScaleFloatToI16 = 32768.0f;
+static constexpr float kScaleFloatToP24 = 0x00800000;
+static constexpr float kScaleFloatToI32 = (float)(1UL << 31);
+static constexpr float kScaleFloatToQ8_23 = 1 << 23;
+static constexpr int32_t kI24PackedMax = 0x007FFFFF;
+static constexpr int32_t kI24PackedMin = 0xFF800000;
+
+void FlowgraphSimd::setEnabled(bool enabled) {
+    sSimdEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool FlowgraphSimd::isEnabled() {
+    return isAvailable() && sSimdEnabled.load(std::memory_order_relaxed);
+}
+
+void FlowgraphSimd::convertI16ToFloat(const int16_t *source, float *destination,
+                                      int32_t numSamples) {
+    int32_t i = isEnabled() ? convertI16ToFloatVector(source, destination, numSamples) : 0;
+    for (; i < numSamples; i++) {
+        destination[i] = source[i] * kScaleI16ToFloat;
+    }
+}
+
+void FlowgraphSimd::convertP24ToFloat(const uint8_t *source, float *destination,
+                                      int32_t numSamples) {
+    int32_t i = isEnabled() ? convertP24ToFloatVector(source, destination, numSamples) : 0;
+    const uint8_t *byteData = &source[i * kBytesPerI24Packed];
+    for (; i < numSamples; i++) {
+        // Assemble the data assuming Little Endian format.
+        int32_t pad = byteData[2];
+        pad <<= 8;
+        pad |= byteData[1];
+        pad <<= 8;
+        pad |= byteData[0];
+        pad <<= 8; // Shift to 32 bit data so the sign is correct.
+        byteData += kBytesPerI24Packed;
+        destination[i] = pad * kScaleP24ToFloat; // scale to range -1.0 to 1.0
+    }
+}
+
+void FlowgraphSimd::convertI32ToFloat(const int32_t *source, float *destination,
+                                      int32_t numSamples, float scale) {
+    int32_t i = isEnabled()
+            ? convertI32ToFloatVector(source, destination, numSamples, scale) : 0;
+    for (; i < numSamples; i++) {
+        destination[i] = source[i] * scale;
+    }
+}
+
+void FlowgraphSimd::convertFloatToI16(const float *source, int16_t *destination,
+                                      int32_t numSamples) {
+    int32_t i = isEnabled() ? convertFloatToI16Vector(source, destination, numSamples) : 0;
+    for (; i < numSamples; i++) {
+        int32_t n = (int32_t) (source[i] * kScaleFloatToI16);
+        destination[i] = std::min(INT16_MAX, std::max(INT16_MIN, n)); // clip
+    }
+}
+
+void FlowgraphSimd::convertFloatToP24(const float *source, uint8_t *destination,
+                                      int32_t numSamples) {
+    int32_t i = isEnabled() ? convertFloatToP24Vector(source, destination, numSamples) : 0;
+    uint8_t *byteData = &destination[i * kBytesPerI24Packed];
+    for (; i < numSamples; i++) {
+        int32_t n = (int32_t) (source[i] * kScaleFloatToP24);
+        n = std::min(kI24PackedMax, std::max(kI24PackedMin, n)); // clip
+        // Write as a packed 24-bit integer in Little Endian format.
+        *byteData++ = (uint8_t) n;
+        *byteData++ = (uint8_t) (n >> 8);
+        *byteData++ = (uint8_t) (n >> 16);
+    }
+}
+
+void FlowgraphSimd::convertFloatToI32(const float *source, int32_t *destination,
+                                      int32_t numSamples) {
+    int32_t i = isEnabled() ? convertFloatToI32Vector(source, destination, numSamples) : 0;
+    for (; i < numSamples; i++) {
+        destination[i] = FlowgraphUtilities::clamp32FromFloat(source[i]);
+    }
+}
+
+void FlowgraphSimd::convertFloatToQ8_23(const float *source, int32_t *destination,
+                                        int32_t numSamples) {
+    int32_t i = isEnabled() ? convertFloatToQ8_23Vector(source, destination, numSamples) : 0;
+    for (; i < numSamples; i++) {
+        destination[i] = FlowgraphUtilities::clamp24FromFloat(source[i]);
+    }
+}
+
+void FlowgraphSimd::clipToRange(const float *source, float *destination,
+                                int32_t numSamples, float minimum, float maximum) {
+    int32_t i = isEnabled()
+            ? clipToRangeVector(source, destination, numSamples, minimum, maximum) : 0;
+    for (; i < numSamples; i++) {
+        destination[i] = std::min(maximum, std::max(minimum, source[i]));
+    }
+}
+
+#if FLOWGRAPH_SIMD_NEON
+
+// Round half away from zero without going through "x + 0.5", which can round up
+// in single precision. The truncated value and the fraction are both exact.
+static inline int32x4_t roundHalfAwayFromZero(float32x4_t value) {
+    int32x4_t truncated = vcvtq_s32_f32(value);
+    float32x4_t fraction = vsubq_f32(value, vcvtq_f32_s32(truncated));
+    // Comparisons return all ones, which is -1.
+    int32x4_t up = vreinterpretq_s32_u32(vcgeq_f32(fraction, vdupq_n_f32(0.5f)));
+    int32x4_t down = vreinterpretq_s32_u32(vcleq_f32(fraction, vdupq_n_f32(-0.5f)));
+    return vaddq_s32(vsubq_s32(truncated, up), down);
+}
+
+int32_t FlowgraphSimd::convertI16ToFloatVector(const int16_t *source, float *destination,
+                                               int32_t numSamples) {
+    const float32x4_t scale = vdupq_n_f32(kScaleI16ToFloat);
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        int16x8_t shorts = vld1q_s16(&source[i]);
+        float32x4_t low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(shorts)));
+        float32x4_t high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(shorts)));
+        vst1q_f32(&destination[i], vmulq_f32(low, scale));
+        vst1q_f32(&destination[i + 4], vmulq_f32(high, scale));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertP24ToFloatVector(const uint8_t *source, float *destination,
+                                               int32_t numSamples) {
+    // Move each 3 byte sample into the top of a 32-bit lane. Index 0xFF gives zero.
+    static const uint8_t kUnpack[16] = {0xFF, 0, 1, 2, 0xFF, 3, 4, 5,
+                                        0xFF, 6, 7, 8, 0xFF, 9, 10, 11};
+    const uint8x16_t unpack = vld1q_u8(kUnpack);
+    const float32x4_t scale = vdupq_n_f32(kScaleP24ToFloat);
+    int32_t i = 0;
+    // Each iteration loads 16 bytes but only consumes 12, so stay 6 samples from the end.
+    for (; i + 6 <= numSamples; i += 4) {
+        uint8x16_t bytes = vld1q_u8(&source[i * kBytesPerI24Packed]);
+        int32x4_t pad = vreinterpretq_s32_u8(vqtbl1q_u8(bytes, unpack));
+        vst1q_f32(&destination[i], vmulq_f32(vcvtq_f32_s32(pad), scale));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertI32ToFloatVector(const int32_t *source, float *destination,
+                                               int32_t numSamples, float scale) {
+    const float32x4_t scaleVector = vdupq_n_f32(scale);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        float32x4_t value = vcvtq_f32_s32(vld1q_s32(&source[i]));
+        vst1q_f32(&destination[i], vmulq_f32(value, scaleVector));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertFloatToI16Vector(const float *source, int16_t *destination,
+                                               int32_t numSamples) {
+    const float32x4_t scale = vdupq_n_f32(kScaleFloatToI16);
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        int32x4_t low = vcvtq_s32_f32(vmulq_f32(vld1q_f32(&source[i]), scale));
+        int32x4_t high = vcvtq_s32_f32(vmulq_f32(vld1q_f32(&source[i + 4]), scale));
+        // The saturating narrow is the same clip as the scalar code.
+        vst1q_s16(&destination[i], vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertFloatToP24Vector(const float *source, uint8_t *destination,
+                                               int32_t numSamples) {
+    // Pick the low 3 bytes of each 32-bit lane.
+    static const uint8_t kPack[16] = {0, 1, 2, 4, 5, 6, 8, 9,
+                                      10, 12, 13, 14, 0xFF, 0xFF, 0xFF, 0xFF};
+    const uint8x16_t pack = vld1q_u8(kPack);
+    const float32x4_t scale = vdupq_n_f32(kScaleFloatToP24);
+    const int32x4_t maximum = vdupq_n_s32(kI24PackedMax);
+    const int32x4_t minimum = vdupq_n_s32(kI24PackedMin);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        int32x4_t n = vcvtq_s32_f32(vmulq_f32(vld1q_f32(&source[i]), scale));
+        n = vminq_s32(maximum, vmaxq_s32(minimum, n));
+        uint8x16_t bytes = vqtbl1q_u8(vreinterpretq_u8_s32(n), pack);
+        uint8_t *byteData = &destination[i * kBytesPerI24Packed];
+        vst1_u8(byteData, vget_low_u8(bytes));
+        uint32_t last = vgetq_lane_u32(vreinterpretq_u32_u8(bytes), 2);
+        memcpy(byteData + 8, &last, sizeof(last));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertFloatToI32Vector(const float *source, int32_t *destination,
+                                               int32_t numSamples) {
+    const float32x4_t scale = vdupq_n_f32(kScaleFloatToI32);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t minusOne = vdupq_n_f32(-1.0f);
+    const int32x4_t maximum = vdupq_n_s32(INT32_MAX);
+    const int32x4_t minimum = vdupq_n_s32(INT32_MIN);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        float32x4_t value = vld1q_f32(&source[i]);
+        int32x4_t n = roundHalfAwayFromZero(vmulq_f32(value, scale));
+        n = vbslq_s32(vcgeq_f32(value, one), maximum, n);
+        n = vbslq_s32(vcleq_f32(value, minusOne), minimum, n);
+        vst1q_s32(&destination[i], n);
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertFloatToQ8_23Vector(const float *source, int32_t *destination,
+                                                 int32_t numSamples) {
+    const float32x4_t scale = vdupq_n_f32(kScaleFloatToQ8_23);
+    const float32x4_t maximum = vdupq_n_f32(kScaleFloatToQ8_23 - 1.f);
+    const float32x4_t minimum = vdupq_n_f32(-kScaleFloatToQ8_23);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        float32x4_t value = vmulq_f32(vld1q_f32(&source[i]), scale);
+        // The "nm" variants ignore NaN like fminf() and fmaxf().
+        value = vmaxnmq_f32(vminnmq_f32(value, maximum), minimum);
+        vst1q_s32(&destination[i], roundHalfAwayFromZero(value));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::clipToRangeVector(const float *source, float *destination,
+                                         int32_t numSamples, float minimum, float maximum) {
+    const float32x4_t minimumVector = vdupq_n_f32(minimum);
+    const float32x4_t maximumVector = vdupq_n_f32(maximum);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        float32x4_t value = vld1q_f32(&source[i]);
+        // Use compare and select rather than vmaxq/vminq, which propagate NaN.
+        value = vbslq_f32(vcgtq_f32(value, minimumVector), value, minimumVector);
+        value = vbslq_f32(vcltq_f32(value, maximumVector), value, maximumVector);
+        vst1q_f32(&destination[i], value);
+    }
+    return i;
+}
+
+#elif FLOWGRAPH_SIMD_SSE
+
+// Round half away from zero without going through "x + 0.5", which can round up
+// in single precision. The truncated value and the fraction are both exact.
+static inline __m128i roundHalfAwayFromZero(__m128 value) {
+    __m128i truncated = _mm_cvttps_epi32(value);
+    __m128 fraction = _mm_sub_ps(value, _mm_cvtepi32_ps(truncated));
+    // Comparisons return all ones, which is -1.
+    __m128i up = _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f)));
+    __m128i down = _mm_castps_si128(_mm_cmple_ps(fraction, _mm_set1_ps(-0.5f)));
+    return _mm_add_epi32(_mm_sub_epi32(truncated, up), down);
+}
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+int32_t FlowgraphSimd::convertI16ToFloatVector(const int16_t *source, float *destination,
+                                               int32_t numSamples) {
+    const __m128 scale = _mm_set1_ps(kScaleI16ToFloat);
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&source[i]));
+        // Sign extend by placing each short in the top half of a lane and shifting down.
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(shorts, shorts), 16);
+        _mm_storeu_ps(&destination[i], _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(&destination[i + 4], _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertP24ToFloatVector(const uint8_t *source, float *destination,
+                                               int32_t numSamples) {
+#if defined(__SSSE3__)
+    // Move each 3 byte sample into the top of a 32-bit lane. Index -1 gives zero.
+    const __m128i unpack = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                                         -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(kScaleP24ToFloat);
+    int32_t i = 0;
+    // Each iteration loads 16 bytes but only consumes 12, so stay 6 samples from the end.
+    for (; i + 6 <= numSamples; i += 4) {
+        __m128i bytes = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(&source[i * kBytesPerI24Packed]));
+        __m128i pad = _mm_shuffle_epi8(bytes, unpack);
+        _mm_storeu_ps(&destination[i], _mm_mul_ps(_mm_cvtepi32_ps(pad), scale));
+    }
+    return i;
+#else
+    (void) source;
+    (void) destination;
+    (void) numSamples;
+    return 0;
+#endif
+}
+
+int32_t FlowgraphSimd::convertI32ToFloatVector(const int32_t *source, float *destination,
+                                               int32_t numSamples, float scale) {
+    const __m128 scaleVector = _mm_set1_ps(scale);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128i ints = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&source[i]));
+        _mm_storeu_ps(&destination[i], _mm_mul_ps(_mm_cvtepi32_ps(ints), scaleVector));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertFloatToI16Vector(const float *source, int16_t *destination,
+                                               int32_t numSamples) {
+    const __m128 scale = _mm_set1_ps(kScaleFloatToI16);
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128i low = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&source[i]), scale));
+        __m128i high = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&source[i + 4]), scale));
+        // The saturating pack is the same clip as the scalar code.
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&destination[i]),
+                         _mm_packs_epi32(low, high));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertFloatToP24Vector(const float *source, uint8_t *destination,
+                                               int32_t numSamples) {
+#if defined(__SSSE3__)
+    // Pick the low 3 bytes of each 32-bit lane.
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9,
+                                       10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128 scale = _mm_set1_ps(kScaleFloatToP24);
+    const __m128i maximum = _mm_set1_epi32(kI24PackedMax);
+    const __m128i minimum = _mm_set1_epi32(kI24PackedMin);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128i n = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(&source[i]), scale));
+        n = select(_mm_cmpgt_epi32(n, maximum), maximum, n);
+        n = select(_mm_cmplt_epi32(n, minimum), minimum, n);
+        __m128i bytes = _mm_shuffle_epi8(n, pack);
+        uint8_t *byteData = &destination[i * kBytesPerI24Packed];
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(byteData), bytes);
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+        memcpy(byteData + 8, &last, sizeof(last));
+    }
+    return i;
+#else
+    (void) source;
+    (void) destination;
+    (void) numSamples;
+    return 0;
+#endif
+}
+
+int32_t FlowgraphSimd::convertFloatToI32Vector(const float *source, int32_t *destination,
+                                               int32_t numSamples) {
+    const __m128 scale = _mm_set1_ps(kScaleFloatToI32);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    const __m128i maximum = _mm_set1_epi32(INT32_MAX);
+    const __m128i minimum = _mm_set1_epi32(INT32_MIN);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128 value = _mm_loadu_ps(&source[i]);
+        __m128i n = roundHalfAwayFromZero(_mm_mul_ps(value, scale));
+        n = select(_mm_castps_si128(_mm_cmpge_ps(value, one)), maximum, n);
+        n = select(_mm_castps_si128(_mm_cmple_ps(value, minusOne)), minimum, n);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&destination[i]), n);
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::convertFloatToQ8_23Vector(const float *source, int32_t *destination,
+                                                 int32_t numSamples) {
+    const __m128 scale = _mm_set1_ps(kScaleFloatToQ8_23);
+    const __m128 maximum = _mm_set1_ps(kScaleFloatToQ8_23 - 1.f);
+    const __m128 minimum = _mm_set1_ps(-kScaleFloatToQ8_23);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128 value = _mm_mul_ps(_mm_loadu_ps(&source[i]), scale);
+        // minps and maxps return the second operand for NaN, like fminf() and fmaxf().
+        value = _mm_max_ps(_mm_min_ps(value, maximum), minimum);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&destination[i]),
+                         roundHalfAwayFromZero(value));
+    }
+    return i;
+}
+
+int32_t FlowgraphSimd::clipToRangeVector(const float *source, float *destination,
+                                         int32_t numSamples, float minimum, float maximum) {
+    const __m128 minimumVector = _mm_set1_ps(minimum);
+    const __m128 maximumVector = _mm_set1_ps(maximum);
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        // maxps(a, b) is (a > b) ? a : b, which matches std::max(minimum, value).
+        __m128 value = _mm_max_ps(_mm_loadu_ps(&source[i]), minimumVector);
+        // minps(a, b) is (a < b) ? a : b, which matches std::min(maximum, value).
+        value = _mm_min_ps(value, maximumVector);
+        _mm_storeu_ps(&destination[i], value);
+    }
+    return i;
+}
+
+#else // no vector support
+
+int32_t FlowgraphSimd::convertI16ToFloatVector(const int16_t *, float *, int32_t) {
+    return 0;
+}
+
+int32_t FlowgraphSimd::convertP24ToFloatVector(const uint8_t *, float *, int32_t) {
+    return 0;
+}
+
+int32_t FlowgraphSimd::convertI32ToFloatVector(const int32_t *, float *, int32_t, float) {
+    return 0;
+}
+
+int32_t FlowgraphSimd::convertFloatToI16Vector(const float *, int16_t *, int32_t) {
+    return 0;
+}
+
+int32_t FlowgraphSimd::convertFloatToP24Vector(const float *, uint8_t *, int32_t) {
+    return 0;
+}
+
+int32_t FlowgraphSimd::convertFloatToI32Vector(const float *, int32_t *, int32_t) {
+    return 0;
+}
+
+int32_t FlowgraphSimd::convertFloatToQ8_23Vector(const float *, int32_t *, int32_t) {
+    return 0;
+}
+
+int32_t FlowgraphSimd::clipToRangeVector(const float *, float *, int32_t, float, float) {
+    return 0;
+}
+
+#endif
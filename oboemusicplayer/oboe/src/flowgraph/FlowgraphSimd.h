@@ -0,0 +1,145 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOWGRAPH_SIMD_H
+#define FLOWGRAPH_SIMD_H
+
+#include <stdint.h>
+
+#include "FlowGraphNode.h"
+
+// Vector paths are only compiled for instruction sets that every Android ABI of that
+// architecture guarantees, so no CPU feature probing is needed at run time.
+// 32-bit ARM is left scalar because its NEON unit flushes denormals to zero,
+// which would not match the scalar rounding behavior.
+#ifndef FLOWGRAPH_SIMD_NEON
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define FLOWGRAPH_SIMD_NEON 1
+#else
+#define FLOWGRAPH_SIMD_NEON 0
+#endif
+#endif // FLOWGRAPH_SIMD_NEON
+
+#ifndef FLOWGRAPH_SIMD_SSE
+#if defined(__SSE2__)
+#define FLOWGRAPH_SIMD_SSE 1
+#else
+#define FLOWGRAPH_SIMD_SSE 0
+#endif
+#endif // FLOWGRAPH_SIMD_SSE
+
+namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph {
+
+/**
+ * Sample format conversion kernels shared by the Source and Sink nodes.
+ *
+ * Each kernel runs a NEON or SSE loop over as many samples as it can and then finishes
+ * the remainder with the original scalar code. The vector loops produce bit-identical
+ * results to the scalar loops, including rounding, clipping and the handling of
+ * NaN and infinity.
+ *
+ * The vector path can be switched off at run time, which is mainly useful for
+ * comparing it against the scalar reference.
+ */
+class FlowgraphSimd {
+public:
+    /**
+     * @return true if a vector implementation was compiled in for this architecture
+     */
+    static bool isAvailable() {
+        return FLOWGRAPH_SIMD_NEON || FLOWGRAPH_SIMD_SSE;
+    }
+
+    /**
+     * @param enabled false to force the scalar implementation
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @return true if the vector implementation is available and enabled
+     */
+    static bool isEnabled();
+
+    static void convertI16ToFloat(const int16_t *source, float *destination,
+                                  int32_t numSamples);
+
+    /**
+     * Convert packed little endian 24-bit samples to float.
+     */
+    static void convertP24ToFloat(const uint8_t *source, float *destination,
+                                  int32_t numSamples);
+
+    /**
+     * Convert 32-bit integers to float by multiplying by the given scale.
+     * Used for both I32 and Q8.23 data.
+     */
+    static void convertI32ToFloat(const int32_t *source, float *destination,
+                                  int32_t numSamples, float scale);
+
+    /**
+     * Convert float to 16-bit integers by truncating and clipping.
+     */
+    static void convertFloatToI16(const float *source, int16_t *destination,
+                                  int32_t numSamples);
+
+    /**
+     * Convert float to packed little endian 24-bit samples by truncating and clipping.
+     */
+    static void convertFloatToP24(const float *source, uint8_t *destination,
+                                  int32_t numSamples);
+
+    /**
+     * Convert float to Q0.31 with the same rounding as FlowgraphUtilities::clamp32FromFloat().
+     */
+    static void convertFloatToI32(const float *source, int32_t *destination,
+                                  int32_t numSamples);
+
+    /**
+     * Convert float to Q8.23 with the same rounding as FlowgraphUtilities::clamp24FromFloat().
+     */
+    static void convertFloatToQ8_23(const float *source, int32_t *destination,
+                                    int32_t numSamples);
+
+    /**
+     * Clip each sample to [minimum, maximum] exactly like
+     * std::min(maximum, std::max(minimum, sample)), so NaN becomes the minimum.
+     */
+    static void clipToRange(const float *source, float *destination,
+                            int32_t numSamples, float minimum, float maximum);
+
+private:
+    // Each returns the number of samples that were processed with vector instructions.
+    static int32_t convertI16ToFloatVector(const int16_t *source, float *destination,
+                                           int32_t numSamples);
+    static int32_t convertP24ToFloatVector(const uint8_t *source, float *destination,
+                                           int32_t numSamples);
+    static int32_t convertI32ToFloatVector(const int32_t *source, float *destination,
+                                           int32_t numSamples, float scale);
+    static int32_t convertFloatToI16Vector(const float *source, int16_t *destination,
+                                           int32_t numSamples);
+    static int32_t convertFloatToP24Vector(const float *source, uint8_t *destination,
+                                           int32_t numSamples);
+    static int32_t convertFloatToI32Vector(const float *source, int32_t *destination,
+                                           int32_t numSamples);
+    static int32_t convertFloatToQ8_23Vector(const float *source, int32_t *destination,
+                                             int32_t numSamples);
+    static int32_t clipToRangeVector(const float *source, float *destination,
+                                     int32_t numSamples, float minimum, float maximum);
+};
+
+} /* namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph */
+
+#endif //FLOWGRAPH_SIMD_H
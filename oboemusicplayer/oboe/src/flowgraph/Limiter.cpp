@@ -18,8 +18,15 @@
 #include <math.h>
 #include <unistd.h>
 #include "FlowGraphNode.h"
+#include "FlowgraphSimd.h"
 #include "Limiter.h"
 
+#if FLOWGRAPH_SIMD_NEON
+#include <arm_neon.h>
+#elif FLOWGRAPH_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
 Limiter::Limiter(int32_t channelCount)
@@ -35,19 +42,91 @@ int32_t Limiter::onProcess(int32_t numFrames) {
     // Cache the last valid output to reduce memory read/write
     float lastValidOutput = mLastValidOutput;
 
-    for (int32_t i = 0; i < numSamples; i++) {
+    int32_t i = FlowgraphSimd::isEnabled()
+            ? processVector(inputBuffer, outputBuffer, numSamples, &lastValidOutput) : 0;
+    for (; i < numSamples; i++) {
         // Use the previous output if the input is NaN
-        if (!isnan(*inputBuffer)) {
-            lastValidOutput = processFloat(*inputBuffer);
+        if (!isnan(inputBuffer[i])) {
+            lastValidOutput = processFloat(inputBuffer[i]);
         }
-        inputBuffer++;
-        *outputBuffer++ = lastValidOutput;
+        outputBuffer[i] = lastValidOutput;
     }
     mLastValidOutput = lastValidOutput;
 
     return numFrames;
 }
 
+int32_t Limiter::processVector(const float *inputBuffer, float *outputBuffer,
+                               int32_t numSamples, float *lastValidOutput) {
+    int32_t i = 0;
+#if FLOWGRAPH_SIMD_NEON
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t knee = vdupq_n_f32(kXWhenYis3Decibels);
+    const float32x4_t ceiling = vdupq_n_f32(M_SQRT2);
+    const float32x4_t splineA = vdupq_n_f32(kPolynomialSplineA);
+    const float32x4_t splineB = vdupq_n_f32(kPolynomialSplineB);
+    const float32x4_t splineC = vdupq_n_f32(kPolynomialSplineC);
+    const uint32x4_t signBit = vdupq_n_u32(0x80000000);
+    for (; i + 4 <= numSamples; i += 4) {
+        float32x4_t in = vld1q_f32(&inputBuffer[i]);
+        if (vminvq_u32(vceqq_f32(in, in)) == 0) {
+            // At least one NaN so use the scalar code, which holds the last valid output.
+            for (int32_t j = i; j < i + 4; j++) {
+                if (!isnan(inputBuffer[j])) {
+                    *lastValidOutput = processFloat(inputBuffer[j]);
+                }
+                outputBuffer[j] = *lastValidOutput;
+            }
+            continue;
+        }
+        float32x4_t inAbs = vabsq_f32(in);
+        float32x4_t spline = vfmaq_f32(splineC, vfmaq_f32(splineB, splineA, inAbs), inAbs);
+        float32x4_t out = vbslq_f32(vcltq_f32(inAbs, knee), spline, ceiling);
+        out = vbslq_f32(signBit, in, out); // copy the sign of the input
+        out = vbslq_f32(vcleq_f32(inAbs, one), in, out);
+        vst1q_f32(&outputBuffer[i], out);
+        *lastValidOutput = vgetq_lane_f32(out, 3);
+    }
+#elif FLOWGRAPH_SIMD_SSE
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 knee = _mm_set1_ps(kXWhenYis3Decibels);
+    const __m128 ceiling = _mm_set1_ps(M_SQRT2);
+    const __m128 splineA = _mm_set1_ps(kPolynomialSplineA);
+    const __m128 splineB = _mm_set1_ps(kPolynomialSplineB);
+    const __m128 splineC = _mm_set1_ps(kPolynomialSplineC);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128 in = _mm_loadu_ps(&inputBuffer[i]);
+        if (_mm_movemask_ps(_mm_cmpunord_ps(in, in)) != 0) {
+            // At least one NaN so use the scalar code, which holds the last valid output.
+            for (int32_t j = i; j < i + 4; j++) {
+                if (!isnan(inputBuffer[j])) {
+                    *lastValidOutput = processFloat(inputBuffer[j]);
+                }
+                outputBuffer[j] = *lastValidOutput;
+            }
+            continue;
+        }
+        __m128 inAbs = _mm_andnot_ps(signBit, in);
+        __m128 spline = _mm_add_ps(_mm_mul_ps(
+                _mm_add_ps(_mm_mul_ps(splineA, inAbs), splineB), inAbs), splineC);
+        __m128 useSpline = _mm_cmplt_ps(inAbs, knee);
+        __m128 out = _mm_or_ps(_mm_and_ps(useSpline, spline), _mm_andnot_ps(useSpline, ceiling));
+        out = _mm_or_ps(out, _mm_and_ps(signBit, in)); // copy the sign of the input
+        __m128 passThrough = _mm_cmple_ps(inAbs, one);
+        out = _mm_or_ps(_mm_and_ps(passThrough, in), _mm_andnot_ps(passThrough, out));
+        _mm_storeu_ps(&outputBuffer[i], out);
+        *lastValidOutput = outputBuffer[i + 3];
+    }
+#else
+    (void) inputBuffer;
+    (void) outputBuffer;
+    (void) numSamples;
+    (void) lastValidOutput;
+#endif
+    return i;
+}
+
 float Limiter::processFloat(float in)
 {
     float in_abs = fabsf(in);
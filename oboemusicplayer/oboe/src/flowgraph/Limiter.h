@@ -55,6 +55,13 @@ private:
      */
     float processFloat(float in);
 
+    /**
+     * Vectorized version of the processing loop.
+     * @return number of samples processed, the caller handles the remainder
+     */
+    int32_t processVector(const float *inputBuffer, float *outputBuffer,
+                          int32_t numSamples, float *lastValidOutput);
+
     // Use the previous valid output for NaN inputs
     float mLastValidOutput = 0.0f;
 };
@@ -17,6 +17,8 @@
 #include <algorithm>
 #include <unistd.h>
 
+#include "FlowGraphNode.h"
+#include "FlowgraphSimd.h"
 #include "SinkI16.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -46,10 +48,8 @@ int32_t SinkI16::read(void *data, int32_t numFrames) {
         shortData += numSamples;
         signal += numSamples;
 #else
-        for (int i = 0; i < numSamples; i++) {
-            int32_t n = (int32_t) (*signal++ * 32768.0f);
-            *shortData++ = std::min(INT16_MAX, std::max(INT16_MIN, n)); // clip
-        }
+        FlowgraphSimd::convertFloatToI16(signal, shortData, numSamples);
+        shortData += numSamples;
 #endif
         framesLeft -= framesRead;
     }
@@ -19,6 +19,7 @@
 
 
 #include "FlowGraphNode.h"
+#include "FlowgraphSimd.h"
 #include "SinkI24.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -27,6 +28,8 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
+static constexpr int kBytesPerI24Packed = 3;
+
 SinkI24::SinkI24(int32_t channelCount)
         : FlowGraphSink(channelCount) {}
 
@@ -45,21 +48,10 @@ int32_t SinkI24::read(void *data, int32_t numFrames) {
         int32_t numSamples = framesRead * channelCount;
 #if FLOWGRAPH_ANDROID_INTERNAL
         memcpy_to_p24_from_float(byteData, floatData, numSamples);
-        static const int kBytesPerI24Packed = 3;
-        byteData += numSamples * kBytesPerI24Packed;
-        floatData += numSamples;
 #else
-        const int32_t kI24PackedMax = 0x007FFFFF;
-        const int32_t kI24PackedMin = 0xFF800000;
-        for (int i = 0; i < numSamples; i++) {
-            int32_t n = (int32_t) (*floatData++ * 0x00800000);
-            n = std::min(kI24PackedMax, std::max(kI24PackedMin, n)); // clip
-            // Write as a packed 24-bit integer in Little Endian format.
-            *byteData++ = (uint8_t) n;
-            *byteData++ = (uint8_t) (n >> 8);
-            *byteData++ = (uint8_t) (n >> 16);
-        }
+        FlowgraphSimd::convertFloatToP24(floatData, byteData, numSamples);
 #endif
+        byteData += numSamples * kBytesPerI24Packed;
         framesLeft -= framesRead;
     }
     return numFrames - framesLeft;
@@ -15,7 +15,7 @@
  */
 
 #include "FlowGraphNode.h"
-#include "FlowgraphUtilities.h"
+#include "FlowgraphSimd.h"
 #include "SinkI32.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -45,9 +45,8 @@ int32_t SinkI32::read(void *data, int32_t numFrames) {
         intData += numSamples;
         signal += numSamples;
 #else
-        for (int i = 0; i < numSamples; i++) {
-            *intData++ = FlowgraphUtilities::clamp32FromFloat(*signal++);
-        }
+        FlowgraphSimd::convertFloatToI32(signal, intData, numSamples);
+        intData += numSamples;
 #endif
         framesLeft -= framesRead;
     }
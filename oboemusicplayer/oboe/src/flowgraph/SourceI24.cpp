@@ -18,6 +18,7 @@
 #include <unistd.h>
 
 #include "FlowGraphNode.h"
+#include "FlowgraphSimd.h"
 #include "SourceI24.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -46,18 +47,7 @@ int32_t SourceI24::onProcess(int32_t numFrames) {
 #if FLOWGRAPH_ANDROID_INTERNAL
     memcpy_to_float_from_p24(floatData, byteData, numSamples);
 #else
-    static const float scale = 1. / (float)(1UL << 31);
-    for (int i = 0; i < numSamples; i++) {
-        // Assemble the data assuming Little Endian format.
-        int32_t pad = byteData[2];
-        pad <<= 8;
-        pad |= byteData[1];
-        pad <<= 8;
-        pad |= byteData[0];
-        pad <<= 8; // Shift to 32 bit data so the sign is correct.
-        byteData += kBytesPerI24Packed;
-        *floatData++ = pad * scale; // scale to range -1.0 to 1.0
-    }
+    FlowgraphSimd::convertP24ToFloat(byteData, floatData, numSamples);
 #endif
 
     mFrameIndex += framesToProcess;
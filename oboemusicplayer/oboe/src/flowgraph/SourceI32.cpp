@@ -18,6 +18,7 @@
 #include <unistd.h>
 
 #include "FlowGraphNode.h"
+#include "FlowgraphSimd.h"
 #include "SourceI32.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -44,9 +45,7 @@ int32_t SourceI32::onProcess(int32_t numFrames) {
 #if FLOWGRAPH_ANDROID_INTERNAL
     memcpy_to_float_from_i32(floatData, intData, numSamples);
 #else
-    for (int i = 0; i < numSamples; i++) {
-        *floatData++ = *intData++ * kScale;
-    }
+    FlowgraphSimd::convertI32ToFloat(intData, floatData, numSamples, kScale);
 #endif
 
     mFrameIndex += framesToProcess;
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <limits>
 #include <math.h>
 
 #include "IntegerRatio.h"
@@ -32,26 +34,49 @@ MultiChannelResampler::MultiChannelResampler(const MultiChannelResampler::Builde
         , mX(static_cast<size_t>(builder.getChannelCount())
                 * static_cast<size_t>(builder.getNumTaps()) * 2)
         , mSingleFrame(builder.getChannelCount())
+        , mVariableRatio(builder.isVariableRatio())
         , mChannelCount(builder.getChannelCount())
         {
-    // Reduce sample rates to the smallest ratio.
-    // For example 44100/48000 would become 147/160.
-    IntegerRatio ratio(builder.getInputRate(), builder.getOutputRate());
-    ratio.reduce();
-    mNumerator = ratio.getNumerator();
-    mDenominator = ratio.getDenominator();
+    if (mVariableRatio) {
+        // Use a fixed fine resolution so the numerator can be adjusted smoothly.
+        mDenominator = kVariableRatioDenominator;
+        mNumerator = static_cast<int32_t>(llround(
+                static_cast<double>(builder.getInputRate()) * mDenominator
+                / builder.getOutputRate()));
+    } else {
+        // Reduce sample rates to the smallest ratio.
+        // For example 44100/48000 would become 147/160.
+        IntegerRatio ratio(builder.getInputRate(), builder.getOutputRate());
+        ratio.reduce();
+        mNumerator = ratio.getNumerator();
+        mDenominator = ratio.getDenominator();
+    }
     mIntegerPhase = mDenominator; // so we start with a write needed
 }
 
+void MultiChannelResampler::setRatio(double ratio) {
+    if (!mVariableRatio || !(ratio > 0.0)) {
+        return;
+    }
+    // The phase table of the SincResampler is only valid while the phase is below the
+    // denominator, so only the numerator changes.
+    double numerator = ratio * mDenominator;
+    mNumerator = static_cast<int32_t>(llround(std::min(numerator,
+            static_cast<double>(std::numeric_limits<int32_t>::max() / 2))));
+    mNumerator = std::max(mNumerator, 1);
+}
+
 // static factory method
 MultiChannelResampler *MultiChannelResampler::make(int32_t channelCount,
                                                    int32_t inputRate,
                                                    int32_t outputRate,
-                                                   Quality quality) {
+                                                   Quality quality,
+                                                   bool variableRatio) {
     Builder builder;
     builder.setInputRate(inputRate);
     builder.setOutputRate(outputRate);
     builder.setChannelCount(channelCount);
+    builder.setVariableRatio(variableRatio);
 
     switch (quality) {
         case Quality::Fastest:
@@ -86,7 +111,9 @@ MultiChannelResampler *MultiChannelResampler::Builder::build() {
     }
     IntegerRatio ratio(getInputRate(), getOutputRate());
     ratio.reduce();
-    bool usePolyphase = (getNumTaps() * ratio.getDenominator()) <= kMaxCoefficients;
+    // Polyphase filters only have coefficients for the phases of one fixed ratio.
+    bool usePolyphase = !isVariableRatio()
+            && (getNumTaps() * ratio.getDenominator()) <= kMaxCoefficients;
     if (usePolyphase) {
         if (getChannelCount() == 1) {
             return new PolyphaseResamplerMono(*this);
@@ -122,6 +122,20 @@ public:
             return this;
         }
 
+        /**
+         * Allow the ratio to be changed with setRatio() while the resampler is running,
+         * for example to follow the drift between two audio clocks.
+         * This selects a resampler that interpolates between filter phases.
+         * Default is false.
+         *
+         * @param variableRatio true to allow setRatio()
+         * @return address of this builder for chaining calls
+         */
+        Builder *setVariableRatio(bool variableRatio) {
+            mVariableRatio = variableRatio;
+            return this;
+        }
+
         int32_t getNumTaps() const {
             return mNumTaps;
         }
@@ -142,12 +156,17 @@ public:
             return mNormalizedCutoff;
         }
 
+        bool isVariableRatio() const {
+            return mVariableRatio;
+        }
+
     protected:
         int32_t mChannelCount = 1;
         int32_t mNumTaps = 16;
         int32_t mInputRate = 48000;
         int32_t mOutputRate = 48000;
         float   mNormalizedCutoff = kDefaultNormalizedCutoff;
+        bool    mVariableRatio = false;
     };
 
     virtual ~MultiChannelResampler() = default;
@@ -159,12 +178,14 @@ public:
      * @param inputRate sample rate of the input stream
      * @param outputRate  sample rate of the output stream
      * @param quality higher quality sounds better but uses more CPU
+     * @param variableRatio true to allow setRatio(), see Builder::setVariableRatio()
      * @return an optimal resampler
      */
     static MultiChannelResampler *make(int32_t channelCount,
                                        int32_t inputRate,
                                        int32_t outputRate,
-                                       Quality quality);
+                                       Quality quality,
+                                       bool variableRatio = false);
 
     bool isWriteNeeded() const {
         return mIntegerPhase >= mDenominator;
@@ -190,6 +211,22 @@ public:
         advanceRead();
     }
 
+    /**
+     * Change the number of input frames that are consumed for each output frame.
+     * This only has an effect if the resampler was built with setVariableRatio(true).
+     * The ratio is quantized to a resolution of 1 / kVariableRatioDenominator.
+     *
+     * @param ratio inputRate / outputRate, usually the nominal ratio times a correction
+     */
+    void setRatio(double ratio);
+
+    /**
+     * @return number of input frames consumed for each output frame
+     */
+    double getRatio() const {
+        return static_cast<double>(mNumerator) / mDenominator;
+    }
+
     int getNumTaps() const {
         return mNumTaps;
     }
@@ -252,6 +289,8 @@ protected:
     }
 
     static constexpr int kMaxCoefficients = 8 * 1024;
+    // Phase resolution used when the ratio can change, about 0.06 ppm.
+    static constexpr int32_t kVariableRatioDenominator = 1 << 24;
     std::vector<float>   mCoefficients;
 
     const int            mNumTaps;
@@ -261,6 +300,7 @@ protected:
     int32_t              mIntegerPhase = 0;
     int32_t              mNumerator = 0;
     int32_t              mDenominator = 0;
+    const bool           mVariableRatio;
 
 
 private:
@@ -56,9 +56,12 @@ void AudioStreamBuffered::allocateFifo() {
             }
         }
 
-        mFifoBuffer = std::make_unique<FifoBuffer>(getBytesPerFrame(), capacityFrames);
+        // Round the storage up to a power of two so the FIFO can use masks instead of modulo.
+        // The extra frames are internal; the stream still reports the requested capacity.
+        mFifoBuffer = std::make_unique<FifoBuffer>(getBytesPerFrame(),
+                FifoBuffer::roundUpToPowerOfTwo(capacityFrames));
         mBufferCapacityInFrames = capacityFrames;
-        mBufferSizeInFrames = mBufferCapacityInFrames;
+        mBufferSizeInFrames = capacityFrames;
     }
 }
 
@@ -82,8 +85,12 @@ DataCallbackResult AudioStreamBuffered::onDefaultCallback(void *audioData, int n
         // Read from the FIFO and write to audioData, clear part of buffer if not enough data.
         framesTransferred = mFifoBuffer->readNow(audioData, numFrames);
     } else {
-        // Read from audioData and write to the FIFO
-        framesTransferred = mFifoBuffer->write(audioData, numFrames); // There is no writeNow()
+        // Read from audioData and write to the FIFO, up to the reported capacity.
+        // The FIFO storage may be larger, see allocateFifo().
+        int32_t emptyFrames = getBufferCapacityInFrames()
+                - static_cast<int32_t>(mFifoBuffer->getFullFramesAvailable());
+        int32_t framesToWrite = std::max(0, std::min(numFrames, emptyFrames));
+        framesTransferred = mFifoBuffer->write(audioData, framesToWrite); // There is no writeNow()
     }
 
     if (framesTransferred < numFrames) {
@@ -260,8 +267,8 @@ ResultWithValue<int32_t> AudioStreamBuffered::setBufferSizeInFrames(int32_t requ
         return ResultWithValue<int32_t>(Result::ErrorUnimplemented);
     }
 
-    if (requestedFrames > mFifoBuffer->getBufferCapacityInFrames()) {
-        requestedFrames = mFifoBuffer->getBufferCapacityInFrames();
+    if (requestedFrames > mBufferCapacityInFrames) {
+        requestedFrames = mBufferCapacityInFrames;
     } else if (requestedFrames < getFramesPerBurst()) {
         requestedFrames = getFramesPerBurst();
     }
@@ -271,7 +278,8 @@ ResultWithValue<int32_t> AudioStreamBuffered::setBufferSizeInFrames(int32_t requ
 
 int32_t AudioStreamBuffered::getBufferCapacityInFrames() const {
     if (mFifoBuffer) {
-        return mFifoBuffer->getBufferCapacityInFrames();
+        // The FIFO storage may be larger, see allocateFifo().
+        return mBufferCapacityInFrames;
     } else {
         return AudioStream::getBufferCapacityInFrames();
     }
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_TESTS_BENCHMARK_UTILITIES_H
+#define OBOE_TESTS_BENCHMARK_UTILITIES_H
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Microbenchmarks are tests named DISABLED_Benchmark, so they only run when asked for.
+ * Build with optimization and run them with
+ *     --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*
+ */
+
+/**
+ * Call function numCalls times.
+ * @return average duration of a call in nanoseconds
+ */
+template <typename Function>
+double benchmarkNanosPerCall(int64_t numCalls, Function &&function) {
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < numCalls; i++) {
+        function();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / numCalls;
+}
+
+#endif // OBOE_TESTS_BENCHMARK_UTILITIES_H
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "common/AdpfWrapper.h"
+
+// ADPF may or may not be supported on a device, but the calls must always be safe.
+TEST(TestAdpfWrapper, ReportWithoutSession) {
+    AdpfWrapper adpfWrapper;
+    EXPECT_FALSE(adpfWrapper.isOpen());
+    adpfWrapper.onBeginCallback();
+    adpfWrapper.onEndCallback(1.0);
+    adpfWrapper.reportActualDuration(1000000);
+    adpfWrapper.close();
+    EXPECT_FALSE(adpfWrapper.isOpen());
+}
+
+#ifndef __ANDROID__
+TEST(TestAdpfWrapper, HostStubRecordsHints) {
+    AdpfWrapper::resetHostStubRecord();
+    AdpfWrapper adpfWrapper;
+    constexpr int64_t kTargetNanos = 4 * 1000 * 1000;
+    ASSERT_EQ(0, adpfWrapper.open(gettid(), kTargetNanos));
+    ASSERT_TRUE(adpfWrapper.isOpen());
+
+    adpfWrapper.reportActualDuration(1000);
+    adpfWrapper.reportActualDuration(2000);
+    adpfWrapper.onBeginCallback();
+    adpfWrapper.onEndCallback(1.0);
+    adpfWrapper.close();
+    // Nothing is reported once the session is closed.
+    adpfWrapper.reportActualDuration(3000);
+
+    AdpfWrapper::HostStubRecord record = AdpfWrapper::getHostStubRecord();
+    EXPECT_EQ(1, record.openCount);
+    EXPECT_EQ(1, record.closeCount);
+    EXPECT_EQ(kTargetNanos, record.targetDurationNanos);
+    ASSERT_EQ(3u, record.actualDurationsNanos.size());
+    EXPECT_EQ(1000, record.actualDurationsNanos[0]);
+    EXPECT_EQ(2000, record.actualDurationsNanos[1]);
+    EXPECT_GE(record.actualDurationsNanos[2], 0);
+}
+#endif // __ANDROID__
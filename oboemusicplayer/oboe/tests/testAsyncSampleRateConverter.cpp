@@ -0,0 +1,219 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <oboe/Oboe.h>
+
+#include "common/AsyncSampleRateConverter.h"
+
+using namespace oboe;
+
+static constexpr int32_t kSampleRate = 48000;
+static constexpr int32_t kChannelCount = 1;
+static constexpr double kSineFrequency = 440.0;
+static constexpr double kSimulatedSeconds = 5 * 60.0; // one song
+static constexpr double kSettlingSeconds = 30.0;
+// Room for the resampler and for the controller to catch up at the start.
+static constexpr int32_t kMarginFrames = 64;
+
+/**
+ * A fake input stream and a fake output stream whose clocks are off from the nominal
+ * rate by a given number of ppm. The input writes a sine wave in bursts on its own
+ * schedule and the output reads bursts on its own schedule.
+ */
+class AsyncSampleRateConverterSimulation {
+public:
+    AsyncSampleRateConverterSimulation(double inputPpm, int32_t inputBurst,
+                                       double outputPpm, int32_t outputBurst)
+            : mInputBurst(inputBurst)
+            , mOutputBurst(outputBurst)
+            , mInputPeriod(inputBurst / (kSampleRate * (1.0 + inputPpm * 1.0e-6)))
+            , mOutputPeriod(outputBurst / (kSampleRate * (1.0 + outputPpm * 1.0e-6)))
+            , mConverter(kChannelCount, kSampleRate, inputBurst + outputBurst + kMarginFrames,
+                         4 * (inputBurst + outputBurst)) {
+    }
+
+    /**
+     * Change the target fill level part way through the run.
+     */
+    void setTargetChange(double timeSeconds, int32_t targetFillFrames) {
+        mTargetChangeTime = timeSeconds;
+        mNewTargetFillFrames = targetFillFrames;
+    }
+
+    void run() {
+        std::vector<float> inputBuffer(mInputBurst * kChannelCount);
+        std::vector<float> outputBuffer(mOutputBurst * kChannelCount);
+        const double phaseIncrement = 2.0 * M_PI * kSineFrequency / kSampleRate;
+        double inputPhase = 0.0;
+        double nextInputTime = 0.0;
+        double nextOutputTime = 0.0;
+        float previousValue = 0.0f;
+        float previousSlope = 0.0f;
+        int64_t framesSinceStart = 0;
+
+        while (nextOutputTime < kSimulatedSeconds) {
+            if (nextInputTime <= nextOutputTime) {
+                for (int32_t i = 0; i < mInputBurst; i++) {
+                    inputBuffer[i] = static_cast<float>(sin(inputPhase));
+                    inputPhase += phaseIncrement;
+                }
+                inputPhase = fmod(inputPhase, 2.0 * M_PI);
+                mConverter.write(inputBuffer.data(), mInputBurst, toNanos(nextInputTime));
+                nextInputTime += mInputPeriod;
+                continue;
+            }
+
+            if (mNewTargetFillFrames > 0 && nextOutputTime >= mTargetChangeTime) {
+                mConverter.setTargetFillFrames(mNewTargetFillFrames);
+                mNewTargetFillFrames = 0;
+            }
+            int32_t framesConverted = mConverter.read(outputBuffer.data(), mOutputBurst,
+                                                      toNanos(nextOutputTime));
+            if (framesConverted > 0 || mStarted) {
+                mStarted = true;
+                for (int32_t i = 0; i < mOutputBurst; i++) {
+                    // Look for glitches as spikes in the second derivative.
+                    float slope = outputBuffer[i] - previousValue;
+                    // Skip the start because the filter is primed with silence.
+                    if (framesSinceStart > 100) {
+                        mMaxSlopeDelta = std::max(mMaxSlopeDelta, fabsf(slope - previousSlope));
+                    }
+                    previousValue = outputBuffer[i];
+                    previousSlope = slope;
+                    framesSinceStart++;
+                }
+            }
+            if (nextOutputTime > kSettlingSeconds) {
+                double fillError = mConverter.getSmoothedFillFrames()
+                        - mConverter.getTargetFillFrames();
+                mMaxFillError = std::max(mMaxFillError, fabs(fillError));
+            }
+            nextOutputTime += mOutputPeriod;
+        }
+    }
+
+    AsyncSampleRateConverter &getConverter() {
+        return mConverter;
+    }
+
+    bool isStarted() const {
+        return mStarted;
+    }
+
+    float getMaxSlopeDelta() const {
+        return mMaxSlopeDelta;
+    }
+
+    double getMaxFillError() const {
+        return mMaxFillError;
+    }
+
+private:
+    static int64_t toNanos(double seconds) {
+        // Start at one second because zero means no timestamp.
+        return static_cast<int64_t>((1.0 + seconds) * 1.0e9);
+    }
+
+    const int32_t mInputBurst;
+    const int32_t mOutputBurst;
+    const double mInputPeriod;
+    const double mOutputPeriod;
+    AsyncSampleRateConverter mConverter;
+    double mTargetChangeTime = 0.0;
+    int32_t mNewTargetFillFrames = 0;
+    bool mStarted = false;
+    float mMaxSlopeDelta = 0.0f;
+    double mMaxFillError = 0.0;
+};
+
+static void checkDrift(double inputPpm, int32_t inputBurst,
+                       double outputPpm, int32_t outputBurst) {
+    AsyncSampleRateConverterSimulation simulation(inputPpm, inputBurst, outputPpm, outputBurst);
+    simulation.run();
+    AsyncSampleRateConverter &converter = simulation.getConverter();
+
+    ASSERT_TRUE(simulation.isStarted());
+    // No frames were dropped or repeated.
+    EXPECT_EQ(0, converter.getUnderflowCount());
+    EXPECT_EQ(0, converter.getOverflowCount());
+    // The correction matches the skew between the two clocks.
+    double expectedPpm = ((1.0 + inputPpm * 1.0e-6) / (1.0 + outputPpm * 1.0e-6) - 1.0) * 1.0e6;
+    EXPECT_NEAR(expectedPpm, converter.getCorrectionPpm(), 5.0);
+    // The latency stays at the target.
+    EXPECT_LT(simulation.getMaxFillError(), 4.0);
+    // A full scale sine at 440 Hz changes slope by about 0.0033 per frame.
+    EXPECT_LT(simulation.getMaxSlopeDelta(), 0.01f);
+}
+
+TEST(TestAsyncSampleRateConverter, NoDrift) {
+    checkDrift(0.0, 192, 0.0, 192);
+}
+
+TEST(TestAsyncSampleRateConverter, InputFast200Ppm) {
+    checkDrift(200.0, 192, 0.0, 192);
+}
+
+TEST(TestAsyncSampleRateConverter, InputSlow200Ppm) {
+    checkDrift(-200.0, 192, 0.0, 192);
+}
+
+TEST(TestAsyncSampleRateConverter, OppositeSkew200Ppm) {
+    checkDrift(200.0, 96, -200.0, 192);
+    checkDrift(-200.0, 240, 200.0, 96);
+}
+
+TEST(TestAsyncSampleRateConverter, ChangeTargetWithoutGlitch) {
+    AsyncSampleRateConverterSimulation simulation(200.0, 192, 0.0, 192);
+    const int32_t initialTarget = simulation.getConverter().getTargetFillFrames();
+    simulation.setTargetChange(10.0, initialTarget - 32);
+    simulation.run();
+    AsyncSampleRateConverter &converter = simulation.getConverter();
+
+    EXPECT_EQ(initialTarget - 32, converter.getTargetFillFrames());
+    EXPECT_EQ(0, converter.getUnderflowCount());
+    EXPECT_EQ(0, converter.getOverflowCount());
+    EXPECT_LT(simulation.getMaxFillError(), 4.0);
+    EXPECT_LT(simulation.getMaxSlopeDelta(), 0.01f);
+}
+
+TEST(TestAsyncSampleRateConverter, ResetWaitsForTarget) {
+    AsyncSampleRateConverter converter(kChannelCount, kSampleRate, 256, 1024);
+    std::vector<float> buffer(256, 0.5f);
+    const int64_t timeNanos = 1000000000;
+    converter.write(buffer.data(), 128, timeNanos);
+    EXPECT_EQ(0, converter.read(buffer.data(), 64, timeNanos));
+    EXPECT_EQ(0.0f, buffer[0]);
+    std::vector<float> moreFrames(256, 0.5f);
+    converter.write(moreFrames.data(), 128, timeNanos);
+    EXPECT_EQ(64, converter.read(buffer.data(), 64, timeNanos));
+
+    converter.reset();
+    EXPECT_EQ(0, converter.getFillFrames());
+    EXPECT_EQ(0, converter.read(buffer.data(), 64, timeNanos));
+    EXPECT_EQ(0.0, converter.getCorrectionPpm());
+}
+
+TEST(TestAsyncSampleRateConverter, OverflowIsCounted) {
+    AsyncSampleRateConverter converter(kChannelCount, kSampleRate, 64, 256);
+    std::vector<float> buffer(300, 0.0f);
+    EXPECT_EQ(256, converter.write(buffer.data(), 300, 1000000000));
+    EXPECT_EQ(44, converter.getOverflowCount());
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <oboe/Oboe.h>
+
+#include "flowgraph/BiquadCascade.h"
+#include "flowgraph/FlowgraphSimd.h"
+#include "flowgraph/SinkFloat.h"
+#include "flowgraph/SourceFloat.h"
+
+#include "BenchmarkUtilities.h"
+
+using namespace oboe::flowgraph;
+
+static constexpr int32_t kSampleRate = 48000;
+static constexpr int32_t kNumFrames = 4800;
+
+/**
+ * Plain transposed direct form II, one channel and one band at a time.
+ */
+class ReferenceBiquad {
+public:
+    explicit ReferenceBiquad(const BiquadCoefficients &coefficients)
+            : mCoefficients(coefficients) {}
+
+    float process(float x) {
+        const BiquadCoefficients &c = mCoefficients;
+        float y = c.b0 * x + mS1;
+        mS1 = c.b1 * x - c.a1 * y + mS2;
+        mS2 = c.b2 * x - c.a2 * y;
+        return y;
+    }
+
+private:
+    BiquadCoefficients mCoefficients;
+    float mS1 = 0.0f;
+    float mS2 = 0.0f;
+};
+
+// A different EQ for each channel so a mixed up lane shows.
+static std::vector<BiquadCoefficients> makeEq(int32_t channel, int32_t numBands) {
+    std::vector<BiquadCoefficients> bands;
+    for (int32_t band = 0; band < numBands; band++) {
+        float frequency = 100.0f * (band + 1) * (1.0f + 0.25f * channel);
+        switch (band % 4) {
+            case 0: bands.push_back(BiquadCoefficients::highPass(frequency, 0.7071f, kSampleRate));
+                break;
+            case 1: bands.push_back(BiquadCoefficients::peaking(frequency, 1.0f, 4.0f, kSampleRate));
+                break;
+            case 2: bands.push_back(BiquadCoefficients::lowShelf(frequency, 0.7071f, -3.0f,
+                                                                 kSampleRate));
+                break;
+            default: bands.push_back(BiquadCoefficients::lowPass(4 * frequency, 0.7071f,
+                                                                kSampleRate));
+                break;
+        }
+    }
+    return bands;
+}
+
+static std::vector<float> makeInput(int32_t channelCount) {
+    std::vector<float> input(kNumFrames * channelCount);
+    for (int32_t i = 0; i < kNumFrames; i++) {
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            input[i * channelCount + channel] = 0.5f * sinf(i * 0.031f * (channel + 1))
+                    + 0.25f * sinf(i * 0.7f + channel);
+        }
+    }
+    return input;
+}
+
+static std::vector<float> runCascade(BiquadCascade &cascade, const std::vector<float> &input,
+                                     int32_t channelCount) {
+    SourceFloat source(channelCount);
+    SinkFloat sink(channelCount);
+    source.output.connect(&cascade.input);
+    cascade.output.connect(&sink.input);
+    std::vector<float> output(input.size());
+    source.setData(input.data(), kNumFrames);
+    EXPECT_EQ(kNumFrames, sink.read(output.data(), kNumFrames));
+    return output;
+}
+
+static void checkAgainstReference(int32_t channelCount, int32_t numBands, bool simd) {
+    FlowgraphSimd::setEnabled(simd);
+    BiquadCascade cascade(channelCount, numBands);
+    std::vector<std::vector<ReferenceBiquad>> references(channelCount);
+    for (int32_t channel = 0; channel < channelCount; channel++) {
+        std::vector<BiquadCoefficients> eq = makeEq(channel, numBands);
+        for (int32_t band = 0; band < numBands; band++) {
+            cascade.setBand(band, channel, eq[band]);
+            references[channel].emplace_back(eq[band]);
+        }
+    }
+    // Start with the coefficients instead of ramping to them.
+    cascade.reset();
+
+    std::vector<float> input = makeInput(channelCount);
+    std::vector<float> output = runCascade(cascade, input, channelCount);
+    FlowgraphSimd::setEnabled(true);
+
+    for (int32_t i = 0; i < kNumFrames; i++) {
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            float expected = input[i * channelCount + channel];
+            for (ReferenceBiquad &biquad : references[channel]) {
+                expected = biquad.process(expected);
+            }
+            // Allow for fused multiply-add in either version.
+            ASSERT_NEAR(expected, output[i * channelCount + channel],
+                        1.0e-5f * std::max(1.0f, fabsf(expected)))
+                    << "channels = " << channelCount << ", bands = " << numBands
+                    << ", simd = " << simd << ", frame = " << i << ", channel = " << channel;
+        }
+    }
+}
+
+TEST(TestBiquadCascade, MatchesReference) {
+    for (int32_t channelCount : {1, 2, 3, 4, 5, 8}) {
+        for (int32_t numBands : {1, 4, BiquadCascade::kMaxBands}) {
+            checkAgainstReference(channelCount, numBands, false);
+            checkAgainstReference(channelCount, numBands, true);
+        }
+    }
+}
+
+TEST(TestBiquadCascade, PassThroughByDefault) {
+    constexpr int32_t kChannelCount = 2;
+    BiquadCascade cascade(kChannelCount, 4);
+    std::vector<float> input = makeInput(kChannelCount);
+    std::vector<float> output = runCascade(cascade, input, kChannelCount);
+    EXPECT_EQ(input, output);
+}
+
+TEST(TestBiquadCascade, RampsToNewCoefficients) {
+    constexpr int32_t kChannelCount = 1;
+    constexpr int32_t kRampFrames = 256;
+    BiquadCascade cascade(kChannelCount, 1, kRampFrames);
+    BiquadCoefficients half;
+    half.b0 = 0.5f;
+    cascade.setBand(0, half);
+
+    std::vector<float> input(kNumFrames * kChannelCount, 1.0f);
+    std::vector<float> output = runCascade(cascade, input, kChannelCount);
+    // The gain moves from 1 to 0.5 in small steps.
+    float maxStep = 0.0f;
+    for (int32_t i = 1; i < kNumFrames; i++) {
+        ASSERT_LE(output[i], output[i - 1]) << "frame = " << i;
+        maxStep = std::max(maxStep, output[i - 1] - output[i]);
+    }
+    EXPECT_LT(maxStep, 0.05f);
+    EXPECT_LT(output[0], 1.0f);
+    EXPECT_GT(output[kRampFrames / 2], 0.5f);
+    EXPECT_FLOAT_EQ(0.5f, output[kRampFrames]);
+    EXPECT_FLOAT_EQ(0.5f, output[kNumFrames - 1]);
+}
+
+// See BenchmarkUtilities.h.
+TEST(TestBiquadCascade, DISABLED_Benchmark) {
+    constexpr int32_t kFramesPerBurst = 192;
+    constexpr int32_t kNumBursts = 5000;
+    constexpr int32_t kNumBands = 8;
+    for (int32_t channelCount : {1, 2, 4, 8}) {
+        for (bool simd : {false, true}) {
+            FlowgraphSimd::setEnabled(simd);
+            BiquadCascade cascade(channelCount, kNumBands);
+            for (int32_t channel = 0; channel < channelCount; channel++) {
+                std::vector<BiquadCoefficients> eq = makeEq(channel, kNumBands);
+                for (int32_t band = 0; band < kNumBands; band++) {
+                    cascade.setBand(band, channel, eq[band]);
+                }
+            }
+            cascade.reset();
+            SourceFloat source(channelCount);
+            SinkFloat sink(channelCount);
+            source.output.connect(&cascade.input);
+            cascade.output.connect(&sink.input);
+            std::vector<float> input = makeInput(channelCount);
+            std::vector<float> output(kFramesPerBurst * channelCount);
+
+            double nanos = benchmarkNanosPerCall(kNumBursts, [&]() {
+                source.setData(input.data(), kFramesPerBurst);
+                sink.read(output.data(), kFramesPerBurst);
+            });
+            printf("%d channels %-6s %6.3f ns/sample/band\n", channelCount,
+                   simd ? "simd" : "scalar",
+                   nanos / (kFramesPerBurst * channelCount * kNumBands));
+        }
+    }
+    FlowgraphSimd::setEnabled(true);
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <oboe/Oboe.h>
+
+#include "BenchmarkUtilities.h"
+
+using namespace oboe;
+
+static constexpr int32_t kSamplesPerFrame = 2;
+static constexpr int32_t kBytesPerFrame = kSamplesPerFrame * sizeof(int16_t);
+
+// Write a ramp through the FIFO in odd sized blocks and check that it comes out unchanged.
+static void checkRamp(uint32_t capacity) {
+    FifoBuffer fifo(kBytesPerFrame, capacity);
+    std::vector<int16_t> block(capacity * kSamplesPerFrame);
+    int16_t writeValue = 0;
+    int16_t readValue = 0;
+    for (int32_t i = 0; i < 1000; i++) {
+        int32_t framesToWrite = 1 + ((i * 37) % capacity);
+        for (int32_t sample = 0; sample < framesToWrite * kSamplesPerFrame; sample++) {
+            block[sample] = writeValue + sample;
+        }
+        int32_t framesWritten = fifo.write(block.data(), framesToWrite);
+        writeValue += framesWritten * kSamplesPerFrame;
+
+        int32_t framesToRead = 1 + ((i * 53) % capacity);
+        int32_t framesRead = fifo.read(block.data(), framesToRead);
+        for (int32_t sample = 0; sample < framesRead * kSamplesPerFrame; sample++) {
+            ASSERT_EQ(static_cast<int16_t>(readValue + sample), block[sample]);
+        }
+        readValue += framesRead * kSamplesPerFrame;
+        int16_t samplesInFifo = writeValue - readValue;
+        ASSERT_EQ(static_cast<uint32_t>(samplesInFifo / kSamplesPerFrame),
+                  fifo.getFullFramesAvailable());
+    }
+}
+
+TEST(TestFifoBuffer, RoundUpToPowerOfTwo) {
+    EXPECT_EQ(1u, FifoBuffer::roundUpToPowerOfTwo(0));
+    EXPECT_EQ(1u, FifoBuffer::roundUpToPowerOfTwo(1));
+    EXPECT_EQ(2u, FifoBuffer::roundUpToPowerOfTwo(2));
+    EXPECT_EQ(4u, FifoBuffer::roundUpToPowerOfTwo(3));
+    EXPECT_EQ(1024u, FifoBuffer::roundUpToPowerOfTwo(960));
+    EXPECT_EQ(1024u, FifoBuffer::roundUpToPowerOfTwo(1024));
+    EXPECT_EQ(2048u, FifoBuffer::roundUpToPowerOfTwo(1025));
+}
+
+TEST(TestFifoBuffer, RampPowerOfTwo) {
+    checkRamp(256);
+}
+
+TEST(TestFifoBuffer, RampNotPowerOfTwo) {
+    checkRamp(250);
+}
+
+TEST(TestFifoBuffer, IndicesMatchAfterCounterSet) {
+    // Start near where a 32-bit counter would wrap.
+    for (uint32_t capacity : {512u, 500u}) {
+        FifoBuffer fifo(kBytesPerFrame, capacity);
+        uint64_t start = (1ULL << 32) - 100;
+        fifo.setReadCounter(start);
+        fifo.setWriteCounter(start);
+        std::vector<int16_t> block(300 * kSamplesPerFrame, 7);
+        for (int i = 0; i < 10; i++) {
+            ASSERT_EQ(300, fifo.write(block.data(), 300));
+            ASSERT_EQ(300, fifo.read(block.data(), 300));
+        }
+        EXPECT_EQ(start + 3000, fifo.getReadCounter());
+        EXPECT_EQ(0u, fifo.getFullFramesAvailable());
+    }
+}
+
+TEST(TestFifoBuffer, Regions) {
+    constexpr int32_t kCapacity = 64;
+    FifoBuffer fifo(kBytesPerFrame, kCapacity);
+    FifoBuffer::Regions regions;
+
+    // Move the indices close to the end.
+    std::vector<int16_t> block(kCapacity * kSamplesPerFrame);
+    ASSERT_EQ(60, fifo.write(block.data(), 60));
+    ASSERT_EQ(60, fifo.read(block.data(), 60));
+
+    // Write in place, across the end of the storage.
+    ASSERT_EQ(kCapacity, fifo.prepareToWrite(100, regions));
+    EXPECT_EQ(4, regions.first.numFrames);
+    EXPECT_EQ(60, regions.second.numFrames);
+    EXPECT_EQ(kCapacity, regions.getTotalFrames());
+    int16_t value = 0;
+    for (auto region : {regions.first, regions.second}) {
+        int16_t *samples = reinterpret_cast<int16_t *>(region.data);
+        for (int32_t i = 0; i < region.numFrames * kSamplesPerFrame; i++) {
+            samples[i] = value++;
+        }
+    }
+    // Nothing is visible until the write is finished.
+    EXPECT_EQ(0u, fifo.getFullFramesAvailable());
+    fifo.finishWrite(10);
+    EXPECT_EQ(10u, fifo.getFullFramesAvailable());
+    fifo.finishWrite(kCapacity - 10);
+
+    // Read in place, across the end of the storage.
+    ASSERT_EQ(kCapacity, fifo.prepareToRead(kCapacity, regions));
+    EXPECT_EQ(4, regions.first.numFrames);
+    EXPECT_EQ(60, regions.second.numFrames);
+    value = 0;
+    for (auto region : {regions.first, regions.second}) {
+        const int16_t *samples = reinterpret_cast<const int16_t *>(region.data);
+        for (int32_t i = 0; i < region.numFrames * kSamplesPerFrame; i++) {
+            ASSERT_EQ(value++, samples[i]);
+        }
+    }
+    fifo.finishRead(kCapacity);
+    EXPECT_EQ(0u, fifo.getFullFramesAvailable());
+
+    // An empty FIFO has nothing to read.
+    EXPECT_EQ(0, fifo.prepareToRead(10, regions));
+    EXPECT_EQ(0, regions.getTotalFrames());
+
+    // No wrap, so the second region is empty.
+    ASSERT_EQ(4, fifo.write(block.data(), 4));
+    fifo.finishRead(fifo.prepareToRead(4, regions));
+    ASSERT_EQ(8, fifo.prepareToWrite(8, regions));
+    EXPECT_EQ(8, regions.first.numFrames);
+    EXPECT_EQ(0, regions.second.numFrames);
+}
+
+// One thread writes a counting sequence while another reads it.
+TEST(TestFifoBuffer, SingleProducerSingleConsumer) {
+    constexpr int32_t kCapacity = 128;
+    constexpr int32_t kTotalFrames = 2000000;
+    FifoBuffer fifo(sizeof(int32_t), kCapacity);
+
+    std::thread writer([&fifo]() {
+        int32_t next = 0;
+        int32_t block[37];
+        while (next < kTotalFrames) {
+            int32_t framesToWrite = std::min(37, kTotalFrames - next);
+            for (int32_t i = 0; i < framesToWrite; i++) {
+                block[i] = next + i;
+            }
+            int32_t framesWritten = fifo.write(block, framesToWrite);
+            if (framesWritten == 0) {
+                std::this_thread::yield(); // in case there is only one CPU
+            }
+            next += framesWritten;
+        }
+    });
+
+    // Keep reading after an error so that the writer can finish.
+    int32_t expected = 0;
+    int32_t errorCount = 0;
+    while (expected < kTotalFrames) {
+        FifoBuffer::Regions regions;
+        int32_t framesRead = fifo.prepareToRead(29, regions);
+        for (auto region : {regions.first, regions.second}) {
+            const int32_t *values = reinterpret_cast<const int32_t *>(region.data);
+            for (int32_t i = 0; i < region.numFrames; i++) {
+                if (values[i] != expected) {
+                    errorCount++;
+                }
+                expected++;
+            }
+        }
+        fifo.finishRead(framesRead);
+        if (framesRead == 0) {
+            std::this_thread::yield();
+        }
+    }
+    writer.join();
+    EXPECT_EQ(0, errorCount);
+    EXPECT_EQ(kTotalFrames, expected);
+}
+
+// Compare a power of two capacity with one that needs a modulo.
+// See BenchmarkUtilities.h.
+TEST(TestFifoBuffer, DISABLED_Benchmark) {
+    constexpr int32_t kFramesPerBurst = 96;
+    constexpr int32_t kNumBursts = 1000000;
+    for (uint32_t capacity : {1024u, 960u}) {
+        FifoBuffer fifo(kBytesPerFrame, capacity);
+        std::vector<int16_t> block(kFramesPerBurst * kSamplesPerFrame);
+        double copyNanos = benchmarkNanosPerCall(kNumBursts, [&]() {
+            fifo.write(block.data(), kFramesPerBurst);
+            fifo.read(block.data(), kFramesPerBurst);
+        });
+
+        int64_t sum = 0;
+        double regionNanos = benchmarkNanosPerCall(kNumBursts, [&]() {
+            FifoBuffer::Regions regions;
+            fifo.finishWrite(fifo.prepareToWrite(kFramesPerBurst, regions));
+            int32_t framesRead = fifo.prepareToRead(kFramesPerBurst, regions);
+            sum += reinterpret_cast<int16_t *>(regions.first.data)[0];
+            fifo.finishRead(framesRead);
+        });
+
+        printf("capacity %4u: write/read %6.1f ns, regions %6.1f ns per burst (%d)\n",
+               capacity, copyNanos, regionNanos, static_cast<int>(sum));
+    }
+}
@@ -20,10 +20,13 @@
 
 #include "stdio.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 #include <oboe/Oboe.h>
 
 #include "flowgraph/ClipToRange.h"
+#include "flowgraph/FlowgraphSimd.h"
 #include "flowgraph/Limiter.h"
 #include "flowgraph/MonoToMultiConverter.h"
 #include "flowgraph/SourceFloat.h"
@@ -32,8 +35,13 @@
 #include "flowgraph/SinkI16.h"
 #include "flowgraph/SinkI24.h"
 #include "flowgraph/SinkI32.h"
+#include "flowgraph/SinkI8_24.h"
 #include "flowgraph/SourceI16.h"
 #include "flowgraph/SourceI24.h"
+#include "flowgraph/SourceI32.h"
+#include "flowgraph/SourceI8_24.h"
+
+#include "BenchmarkUtilities.h"
 
 using namespace oboe::flowgraph;
 
@@ -267,3 +275,349 @@ TEST(test_flowgraph, module_limiter_nan) {
         EXPECT_NEAR(expected[i], output[i], tolerance);
     }
 }
+
+// Run a conversion with the scalar code and then with the vector code.
+// The outputs must be bit-identical.
+template <typename InputType, typename OutputType, typename Convert>
+static void checkSimdMatchesScalar(const std::vector<InputType> &input,
+                                   int32_t numSamples,
+                                   int32_t outputElementsPerSample,
+                                   Convert convert) {
+    std::vector<OutputType> expected(numSamples * outputElementsPerSample);
+    std::vector<OutputType> actual(numSamples * outputElementsPerSample);
+    FlowgraphSimd::setEnabled(false);
+    convert(input.data(), expected.data(), numSamples);
+    FlowgraphSimd::setEnabled(true);
+    convert(input.data(), actual.data(), numSamples);
+    if (memcmp(expected.data(), actual.data(), expected.size() * sizeof(OutputType)) != 0) {
+        for (size_t i = 0; i < expected.size(); i++) {
+            if (memcmp(&expected[i], &actual[i], sizeof(OutputType)) != 0) {
+                ADD_FAILURE() << "mismatch at sample " << (i / outputElementsPerSample)
+                        << ", expected " << +expected[i] << ", actual " << +actual[i];
+                break;
+            }
+        }
+    }
+}
+
+// Every quantization level, the half way points between them and their neighbors.
+static void fillQuantizationEdges(std::vector<float> &values, float scale,
+                                  int64_t firstLevel, int64_t numLevels,
+                                  int64_t levelStride = 1) {
+    values.clear();
+    for (int64_t i = 0; i < numLevels; i++) {
+        int64_t level = firstLevel + i * levelStride;
+        for (float x : {(float) level, level + 0.5f}) {
+            float value = x / scale;
+            values.push_back(value);
+            values.push_back(nextafterf(value, INFINITY));
+            values.push_back(nextafterf(value, -INFINITY));
+        }
+    }
+}
+
+// Infinities, NaNs, denormals and a spread of bit patterns across the whole float range.
+static std::vector<float> makeSpecialFloats() {
+    std::vector<float> values = {0.0f, -0.0f, INFINITY, -INFINITY, NAN, -NAN,
+                                 1.0f, -1.0f, 2.0f, -2.0f, 1.0e10f, -1.0e10f,
+                                 FLT_MIN, -FLT_MIN, FLT_MAX, -FLT_MAX,
+                                 FLT_TRUE_MIN, -FLT_TRUE_MIN};
+    constexpr uint32_t kBitsStride = 65537; // prime, so all exponents are covered
+    for (uint64_t bits = 0; bits <= UINT32_MAX; bits += kBitsStride) {
+        uint32_t bits32 = (uint32_t) bits;
+        float value;
+        memcpy(&value, &bits32, sizeof(value));
+        values.push_back(value);
+    }
+    // Odd size so that the scalar tail is exercised.
+    if (values.size() % 2 == 0) values.push_back(0.25f);
+    return values;
+}
+
+static void checkFloatToIntegerConversion(float scale, int64_t minLevel, int64_t maxLevel,
+                                          int64_t levelStride,
+                                          void (*convert)(const float *, int32_t *, int32_t)) {
+    constexpr int64_t kLevelsPerBlock = 4095;
+    std::vector<float> values;
+    for (int64_t level = minLevel; level <= maxLevel; level += kLevelsPerBlock * levelStride) {
+        int64_t numLevels = std::min(kLevelsPerBlock, (maxLevel - level) / levelStride + 1);
+        fillQuantizationEdges(values, scale, level, numLevels, levelStride);
+        checkSimdMatchesScalar<float, int32_t>(values, values.size(), 1, convert);
+    }
+    std::vector<float> special = makeSpecialFloats();
+    checkSimdMatchesScalar<float, int32_t>(special, special.size(), 1, convert);
+}
+
+TEST(test_flowgraph, simd_i16_to_float) {
+    std::vector<int16_t> input;
+    for (int32_t i = INT16_MIN; i <= INT16_MAX; i++) {
+        input.push_back(i);
+    }
+    input.push_back(INT16_MIN); // odd size
+    checkSimdMatchesScalar<int16_t, float>(input, input.size(), 1,
+            FlowgraphSimd::convertI16ToFloat);
+}
+
+TEST(test_flowgraph, simd_p24_to_float) {
+    // Every 24-bit value, in blocks.
+    constexpr int32_t kSamplesPerBlock = 4099;
+    std::vector<uint8_t> input;
+    for (int32_t first = -(1 << 23); first < (1 << 23); first += kSamplesPerBlock) {
+        int32_t numSamples = std::min(kSamplesPerBlock, (1 << 23) - first);
+        input.resize(numSamples * kBytesPerI24Packed);
+        for (int32_t i = 0; i < numSamples; i++) {
+            int32_t n = first + i;
+            input[i * kBytesPerI24Packed] = (uint8_t) n;
+            input[i * kBytesPerI24Packed + 1] = (uint8_t) (n >> 8);
+            input[i * kBytesPerI24Packed + 2] = (uint8_t) (n >> 16);
+        }
+        checkSimdMatchesScalar<uint8_t, float>(input, numSamples, 1,
+                FlowgraphSimd::convertP24ToFloat);
+    }
+}
+
+TEST(test_flowgraph, simd_i32_to_float) {
+    std::vector<int32_t> input = {INT32_MIN, INT32_MAX, -1, 0, 1};
+    constexpr int64_t kStride = 65521;
+    for (int64_t n = INT32_MIN; n <= INT32_MAX; n += kStride) {
+        input.push_back((int32_t) n);
+        input.push_back((int32_t) (n | 0xFF)); // needs rounding to fit in a float
+    }
+    for (float scale : {1.0f / (1UL << 31), 1.0f / (1UL << 23)}) {
+        checkSimdMatchesScalar<int32_t, float>(input, input.size(), 1,
+                [scale](const int32_t *source, float *destination, int32_t numSamples) {
+                    FlowgraphSimd::convertI32ToFloat(source, destination, numSamples, scale);
+                });
+    }
+}
+
+TEST(test_flowgraph, simd_float_to_i16) {
+    std::vector<float> input;
+    fillQuantizationEdges(input, 32768.0f, INT16_MIN - 2, 65536 + 4);
+    input.push_back(0.5f); // odd size
+    checkSimdMatchesScalar<float, int16_t>(input, input.size(), 1,
+            FlowgraphSimd::convertFloatToI16);
+    std::vector<float> special = makeSpecialFloats();
+    checkSimdMatchesScalar<float, int16_t>(special, special.size(), 1,
+            FlowgraphSimd::convertFloatToI16);
+}
+
+TEST(test_flowgraph, simd_float_to_p24) {
+    constexpr int64_t kLevelsPerBlock = 4095;
+    std::vector<float> input;
+    for (int64_t level = -(1 << 23) - 2; level < (1 << 23) + 2; level += kLevelsPerBlock) {
+        fillQuantizationEdges(input, 0x00800000, level, kLevelsPerBlock);
+        checkSimdMatchesScalar<float, uint8_t>(input, input.size(), kBytesPerI24Packed,
+                FlowgraphSimd::convertFloatToP24);
+    }
+    std::vector<float> special = makeSpecialFloats();
+    checkSimdMatchesScalar<float, uint8_t>(special, special.size(), kBytesPerI24Packed,
+            FlowgraphSimd::convertFloatToP24);
+}
+
+TEST(test_flowgraph, simd_float_to_q8_23) {
+    checkFloatToIntegerConversion(1 << 23, -(1 << 23) - 2, (1 << 23) + 2, 1,
+            FlowgraphSimd::convertFloatToQ8_23);
+}
+
+TEST(test_flowgraph, simd_float_to_i32) {
+    // All levels near zero, where the half way points are representable,
+    // then a stride across the rest of the range.
+    checkFloatToIntegerConversion((float) (1UL << 31), -(1 << 24), 1 << 24, 1,
+            FlowgraphSimd::convertFloatToI32);
+    checkFloatToIntegerConversion((float) (1UL << 31), INT32_MIN - 2LL, INT32_MAX + 2LL, 4093,
+            FlowgraphSimd::convertFloatToI32);
+}
+
+TEST(test_flowgraph, simd_clip_to_range) {
+    std::vector<float> input;
+    fillQuantizationEdges(input, 1.0f, -3, 7);
+    std::vector<float> special = makeSpecialFloats();
+    input.insert(input.end(), special.begin(), special.end());
+    for (float limit : {kDefaultMaxHeadroom, 1.0f, 0.5f}) {
+        checkSimdMatchesScalar<float, float>(input, input.size(), 1,
+                [limit](const float *source, float *destination, int32_t numSamples) {
+                    FlowgraphSimd::clipToRange(source, destination, numSamples,
+                                               -limit, limit);
+                });
+    }
+}
+
+TEST(test_flowgraph, simd_limiter) {
+    constexpr int kNumSamples = 20001;
+    std::vector<float> input;
+    for (int i = 0; i < kNumSamples; i++) {
+        input.push_back(-3.0f + (6.0f * i) / (kNumSamples - 1));
+    }
+    // NaN in various lanes, including a whole vector of them.
+    for (int i : {1, 6, 7, 100, 101, 102, 103, 1003}) {
+        input[i] = NAN;
+    }
+    std::vector<float> special = makeSpecialFloats();
+    input.insert(input.end(), special.begin(), special.end());
+
+    auto runLimiter = [&input](std::vector<float> &output) {
+        SourceFloat sourceFloat{1};
+        Limiter limiter{1};
+        SinkFloat sinkFloat{1};
+        sourceFloat.setData(input.data(), input.size());
+        sourceFloat.output.connect(&limiter.input);
+        limiter.output.connect(&sinkFloat.input);
+        output.resize(input.size());
+        return sinkFloat.read(output.data(), output.size());
+    };
+    std::vector<float> expected;
+    std::vector<float> actual;
+    FlowgraphSimd::setEnabled(false);
+    ASSERT_EQ((int32_t) input.size(), runLimiter(expected));
+    FlowgraphSimd::setEnabled(true);
+    ASSERT_EQ((int32_t) input.size(), runLimiter(actual));
+    for (size_t i = 0; i < input.size(); i++) {
+        // The spline may or may not be fused into an FMA by the compiler.
+        EXPECT_FLOAT_EQ(expected[i], actual[i]) << ", i = " << i << ", input = " << input[i];
+    }
+}
+
+// Run each format node through a graph with odd block sizes and several channels.
+TEST(test_flowgraph, simd_nodes_match_scalar) {
+    constexpr int32_t kChannelCount = 3;
+    constexpr int32_t kNumFrames = 1001;
+    constexpr int32_t kNumSamples = kNumFrames * kChannelCount;
+    std::vector<float> floats(kNumSamples);
+    for (int32_t i = 0; i < kNumSamples; i++) {
+        floats[i] = 1.2f * sinf(i * 0.01f) + 0.0001f * i;
+    }
+
+    for (int32_t blockSize : {1, 7, 64, 192, kNumFrames}) {
+        std::vector<int16_t> i16[2];
+        std::vector<uint8_t> p24[2];
+        std::vector<int32_t> i32[2];
+        std::vector<int32_t> q8_23[2];
+        std::vector<float> roundTrip[2];
+        for (int pass = 0; pass < 2; pass++) {
+            FlowgraphSimd::setEnabled(pass == 1);
+            i16[pass].resize(kNumSamples);
+            p24[pass].resize(kNumSamples * kBytesPerI24Packed);
+            i32[pass].resize(kNumSamples);
+            q8_23[pass].resize(kNumSamples);
+            roundTrip[pass].resize(kNumSamples * 4);
+            auto writeAll = [&](FlowGraphSink &sink, uint8_t *data, int32_t bytesPerFrame) {
+                SourceFloat source{kChannelCount};
+                source.setData(floats.data(), kNumFrames);
+                source.output.connect(&sink.input);
+                for (int32_t frame = 0; frame < kNumFrames; frame += blockSize) {
+                    sink.read(data + frame * bytesPerFrame,
+                              std::min(blockSize, kNumFrames - frame));
+                }
+            };
+            SinkI16 sinkI16{kChannelCount};
+            writeAll(sinkI16, (uint8_t *) i16[pass].data(), kChannelCount * sizeof(int16_t));
+            SinkI24 sinkI24{kChannelCount};
+            writeAll(sinkI24, p24[pass].data(), kChannelCount * kBytesPerI24Packed);
+            SinkI32 sinkI32{kChannelCount};
+            writeAll(sinkI32, (uint8_t *) i32[pass].data(), kChannelCount * sizeof(int32_t));
+            SinkI8_24 sinkI8_24{kChannelCount};
+            writeAll(sinkI8_24, (uint8_t *) q8_23[pass].data(), kChannelCount * sizeof(int32_t));
+
+            auto readAll = [&](FlowGraphSourceBuffered &source, const void *data, float *output) {
+                SinkFloat sink{kChannelCount};
+                source.setData(data, kNumFrames);
+                source.output.connect(&sink.input);
+                for (int32_t frame = 0; frame < kNumFrames; frame += blockSize) {
+                    sink.read(output + frame * kChannelCount,
+                              std::min(blockSize, kNumFrames - frame));
+                }
+            };
+            SourceI16 sourceI16{kChannelCount};
+            readAll(sourceI16, i16[pass].data(), &roundTrip[pass][0]);
+            SourceI24 sourceI24{kChannelCount};
+            readAll(sourceI24, p24[pass].data(), &roundTrip[pass][kNumSamples]);
+            SourceI32 sourceI32{kChannelCount};
+            readAll(sourceI32, i32[pass].data(), &roundTrip[pass][2 * kNumSamples]);
+            SourceI8_24 sourceI8_24{kChannelCount};
+            readAll(sourceI8_24, q8_23[pass].data(), &roundTrip[pass][3 * kNumSamples]);
+        }
+        EXPECT_EQ(i16[0], i16[1]) << "blockSize = " << blockSize;
+        EXPECT_EQ(p24[0], p24[1]) << "blockSize = " << blockSize;
+        EXPECT_EQ(i32[0], i32[1]) << "blockSize = " << blockSize;
+        EXPECT_EQ(q8_23[0], q8_23[1]) << "blockSize = " << blockSize;
+        EXPECT_EQ(roundTrip[0], roundTrip[1]) << "blockSize = " << blockSize;
+    }
+}
+
+// Microbenchmarks for the format nodes, see BenchmarkUtilities.h.
+class FlowgraphBenchmark : public ::testing::Test {
+protected:
+    static constexpr int32_t kChannelCount = 2;
+    static constexpr int32_t kFramesPerBurst = 192;
+    static constexpr int32_t kNumBursts = 20000;
+
+    template <typename Function>
+    void measure(const char *name, Function runBurst) {
+        for (bool simd : {false, true}) {
+            FlowgraphSimd::setEnabled(simd);
+            double nanos = benchmarkNanosPerCall(kNumBursts, runBurst);
+            printf("%-12s %-6s %7.3f ns/sample\n", name, simd ? "simd" : "scalar",
+                   nanos / (kFramesPerBurst * kChannelCount));
+        }
+        FlowgraphSimd::setEnabled(true);
+    }
+
+    template <typename SinkType>
+    void measureSink(const char *name, void *data) {
+        SourceFloat source{kChannelCount};
+        SinkType sink{kChannelCount};
+        source.output.connect(&sink.input);
+        measure(name, [&]() {
+            source.setData(mFloats, kFramesPerBurst);
+            sink.read(data, kFramesPerBurst);
+        });
+    }
+
+    template <typename SourceType>
+    void measureSource(const char *name, const void *data) {
+        SourceType source{kChannelCount};
+        SinkFloat sink{kChannelCount};
+        source.output.connect(&sink.input);
+        measure(name, [&]() {
+            source.setData(data, kFramesPerBurst);
+            sink.read(mFloats, kFramesPerBurst);
+        });
+    }
+
+    template <typename FilterType>
+    void measureFilter(const char *name) {
+        SourceFloat source{kChannelCount};
+        FilterType filter{kChannelCount};
+        SinkFloat sink{kChannelCount};
+        source.output.connect(&filter.input);
+        filter.output.connect(&sink.input);
+        measure(name, [&]() {
+            source.setData(mFloats, kFramesPerBurst);
+            sink.read(mOutput, kFramesPerBurst);
+        });
+    }
+
+    void SetUp() override {
+        for (int32_t i = 0; i < kFramesPerBurst * kChannelCount; i++) {
+            mFloats[i] = 1.5f * sinf(i * 0.05f);
+        }
+    }
+
+    float mFloats[kFramesPerBurst * kChannelCount];
+    float mOutput[kFramesPerBurst * kChannelCount];
+    uint8_t mBytes[kFramesPerBurst * kChannelCount * sizeof(int32_t)] = {};
+};
+
+TEST_F(FlowgraphBenchmark, DISABLED_Benchmark) {
+    measureSource<SourceI16>("SourceI16", mBytes);
+    measureSource<SourceI24>("SourceI24", mBytes);
+    measureSource<SourceI32>("SourceI32", mBytes);
+    measureSource<SourceI8_24>("SourceI8_24", mBytes);
+    measureSink<SinkI16>("SinkI16", mBytes);
+    measureSink<SinkI24>("SinkI24", mBytes);
+    measureSink<SinkI32>("SinkI32", mBytes);
+    measureSink<SinkI8_24>("SinkI8_24", mBytes);
+    measureFilter<ClipToRange>("ClipToRange");
+    measureFilter<Limiter>("Limiter");
+}
@@ -7,23 +7,10 @@
 #include <chrono>
 #include <inttypes.h>  // For PRId64
 
-namespace little_endian_io
-{
-    template <typename Word>
-    std::ostream& write_word( std::ostream& outs, Word value, unsigned size = sizeof( Word ) )
-    {
-        for (; size; --size, value >>= 8)
-            outs.put( static_cast <char> (value & 0xFF) );
-        return outs;
-    }
-}
-
 extern JavaVM* g_javaVM;
 extern jobject g_callbackObject;
 
 
-using namespace little_endian_io;
-
 EarbackEngine::EarbackEngine() {
     assert(mOutputChannelCount == mInputChannelCount);
 }
@@ -86,9 +73,20 @@ oboe::Result EarbackEngine::openPlaybackStream() {
     warnIfNotLowLatency(mRecordingStream);
 
     mDuplexStream = std::make_unique<FullDuplexPass>();
+    mDuplexStream->getInput().setCushionBursts(mCushionBursts);
+    mDuplexStream->setEffects(&mVocalEffects);
+    mDuplexStream->setPitchTracker(&mPitchTracker);
+    mTakeFifo = std::make_unique<oboe::FifoBuffer>(
+            mInputChannelCount * sizeof(float), kTakeFifoSeconds * mSampleRate);
+    mDuplexStream->setTakeFifo(mTakeFifo.get());
     mDuplexStream->setSharedInputStream(mRecordingStream);
     mDuplexStream->setSharedOutputStream(mPlayStream);
-    mDuplexStream->start();
+    result = mDuplexStream->start();
+    if (result != oboe::Result::OK) {
+        __android_log_print(ANDROID_LOG_ERROR, "EarbackEngine", "Error starting streams: %s",
+                            oboe::convertToText(result));
+        closeStreams();
+    }
     return result;
 }
 
@@ -120,13 +118,124 @@ oboe::AudioStreamBuilder *EarbackEngine::setupCommonStreamParameters(
     return builder;
 }
 
+int32_t EarbackEngine::getCushionBursts() {
+    if (mDuplexStream) {
+        mCushionBursts = mDuplexStream->getInput().getCushionBursts();
+    }
+    return mCushionBursts;
+}
+
+double EarbackEngine::getRoundTripLatencyMillis() {
+    if (!mIsEffectOn || !mDuplexStream) {
+        return -1.0;
+    }
+    double framesPerMilli = mSampleRate / 1000.0;
+    // The microphone is read as soon as it is available, so the input stream only holds
+    // about a burst. The rest of the input latency is held by the drift compensation.
+    double compensationMillis = mDuplexStream->getInput().getTargetFrames() / framesPerMilli;
+    auto latency = mDuplexStream->calculateRoundTripLatencyMillis();
+    if (latency) {
+        return latency.value() + compensationMillis;
+    }
+    return (mRecordingStream->getFramesPerBurst() + mPlayStream->getBufferSizeInFrames())
+           / framesPerMilli + compensationMillis;
+}
+
 void EarbackEngine::closeStreams() {
+    stopTakeRecording();
     if (mDuplexStream) {
+        // Keep the tuned value for the next time the effect is turned on.
+        mCushionBursts = mDuplexStream->getInput().getCushionBursts();
         mDuplexStream->stop();
     }
     closeStream(mPlayStream);
     closeStream(mRecordingStream);
     mDuplexStream.reset();
+    mTakeFifo.reset();
+    mPerformanceHint.close();
+}
+
+bool EarbackEngine::startTakeRecording(const char *filePath) {
+    if (!mIsEffectOn || !mDuplexStream || !mTakeFifo || mTakeWriter.joinable()) {
+        return false;
+    }
+    mWavFilePath = filePath;
+    mWavFile.open(mWavFilePath, std::ios::binary | std::ios::trunc);
+    if (!mWavFile.is_open()) {
+        __android_log_print(ANDROID_LOG_ERROR, "EarbackEngine", "Cannot open %s",
+                            mWavFilePath.c_str());
+        return false;
+    }
+
+    mWavWriter.writeHeader(mInputChannelCount, mSampleRate, kBitsPerSample);
+
+    // The take is disarmed, so the callback is not adding to the FIFO and anything in it is
+    // from the last take.
+    mTakeFifo->finishRead(mTakeFifo->getFullFramesAvailable());
+    pcmData.resize(mTakeFifo->getBufferCapacityInFrames() * mInputChannelCount);
+    mTakeFramesWritten = 0;
+    mDuplexStream->resetTakeFramesDropped();
+    mTakeRunning = true;
+    mTakeWriter = std::thread(&EarbackEngine::writeTake, this);
+    mDuplexStream->armTake();
+    __android_log_print(ANDROID_LOG_INFO, "EarbackEngine", "Recording take to %s",
+                        mWavFilePath.c_str());
+    return true;
+}
+
+void EarbackEngine::stopTakeRecording() {
+    if (!mTakeWriter.joinable()) {
+        return;
+    }
+    if (mDuplexStream) {
+        // Waits for a copy in progress, so the writer thread saves the whole take.
+        mDuplexStream->disarmTake();
+    }
+    mTakeRunning = false;
+    mTakeWriter.join();
+
+    // Fill in the chunk sizes now that the length is known.
+    if (!mWavWriter.finish()) {
+        __android_log_print(ANDROID_LOG_ERROR, "EarbackEngine", "Error finishing %s",
+                            mWavFilePath.c_str());
+    }
+    mWavFile.close();
+    __android_log_print(ANDROID_LOG_INFO, "EarbackEngine",
+                        "Take finished, %" PRId64 " frames, %" PRId64 " dropped",
+                        mTakeFramesWritten, getTakeFramesDropped());
+}
+
+void EarbackEngine::writeTake() {
+    while (true) {
+        // Check before reading, so everything the callback wrote before it stopped is saved.
+        bool running = mTakeRunning.load();
+        oboe::FifoBuffer::Regions regions;
+        int32_t numFrames = mTakeFifo->prepareToRead(mTakeFifo->getBufferCapacityInFrames(),
+                                                     regions);
+        if (numFrames == 0) {
+            if (!running) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        for (const oboe::FifoBuffer::Region &region : {regions.first, regions.second}) {
+            auto floatAudioData = reinterpret_cast<const float *>(region.data);
+            int32_t numSamples = region.numFrames * mInputChannelCount;
+            for (int32_t i = 0; i < numSamples; i++) {
+                // Convert float to int16 with clamping
+                pcmData[i] = static_cast<int16_t>(
+                        std::min(std::max(floatAudioData[i], -1.0f), 1.0f) * 32767);
+            }
+            mWavWriter.write(pcmData.data(), numSamples * sizeof(int16_t));
+        }
+        mTakeFifo->finishRead(numFrames);
+        mTakeFramesWritten += numFrames;
+    }
+    if (!mWavFile) {
+        __android_log_print(ANDROID_LOG_ERROR, "EarbackEngine", "Error writing %s",
+                            mWavFilePath.c_str());
+    }
 }
 
 void EarbackEngine::closeStream(std::shared_ptr<oboe::AudioStream> &stream) {
@@ -152,7 +261,14 @@ oboe::DataCallbackResult EarbackEngine::onAudioReady(
         return oboe::DataCallbackResult::Stop;
     }
 
-    return mDuplexStream->onAudioReady(oboeStream, audioData, numFrames);
+    mTelemetry.onBeginCallback(*oboeStream);
+    mPerformanceHint.onBeginCallback(*oboeStream);
+    oboe::DataCallbackResult result = mDuplexStream->onAudioReady(oboeStream, audioData,
+                                                                  numFrames);
+    // The input stream is the only voice.
+    mPerformanceHint.onEndCallback(numFrames, 1);
+    mTelemetry.onEndCallback(*oboeStream, numFrames, 1);
+    return result;
 }
 
 
@@ -18,6 +18,7 @@
 #define OBOE_LIVEEFFECTENGINE_H
 
 #include <jni.h>
+#include <atomic>
 #include "oboe/Oboe.h"
 #include <memory>
 #include <string>
@@ -25,6 +26,9 @@
 #include <thread>
 #include <vector>
 #include "FullDuplexPass.h"
+#include <wav/WavStreamWriter.h>
+#include <player/PerformanceHint.h>
+#include <player/StreamTelemetry.h>
 
 class EarbackEngine : public oboe::AudioStreamCallback {
 public:
@@ -32,8 +36,6 @@ public:
 
     void setRecordingDeviceId(int32_t deviceId);
     void setPlaybackDeviceId(int32_t deviceId);
-    oboe::AudioStream *stream{};
-    int64_t framePosition = 0;
     /**
      * @param isOn
      * @return true if it succeeds
@@ -49,6 +51,59 @@ public:
     bool isAAudioRecommended(void);
     void setVolume(float volume);  // Add this line
 
+    // Callback timing and glitch statistics for the output stream.
+    void getTelemetry(iolib::StreamTelemetry::Snapshot &snapshot) {
+        mTelemetry.getSnapshot(snapshot);
+    }
+    void resetTelemetry() { mTelemetry.requestReset(); }
+
+    // Correction applied to the microphone for the clock drift, in parts per million.
+    double getMicDriftPpm() {
+        return mDuplexStream ? mDuplexStream->getInput().getCorrectionPpm() : 0.0;
+    }
+    // Number of times the microphone ran dry.
+    int32_t getMicUnderflowCount() {
+        return mDuplexStream ? mDuplexStream->getInput().getUnderflowCount() : 0;
+    }
+
+    /**
+     * Input bursts kept as a cushion against the microphone running dry. It is tuned while
+     * the effect is on, so save it per device and set it before the next setEffectOn(true).
+     */
+    int32_t getCushionBursts();
+    void setCushionBursts(int32_t numBursts) { mCushionBursts = numBursts; }
+
+    /**
+     * @return time from the microphone to the speaker in milliseconds,
+     *         or -1 if the effect is off
+     */
+    double getRoundTripLatencyMillis();
+
+    /**
+     * Effects applied to the microphone. They are kept when the effect is turned off
+     * and on again, and may be changed while it is on.
+     */
+    iolib::VocalEffectChain &getVocalEffects() { return mVocalEffects; }
+
+    // Pitch of the microphone before the effects, for scoring. Off until enabled.
+    iolib::PitchTracker &getPitchTracker() { return mPitchTracker; }
+
+    /**
+     * Record the microphone to a 16-bit WAV file from the stream that feeds the speaker,
+     * so no second input stream is needed. Takes over 4 GB are written as RF64.
+     * The take is the voice before the effects. The callback copies the input into a FIFO
+     * and a thread writes it to the file.
+     *
+     * @return false if the effect is off, a take is being recorded or the file cannot be opened
+     */
+    bool startTakeRecording(const char *filePath);
+    // Finish the file. Also done when the effect is turned off.
+    void stopTakeRecording();
+    bool isTakeRecording() const { return mTakeWriter.joinable(); }
+    // Frames missing from the current or last take because the file writer fell behind.
+    int64_t getTakeFramesDropped() {
+        return mDuplexStream ? mDuplexStream->getTakeFramesDropped() : 0;
+    }
 
 private:
     bool              mIsEffectOn = false;
@@ -59,11 +114,16 @@ private:
     int32_t           mSampleRate = 44100;
     const int32_t     mInputChannelCount = oboe::ChannelCount::Mono;
     const int32_t     mOutputChannelCount = oboe::ChannelCount::Mono;
-    size_t data_chunk_pos = 0;
+    static constexpr int32_t kTakeFifoSeconds = 2;
+    static constexpr int32_t kBitsPerSample = 16;
     std::vector<int16_t> pcmData;  // Buffer to store PCM data
-    size_t playbackIndex = 0;
 
+    iolib::VocalEffectChain mVocalEffects;
+    iolib::PitchTracker mPitchTracker;
     std::unique_ptr<FullDuplexPass> mDuplexStream;
+    std::atomic<int32_t> mCushionBursts{iolib::DriftCompensatedInput::kDefaultCushionBursts};
+    iolib::PerformanceHint mPerformanceHint;
+    iolib::StreamTelemetry mTelemetry;
     std::shared_ptr<oboe::AudioStream> mRecordingStream;
     std::shared_ptr<oboe::AudioStream> mPlayStream;
     oboe::Result openPlaybackStream();
@@ -76,11 +136,18 @@ private:
     oboe::AudioStreamBuilder *setupPlaybackStreamParameters(
         oboe::AudioStreamBuilder *builder);
     void warnIfNotLowLatency(std::shared_ptr<oboe::AudioStream> &audioStream);
+    void writeTake();
 
     // WAV file memberss
     std::ofstream mWavFile;
     std::string mWavFilePath;
+    parselib::WavStreamWriter mWavWriter{mWavFile};
     bool isStreamOpen = false;
+    // Filled by the callback and drained by mTakeWriter.
+    std::unique_ptr<oboe::FifoBuffer> mTakeFifo;
+    std::thread mTakeWriter;
+    std::atomic<bool> mTakeRunning{false};
+    int64_t mTakeFramesWritten = 0;
 };
 
 #endif  // OBOE_LIVEEFFECTENGINE_H
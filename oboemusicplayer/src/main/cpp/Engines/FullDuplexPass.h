@@ -17,38 +17,106 @@
 #ifndef SAMPLES_FULLDUPLEXPASS_H
 #define SAMPLES_FULLDUPLEXPASS_H
 
+#include <atomic>
+#include <thread>
+
+#include <oboe/FifoBuffer.h>
+#include <analysis/PitchTracker.h>
+#include <effects/VocalEffectChain.h>
+#include <player/DriftCompensatedInput.h>
+
 class FullDuplexPass : public oboe::FullDuplexStream {
 public:
+    oboe::Result start() override {
+        // The input and output clocks drift apart, so the input is resampled to follow.
+        if (!mInput.open(*getInputStream(), *getOutputStream())) {
+            return oboe::Result::ErrorInvalidFormat;
+        }
+        if (mEffects != nullptr) {
+            mEffects->configure(getOutputStream()->getChannelCount(),
+                                getOutputStream()->getSampleRate());
+        }
+        if (mPitchTracker != nullptr) {
+            mPitchTracker->configure(getOutputStream()->getChannelCount(),
+                                     getOutputStream()->getSampleRate());
+        }
+        return oboe::FullDuplexStream::start();
+    }
+
+    oboe::ResultWithValue<int32_t> readInput(int32_t /*numFrames*/) override {
+        // Take everything the input has captured, mInput keeps the backlog constant.
+        return mInput.pull(*getInputStream());
+    }
+
     virtual oboe::DataCallbackResult
     onBothStreamsReady(
-            const void *inputData,
-            int   numInputFrames,
+            const void * /*inputData*/,
+            int   /*numInputFrames*/,
             void *outputData,
             int   numOutputFrames) {
-        // Copy the input samples to the output with a little arbitrary gain change.
+        // Copy the input to the output. This assumes the data format for both streams
+        // is Float and that they have the same channel count, see DriftCompensatedInput.
+        auto output = static_cast<float *>(outputData);
+        mInput.read(output, numOutputFrames);
+        if (mTakeFifo != nullptr) {
+            // Marked before checking mTakeArmed, so disarmTake() can wait for this write.
+            mTakeWriting.store(true);
+            if (mTakeArmed.load()) {
+                // Never wait for the file writer, the take gets a gap if it falls behind.
+                int32_t framesWritten = mTakeFifo->write(output, numOutputFrames);
+                mTakeFramesDropped.fetch_add(numOutputFrames - framesWritten,
+                                             std::memory_order_relaxed);
+            }
+            mTakeWriting.store(false, std::memory_order_release);
+        }
+        if (mPitchTracker != nullptr) {
+            // The frames of this callback have not been counted as written yet.
+            mPitchTracker->write(output, numOutputFrames, getOutputStream()->getFramesWritten());
+        }
+        if (mEffects != nullptr) {
+            mEffects->process(output, numOutputFrames);
+        }
+        return oboe::DataCallbackResult::Continue;
+    }
 
-        // This code assumes the data format for both streams is Float.
-        const float *inputFloats = static_cast<const float *>(inputData);
-        float *outputFloats = static_cast<float *>(outputData);
+    iolib::DriftCompensatedInput &getInput() { return mInput; }
 
-        // It also assumes the channel count for each stream is the same.
-        int32_t samplesPerFrame = getOutputStream()->getChannelCount();
-        int32_t numInputSamples = numInputFrames * samplesPerFrame;
-        int32_t numOutputSamples = numOutputFrames * samplesPerFrame;
+    // Effects applied to the input on its way to the output. Set before start().
+    void setEffects(iolib::VocalEffectChain *effects) { mEffects = effects; }
 
-        // It is possible that there may be fewer input than output samples.
-        int32_t samplesToProcess = std::min(numInputSamples, numOutputSamples);
-        for (int32_t i = 0; i < samplesToProcess; i++) {
-            *outputFloats++ = *inputFloats++; //* 0.95; // do some arbitrary processing
-        }
+    // Gets the input before the effects. Set before start().
+    void setPitchTracker(iolib::PitchTracker *pitchTracker) { mPitchTracker = pitchTracker; }
 
-        // If there are fewer input samples then clear the rest of the buffer.
-        int32_t samplesLeft = numOutputSamples - numInputSamples;
-        for (int32_t i = 0; i < samplesLeft; i++) {
-            *outputFloats++ = 0.0; // silence
+    // Gets a copy of the input before the effects while recording. Set before start().
+    void setTakeFifo(oboe::FifoBuffer *fifo) { mTakeFifo = fifo; }
+    // Start copying to the take FIFO. Call after draining what is left of the last take.
+    void armTake() { mTakeArmed.store(true); }
+    /**
+     * Stop copying to the take FIFO. When this returns, the callback is not writing to it,
+     * not even a copy that started before, so the FIFO can be drained or read to the end.
+     */
+    void disarmTake() {
+        mTakeArmed.store(false);
+        while (mTakeWriting.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
         }
-
-        return oboe::DataCallbackResult::Continue;
     }
+    // Frames that did not fit in the take FIFO since the last reset.
+    int64_t getTakeFramesDropped() const {
+        return mTakeFramesDropped.load(std::memory_order_relaxed);
+    }
+    // Call before armTake().
+    void resetTakeFramesDropped() { mTakeFramesDropped.store(0, std::memory_order_relaxed); }
+
+private:
+    iolib::DriftCompensatedInput mInput;
+    iolib::VocalEffectChain *mEffects = nullptr;
+    iolib::PitchTracker *mPitchTracker = nullptr;
+    oboe::FifoBuffer *mTakeFifo = nullptr;
+    // Sequentially consistent, so either the callback sees the take disarmed or
+    // disarmTake() sees the write in progress.
+    std::atomic<bool> mTakeArmed{false};
+    std::atomic<bool> mTakeWriting{false};
+    std::atomic<int64_t> mTakeFramesDropped{0};
 };
 #endif //SAMPLES_FULLDUPLEXPASS_H
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <android/log.h>
+#include "LatencyCalibrator.h"
+#include "../../../../oboe/src/common/AudioClock.h"
+// The analyzer logs through the OboeTester macros.
+#include "../../../../oboe/apps/OboeTester/app/src/main/cpp/android_debug.h"
+#include "../../../../oboe/apps/OboeTester/app/src/main/cpp/analyzer/LatencyAnalyzer.h"
+
+static const char* TAG = "LatencyCalibrator";
+
+using namespace oboe;
+
+/**
+ * Drives the OboeTester analyzer one frame at a time, like LoopbackProcessor::process(),
+ * and remembers the stream positions where the pulse was started and where the
+ * recording of it was started.
+ */
+class LatencyCalibrator::PulseLoopback : public FullDuplexStream {
+public:
+    explicit PulseLoopback(int32_t sampleRate) {
+        mAnalyzer.setSampleRate(sampleRate);
+        mAnalyzer.setup();
+        mAnalyzer.prepareToTest();
+    }
+
+    DataCallbackResult onBothStreamsReady(
+            const void *inputData,
+            int   numInputFrames,
+            void *outputData,
+            int   numOutputFrames) override {
+        // Once the recording is complete the analyzer belongs to poll().
+        if (mRecordingComplete.load(std::memory_order_acquire)) {
+            return DataCallbackResult::Continue;
+        }
+        auto input = static_cast<const int16_t *>(inputData);
+        auto output = static_cast<float *>(outputData);
+        int32_t outputChannelCount = getOutputStream()->getChannelCount();
+        int64_t inputPosition = getInputStream()->getFramesRead() - numInputFrames;
+        int64_t outputPosition = getOutputStream()->getFramesWritten();
+
+        int numFrames = std::max(numInputFrames, numOutputFrames);
+        for (int i = 0; i < numFrames; i++) {
+            if (i < numInputFrames) {
+                float sample = input[i] * (1.0f / 32768);
+                mAnalyzer.processInputFrame(&sample, 1);
+                if (mRecordingStartPosition < 0 && mAnalyzer.getProgress() > 0) {
+                    mRecordingStartPosition = inputPosition + i;
+                }
+            }
+            if (i < numOutputFrames) {
+                if (mPulseStartPosition < 0 && mAnalyzer.getState() == kAnalyzerStateInPulse) {
+                    mPulseStartPosition = outputPosition + i;
+                }
+                mAnalyzer.processOutputFrame(output, outputChannelCount);
+                output += outputChannelCount;
+            }
+        }
+
+        if (mAnalyzer.isRecordingComplete()) {
+            mRecordingComplete.store(true, std::memory_order_release);
+        }
+        return DataCallbackResult::Continue;
+    }
+
+    bool isRecordingComplete() const {
+        return mRecordingComplete.load(std::memory_order_acquire);
+    }
+
+    // Only call after isRecordingComplete() returns true.
+    WhiteNoiseLatencyAnalyzer &getAnalyzer() { return mAnalyzer; }
+    int64_t getPulseStartPosition() const { return mPulseStartPosition; }
+    int64_t getRecordingStartPosition() const { return mRecordingStartPosition; }
+
+private:
+    // Must match PulseLatencyAnalyzer::STATE_IN_PULSE
+    static constexpr int kAnalyzerStateInPulse = 1;
+
+    WhiteNoiseLatencyAnalyzer mAnalyzer;
+    int64_t mPulseStartPosition = -1;
+    int64_t mRecordingStartPosition = -1;
+    std::atomic<bool> mRecordingComplete{false};
+};
+
+LatencyCalibrator::LatencyCalibrator() = default;
+
+LatencyCalibrator::~LatencyCalibrator() {
+    closeStreams();
+}
+
+bool LatencyCalibrator::start(int32_t recordingDeviceId, int32_t playbackDeviceId) {
+    closeStreams();
+    mState = kStateFailed;
+    mLoopback = std::make_unique<PulseLoopback>(kSampleRate);
+
+    AudioStreamBuilder outBuilder;
+    outBuilder.setDirection(Direction::Output)
+            ->setDeviceId(playbackDeviceId)
+            ->setDataCallback(mLoopback.get())
+            ->setFormat(AudioFormat::Float)
+            ->setChannelCount(ChannelCount::Stereo)
+            ->setPerformanceMode(PerformanceMode::LowLatency)
+            ->setSharingMode(SharingMode::Shared)
+            ->setSampleRate(kSampleRate)
+            ->setSampleRateConversionQuality(SampleRateConversionQuality::Medium);
+    Result result = outBuilder.openStream(mPlayStream);
+    if (result != Result::OK) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "Error opening output: %s",
+                            convertToText(result));
+        return false;
+    }
+
+    // Same as RecordingEngine, so the offset includes the same input path.
+    AudioStreamBuilder inBuilder;
+    inBuilder.setDirection(Direction::Input)
+            ->setDeviceId(recordingDeviceId)
+            ->setFormat(AudioFormat::I16)
+            ->setChannelCount(ChannelCount::Mono)
+            ->setInputPreset(InputPreset::Generic)
+            ->setPerformanceMode(PerformanceMode::None)
+            ->setSharingMode(SharingMode::Exclusive)
+            ->setAudioApi(AudioApi::AAudio)
+            ->setSampleRate(kSampleRate)
+            ->setSampleRateConversionQuality(SampleRateConversionQuality::Best)
+            ->setBufferCapacityInFrames(mPlayStream->getBufferCapacityInFrames() * 2);
+    result = inBuilder.openStream(mRecordingStream);
+    if (result != Result::OK) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "Error opening input: %s",
+                            convertToText(result));
+        closeStreams();
+        return false;
+    }
+
+    mLoopback->setSharedInputStream(mRecordingStream);
+    mLoopback->setSharedOutputStream(mPlayStream);
+    result = mLoopback->start();
+    if (result != Result::OK) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "Error starting streams: %s",
+                            convertToText(result));
+        closeStreams();
+        return false;
+    }
+    mStartNanos = AudioClock::getNanoseconds();
+    mState = kStateRunning;
+    return true;
+}
+
+int32_t LatencyCalibrator::poll() {
+    if (mState != kStateRunning) {
+        return mState;
+    }
+    if (!mLoopback->isRecordingComplete()) {
+        int64_t elapsedNanos = AudioClock::getNanoseconds() - mStartNanos;
+        if (elapsedNanos > kTimeoutMillis * kNanosPerMillisecond) {
+            __android_log_print(ANDROID_LOG_ERROR, TAG, "Timed out waiting for the pulse");
+            closeStreams();
+            mState = kStateFailed;
+        }
+        return mState;
+    }
+
+    // The timestamps are only available while the streams are running.
+    ResultWithValue<FrameTimestamp> inputTimestamp =
+            mRecordingStream->getTimestamp(CLOCK_MONOTONIC);
+    ResultWithValue<FrameTimestamp> outputTimestamp =
+            mPlayStream->getTimestamp(CLOCK_MONOTONIC);
+    mLoopback->stop();
+    if (!inputTimestamp || !outputTimestamp) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "No timestamps, input: %s, output: %s",
+                            convertToText(inputTimestamp.error()),
+                            convertToText(outputTimestamp.error()));
+        mState = kStateFailed;
+    } else {
+        mState = analyze(inputTimestamp.value(), outputTimestamp.value());
+    }
+    closeStreams();
+    return mState;
+}
+
+int32_t LatencyCalibrator::analyze(const FrameTimestamp &inputTimestamp,
+                                   const FrameTimestamp &outputTimestamp) {
+    WhiteNoiseLatencyAnalyzer &analyzer = mLoopback->getAnalyzer();
+    analyzer.analyze();
+    mConfidence = analyzer.getMeasuredConfidence();
+    if (analyzer.getResult() != LatencyAnalyzer::RESULT_OK) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "Pulse not found, confidence = %f",
+                            mConfidence);
+        return kStateFailed;
+    }
+
+    int64_t pulsePosition = mLoopback->getPulseStartPosition();
+    int64_t capturePosition = mLoopback->getRecordingStartPosition()
+            + analyzer.getMeasuredLatency();
+    int64_t presentationNanos = outputTimestamp.timestamp
+            + (pulsePosition - outputTimestamp.position) * kNanosPerSecond
+              / mPlayStream->getSampleRate();
+    int64_t captureNanos = inputTimestamp.timestamp
+            + (capturePosition - inputTimestamp.position) * kNanosPerSecond
+              / mRecordingStream->getSampleRate();
+    mOffsetNanos = captureNanos - presentationNanos;
+    __android_log_print(ANDROID_LOG_INFO, TAG,
+                        "offset = %.3f ms, confidence = %f, loop latency = %d frames",
+                        mOffsetNanos / static_cast<double>(kNanosPerMillisecond), mConfidence,
+                        static_cast<int>(capturePosition - pulsePosition));
+    return kStateDone;
+}
+
+void LatencyCalibrator::stop() {
+    closeStreams();
+    if (mState == kStateRunning) {
+        mState = kStateIdle;
+    }
+}
+
+void LatencyCalibrator::closeStreams() {
+    if (mLoopback) {
+        mLoopback->stop();
+    }
+    if (mPlayStream) {
+        mPlayStream->close();
+        mPlayStream.reset();
+    }
+    if (mRecordingStream) {
+        mRecordingStream->close();
+        mRecordingStream.reset();
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_LATENCYCALIBRATOR_H
+#define OBOE_LATENCYCALIBRATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "oboe/Oboe.h"
+
+/**
+ * Measures how late the microphone hears the speaker, compared to what the stream
+ * timestamps say.
+ *
+ * A burst of white noise is played and recorded through the air, and found in the recording
+ * with the correlation used by the OboeTester round trip latency test. The output frame that
+ * started the pulse and the input frame that captured it are converted to CLOCK_MONOTONIC
+ * with the timestamps of each stream. The difference is the offset that RecordingEngine
+ * adds to the presentation time of the backing track to find the input frame that
+ * lines up with it.
+ *
+ * The input stream is opened like the one in RecordingEngine, so the measured offset
+ * includes the same input path.
+ */
+class LatencyCalibrator {
+public:
+    // Must match NativeMusicPlayer.CALIBRATION_*
+    static constexpr int32_t kStateIdle = 0;
+    static constexpr int32_t kStateRunning = 1;
+    static constexpr int32_t kStateDone = 2;
+    static constexpr int32_t kStateFailed = 3;
+
+    LatencyCalibrator();
+    ~LatencyCalibrator();
+
+    /**
+     * Open the streams and play the pulse. The device should be quiet and the volume
+     * loud enough for the microphone to hear the speaker.
+     *
+     * @return true if the streams started
+     */
+    bool start(int32_t recordingDeviceId, int32_t playbackDeviceId);
+
+    /**
+     * Check on a measurement. Call from the UI thread every few hundred milliseconds.
+     * When the pulse has been recorded this closes the streams and runs the correlation.
+     *
+     * @return one of the kState* values
+     */
+    int32_t poll();
+
+    // Abandon a measurement.
+    void stop();
+
+    // Capture time minus presentation time of the same sound, valid when kStateDone.
+    int64_t getOffsetNanos() const { return mOffsetNanos; }
+    // Between 0.0 and 1.0, valid when kStateDone.
+    double getConfidence() const { return mConfidence; }
+
+private:
+    class PulseLoopback;
+
+    static constexpr int32_t kSampleRate = 44100; // RecordingEngine records at this rate
+    static constexpr int64_t kTimeoutMillis = 5000;
+
+    void closeStreams();
+    int32_t analyze(const oboe::FrameTimestamp &inputTimestamp,
+                    const oboe::FrameTimestamp &outputTimestamp);
+
+    std::unique_ptr<PulseLoopback> mLoopback;
+    std::shared_ptr<oboe::AudioStream> mRecordingStream;
+    std::shared_ptr<oboe::AudioStream> mPlayStream;
+    int32_t mState = kStateIdle;
+    int64_t mStartNanos = 0;
+    int64_t mOffsetNanos = 0;
+    double  mConfidence = 0.0;
+};
+
+#endif //OBOE_LATENCYCALIBRATOR_H
@@ -7,19 +7,9 @@
 #include "RecordingEngine.h"
 #include "../../../../oboe/include/oboe/Oboe.h"
 #include <inttypes.h>  // For PRId64
+#include <algorithm>
 
-namespace little_endian_io
-{
-    template <typename Word>
-    std::ostream& write_word( std::ostream& outs, Word value, unsigned size = sizeof( Word ) )
-    {
-        for (; size; --size, value >>= 8)
-            outs.put( static_cast <char> (value & 0xFF) );
-        return outs;
-    }
-}
-
-using namespace little_endian_io;
+using parselib::WavStreamWriter;
 
 long long currentTimeMillisRecording() {
     return std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -54,20 +44,9 @@ void RecordingEngine::startRecording(const char * filePath, oboe::InputPreset in
     //const char *path = "/storage/emulated/0/Music/record.wav";
     const char *path = filePath;
     f.open(path, std::ios::binary);
-    // Write the file headers
-    f << "RIFF----WAVEfmt ";     // (chunk size to be filled in later)
-    write_word( f,     16, 4 );  // no extension data
-    write_word( f,      1, 2 );  // PCM - integer samples
-    write_word( f,      numChannels, 2 );  // one channel (mono) or two channels (stereo file)
-    write_word( f,  44100, 4 );  // samples per second (Hz)
-    //write_word( f, 176400, 4 );  // (Sample Rate * BitsPerSample * Channels) / 8
-    write_word( f,(44100 * bitsPerSample * numChannels) / 8, 4 );  // (Sample Rate * BitsPerSample * Channels) / 8
-    write_word( f,      4, 2 );  // data block size (size of two integer samples, one for each channel, in bytes)
-    write_word( f,     bitsPerSample, 2 );  // number of bits per sample (use a multiple of 8)
-
-    // Write the data chunk header
-    f << "data----";  // (chunk size to be filled in later)
-    // f.flush();
+    // The sizes are filled in by finish(), long takes become RF64.
+    WavStreamWriter writer(f);
+    writer.writeHeader(numChannels, 44100, bitsPerSample);
 
     oboe::Result r = builder.openStream(&stream);
     if (r != oboe::Result::OK) {
@@ -79,6 +58,16 @@ void RecordingEngine::startRecording(const char * filePath, oboe::InputPreset in
         return;
     }
 
+    mTransportClock.reset(stream->getSampleRate());
+    {
+        std::lock_guard<std::mutex> lock(mAlignmentLock);
+        mTakeTrackStartTimeProvider = mTrackStartTimeProvider;
+        mTakeAlignmentOffsetNanos = mAlignmentOffsetNanos;
+    }
+    mAlignmentPending = static_cast<bool>(mTakeTrackStartTimeProvider);
+    mPendingFrames.clear();
+    mFramesToSkip = 0;
+
     auto a = stream->getState();
     __android_log_print(ANDROID_LOG_INFO, "OboeAudioRecorder", "Recording started at %lld ms",
                         currentTimeMillisRecording());
@@ -109,13 +98,17 @@ void RecordingEngine::startRecording(const char * filePath, oboe::InputPreset in
 
         while (isRecording) {
             auto result = stream->read(mybuffer, requestedFrames, kTimeoutValue * 1000);
+            mTransportClock.update(*stream);
             if (!firstFrameHit && framePosition == 0 && presentationTime == 0) {
                 // Get the current timestamp
-                oboe::Result results = stream->getTimestamp(CLOCK_BOOTTIME, &framePosition, &presentationTime);
+                int64_t position = 0;
+                int64_t timeNanos = 0;
+                oboe::Result results = stream->getTimestamp(CLOCK_BOOTTIME, &position, &timeNanos);
                 if (results == oboe::Result::OK) {
+                    framePosition = position;
                     presentationTime = currentTimeMillisRecording();
-                    __android_log_print(ANDROID_LOG_INFO, "OboeAudio", "First frame timestamp: %" PRId64 " ns", presentationTime);
-                    __android_log_print(ANDROID_LOG_INFO, "OboeAudio", "Frame position: %" PRId64 ", Presentation time: %" PRId64 " ns", framePosition, presentationTime);
+                    __android_log_print(ANDROID_LOG_INFO, "OboeAudio", "First frame timestamp: %" PRId64 " ns", presentationTime.load());
+                    __android_log_print(ANDROID_LOG_INFO, "OboeAudio", "Frame position: %" PRId64 ", Presentation time: %" PRId64 " ns", framePosition.load(), presentationTime.load());
                 } else {
                     __android_log_print(ANDROID_LOG_ERROR, "OboeAudio", "Failed to get timestamp: %s", oboe::convertToText(results));
                 }
@@ -130,18 +123,109 @@ void RecordingEngine::startRecording(const char * filePath, oboe::InputPreset in
 
             if (result == oboe::Result::OK) {
                 auto nbFramesRead = result.value();
-                for (int i = 0; i < nbFramesRead; i++) {
-                    write_word( f, (int)(mybuffer[i]), 2 );
-                }
+                writeAligned(writer, mybuffer, nbFramesRead);
             } else {
                 auto error = convertToText(result.error());
                 __android_log_print(ANDROID_LOG_INFO, "OboeAudioRecorder", "error = %s", error);
             }
         }
+        if (mAlignmentPending && !mPendingFrames.empty()) {
+            __android_log_print(ANDROID_LOG_WARN, "OboeAudioRecorder",
+                                "The track never started, the take is not aligned");
+            writeFrames(writer, mPendingFrames.data(),
+                        static_cast<int32_t>(mPendingFrames.size()));
+            mPendingFrames.clear();
+        }
+        writer.finish();
         __android_log_print(ANDROID_LOG_INFO, "OboeAudioRecorder", "Requesting stop");
     }
 }
 
+void RecordingEngine::setTrackAlignment(int64_t offsetNanos,
+                                        std::function<int64_t()> trackStartTimeProvider) {
+    std::lock_guard<std::mutex> lock(mAlignmentLock);
+    mAlignmentOffsetNanos = offsetNanos;
+    mTrackStartTimeProvider = std::move(trackStartTimeProvider);
+}
+
+void RecordingEngine::clearTrackAlignment() {
+    std::lock_guard<std::mutex> lock(mAlignmentLock);
+    mTrackStartTimeProvider = nullptr;
+}
+
+bool RecordingEngine::findAlignedPosition(int64_t *position) {
+    int64_t trackStartNanos = mTakeTrackStartTimeProvider();
+    if (trackStartNanos < 0) {
+        return false;
+    }
+    // The microphone hears the first frame of the track this much later than
+    // the input timestamps would suggest.
+    int64_t captureNanos = trackStartNanos + mTakeAlignmentOffsetNanos;
+    return mTransportClock.getPositionAtTimeNanos(captureNanos, position);
+}
+
+void RecordingEngine::writeFrames(WavStreamWriter &writer, const int16_t *frames,
+                                  int32_t numFrames) {
+    writer.write(frames, numFrames * sizeof(int16_t));
+}
+
+void RecordingEngine::writeAligned(WavStreamWriter &writer, const int16_t *frames,
+                                   int32_t numFrames) {
+    if (mFramesToSkip > 0) {
+        auto framesToSkip = static_cast<int32_t>(std::min<int64_t>(mFramesToSkip, numFrames));
+        mFramesToSkip -= framesToSkip;
+        frames += framesToSkip;
+        numFrames -= framesToSkip;
+    }
+    if (!mAlignmentPending) {
+        writeFrames(writer, frames, numFrames);
+        return;
+    }
+
+    // Hold the input until we know which frame lines up with the start of the track.
+    int64_t position = stream->getFramesRead() - numFrames;
+    if (position != mPendingPosition + static_cast<int64_t>(mPendingFrames.size())) {
+        // The input is not contiguous, for example after a pause.
+        mPendingFrames.clear();
+        mPendingPosition = position;
+    }
+    mPendingFrames.insert(mPendingFrames.end(), frames, frames + numFrames);
+    size_t maxPendingFrames = static_cast<size_t>(kMaxPendingSeconds) * stream->getSampleRate();
+    if (mPendingFrames.size() > maxPendingFrames) {
+        size_t excess = mPendingFrames.size() - maxPendingFrames;
+        mPendingFrames.erase(mPendingFrames.begin(), mPendingFrames.begin() + excess);
+        mPendingPosition += excess;
+    }
+
+    int64_t alignedPosition = 0;
+    if (!findAlignedPosition(&alignedPosition)) {
+        return;
+    }
+    mAlignmentPending = false;
+    auto numPending = static_cast<int64_t>(mPendingFrames.size());
+    int64_t framesBeforeTrack = alignedPosition - mPendingPosition;
+    if (framesBeforeTrack < 0) {
+        // The track started before the recording.
+        static constexpr int32_t kSilenceFrames = 256;
+        static const int16_t silence[kSilenceFrames] = {};
+        for (int64_t framesLeft = -framesBeforeTrack; framesLeft > 0;
+                framesLeft -= kSilenceFrames) {
+            writeFrames(writer, silence,
+                        static_cast<int32_t>(std::min<int64_t>(framesLeft, kSilenceFrames)));
+        }
+        writeFrames(writer, mPendingFrames.data(), static_cast<int32_t>(numPending));
+    } else if (framesBeforeTrack <= numPending) {
+        writeFrames(writer, mPendingFrames.data() + framesBeforeTrack,
+                    static_cast<int32_t>(numPending - framesBeforeTrack));
+    } else {
+        // The microphone has not heard the start of the track yet.
+        mFramesToSkip = framesBeforeTrack - numPending;
+    }
+    __android_log_print(ANDROID_LOG_INFO, "OboeAudioRecorder",
+                        "Take aligned to the track, %" PRId64 " frames trimmed", framesBeforeTrack);
+    mPendingFrames.clear();
+}
+
 
 void RecordingEngine::stopRecording() {
     this->isRecording = false;
@@ -8,14 +8,19 @@
 
 #endif //OBOE_MP3_PLAYER_RECORDINGENGINE_H
 #include <jni.h>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <fstream>
+#include <functional>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include "../../../../oboe/include/oboe/AudioStreamCallback.h"
 #include "../../../../oboe/include/oboe/Oboe.h"
 #include "../../../../oboe/include/oboe/Definitions.h"
+#include <player/TransportClock.h>
+#include <wav/WavStreamWriter.h>
 
 class RecordingEngine{
 public:
@@ -30,13 +35,50 @@ public:
     void resumeRecording();
     bool setAudioApi(oboe::AudioApi);
     bool isAAudioRecommended(void);
-    int64_t framePosition = 0;
-    int64_t presentationTime = 0;
+    std::atomic<int64_t> framePosition{0};
+    std::atomic<int64_t> presentationTime{0};
     jlong getFramePosition();
     jlong getFrameTimeStamp();
     jint getAudioSessionId();
 
+    // Input frame positions in CLOCK_MONOTONIC time, see TransportClock.
+    const iolib::TransportClock &getTransportClock() const { return mTransportClock; }
+
+    /**
+     * Line the next take up with the backing track. Frame 0 of the file will be the input
+     * frame that captured the first frame of the track: earlier input is trimmed, and if
+     * the track started before the recording the file starts with silence.
+     *
+     * @param offsetNanos measured by LatencyCalibrator
+     * @param trackStartTimeProvider returns SimpleAudioPlayer::getTrackStartTimeNanos()
+     *
+     * May be called from any thread. A take that is already recording keeps the
+     * alignment it started with.
+     */
+    void setTrackAlignment(int64_t offsetNanos, std::function<int64_t()> trackStartTimeProvider);
+    void clearTrackAlignment();
+
 private:
+    // Input held while waiting for the track to start.
+    static constexpr int32_t kMaxPendingSeconds = 10;
+
+    bool findAlignedPosition(int64_t *position);
+    void writeFrames(parselib::WavStreamWriter &writer, const int16_t *frames, int32_t numFrames);
+    void writeAligned(parselib::WavStreamWriter &writer, const int16_t *frames, int32_t numFrames);
+
+    iolib::TransportClock mTransportClock;
+    // Set by setTrackAlignment(), copied by startRecording().
+    std::mutex mAlignmentLock;
+    std::function<int64_t()> mTrackStartTimeProvider;
+    int64_t mAlignmentOffsetNanos = 0;
+    // Only used by the recording loop.
+    std::function<int64_t()> mTakeTrackStartTimeProvider;
+    int64_t mTakeAlignmentOffsetNanos = 0;
+    bool mAlignmentPending = false;
+    std::vector<int16_t> mPendingFrames;
+    int64_t mPendingPosition = 0;
+    // Input frames after the pending ones that come before the track.
+    int64_t mFramesToSkip = 0;
 
 
 };
\ No newline at end of file
@@ -8,7 +8,10 @@
 #include <stream/MemInputStream.h>
 #include <wav/WavStreamReader.h>
 #include <inttypes.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <time.h>
 // local includes
 #include <player/OneShotSampleSource.h>
 #include <jni.h>
@@ -21,8 +24,6 @@ using namespace oboe;
 using namespace parselib;
 
 namespace iolib {
-    constexpr int32_t kBufferSizeInBursts = 2; // Use 2 bursts as the buffer size (double buffer)
-
     static JNIEnv* getJNIEnv() {
         if (!g_JavaVM) return nullptr;
         JNIEnv* env = nullptr;
@@ -70,18 +71,37 @@ namespace iolib {
             return DataCallbackResult::Continue;
         }
 
+        mParent->mTelemetry.onBeginCallback(*oboeStream);
+        mParent->mPerformanceHint.onBeginCallback(*oboeStream);
+
         // Clear the audio buffer
         memset(audioData, 0, static_cast<size_t>(numFrames) *
                              static_cast<size_t>(mParent->mChannelCount) * sizeof(float));
 
-        // Mix audio from sample sources
+        // Mix audio from sample sources, measuring each one as it is mixed.
+        float meteringRate = mParent->mMeteringRate.load(std::memory_order_relaxed);
+        int32_t activeVoices = 0;
         for (int32_t index = 0; index < mParent->mNumSampleBuffers; index++) {
+            mParent->mSampleSources[index]->setMetering(
+                    meteringRate > 0.0f && index < PlayerStatus::kMaxSources);
             if (mParent->mSampleSources[index]->isPlaying()) {
                 mParent->mSampleSources[index]->mixAudio(
                         static_cast<float *>(audioData), mParent->mChannelCount, numFrames);
+                activeVoices++;
             }
         }
 
+        mParent->mPerformanceHint.onEndCallback(numFrames, activeVoices);
+
+        if (activeVoices == 0) {
+            mParent->mTrackStartPosition.store(-1, std::memory_order_relaxed);
+        } else if (mParent->mTrackStartPosition.load(std::memory_order_relaxed) < 0) {
+            // Voices start at the beginning of a callback. The frames of this callback
+            // have not been counted as written yet.
+            mParent->mTrackStartPosition.store(oboeStream->getFramesWritten(),
+                                               std::memory_order_release);
+        }
+
         // Send audio data directly to Java callback
         if (gJavaCallbackObj && gOnAudioDataAvailableMethod) {
             JNIEnv *env = getJNIEnv();
@@ -111,6 +131,12 @@ namespace iolib {
             }
         }
 
+        mParent->mBufferSizeTuner.onAudioReady(*oboeStream, numFrames);
+        mParent->mTransportClock.update(*oboeStream);
+        mParent->publishStatus(*oboeStream, static_cast<const float *>(audioData), numFrames,
+                               activeVoices, meteringRate);
+        // Includes the Java callback, which is part of the time spent in the callback.
+        mParent->mTelemetry.onEndCallback(*oboeStream, numFrames, activeVoices);
         return DataCallbackResult::Continue;
     }
 
@@ -155,12 +181,105 @@ namespace iolib {
         }
     }
 
-    int64_t SimpleAudioPlayer::getPosition(int index, int sampleRate, int channelCount) {
-        return mSampleSources[index]->getCurrentPositionInMillis(sampleRate, channelCount);
+    void SimpleAudioPlayer::publishStatus(AudioStream &stream, const float *audioData,
+                                          int32_t numFrames, int32_t activeVoices,
+                                          float meteringRate) {
+        updateMeters(audioData, numFrames, meteringRate);
+
+        PlayerStatus::Values &status = mStatusValues;
+        status.callbackCount++;
+        // The frames of this callback have not been counted as written yet.
+        status.framesWritten = stream.getFramesWritten() + numFrames;
+        if (!mTransportClock.getTimeNanosAtPosition(status.framesWritten,
+                                                    &status.framesWrittenTimeNanos)) {
+            status.framesWrittenTimeNanos = -1;
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        status.callbackTimeNanos = now.tv_sec * 1000000000LL + now.tv_nsec;
+        status.framesPerSecond = mTransportClock.getFrameRate();
+        status.sampleRate = mSampleRate;
+        status.channelCount = mChannelCount;
+        status.bufferSizeInFrames = mBufferSizeTuner.getBufferSizeInFrames();
+        status.xRunCount = mBufferSizeTuner.getXRunCount();
+        status.activeVoices = activeVoices;
+        status.numSources = std::min(mNumSampleBuffers, PlayerStatus::kMaxSources);
+        for (int32_t index = 0; index < status.numSources; index++) {
+            SampleSource *source = mSampleSources[index];
+            status.sources[index].positionFrames = source->getPositionInFrames();
+            status.sources[index].numFrames = source->getNumFrames();
+            status.sources[index].flags = source->isPlaying() ? PlayerStatus::kSourcePlaying : 0;
+        }
+        mStatus.publish(status);
     }
 
-    int64_t SimpleAudioPlayer::getDuration(int i, int channelCount){
-        return mSampleSources[0]->getDurationInMillis(i, channelCount);
+    void SimpleAudioPlayer::updateMeters(const float *audioData, int32_t numFrames,
+                                         float meteringRate) {
+        if (meteringRate <= 0.0f) {
+            if (mMeterFrames >= 0) {
+                resetMeters();
+                mMeterFrames = -1;
+            }
+            return;
+        }
+        mMeterFrames = std::max(mMeterFrames, 0);
+
+        // The sources were measured while they were mixed, the output is measured here.
+        mMasterMeter.process(audioData, mChannelCount, numFrames);
+        mMeterFrames += numFrames;
+        int32_t windowFrames = std::max(1, static_cast<int32_t>(mSampleRate / meteringRate));
+        if (mMeterFrames < windowFrames) {
+            return;
+        }
+
+        // Sources that did not play for all of the window count as silent for the rest.
+        PlayerStatus::Values &status = mStatusValues;
+        float scale = 1.0f / mMeterFrames;
+        const LevelAccumulator &master = mMasterMeter.getLevels();
+        for (int32_t channel = 0; channel < PlayerStatus::kMaxChannels; channel++) {
+            status.peak[channel] = master.peak[channel];
+            status.rms[channel] = sqrtf(master.sumSquares[channel] * scale);
+            status.truePeak[channel] = mMasterMeter.getTruePeak(channel);
+        }
+        int32_t numSources = std::min(mNumSampleBuffers, PlayerStatus::kMaxSources);
+        for (int32_t index = 0; index < numSources; index++) {
+            const LevelAccumulator &levels = mSampleSources[index]->getLevels();
+            for (int32_t channel = 0; channel < PlayerStatus::kMaxChannels; channel++) {
+                status.sources[index].peak[channel] = levels.peak[channel];
+                status.sources[index].rms[channel] = sqrtf(levels.sumSquares[channel] * scale);
+            }
+            mSampleSources[index]->resetLevels();
+        }
+        mMasterMeter.clear();
+        mMeterFrames = 0;
+        status.meterCount++;
+    }
+
+    void SimpleAudioPlayer::resetMeters() {
+        mMasterMeter.reset();
+        for (int32_t index = 0; index < mNumSampleBuffers; index++) {
+            mSampleSources[index]->resetLevels();
+        }
+        PlayerStatus::Values &status = mStatusValues;
+        for (int32_t channel = 0; channel < PlayerStatus::kMaxChannels; channel++) {
+            status.peak[channel] = 0.0f;
+            status.rms[channel] = 0.0f;
+            status.truePeak[channel] = 0.0f;
+            for (int32_t index = 0; index < PlayerStatus::kMaxSources; index++) {
+                status.sources[index].peak[channel] = 0.0f;
+                status.sources[index].rms[channel] = 0.0f;
+            }
+        }
+    }
+
+    int64_t SimpleAudioPlayer::getTrackStartTimeNanos() {
+        int64_t startPosition = mTrackStartPosition.load(std::memory_order_acquire);
+        int64_t startTimeNanos = -1;
+        if (startPosition < 0
+                || !mTransportClock.getTimeNanosAtPosition(startPosition, &startTimeNanos)) {
+            return -1;
+        }
+        return startTimeNanos;
     }
 
     int SimpleAudioPlayer::getAudioSessionId() {
@@ -170,6 +289,9 @@ namespace iolib {
     bool SimpleAudioPlayer::openStream() {
         __android_log_print(ANDROID_LOG_INFO, TAG, "openStream()");
 
+        // The hint session belongs to the old callback thread.
+        mPerformanceHint.close();
+
         // Use shared_ptr to prevent use of a deleted callback.
         mDataCallback = std::make_shared<MyDataCallback>(this);
         mErrorCallback = std::make_shared<MyErrorCallback>(this);
@@ -193,17 +315,12 @@ namespace iolib {
             return false;
         }
 
-        // Reduce stream latency by setting the buffer size to a multiple of the burst size
-        // Note: this will fail with ErrorUnimplemented if we are using a callback with OpenSL ES
-        // See oboe::AudioStreamBuffered::setBufferSizeInFrames
-        result = mAudioStream->setBufferSizeInFrames(
-                mAudioStream->getFramesPerBurst() * kBufferSizeInBursts);
-        if (result != Result::OK) {
-            __android_log_print(
-                    ANDROID_LOG_WARN,
-                    TAG,
-                    "setBufferSizeInFrames failed. Error: %s", convertToText(result));
-        }
+        // Frame positions start again with the new stream.
+        mTrackStartPosition.store(-1);
+        mTransportClock.reset(mAudioStream->getSampleRate());
+
+        // Start with the lowest latency and let the tuner grow the buffer if it glitches.
+        mBufferSizeTuner.start(*mAudioStream);
 
         mSampleRate = mAudioStream->getSampleRate();
 
@@ -249,12 +366,14 @@ namespace iolib {
     void SimpleAudioPlayer::teardownAudioStream() {
         __android_log_print(ANDROID_LOG_INFO, TAG, "teardownAudioStream()");
         this->firstFrameHit = false;
+        mBufferSizeTuner.stop();
         // tear down the player
         if (mAudioStream) {
             mAudioStream->stop();
             mAudioStream->close();
             mAudioStream.reset();
         }
+        mPerformanceHint.close();
     }
 
     void SimpleAudioPlayer::pauseStream(){
@@ -279,6 +398,7 @@ namespace iolib {
 
     void SimpleAudioPlayer::addSampleSource(SampleSource* source, SampleBuffer* buffer) {
         buffer->resampleData(mSampleRate);
+        buffer->buildWaveformOverview();
 
         mSampleBuffers.push_back(buffer);
         mSampleSources.push_back(source);
@@ -290,6 +410,7 @@ namespace iolib {
         resetAll();
 
         for (int32_t bufferIndex = 0; bufferIndex < mNumSampleBuffers; bufferIndex++) {
+            delete mSampleBuffers[bufferIndex];
             delete mSampleSources[bufferIndex];
         }
 
@@ -310,10 +431,27 @@ namespace iolib {
             __android_log_print(ANDROID_LOG_INFO, TAG, "timestamp at triggerDown(): %lld", currentTimeMillis);
             __android_log_print(ANDROID_LOG_INFO, TAG, "triggerDown(%d)", index);
 
+            if (!mSampleSources[index]->isPlaying()) {
+                hintUpcomingVoices(getActiveVoiceCount() + 1);
+            }
             mSampleSources[index]->setPlayMode();
         }
     }
 
+    int32_t SimpleAudioPlayer::getActiveVoiceCount() {
+        int32_t activeVoices = 0;
+        for (int32_t index = 0; index < mNumSampleBuffers; index++) {
+            if (mSampleSources[index]->isPlaying()) {
+                activeVoices++;
+            }
+        }
+        return activeVoices;
+    }
+
+    void SimpleAudioPlayer::hintUpcomingVoices(int32_t numVoices) {
+        mPerformanceHint.hintActiveVoices(numVoices);
+    }
+
     void SimpleAudioPlayer::triggerUp(int32_t index) {
         this->firstFrameHit = false;
         if (index < mNumSampleBuffers) {
@@ -21,12 +21,20 @@
  * limitations under the License.
  */
 
+#include <atomic>
 #include <vector>
 
 #include <oboe/Oboe.h>
 
+#include <analysis/LevelMeter.h>
+#include <analysis/WaveformOverview.h>
+#include <player/BufferSizeTuner.h>
 #include <player/OneShotSampleSource.h>
+#include <player/PerformanceHint.h>
+#include <player/PlayerStatus.h>
 #include <player/SampleBuffer.h>
+#include <player/StreamTelemetry.h>
+#include <player/TransportClock.h>
 #include "AudioRingBuffer.h"
 extern JavaVM* g_JavaVM;
 extern jobject gJavaCallbackObj;
@@ -65,6 +73,13 @@ namespace iolib {
         void triggerDown(int32_t index);
         void triggerUp(int32_t index);
 
+        /**
+         * Tell the CPU governor that this many voices are about to play, for example
+         * just before starting several stems together. triggerDown() does this for one voice.
+         */
+        void hintUpcomingVoices(int32_t numVoices);
+        int32_t getActiveVoiceCount();
+
         void resetAll();
 
         bool getOutputReset() { return mOutputReset; }
@@ -75,17 +90,71 @@ namespace iolib {
 
         void setGain(int index, float gain);
         float getGain(int index);
+
+        /**
+         * The overview of a loaded source, built by addSampleSource(), or nullptr if the
+         * index is out of range. unloadSampleData() deletes the buffer that owns it.
+         */
+        const WaveformOverview *getWaveformOverview(int32_t index) {
+            if (index < 0 || index >= static_cast<int32_t>(mSampleBuffers.size())) {
+                return nullptr;
+            }
+            return &mSampleBuffers[index]->getWaveformOverview();
+        }
         void pauseStream();
         void resumeStream();
         void seekTo(int64_t positionMillis, int mSampleRate, int mNumChannels);
-        int64_t getPosition(int index, int mSampleRate, int mNumChannels);
-        int64_t getDuration(int i, int channelCount);
         int64_t getFramePosition();
         int64_t getFrameTimeStamp();
-        int64_t framePosition = 0;
-        int64_t presentationTime = 0;
+        std::atomic<int64_t> framePosition{0};
+        std::atomic<int64_t> presentationTime{0};
         int getAudioSessionId();
 
+        // Output frame positions in CLOCK_MONOTONIC time, see TransportClock.
+        const TransportClock &getTransportClock() const { return mTransportClock; }
+
+        /**
+         * CLOCK_MONOTONIC time at which the first frame of the current playback was presented,
+         * from the output timestamp. RecordingEngine uses it to line takes up with the track.
+         * May be called from any thread.
+         *
+         * @return nanoseconds, or -1 if nothing is playing or there is no timestamp yet
+         */
+        int64_t getTrackStartTimeNanos();
+
+        // Adaptive buffer sizing, see BufferSizeTuner.
+        // The limits are used the next time the stream is opened.
+        void setBufferTuningLimits(int32_t minimumBursts, int32_t maximumBursts,
+                                   int32_t quietPeriodMillis) {
+            mBufferSizeTuner.setLimits(minimumBursts, maximumBursts, quietPeriodMillis);
+        }
+        int32_t getBufferSizeInFrames() { return mBufferSizeTuner.getBufferSizeInFrames(); }
+        int32_t getXRunCount() { return mBufferSizeTuner.getXRunCount(); }
+        int32_t getBufferGrowCount() { return mBufferSizeTuner.getGrowCount(); }
+        int32_t getBufferShrinkCount() { return mBufferSizeTuner.getShrinkCount(); }
+
+        // Callback timing and glitch statistics, see StreamTelemetry.
+        void getTelemetry(StreamTelemetry::Snapshot &snapshot) { mTelemetry.getSnapshot(snapshot); }
+        void resetTelemetry() { mTelemetry.requestReset(); }
+
+        /**
+         * Positions, transport time, buffer state and levels, updated by every data callback.
+         * The block can be wrapped in a direct ByteBuffer, see PlayerStatus.
+         */
+        PlayerStatus &getStatus() { return mStatus; }
+
+        static constexpr float kDefaultMeteringRate = 30.0f;
+
+        /**
+         * How many times per second the levels in the status are updated. Each update has
+         * the peak, RMS and true peak of the output, and the peak and RMS of each source,
+         * over the audio since the last one. 0 turns metering off, which saves its cost.
+         * May be called from any thread.
+         */
+        void setMeteringRate(float rateHz) {
+            mMeteringRate.store(rateHz, std::memory_order_relaxed);
+        }
+
     private:
         class MyDataCallback : public oboe::AudioStreamDataCallback {
         public:
@@ -131,6 +200,24 @@ namespace iolib {
         std::shared_ptr<MyDataCallback> mDataCallback;
         std::shared_ptr<MyErrorCallback> mErrorCallback;
         bool mIsStreamPaused;
+        BufferSizeTuner mBufferSizeTuner;
+        PerformanceHint mPerformanceHint;
+        StreamTelemetry mTelemetry;
+        TransportClock mTransportClock;
+        // Output frame position where the voices started, or -1 when none are playing.
+        std::atomic<int64_t> mTrackStartPosition{-1};
+
+        // Only used by the data callback.
+        void publishStatus(oboe::AudioStream &stream, const float *audioData, int32_t numFrames,
+                           int32_t activeVoices, float meteringRate);
+        void updateMeters(const float *audioData, int32_t numFrames, float meteringRate);
+        void resetMeters();
+        PlayerStatus mStatus;
+        PlayerStatus::Values mStatusValues{};
+        std::atomic<float> mMeteringRate{kDefaultMeteringRate};
+        LevelMeter mMasterMeter;
+        // Frames in the current metering window, or -1 while metering is off.
+        int32_t mMeterFrames = 0;
 
         void callJavaMethod(const char *methodName, const char *methodSignature, const char *str);
 
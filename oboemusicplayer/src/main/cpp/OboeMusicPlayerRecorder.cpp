@@ -1,16 +1,21 @@
 #include <jni.h>
+#include <algorithm>
 #include <string>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <android/log.h>
+#include <decoder/AudioDecoderRegistry.h>
+#include <probe/AudioDirectoryScanner.h>
+#include <stream/MappedInputStream.h>
 #include <stream/MemInputStream.h>
-#include <wav/WavStreamReader.h>
 #include <player/OneShotSampleSource.h>
 #include "Engines/RecordingEngine.h"
 #include "Engines/EarbackEngine.h"
+#include "Engines/LatencyCalibrator.h"
 #include "Engines/SimpleAudioPlayer.h"
+#include "../../../oboe/src/common/AudioClock.h"
 
 static const char* TAG = "MusicPlayerRecorderJNI";
 using namespace iolib;
@@ -18,6 +23,7 @@ using namespace parselib;
 static EarbackEngine * earbackEngine = nullptr;
 static SimpleAudioPlayer* sDTPlayer = nullptr; // Dynamically allocated
 static RecordingEngine* recordingEngine = nullptr;
+static LatencyCalibrator* latencyCalibrator = nullptr;
 static const int kOboeApiAAudio = 0;
 static const int kOboeApiOpenSLES = 1;
 JavaVM* g_JavaVM = nullptr;
@@ -90,35 +96,59 @@ JNIEXPORT void JNICALL Java_in_reconv_oboemusicplayer_NativeMusicPlayer_teardown
 }
 
 /**
- * Native (JNI) implementation of MusicPlayer.loadWavAssetNative()
+ * Decode all of an asset into a SampleBuffer and add it to the player.
+ * The stream is only read here, so it need not outlive the call.
  */
-
-// the trick is to load the wav files before being asked to play, this way we can make sure that the
-// lease possible latency is being introduced.
-JNIEXPORT void JNICALL Java_in_reconv_oboemusicplayer_NativeMusicPlayer_loadWavAssetNative(
-        JNIEnv* env, jobject, jbyteArray bytearray, jint index, jfloat pan) {
+static bool loadAsset(parselib::InputStream *stream, jfloat pan) {
     if (sDTPlayer == nullptr) {
         sDTPlayer = new SimpleAudioPlayer();
     }
-    int len = env->GetArrayLength (bytearray);
-
-    unsigned char* buf = new unsigned char[len];
-    env->GetByteArrayRegion (bytearray, 0, len, reinterpret_cast<jbyte*>(buf));
-
-    MemInputStream stream(buf, len);
 
-    WavStreamReader reader(&stream);
-    reader.parse();
-
-    reader.getNumChannels();
+    // The format of the asset is picked from its first bytes.
+    std::unique_ptr<AudioDecoder> decoder = AudioDecoderRegistry::createDecoder(stream);
+    if (decoder == nullptr) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "loadAsset: unknown audio format");
+        return false;
+    }
 
     SampleBuffer* sampleBuffer = new SampleBuffer();
-    sampleBuffer->loadSampleData(&reader);
+    sampleBuffer->loadSampleData(decoder.get());
 
     OneShotSampleSource* source = new OneShotSampleSource(sampleBuffer, pan);
     sDTPlayer->addSampleSource(source, sampleBuffer);
+    return true;
+}
 
-    delete[] buf;
+/**
+ * Native (JNI) implementation of MusicPlayer.loadWavAssetFdNative()
+ * The file is mapped rather than copied, so an asset never has to be in memory as bytes.
+ */
+
+// the trick is to load the wav files before being asked to play, this way we can make sure that the
+// lease possible latency is being introduced.
+JNIEXPORT jboolean JNICALL Java_in_reconv_oboemusicplayer_NativeMusicPlayer_loadWavAssetFdNative(
+        JNIEnv* env, jobject, jint fd, jlong offset, jlong length, jint index, jfloat pan) {
+    MappedInputStream stream(fd, offset, length);
+    if (!stream.isValid()) {
+        return JNI_FALSE;
+    }
+    return loadAsset(&stream, pan) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Native (JNI) implementation of MusicPlayer.loadWavBufferNative()
+ * Decodes straight from the memory of a direct ByteBuffer, from 0 to its capacity.
+ */
+JNIEXPORT jboolean JNICALL Java_in_reconv_oboemusicplayer_NativeMusicPlayer_loadWavBufferNative(
+        JNIEnv* env, jobject, jobject buffer, jint index, jfloat pan) {
+    auto *data = static_cast<unsigned char *>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (data == nullptr || capacity <= 0) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "loadWavBufferNative: not a direct buffer");
+        return JNI_FALSE;
+    }
+    MemInputStream stream(data, capacity);
+    return loadAsset(&stream, pan) ? JNI_TRUE : JNI_FALSE;
 }
 
 /**
@@ -229,14 +259,6 @@ JNIEXPORT void JNICALL Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setGain(
     sDTPlayer->setGain(index, gain);
 }
 
-JNIEXPORT jlong JNICALL Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getPosition(
-        JNIEnv *env, jobject thiz, jint  index, jint mSampleRate, jint mNumChannels) {
-    if (sDTPlayer == nullptr) {
-        return 0;
-    }
-    return sDTPlayer->getPosition(index, mSampleRate, mNumChannels);
-}
-
 JNIEXPORT jfloat JNICALL Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getGain(
         JNIEnv *env, jobject thiz, jint index) {
     if (sDTPlayer == nullptr) {
@@ -422,19 +444,61 @@ Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setCallbackObject(JNIEnv *env,
 }
 
 extern "C"
-JNIEXPORT jlong JNICALL
-Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getDurationNative(JNIEnv *env, jobject thiz, jint mSampleRate, jint mNumChannels) {
+JNIEXPORT jobject JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getPlayerStatusBuffer(JNIEnv *env, jobject thiz) {
     if (sDTPlayer == nullptr) {
-        return 0;
+        return nullptr;
+    }
+    // The player is never deleted, so the memory stays valid for the buffer.
+    PlayerStatus &status = sDTPlayer->getStatus();
+    return env->NewDirectByteBuffer(status.getBlock(), status.getBlockSize());
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_copyPlayerStatus(JNIEnv *env, jobject thiz,
+                                                                  jobject snapshot) {
+    jlong capacity = env->GetDirectBufferCapacity(snapshot);
+    if (sDTPlayer == nullptr || capacity < 0) {
+        return JNI_FALSE;
     }
-    return sDTPlayer->getDuration(mSampleRate, mNumChannels);
+    bool copied = sDTPlayer->getStatus().copyTo(env->GetDirectBufferAddress(snapshot),
+                                                static_cast<size_t>(capacity));
+    return copied ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT jobject JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getWaveformOverviewBuffer(JNIEnv *env,
+                                                                           jobject thiz,
+                                                                           jint index) {
+    if (sDTPlayer == nullptr) {
+        return nullptr;
+    }
+    const WaveformOverview *overview = sDTPlayer->getWaveformOverview(index);
+    if (overview == nullptr || overview->getData() == nullptr) {
+        return nullptr;
+    }
+    // The buffer is read only from Java, and only until the samples are unloaded.
+    return env->NewDirectByteBuffer(const_cast<uint8_t *>(overview->getData()),
+                                    static_cast<jlong>(overview->getSize()));
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setMeteringRate(JNIEnv *env, jobject thiz,
+                                                                 jfloat rateHz) {
+    if (sDTPlayer == nullptr) {
+        return;
+    }
+    sDTPlayer->setMeteringRate(rateHz);
 }
 
 extern "C"
 JNIEXPORT jlong JNICALL
 Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getMusicPlayerTimeStamp(JNIEnv *env, jobject thiz) {
     if (sDTPlayer == nullptr) {
-        sDTPlayer = new SimpleAudioPlayer();
+        return 0;
     }
     return sDTPlayer->getFrameTimeStamp();
 }
@@ -443,7 +507,7 @@ extern "C"
 JNIEXPORT jlong JNICALL
 Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getMusicPlayerFramePosition(JNIEnv *env, jobject thiz) {
     if (sDTPlayer == nullptr) {
-        sDTPlayer = new SimpleAudioPlayer();
+        return 0;
     }
     return sDTPlayer->getFramePosition();
 }
@@ -479,4 +543,424 @@ Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getPlayerAudioSessionId(JNIEnv
         sDTPlayer = new SimpleAudioPlayer();
     }
     return sDTPlayer->getAudioSessionId();
-}
\ No newline at end of file
+}
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setBufferTuningLimits(JNIEnv *env, jobject thiz,
+                                                                       jint minimumBursts,
+                                                                       jint maximumBursts,
+                                                                       jint quietPeriodMillis) {
+    if (sDTPlayer == nullptr) {
+        sDTPlayer = new SimpleAudioPlayer();
+    }
+    sDTPlayer->setBufferTuningLimits(minimumBursts, maximumBursts, quietPeriodMillis);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getBufferSizeInFrames(JNIEnv *env, jobject thiz) {
+    if (sDTPlayer == nullptr) {
+        return 0;
+    }
+    return sDTPlayer->getBufferSizeInFrames();
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getXRunCount(JNIEnv *env, jobject thiz) {
+    if (sDTPlayer == nullptr) {
+        return 0;
+    }
+    return sDTPlayer->getXRunCount();
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getBufferGrowCount(JNIEnv *env, jobject thiz) {
+    if (sDTPlayer == nullptr) {
+        return 0;
+    }
+    return sDTPlayer->getBufferGrowCount();
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getBufferShrinkCount(JNIEnv *env, jobject thiz) {
+    if (sDTPlayer == nullptr) {
+        return 0;
+    }
+    return sDTPlayer->getBufferShrinkCount();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_hintUpcomingVoices(JNIEnv *env, jobject thiz,
+                                                                    jint numVoices) {
+    if (sDTPlayer == nullptr) {
+        return;
+    }
+    sDTPlayer->hintUpcomingVoices(numVoices);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getEarbackCushionBursts(JNIEnv *env, jobject thiz) {
+    if (earbackEngine == nullptr) {
+        return iolib::DriftCompensatedInput::kDefaultCushionBursts;
+    }
+    return earbackEngine->getCushionBursts();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setEarbackCushionBursts(JNIEnv *env, jobject thiz,
+                                                                        jint num_bursts) {
+    if (earbackEngine == nullptr) {
+        return;
+    }
+    earbackEngine->setCushionBursts(num_bursts);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getEarbackGlitchCount(JNIEnv *env, jobject thiz) {
+    if (earbackEngine == nullptr) {
+        return 0;
+    }
+    return earbackEngine->getMicUnderflowCount();
+}
+
+extern "C"
+JNIEXPORT jdouble JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getEarbackRoundTripLatencyMillis(JNIEnv *env,
+                                                                                 jobject thiz) {
+    if (earbackEngine == nullptr) {
+        return -1.0;
+    }
+    return earbackEngine->getRoundTripLatencyMillis();
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getPlayerTelemetryJson(JNIEnv *env, jobject thiz) {
+    if (sDTPlayer == nullptr) {
+        return nullptr;
+    }
+    StreamTelemetry::Snapshot snapshot;
+    sDTPlayer->getTelemetry(snapshot);
+    return env->NewStringUTF(StreamTelemetry::toJson(snapshot).c_str());
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getEarbackTelemetryJson(JNIEnv *env, jobject thiz) {
+    if (earbackEngine == nullptr) {
+        return nullptr;
+    }
+    StreamTelemetry::Snapshot snapshot;
+    earbackEngine->getTelemetry(snapshot);
+    return env->NewStringUTF(StreamTelemetry::toJson(snapshot).c_str());
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getPlayerTelemetrySummary(JNIEnv *env,
+                                                                           jobject thiz) {
+    if (sDTPlayer == nullptr) {
+        return nullptr;
+    }
+    StreamTelemetry::Snapshot snapshot;
+    sDTPlayer->getTelemetry(snapshot);
+    // The order must match NativeMusicPlayer.TELEMETRY_*
+    jlong summary[] = {
+            snapshot.callbackCount,
+            snapshot.framesRendered,
+            snapshot.xRunCount,
+            snapshot.maxActiveVoices,
+            TelemetryHistogram::getValueAtPercentile(snapshot.durationCounts, 50.0),
+            TelemetryHistogram::getValueAtPercentile(snapshot.durationCounts, 99.0),
+            snapshot.maxDurationNanos,
+            TelemetryHistogram::getValueAtPercentile(snapshot.jitterCounts, 99.0),
+    };
+    jsize length = sizeof(summary) / sizeof(summary[0]);
+    jlongArray result = env->NewLongArray(length);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, length, summary);
+    }
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_resetTelemetry(JNIEnv *env, jobject thiz) {
+    if (sDTPlayer != nullptr) {
+        sDTPlayer->resetTelemetry();
+    }
+    if (earbackEngine != nullptr) {
+        earbackEngine->resetTelemetry();
+    }
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_startLatencyCalibration(JNIEnv *env,
+                                                                        jobject thiz,
+                                                                        jint recording_device_id,
+                                                                        jint playback_device_id) {
+    if (latencyCalibrator == nullptr) {
+        latencyCalibrator = new LatencyCalibrator();
+    }
+    return latencyCalibrator->start(recording_device_id, playback_device_id)
+           ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_pollLatencyCalibration(JNIEnv *env,
+                                                                       jobject thiz) {
+    if (latencyCalibrator == nullptr) {
+        return LatencyCalibrator::kStateIdle;
+    }
+    return latencyCalibrator->poll();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_stopLatencyCalibration(JNIEnv *env,
+                                                                       jobject thiz) {
+    if (latencyCalibrator != nullptr) {
+        latencyCalibrator->stop();
+    }
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getCalibratedOffsetNanos(JNIEnv *env,
+                                                                         jobject thiz) {
+    if (latencyCalibrator == nullptr) {
+        return 0;
+    }
+    return latencyCalibrator->getOffsetNanos();
+}
+
+extern "C"
+JNIEXPORT jdouble JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getCalibrationConfidence(JNIEnv *env,
+                                                                         jobject thiz) {
+    if (latencyCalibrator == nullptr) {
+        return 0.0;
+    }
+    return latencyCalibrator->getConfidence();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setRecordingAlignment(JNIEnv *env, jobject thiz,
+                                                                      jboolean enabled,
+                                                                      jlong offset_nanos) {
+    if (recordingEngine == nullptr) {
+        return;
+    }
+    if (enabled) {
+        recordingEngine->setTrackAlignment(offset_nanos, []() -> int64_t {
+            return (sDTPlayer != nullptr) ? sDTPlayer->getTrackStartTimeNanos() : -1;
+        });
+    } else {
+        recordingEngine->clearTrackAlignment();
+    }
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getTransportPositions(JNIEnv *env,
+                                                                      jobject thiz) {
+    // Both positions are taken at the same instant, without touching the streams.
+    int64_t nowNanos = oboe::AudioClock::getNanoseconds();
+    jlong positions[] = {nowNanos, -1, -1};  // The order must match NativeMusicPlayer.TRANSPORT_*
+    int64_t position = 0;
+    if (sDTPlayer != nullptr
+            && sDTPlayer->getTransportClock().getPositionAtTimeNanos(nowNanos, &position)) {
+        positions[1] = position;
+    }
+    if (recordingEngine != nullptr
+            && recordingEngine->getTransportClock().getPositionAtTimeNanos(nowNanos, &position)) {
+        positions[2] = position;
+    }
+    jsize length = sizeof(positions) / sizeof(positions[0]);
+    jlongArray result = env->NewLongArray(length);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, length, positions);
+    }
+    return result;
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_addVocalEffect(JNIEnv *env, jobject thiz,
+                                                               jint type) {
+    if (earbackEngine == nullptr || type < 0 || type >= kNumVocalEffectTypes) {
+        return -1;
+    }
+    return earbackEngine->getVocalEffects().addEffect(static_cast<VocalEffectType>(type));
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_removeVocalEffect(JNIEnv *env, jobject thiz,
+                                                                  jint effect_id) {
+    if (earbackEngine == nullptr) {
+        return JNI_FALSE;
+    }
+    return earbackEngine->getVocalEffects().removeEffect(effect_id) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_moveVocalEffect(JNIEnv *env, jobject thiz,
+                                                                jint effect_id, jint index) {
+    if (earbackEngine == nullptr) {
+        return JNI_FALSE;
+    }
+    return earbackEngine->getVocalEffects().moveEffect(effect_id, index) ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setVocalEffectEnabled(JNIEnv *env, jobject thiz,
+                                                                      jint effect_id,
+                                                                      jboolean enabled) {
+    if (earbackEngine == nullptr) {
+        return JNI_FALSE;
+    }
+    return earbackEngine->getVocalEffects().setEffectEnabled(effect_id, enabled)
+           ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setVocalEffectParameters(JNIEnv *env,
+                                                                         jobject thiz,
+                                                                         jint effect_id,
+                                                                         jfloatArray values) {
+    if (earbackEngine == nullptr || values == nullptr) {
+        return JNI_FALSE;
+    }
+    // Missing values are zero, extra values are ignored.
+    VocalEffectParameters parameters{};
+    jsize length = std::min<jsize>(env->GetArrayLength(values),
+                                   VocalEffectParameters::kMaxParameters);
+    env->GetFloatArrayRegion(values, 0, length, parameters.values.data());
+    return earbackEngine->getVocalEffects().setEffectParameters(effect_id, parameters)
+           ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_clearVocalEffects(JNIEnv *env, jobject thiz) {
+    if (earbackEngine == nullptr) {
+        return;
+    }
+    earbackEngine->getVocalEffects().clear();
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_startEarbackRecording(JNIEnv *env,
+                                                                      jobject thiz,
+                                                                      jstring file_path) {
+    if (earbackEngine == nullptr || file_path == nullptr) {
+        return JNI_FALSE;
+    }
+    const char *path = env->GetStringUTFChars(file_path, nullptr);
+    bool started = earbackEngine->startTakeRecording(path);
+    env->ReleaseStringUTFChars(file_path, path);
+    return started ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_stopEarbackRecording(JNIEnv *env,
+                                                                     jobject thiz) {
+    if (earbackEngine == nullptr) {
+        return;
+    }
+    earbackEngine->stopTakeRecording();
+}
+
+extern "C"
+JNIEXPORT jlong JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_getEarbackRecordingFramesDropped(JNIEnv *env,
+                                                                                 jobject thiz) {
+    if (earbackEngine == nullptr) {
+        return 0;
+    }
+    return earbackEngine->getTakeFramesDropped();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_setPitchTrackingEnabled(JNIEnv *env,
+                                                                        jobject thiz,
+                                                                        jboolean enabled) {
+    if (earbackEngine == nullptr) {
+        return;
+    }
+    earbackEngine->getPitchTracker().setEnabled(enabled);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_readPitchEstimates(JNIEnv *env, jobject thiz,
+                                                                   jlongArray timestamps_micros,
+                                                                   jfloatArray frequencies,
+                                                                   jfloatArray confidences) {
+    if (earbackEngine == nullptr || timestamps_micros == nullptr || frequencies == nullptr
+            || confidences == nullptr) {
+        return 0;
+    }
+    PitchTracker &pitchTracker = earbackEngine->getPitchTracker();
+    int32_t sampleRate = pitchTracker.getSampleRate();
+    if (sampleRate <= 0) {
+        return 0;
+    }
+    jsize capacity = std::min({env->GetArrayLength(timestamps_micros),
+                               env->GetArrayLength(frequencies),
+                               env->GetArrayLength(confidences),
+                               static_cast<jsize>(PitchTracker::kMaxEstimates)});
+    PitchEstimate estimates[PitchTracker::kMaxEstimates];
+    int32_t numEstimates = pitchTracker.readEstimates(estimates, capacity);
+    if (numEstimates <= 0) {
+        return 0;
+    }
+    jlong timestamps[PitchTracker::kMaxEstimates];
+    jfloat values[PitchTracker::kMaxEstimates];
+    for (int32_t i = 0; i < numEstimates; i++) {
+        timestamps[i] = estimates[i].framePosition * 1000000 / sampleRate;
+    }
+    env->SetLongArrayRegion(timestamps_micros, 0, numEstimates, timestamps);
+    for (int32_t i = 0; i < numEstimates; i++) {
+        values[i] = estimates[i].frequency;
+    }
+    env->SetFloatArrayRegion(frequencies, 0, numEstimates, values);
+    for (int32_t i = 0; i < numEstimates; i++) {
+        values[i] = estimates[i].confidence;
+    }
+    env->SetFloatArrayRegion(confidences, 0, numEstimates, values);
+    return numEstimates;
+}
+
+extern "C"
+JNIEXPORT jstring JNICALL
+Java_in_reconv_oboemusicplayer_NativeMusicPlayer_probeAudioDirectory(JNIEnv *env,
+                                                                     jobject thiz,
+                                                                     jstring directory_path,
+                                                                     jboolean recursive) {
+    if (directory_path == nullptr) {
+        return nullptr;
+    }
+    const char *path = env->GetStringUTFChars(directory_path, nullptr);
+    std::vector<AudioDirectoryScanner::Entry> entries =
+            AudioDirectoryScanner::scan(path, recursive == JNI_TRUE);
+    env->ReleaseStringUTFChars(directory_path, path);
+    return env->NewStringUTF(AudioDirectoryScanner::toJson(entries).c_str());
+}
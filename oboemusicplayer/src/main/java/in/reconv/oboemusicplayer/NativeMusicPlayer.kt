@@ -4,10 +4,11 @@ import android.content.Context
 import android.content.res.AssetManager
 import android.media.AudioManager
 import android.os.Build
+import android.os.ParcelFileDescriptor
 import android.util.Log
 import java.io.File
-import java.io.FileInputStream
 import java.io.IOException
+import java.nio.ByteBuffer
 
 class NativeMusicPlayer {
     /**
@@ -27,17 +28,50 @@ class NativeMusicPlayer {
         }
 
         val TAG: String = "MusicPlayer"
+
+        // Indices into getPlayerTelemetrySummary(). Durations are in nanoseconds.
+        const val TELEMETRY_CALLBACKS: Int = 0
+        const val TELEMETRY_FRAMES: Int = 1
+        const val TELEMETRY_XRUNS: Int = 2
+        const val TELEMETRY_MAX_VOICES: Int = 3
+        const val TELEMETRY_DURATION_P50: Int = 4
+        const val TELEMETRY_DURATION_P99: Int = 5
+        const val TELEMETRY_DURATION_MAX: Int = 6
+        const val TELEMETRY_JITTER_P99: Int = 7
+
+        // Indices into getTransportPositions(). Positions are -1 while a stream has no timestamp.
+        const val TRANSPORT_TIME_NANOS: Int = 0
+        const val TRANSPORT_PLAYER_FRAME: Int = 1
+        const val TRANSPORT_RECORDER_FRAME: Int = 2
+
+        // Values returned by pollLatencyCalibration(), must match LatencyCalibrator.h
+        const val CALIBRATION_IDLE: Int = 0
+        const val CALIBRATION_RUNNING: Int = 1
+        const val CALIBRATION_DONE: Int = 2
+        const val CALIBRATION_FAILED: Int = 3
+
+        // Types for addVocalEffect(), must match VocalEffectType in VocalEffects.h
+        const val VOCAL_EFFECT_GAIN: Int = 0
+        const val VOCAL_EFFECT_ECHO: Int = 1
+        const val VOCAL_EFFECT_SLAPBACK: Int = 2
+        const val VOCAL_EFFECT_FLANGER: Int = 3
+        const val VOCAL_EFFECT_VIBRATO: Int = 4
+        const val VOCAL_EFFECT_WHITE_CHORUS: Int = 5
+        const val VOCAL_EFFECT_DOUBLING: Int = 6
+        const val VOCAL_EFFECT_TREMOLO: Int = 7
+        const val VOCAL_EFFECT_OVERDRIVE: Int = 8
+        const val VOCAL_EFFECT_DISTORTION: Int = 9
+
+        private const val CUSHION_PREFS: String = "earback_cushion"
     }
 
     private fun loadWavAsset(assetMgr: AssetManager, assetName: String, index: Int, pan: Float) {
         try {
-            val assetFD = assetMgr.openFd(assetName)
-            val dataStream = assetFD.createInputStream()
-            val dataLen = assetFD.getLength().toInt()
-            val dataBytes = ByteArray(dataLen)
-            dataStream.read(dataBytes, 0, dataLen)
-            loadWavAssetNative(dataBytes, index, pan)
-            assetFD.close()
+            // The asset is mapped from the APK rather than copied into a ByteArray.
+            assetMgr.openFd(assetName).use { assetFD ->
+                loadWavAssetFdNative(assetFD.parcelFileDescriptor.fd, assetFD.startOffset,
+                        assetFD.length, index, pan)
+            }
         } catch (ex: IOException) {
             Log.i(TAG, "IOException$ex")
         }
@@ -45,27 +79,26 @@ class NativeMusicPlayer {
 
     public fun loadWavFile(filePath: String, index: Int, pan: Float) {
         try {
-            // Open the file using FileInputStream
-            val file = File(filePath)
-            val dataStream = FileInputStream(file)
-
-            // Get the file size
-            val dataLen = file.length().toInt()
-
-            // Read the file data into a byte array
-            val dataBytes = ByteArray(dataLen)
-            dataStream.read(dataBytes, 0, dataLen)
-
-            // Call your native function with the data
-            loadWavAssetNative(dataBytes, index, pan)
-
-            // Close the stream
-            dataStream.close()
+            // The file is mapped rather than read into a ByteArray.
+            ParcelFileDescriptor.open(File(filePath), ParcelFileDescriptor.MODE_READ_ONLY).use { pfd ->
+                loadWavAssetFdNative(pfd.fd, 0, pfd.statSize, index, pan)
+            }
         } catch (ex: IOException) {
             Log.i(TAG, "IOException: $ex")
         }
     }
 
+    /**
+     * Load a WAV or FLAC file that is already in memory, without copying it.
+     * The buffer must be direct, and all of it up to its capacity is read.
+     */
+    public fun loadWavBuffer(buffer: ByteBuffer, index: Int, pan: Float): Boolean {
+        if (!buffer.isDirect) {
+            Log.e(TAG, "loadWavBuffer needs a direct ByteBuffer")
+            return false
+        }
+        return loadWavBufferNative(buffer, index, pan)
+    }
 
     fun setupAudioStream() {
         setupAudioStreamNative(NUM_PLAY_CHANNELS)
@@ -79,12 +112,6 @@ class NativeMusicPlayer {
         teardownAudioStreamNative()
     }
 
-    fun getDuration(mSampleRate: Int, mChannelCount: Int): Long{
-        return getDurationNative(mSampleRate, mChannelCount)
-    }
-
-    private external fun getDurationNative(mSampleRate: Int, mChannelCount: Int): Long
-
     // asset-based samples
     fun loadWavAssets(assetMgr: AssetManager) {
         loadWavAsset(assetMgr, "Karoke_aaj_se_teri.wav", 0, 0f)
@@ -101,7 +128,9 @@ class NativeMusicPlayer {
     private external fun startAudioStreamNative()
     private external fun teardownAudioStreamNative()
 
-    private external fun loadWavAssetNative(wavBytes: ByteArray, index: Int, pan: Float)
+    private external fun loadWavAssetFdNative(fd: Int, offset: Long, length: Long, index: Int,
+                                              pan: Float): Boolean
+    private external fun loadWavBufferNative(buffer: ByteBuffer, index: Int, pan: Float): Boolean
     private external fun unloadWavAssetsNative()
 
     external fun trigger(drumIndex: Int)
@@ -120,7 +149,6 @@ class NativeMusicPlayer {
     external fun pauseTrigger()
     external fun resumeTrigger()
     external fun seekToPosition(position: Long, mSampleRate : Int, mChannelCount: Int)
-    external fun getPosition(index: Int, mSampleRate : Int, mChannelCount: Int): Long
 
     // External functions for Recording
     external fun create(): Boolean
@@ -148,6 +176,159 @@ class NativeMusicPlayer {
     external fun setCallbackObject(callbackObject: Any?)
     external fun getPlayerAudioSessionId(): Int
     external fun getRecorderAudioSessionId(): Int
+
+    // Adaptive buffer sizing. The limits are applied when the player stream is next opened.
+    // maximumBursts = 0 means the buffer capacity.
+    external fun setBufferTuningLimits(minimumBursts: Int, maximumBursts: Int, quietPeriodMillis: Int)
+    external fun getBufferSizeInFrames(): Int
+    external fun getXRunCount(): Int
+    external fun getBufferGrowCount(): Int
+    external fun getBufferShrinkCount(): Int
+
+    private var playerStatus: PlayerStatus? = null
+
+    /**
+     * Positions, durations, transport time, buffer state and output levels, updated by
+     * every data callback. Call read() on it each time before using the fields; that does
+     * not call into native code. Returns null before createPlayer().
+     */
+    fun getPlayerStatus(): PlayerStatus? {
+        if (playerStatus == null) {
+            playerStatus = getPlayerStatusBuffer()?.let { PlayerStatus(it, ::copyPlayerStatus) }
+        }
+        return playerStatus
+    }
+
+    private external fun getPlayerStatusBuffer(): ByteBuffer?
+    private external fun copyPlayerStatus(snapshot: ByteBuffer): Boolean
+
+    /**
+     * Min, max and RMS of the source at index, at a few zoom levels, for drawing its
+     * waveform. Returns null if nothing is loaded at index. The overview reads native memory
+     * that is freed by unloadWavAssets(), so get it again after every load.
+     */
+    fun getWaveformOverview(index: Int): WaveformOverview? =
+        getWaveformOverviewBuffer(index)?.let { WaveformOverview(it) }
+
+    private external fun getWaveformOverviewBuffer(index: Int): ByteBuffer?
+
+    /**
+     * How many times per second the levels in getPlayerStatus() are measured, 30 by default.
+     * Use about the rate the meters are drawn at. 0 turns metering off.
+     */
+    external fun setMeteringRate(rateHz: Float)
+
+    // Call just before starting several stems at once so the CPU can speed up in advance.
+    external fun hintUpcomingVoices(numVoices: Int)
+
+    // Data callback timing and glitch statistics, as JSON for logging or upload.
+    external fun getPlayerTelemetryJson(): String?
+    external fun getEarbackTelemetryJson(): String?
+    external fun getPlayerTelemetrySummary(): LongArray?
+    external fun resetTelemetry()
+
+    // Earback input cushion, in input bursts. It is tuned while the effect is on.
+    external fun getEarbackCushionBursts(): Int
+    external fun setEarbackCushionBursts(numBursts: Int)
+    // Number of times the microphone ran dry since the effect was turned on.
+    external fun getEarbackGlitchCount(): Int
+    // Microphone to speaker latency, or -1 if the effect is off.
+    external fun getEarbackRoundTripLatencyMillis(): Double
+
+    /**
+     * The output frame being heard and the input frame being captured at one CLOCK_MONOTONIC
+     * time, corrected for the drift of each audio clock. Cheap enough to call every UI frame.
+     */
+    external fun getTransportPositions(): LongArray?
+
+    // Speaker to microphone calibration. Start it in a quiet room with the volume up,
+    // then poll every few hundred milliseconds until it is DONE or FAILED.
+    external fun startLatencyCalibration(recordingDeviceId: Int, playbackDeviceId: Int): Boolean
+    external fun pollLatencyCalibration(): Int
+    external fun stopLatencyCalibration()
+    // How much later the microphone hears a sound than the timestamps say it was played.
+    external fun getCalibratedOffsetNanos(): Long
+    // Between 0 and 1. The calibration fails below 0.5.
+    external fun getCalibrationConfidence(): Double
+
+    /**
+     * Trim or pad the next recordings so that they start with the first frame of the track
+     * played by trigger(). Call after create() and before startRecording().
+     */
+    external fun setRecordingAlignment(enabled: Boolean, offsetNanos: Long)
+
+    /**
+     * Effects applied to the earback microphone, in order. They can be changed while the
+     * effect is on without glitches. Add returns an id, or -1 if there are already 8.
+     * The parameters are those of the fxlab effects, for example {feedback, delay ms} for echo.
+     */
+    external fun addVocalEffect(type: Int): Int
+    external fun removeVocalEffect(effectId: Int): Boolean
+    external fun moveVocalEffect(effectId: Int, index: Int): Boolean
+    external fun setVocalEffectEnabled(effectId: Int, enabled: Boolean): Boolean
+    external fun setVocalEffectParameters(effectId: Int, values: FloatArray): Boolean
+    external fun clearVocalEffects()
+
+    /**
+     * Record the earback microphone, before the effects, to a 16-bit WAV file while the
+     * effect is on. It uses the input that feeds the speaker, so do not also call
+     * startRecording(). The take is finished by stopEarbackRecording() or setEffectOn(false).
+     */
+    external fun startEarbackRecording(filePath: String): Boolean
+    external fun stopEarbackRecording()
+    // Frames missing from the take because the storage was too slow.
+    external fun getEarbackRecordingFramesDropped(): Long
+
+    /**
+     * Track the pitch of the earback microphone natively, for scoring. Can be turned on
+     * before or while the effect is on. Use it instead of analyzing onAudioDataAvailable.
+     */
+    external fun setPitchTrackingEnabled(enabled: Boolean)
+
+    /**
+     * Take the pitch estimates made since the last call, about one every 10 ms, oldest first.
+     * The timestamp is the time in the output stream in microseconds. The frequency is in Hz,
+     * or 0 when the voice is not pitched. The confidence goes from 0 to 1.
+     * Up to 256 are kept, so poll at least every two seconds.
+     *
+     * @return number of estimates written to the arrays
+     */
+    external fun readPitchEstimates(timestampsMicros: LongArray, frequencies: FloatArray,
+                                    confidences: FloatArray): Int
+
+    /**
+     * Read the format, length, cue points and loops of every WAV and FLAC file in a directory
+     * from their headers, without loading any audio. Several files are read at once, so
+     * call it off the main thread. Other files are left out.
+     *
+     * @return a JSON array with an object per file, sorted by path
+     */
+    external fun probeAudioDirectory(directoryPath: String, recursive: Boolean): String?
+
+    /**
+     * Start the earback cushion at the value that was stable last time on these devices.
+     * Call after create() and before setEffectOn(true).
+     */
+    fun restoreEarbackCushion(context: Context, recordingDeviceId: Int, playbackDeviceId: Int) {
+        val prefs = context.getSharedPreferences(CUSHION_PREFS, Context.MODE_PRIVATE)
+        val key = cushionKey(recordingDeviceId, playbackDeviceId)
+        if (prefs.contains(key)) {
+            setEarbackCushionBursts(prefs.getInt(key, 0))
+        }
+    }
+
+    /**
+     * Save the tuned earback cushion for these devices. Call before setEffectOn(false).
+     */
+    fun saveEarbackCushion(context: Context, recordingDeviceId: Int, playbackDeviceId: Int) {
+        context.getSharedPreferences(CUSHION_PREFS, Context.MODE_PRIVATE).edit()
+            .putInt(cushionKey(recordingDeviceId, playbackDeviceId), getEarbackCushionBursts())
+            .apply()
+    }
+
+    private fun cushionKey(recordingDeviceId: Int, playbackDeviceId: Int): String {
+        return "${Build.MANUFACTURER}/${Build.MODEL}/$recordingDeviceId/$playbackDeviceId"
+    }
     fun setDefaultStreamValues(context: Context) {
         if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.JELLY_BEAN_MR1) {
             val myAudioMgr = context.getSystemService(Context.AUDIO_SERVICE) as AudioManager
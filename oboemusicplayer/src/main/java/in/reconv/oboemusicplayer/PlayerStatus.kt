@@ -0,0 +1,235 @@
+package `in`.reconv.oboemusicplayer
+
+import android.os.Build
+import java.lang.invoke.VarHandle
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Reads the state that the player's data callback publishes into shared memory, see
+ * PlayerStatus.h. read() only copies memory and does not allocate, so it is cheap enough
+ * to call every UI frame. Get the buffer from NativeMusicPlayer.getPlayerStatus().
+ *
+ * The callback never waits for the reader. read() copies the values and tries again if the
+ * callback changed them in the meantime, so the fields are always from one callback.
+ * ByteBuffer reads have no memory ordering of their own, so the copy is fenced with
+ * VarHandle.acquireFence(). Before Android 13 that is not available, and read() asks
+ * copySnapshot to copy the block natively instead, which costs a JNI call.
+ *
+ * @param copySnapshot copies a consistent snapshot of the block into a direct buffer of the
+ *                     same size, see PlayerStatus::copyTo()
+ */
+class PlayerStatus(buffer: ByteBuffer, private val copySnapshot: (ByteBuffer) -> Boolean) {
+    companion object {
+        // Must match PlayerStatus.h
+        const val VERSION: Int = 2
+        const val SOURCE_PLAYING: Int = 1
+
+        private const val SEQUENCE = 0
+        private const val LAYOUT_VERSION = 4
+        private const val LAYOUT_MAX_SOURCES = 12
+        private const val VALUES = 16
+        private const val CALLBACK_COUNT = VALUES + 0
+        private const val FRAMES_WRITTEN = VALUES + 8
+        private const val FRAMES_WRITTEN_TIME_NANOS = VALUES + 16
+        private const val CALLBACK_TIME_NANOS = VALUES + 24
+        private const val FRAMES_PER_SECOND = VALUES + 32
+        private const val SAMPLE_RATE = VALUES + 40
+        private const val CHANNEL_COUNT = VALUES + 44
+        private const val BUFFER_SIZE_IN_FRAMES = VALUES + 48
+        private const val XRUN_COUNT = VALUES + 52
+        private const val ACTIVE_VOICES = VALUES + 56
+        private const val NUM_SOURCES = VALUES + 60
+        private const val METER_COUNT = VALUES + 64
+        private const val PEAK = VALUES + 72
+        private const val RMS = VALUES + 80
+        private const val TRUE_PEAK = VALUES + 88
+        private const val SOURCES = VALUES + 96
+        private const val SOURCE_SIZE = 40
+        private const val SOURCE_PEAK = 24
+        private const val SOURCE_RMS = 32
+        private const val MAX_CHANNELS = 2
+
+        private const val MAX_TRIES = 8
+    }
+
+    private val block: ByteBuffer = buffer.duplicate().order(ByteOrder.LITTLE_ENDIAN)
+    private val snapshot: ByteBuffer? =
+        if (Build.VERSION.SDK_INT < Build.VERSION_CODES.TIRAMISU) {
+            ByteBuffer.allocateDirect(block.capacity()).order(ByteOrder.LITTLE_ENDIAN)
+        } else {
+            null
+        }
+
+    init {
+        require(block.getInt(LAYOUT_VERSION) == VERSION) { "Unsupported player status version" }
+    }
+
+    val maxSources: Int = block.getInt(LAYOUT_MAX_SOURCES)
+
+    // The values of the last successful read(). Times are CLOCK_MONOTONIC nanoseconds.
+    var callbackCount: Long = 0
+        private set
+    var framesWritten: Long = 0
+        private set
+    // When the frame at framesWritten is heard, or -1 before the stream has a timestamp.
+    var framesWrittenTimeNanos: Long = -1
+        private set
+    var callbackTimeNanos: Long = 0
+        private set
+    var framesPerSecond: Double = 0.0
+        private set
+    var sampleRate: Int = 0
+        private set
+    var channelCount: Int = 0
+        private set
+    var bufferSizeInFrames: Int = 0
+        private set
+    var xRunCount: Int = 0
+        private set
+    var activeVoices: Int = 0
+        private set
+    var numSources: Int = 0
+        private set
+    // Metering windows measured so far. The levels only change when this does.
+    var meterCount: Long = 0
+        private set
+    // Output levels per channel in the last metering window, linear from 0 to 1 and over.
+    val peak = FloatArray(MAX_CHANNELS)
+    val rms = FloatArray(MAX_CHANNELS)
+    val truePeak = FloatArray(MAX_CHANNELS)
+    // Per source, in frames of the output sample rate.
+    val sourcePositionFrames = LongArray(maxSources)
+    val sourceNumFrames = LongArray(maxSources)
+    val sourceFlags = IntArray(maxSources)
+    // What each source adds to each output channel, at [source * 2 + channel].
+    val sourcePeak = FloatArray(maxSources * MAX_CHANNELS)
+    val sourceRms = FloatArray(maxSources * MAX_CHANNELS)
+
+    // Where read() copies to before it knows the copy is consistent.
+    private var scratchCallbackCount: Long = 0
+    private var scratchFramesWritten: Long = 0
+    private var scratchFramesWrittenTimeNanos: Long = 0
+    private var scratchCallbackTimeNanos: Long = 0
+    private var scratchFramesPerSecond: Double = 0.0
+    private var scratchSampleRate: Int = 0
+    private var scratchChannelCount: Int = 0
+    private var scratchBufferSizeInFrames: Int = 0
+    private var scratchXRunCount: Int = 0
+    private var scratchActiveVoices: Int = 0
+    private var scratchNumSources: Int = 0
+    private var scratchMeterCount: Long = 0
+    private val scratchLevels = FloatArray(3 * MAX_CHANNELS)
+    private val scratchPositions = LongArray(maxSources)
+    private val scratchNumFrames = LongArray(maxSources)
+    private val scratchFlags = IntArray(maxSources)
+    private val scratchSourcePeak = FloatArray(maxSources * MAX_CHANNELS)
+    private val scratchSourceRms = FloatArray(maxSources * MAX_CHANNELS)
+
+    /**
+     * Copy the latest values into the fields.
+     * @return false if the callback kept changing them, in which case the fields are not changed
+     */
+    fun read(): Boolean {
+        if (Build.VERSION.SDK_INT < Build.VERSION_CODES.TIRAMISU) {
+            val snapshot = snapshot ?: return false
+            if (!copySnapshot(snapshot)) {
+                return false
+            }
+            copyValues(snapshot)
+            commit()
+            return true
+        }
+        for (attempt in 0 until MAX_TRIES) {
+            val before = block.getInt(SEQUENCE)
+            if ((before and 1) != 0) {
+                continue
+            }
+            // Keep the copy between the two reads of the sequence, as PlayerStatus::load() does.
+            VarHandle.acquireFence()
+            copyValues(block)
+            VarHandle.acquireFence()
+            if (block.getInt(SEQUENCE) != before) {
+                continue
+            }
+            commit()
+            return true
+        }
+        return false
+    }
+
+    private fun copyValues(source: ByteBuffer) {
+        scratchCallbackCount = source.getLong(CALLBACK_COUNT)
+        scratchFramesWritten = source.getLong(FRAMES_WRITTEN)
+        scratchFramesWrittenTimeNanos = source.getLong(FRAMES_WRITTEN_TIME_NANOS)
+        scratchCallbackTimeNanos = source.getLong(CALLBACK_TIME_NANOS)
+        scratchFramesPerSecond = source.getDouble(FRAMES_PER_SECOND)
+        scratchSampleRate = source.getInt(SAMPLE_RATE)
+        scratchChannelCount = source.getInt(CHANNEL_COUNT)
+        scratchBufferSizeInFrames = source.getInt(BUFFER_SIZE_IN_FRAMES)
+        scratchXRunCount = source.getInt(XRUN_COUNT)
+        scratchActiveVoices = source.getInt(ACTIVE_VOICES)
+        scratchNumSources = source.getInt(NUM_SOURCES).coerceIn(0, maxSources)
+        scratchMeterCount = source.getLong(METER_COUNT)
+        // peak, rms and truePeak are consecutive
+        for (i in 0 until 3 * MAX_CHANNELS) {
+            scratchLevels[i] = source.getFloat(PEAK + i * 4)
+        }
+        for (index in 0 until scratchNumSources) {
+            val offset = SOURCES + index * SOURCE_SIZE
+            scratchPositions[index] = source.getLong(offset)
+            scratchNumFrames[index] = source.getLong(offset + 8)
+            scratchFlags[index] = source.getInt(offset + 16)
+            for (channel in 0 until MAX_CHANNELS) {
+                scratchSourcePeak[index * MAX_CHANNELS + channel] =
+                    source.getFloat(offset + SOURCE_PEAK + channel * 4)
+                scratchSourceRms[index * MAX_CHANNELS + channel] =
+                    source.getFloat(offset + SOURCE_RMS + channel * 4)
+            }
+        }
+    }
+
+    private fun commit() {
+        callbackCount = scratchCallbackCount
+        framesWritten = scratchFramesWritten
+        framesWrittenTimeNanos = scratchFramesWrittenTimeNanos
+        callbackTimeNanos = scratchCallbackTimeNanos
+        framesPerSecond = scratchFramesPerSecond
+        sampleRate = scratchSampleRate
+        channelCount = scratchChannelCount
+        bufferSizeInFrames = scratchBufferSizeInFrames
+        xRunCount = scratchXRunCount
+        activeVoices = scratchActiveVoices
+        numSources = scratchNumSources
+        meterCount = scratchMeterCount
+        scratchLevels.copyInto(peak, 0, 0, MAX_CHANNELS)
+        scratchLevels.copyInto(rms, 0, MAX_CHANNELS, 2 * MAX_CHANNELS)
+        scratchLevels.copyInto(truePeak, 0, 2 * MAX_CHANNELS, 3 * MAX_CHANNELS)
+        scratchPositions.copyInto(sourcePositionFrames, 0, 0, scratchNumSources)
+        scratchNumFrames.copyInto(sourceNumFrames, 0, 0, scratchNumSources)
+        scratchFlags.copyInto(sourceFlags, 0, 0, scratchNumSources)
+        scratchSourcePeak.copyInto(sourcePeak, 0, 0, scratchNumSources * MAX_CHANNELS)
+        scratchSourceRms.copyInto(sourceRms, 0, 0, scratchNumSources * MAX_CHANNELS)
+    }
+
+    fun isSourcePlaying(index: Int): Boolean =
+        index < numSources && (sourceFlags[index] and SOURCE_PLAYING) != 0
+
+    fun getSourcePositionMillis(index: Int): Long =
+        if (index < numSources && sampleRate > 0) sourcePositionFrames[index] * 1000 / sampleRate else 0
+
+    fun getSourceDurationMillis(index: Int): Long =
+        if (index < numSources && sampleRate > 0) sourceNumFrames[index] * 1000 / sampleRate else 0
+
+    /**
+     * The output frame being heard at a CLOCK_MONOTONIC time, such as System.nanoTime(),
+     * or -1 before the stream has a timestamp.
+     */
+    fun getHeardPosition(timeNanos: Long): Long {
+        if (framesWrittenTimeNanos < 0 || framesPerSecond <= 0.0) {
+            return -1
+        }
+        val offsetFrames = (timeNanos - framesWrittenTimeNanos) * framesPerSecond / 1e9
+        return framesWritten + offsetFrames.toLong()
+    }
+}
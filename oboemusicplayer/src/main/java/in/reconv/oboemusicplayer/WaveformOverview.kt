@@ -0,0 +1,65 @@
+package `in`.reconv.oboemusicplayer
+
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * The minimum, maximum and RMS of a loaded source at a few zoom levels, measured when it was
+ * loaded, see WaveformOverview.h. Reading a bin does not copy or allocate, so a waveform view
+ * can draw straight from it. Get one from NativeMusicPlayer.getWaveformOverview().
+ *
+ * The memory belongs to the native player. Drop this object when the sources are unloaded.
+ */
+class WaveformOverview(buffer: ByteBuffer) {
+    companion object {
+        // Must match WaveformOverview.h
+        const val VERSION: Int = 1
+
+        private const val LAYOUT_VERSION = 0
+        private const val CHANNEL_COUNT = 4
+        private const val NUM_FRAMES = 8
+        private const val NUM_LEVELS = 12
+        private const val LEVELS = 16
+        private const val LEVEL_SIZE = 16
+        private const val VALUES_PER_CHANNEL = 3
+
+        private const val SCALE = 1.0f / 32767.0f
+    }
+
+    private val block: ByteBuffer = buffer.asReadOnlyBuffer().order(ByteOrder.LITTLE_ENDIAN)
+
+    init {
+        require(block.getInt(LAYOUT_VERSION) == VERSION) { "Unsupported waveform overview version" }
+    }
+
+    val channelCount: Int = block.getInt(CHANNEL_COUNT)
+    val numFrames: Int = block.getInt(NUM_FRAMES)
+    val numLevels: Int = block.getInt(NUM_LEVELS)
+
+    // Level 0 has the smallest bins.
+    fun getFramesPerBin(level: Int): Int = block.getInt(LEVELS + level * LEVEL_SIZE)
+    fun getNumBins(level: Int): Int = block.getInt(LEVELS + level * LEVEL_SIZE + 4)
+
+    /**
+     * The coarsest level whose bins are no wider than a pixel, so that every pixel has at
+     * least one bin. Level 0 if even its bins are wider.
+     */
+    fun getLevelForFramesPerPixel(framesPerPixel: Float): Int {
+        var level = 0
+        while (level + 1 < numLevels && getFramesPerBin(level + 1) <= framesPerPixel) {
+            level++
+        }
+        return level
+    }
+
+    // The values of a bin, from -1.0 to 1.0.
+    fun getMin(level: Int, bin: Int, channel: Int): Float = getValue(level, bin, channel, 0)
+    fun getMax(level: Int, bin: Int, channel: Int): Float = getValue(level, bin, channel, 1)
+    fun getRms(level: Int, bin: Int, channel: Int): Float = getValue(level, bin, channel, 2)
+
+    private fun getValue(level: Int, bin: Int, channel: Int, value: Int): Float {
+        val offset = block.getInt(LEVELS + level * LEVEL_SIZE + 8)
+        val index = (bin * channelCount + channel) * VALUES_PER_CHANNEL + value
+        return block.getShort(offset + index * 2) * SCALE
+    }
+}
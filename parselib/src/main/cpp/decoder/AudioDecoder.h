@@ -0,0 +1,96 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_DECODER_AUDIODECODER_H_
+#define _IO_DECODER_AUDIODECODER_H_
+
+#include <cstdint>
+
+namespace parselib {
+
+/**
+ * An interface declaration for reading audio out of an encoded stream, whatever the format.
+ * Concrete implementations include WavStreamReader and FlacStreamReader.
+ * AudioDecoderRegistry picks the implementation for a stream from its first bytes.
+ */
+class AudioDecoder {
+public:
+    AudioDecoder() {}
+    virtual ~AudioDecoder() {}
+
+    static constexpr int ERR_INVALID_FORMAT    = -1;
+    static constexpr int ERR_INVALID_STATE    = -2;
+
+    /**
+     * Read the headers, leaving the stream at the start of the audio.
+     * Returns: false if the stream cannot be decoded.
+     */
+    virtual bool parse() = 0;
+
+    virtual int getSampleRate() = 0;
+
+    virtual int getNumChannels() = 0;
+
+    /**
+     * Returns: The length of the audio, or 0 if the stream does not say.
+     */
+    virtual int64_t getNumSampleFrames() = 0;
+
+    virtual int getBitsPerSample() = 0;
+
+    /**
+     * Returns: The AudioEncoding of the samples in the stream.
+     */
+    virtual int getSampleEncoding() = 0;
+
+    /**
+     * Returns: The WAVE_FORMAT_EXTENSIBLE speaker positions of the channels,
+     * or 0 if the stream does not give them.
+     */
+    virtual uint32_t getChannelMask() { return 0; }
+
+    /**
+     * Returns: AudioEncoding::PCM_16 if getData16() is cheaper than getDataFloat(),
+     * otherwise AudioEncoding::PCM_IEEEFLOAT.
+     */
+    virtual int getNativeEncoding() = 0;
+
+    // Data access
+    virtual void positionToAudio() = 0;
+
+    /**
+     * Move so that the next read starts at the specified frame.
+     * Returns: false if the frame could not be reached.
+     */
+    virtual bool seekToFrame(int64_t frame) = 0;
+
+    /**
+     * Read interleaved frames, scaled to -1.0 to 1.0.
+     * Any frames past the end of the audio are set to 0.
+     * Returns: The number of frames read, or ERR_INVALID_FORMAT or ERR_INVALID_STATE.
+     */
+    virtual int getDataFloat(float *buff, int numFrames) = 0;
+
+    /**
+     * Read interleaved frames as 16-bit samples, which for 16-bit audio is not converted.
+     * Any frames past the end of the audio are set to 0.
+     * Returns: The number of frames read, or ERR_INVALID_FORMAT or ERR_INVALID_STATE.
+     */
+    virtual int getData16(int16_t *buff, int numFrames) = 0;
+};
+
+} // namespace parselib
+
+#endif // _IO_DECODER_AUDIODECODER_H_
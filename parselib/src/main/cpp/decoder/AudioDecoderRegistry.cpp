@@ -0,0 +1,117 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <mutex>
+#include <string.h>
+
+#include "stream/InputStream.h"
+#include "flac/FlacStreamReader.h"
+#include "wav/WavStreamReader.h"
+
+#include "AudioDecoderRegistry.h"
+
+namespace parselib {
+
+namespace {
+
+struct Entry {
+    std::string name;
+    std::vector<AudioDecoderRegistry::Magic> magics;
+    AudioDecoderRegistry::Factory factory;
+
+    bool matches(const uint8_t *data, int numBytes) const {
+        for (const AudioDecoderRegistry::Magic &magic : magics) {
+            if (magic.offset + static_cast<int>(magic.bytes.size()) > numBytes
+                    || memcmp(data + magic.offset, magic.bytes.data(), magic.bytes.size()) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct Registry {
+    std::mutex lock;
+    std::vector<Entry> entries;
+
+    Registry() {
+        auto wav = [](InputStream *stream) {
+            return std::unique_ptr<AudioDecoder>(new WavStreamReader(stream));
+        };
+        auto flac = [](InputStream *stream) {
+            return std::unique_ptr<AudioDecoder>(new FlacStreamReader(stream));
+        };
+        entries.push_back({"wav", {{0, "RIFF"}, {8, "WAVE"}}, wav});
+        entries.push_back({"wav", {{0, "RF64"}, {8, "WAVE"}}, wav});
+        entries.push_back({"wav", {{0, "BW64"}, {8, "WAVE"}}, wav});
+        entries.push_back({"flac", {{0, "fLaC"}}, flac});
+        // An ID3v2 tag in front of the stream. FlacStreamReader skips it, and gives up
+        // if it is followed by something else, such as MP3.
+        entries.push_back({"flac", {{0, "ID3"}}, flac});
+    }
+};
+
+Registry &getRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+} // namespace
+
+void AudioDecoderRegistry::registerDecoder(const std::string &name,
+                                           const std::vector<Magic> &magics, Factory factory) {
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.lock);
+    registry.entries.insert(registry.entries.begin(), {name, magics, std::move(factory)});
+}
+
+std::unique_ptr<AudioDecoder> AudioDecoderRegistry::createDecoder(InputStream *stream) {
+    uint8_t header[kMaxMagicBytes];
+    int32_t numBytes = stream->peek(header, sizeof(header));
+    int64_t startPos = stream->getPos();
+
+    std::vector<Factory> factories;
+    {
+        Registry &registry = getRegistry();
+        std::lock_guard<std::mutex> lock(registry.lock);
+        for (const Entry &entry : registry.entries) {
+            if (entry.matches(header, numBytes)) {
+                factories.push_back(entry.factory);
+            }
+        }
+    }
+
+    for (const Factory &factory : factories) {
+        std::unique_ptr<AudioDecoder> decoder = factory(stream);
+        if (decoder != nullptr && decoder->parse()) {
+            return decoder;
+        }
+        stream->setPos(startPos);
+    }
+    return nullptr;
+}
+
+std::string AudioDecoderRegistry::sniff(const void *data, int numBytes) {
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.lock);
+    for (const Entry &entry : registry.entries) {
+        if (entry.matches(static_cast<const uint8_t *>(data), numBytes)) {
+            return entry.name;
+        }
+    }
+    return "";
+}
+
+} // namespace parselib
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_DECODER_AUDIODECODERREGISTRY_H_
+#define _IO_DECODER_AUDIODECODERREGISTRY_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AudioDecoder.h"
+
+namespace parselib {
+
+class InputStream;
+
+/**
+ * Maps the magic bytes at the start of a stream to the AudioDecoder for its format.
+ * WAV (RIFF, RF64 and BW64) and FLAC are registered to begin with.
+ */
+class AudioDecoderRegistry {
+public:
+    // Creates a decoder that reads from the stream. parse() has not been called yet.
+    typedef std::function<std::unique_ptr<AudioDecoder>(InputStream *stream)> Factory;
+
+    // Bytes that a stream must have at an offset from its start.
+    struct Magic {
+        int offset;
+        std::string bytes;
+    };
+
+    // How far into a stream the magic bytes may reach.
+    static constexpr int kMaxMagicBytes = 32;
+
+    /**
+     * Add a format. A stream must match every one of the magics. Formats registered later
+     * are tried first, so an application can replace a built in decoder.
+     * May be called from any thread.
+     */
+    static void registerDecoder(const std::string &name, const std::vector<Magic> &magics,
+                                Factory factory);
+
+    /**
+     * Pick a decoder by the bytes at the current position of the stream and parse it.
+     * If more than one format matches, the first whose parse() succeeds is used.
+     * Returns: The decoder, positioned at the start of the audio, or nullptr if no format
+     * matches. The stream must outlive it.
+     */
+    static std::unique_ptr<AudioDecoder> createDecoder(InputStream *stream);
+
+    /**
+     * Returns: The name of the format whose magic bytes match the data, or "" if none does.
+     */
+    static std::string sniff(const void *data, int numBytes);
+};
+
+} // namespace parselib
+
+#endif // _IO_DECODER_AUDIODECODERREGISTRY_H_
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_FLAC_FLACBITREADER_H_
+#define _IO_FLAC_FLACBITREADER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace parselib {
+
+/**
+ * Reads big endian bit fields from a block of memory, most significant bit first.
+ *
+ * Up to 64 bits are kept in a cache so most reads are a shift and a mask. Reading past
+ * the end of the block returns zero bits and makes isOverrun() true, so a frame that is
+ * cut off can be decoded without checks on every field and then tried again with more data.
+ */
+class FlacBitReader {
+public:
+    FlacBitReader(const uint8_t *data, size_t numBytes)
+            : mData(data), mNumBytes(numBytes) {}
+
+    /**
+     * @param numBits from 0 to 32
+     */
+    uint32_t readBits(int numBits) {
+        if (numBits == 0) {
+            return 0;
+        }
+        if (mCacheBits < numBits) {
+            refill();
+        }
+        auto value = static_cast<uint32_t>(mCache >> (64 - numBits));
+        mCache <<= numBits;
+        mCacheBits -= numBits;
+        return value;
+    }
+
+    /**
+     * Read a two's complement value.
+     * @param numBits from 0 to 32
+     */
+    int32_t readSigned(int numBits) {
+        if (numBits == 0) {
+            return 0;
+        }
+        uint32_t value = readBits(numBits);
+        return static_cast<int32_t>(value << (32 - numBits)) >> (32 - numBits);
+    }
+
+    /**
+     * Read a unary coded value, which is the number of 0 bits before the next 1.
+     */
+    uint32_t readUnary() {
+        uint32_t count = 0;
+        while (true) {
+            // The bits below the cached ones are always 0.
+            if (mCache != 0) {
+                int zeros = __builtin_clzll(mCache);
+                count += zeros;
+                mCache <<= zeros + 1;
+                mCacheBits -= zeros + 1;
+                return count;
+            }
+            count += mCacheBits;
+            mCacheBits = 0;
+            if (isOverrun()) {
+                return 0;
+            }
+            refill();
+        }
+    }
+
+    /**
+     * Read a run of Rice coded signed values, as used for the residual.
+     * This is where most of the decoding time goes.
+     */
+    void readRice(int32_t *values, int count, int parameter) {
+        for (int i = 0; i < count; i++) {
+            if (mCacheBits < 32) {
+                refill();
+            }
+            // Most values fit in the cache, so the unary part is one count of leading zeros.
+            int zeros = (mCache != 0) ? __builtin_clzll(mCache) : 64;
+            int length = zeros + 1 + parameter;
+            uint32_t value;
+            if (length <= mCacheBits) {
+                uint64_t rest = mCache << (zeros + 1);
+                value = (static_cast<uint32_t>(zeros) << parameter)
+                        | static_cast<uint32_t>((rest >> 1) >> (63 - parameter));
+                mCache <<= length - 1;
+                mCache <<= 1;
+                mCacheBits -= length;
+            } else {
+                value = (readUnary() << parameter) | readBits(parameter);
+            }
+            values[i] = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+    }
+
+    /**
+     * The number coded in the frame header like UTF-8 characters, of up to 36 bits.
+     * @return -1 if it is not valid
+     */
+    int64_t readUtf8() {
+        uint32_t first = readBits(8);
+        int numExtra;
+        uint64_t value;
+        if ((first & 0x80) == 0) {
+            return first;
+        } else if ((first & 0xE0) == 0xC0) {
+            numExtra = 1;
+            value = first & 0x1F;
+        } else if ((first & 0xF0) == 0xE0) {
+            numExtra = 2;
+            value = first & 0x0F;
+        } else if ((first & 0xF8) == 0xF0) {
+            numExtra = 3;
+            value = first & 0x07;
+        } else if ((first & 0xFC) == 0xF8) {
+            numExtra = 4;
+            value = first & 0x03;
+        } else if ((first & 0xFE) == 0xFC) {
+            numExtra = 5;
+            value = first & 0x01;
+        } else if (first == 0xFE) {
+            numExtra = 6;
+            value = 0;
+        } else {
+            return -1;
+        }
+        for (int i = 0; i < numExtra; i++) {
+            uint32_t next = readBits(8);
+            if ((next & 0xC0) != 0x80) {
+                return -1;
+            }
+            value = (value << 6) | (next & 0x3F);
+        }
+        return static_cast<int64_t>(value);
+    }
+
+    // Skip to the start of the next byte.
+    void alignToByte() {
+        int extra = mCacheBits & 7;
+        mCache <<= extra;
+        mCacheBits -= extra;
+    }
+
+    // Only meaningful at a byte boundary.
+    size_t getBytePosition() const { return mBytePos - mCacheBits / 8; }
+
+    bool isOverrun() const { return mBytePos * 8 - mCacheBits > mNumBytes * 8; }
+
+private:
+    // Fill the cache with whole bytes, leaving at least 57 bits in it.
+    void refill() {
+        if (mBytePos + 8 <= mNumBytes) {
+            const uint8_t *p = mData + mBytePos;
+            uint64_t word = (static_cast<uint64_t>(p[0]) << 56) | (static_cast<uint64_t>(p[1]) << 48)
+                    | (static_cast<uint64_t>(p[2]) << 40) | (static_cast<uint64_t>(p[3]) << 32)
+                    | (static_cast<uint64_t>(p[4]) << 24) | (static_cast<uint64_t>(p[5]) << 16)
+                    | (static_cast<uint64_t>(p[6]) << 8) | static_cast<uint64_t>(p[7]);
+            int numBytes = (63 - mCacheBits) >> 3;
+            word &= ~0ULL << (64 - numBytes * 8);
+            mCache |= word >> mCacheBits;
+            mCacheBits += numBytes * 8;
+            mBytePos += numBytes;
+        } else {
+            // Near the end, past which the bytes read as 0.
+            while (mCacheBits <= 56) {
+                uint64_t byte = (mBytePos < mNumBytes) ? mData[mBytePos] : 0;
+                mCache |= byte << (56 - mCacheBits);
+                mCacheBits += 8;
+                mBytePos++;
+            }
+        }
+    }
+
+    const uint8_t *mData;
+    size_t mNumBytes;
+    size_t mBytePos = 0;
+    uint64_t mCache = 0;
+    int mCacheBits = 0;
+};
+
+} // namespace parselib
+
+#endif // _IO_FLAC_FLACBITREADER_H_
@@ -0,0 +1,777 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <string.h>
+
+#include <android/log.h>
+
+#include "stream/InputStream.h"
+#include "wav/AudioEncoding.h"
+
+#include "FlacBitReader.h"
+#include "FlacStreamReader.h"
+
+// The LPC prediction is a dot product over the previous samples, which is done four at a
+// time where the instruction set has a 32-bit vector multiply.
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FLAC_SIMD_NEON 1
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define FLAC_SIMD_SSE 1
+#endif
+
+static const char *TAG = "FlacStreamReader";
+
+namespace parselib {
+
+static constexpr int kMetadataStreamInfo = 0;
+static constexpr int kMetadataSeekTable = 3;
+static constexpr int kStreamInfoSize = 34;
+static constexpr int kSeekPointSize = 18;
+static constexpr uint64_t kPlaceholderSeekPoint = 0xFFFFFFFFFFFFFFFFull;
+
+static constexpr int kMaxFixedOrder = 4;
+static constexpr int kMaxLpcOrder = 32;
+
+// Channel assignments other than independent channels.
+static constexpr int kLeftSide = 8;
+static constexpr int kSideRight = 9;
+static constexpr int kMidSide = 10;
+
+static constexpr size_t kMinInputBytes = 64 * 1024;
+// A frame that does not fit in this is taken to be corrupt.
+static constexpr size_t kMaxInputBytes = 16 * 1024 * 1024;
+
+static const int kSampleSizes[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+
+struct CrcTables {
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+
+    constexpr CrcTables() : crc8(), crc16() {
+        for (int i = 0; i < 256; i++) {
+            int c8 = i;
+            int c16 = i << 8;
+            for (int bit = 0; bit < 8; bit++) {
+                c8 = (c8 & 0x80) ? ((c8 << 1) ^ 0x07) : (c8 << 1);
+                c16 = (c16 & 0x8000) ? ((c16 << 1) ^ 0x8005) : (c16 << 1);
+            }
+            crc8[i] = static_cast<uint8_t>(c8);
+            crc16[i] = static_cast<uint16_t>(c16);
+        }
+    }
+};
+
+static constexpr CrcTables kCrc;
+
+static uint8_t crc8(const uint8_t *data, size_t numBytes) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < numBytes; i++) {
+        crc = kCrc.crc8[crc ^ data[i]];
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t numBytes) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < numBytes; i++) {
+        crc = static_cast<uint16_t>((crc << 8) ^ kCrc.crc16[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+static bool isFrameSync(const uint8_t *data) {
+    return data[0] == 0xFF && (data[1] & 0xFE) == 0xF8;
+}
+
+static int64_t readBigEndian(const uint8_t *data, int numBytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < numBytes; i++) {
+        value = (value << 8) | data[i];
+    }
+    return static_cast<int64_t>(value);
+}
+
+FlacStreamReader::FlacStreamReader(InputStream *stream) {
+    mStream = stream;
+
+    mSampleRate = 0;
+    mNumChannels = 0;
+    mBitsPerSample = 0;
+    mTotalFrames = 0;
+    mMaxBlockSize = 0;
+    mMaxFrameSize = 0;
+
+    mAudioDataStartPos = -1;
+}
+
+int FlacStreamReader::getEncodingForBits(int bitsPerSample) {
+    // 12 and 20-bit samples are reported as the next size up.
+    if (bitsPerSample <= 0) {
+        return AudioEncoding::INVALID;
+    } else if (bitsPerSample <= 8) {
+        return AudioEncoding::PCM_8;
+    } else if (bitsPerSample <= 16) {
+        return AudioEncoding::PCM_16;
+    } else if (bitsPerSample <= 24) {
+        return AudioEncoding::PCM_24;
+    }
+    return AudioEncoding::INVALID;
+}
+
+int FlacStreamReader::getSampleEncoding() {
+    return getEncodingForBits(mBitsPerSample);
+}
+
+uint32_t FlacStreamReader::getDefaultChannelMask(int numChannels) {
+    // Mono is front center, and 7 channels have a back center.
+    static const uint32_t kChannelMasks[kMaxChannels] = {
+            0x004, 0x003, 0x007, 0x033, 0x037, 0x03F, 0x70F, 0x63F
+    };
+    return (numChannels >= 1 && numChannels <= kMaxChannels)
+            ? kChannelMasks[numChannels - 1] : 0;
+}
+
+uint32_t FlacStreamReader::getChannelMask() {
+    return getDefaultChannelMask(mNumChannels);
+}
+
+int FlacStreamReader::getNativeEncoding() {
+    return mBitsPerSample <= 16 ? AudioEncoding::PCM_16 : AudioEncoding::PCM_IEEEFLOAT;
+}
+
+bool FlacStreamReader::parse() {
+    // Some taggers put an ID3v2 tag in front of the stream.
+    uint8_t id3[10];
+    if (mStream->peek(id3, sizeof(id3)) == sizeof(id3) && memcmp(id3, "ID3", 3) == 0) {
+        int64_t tagSize = ((id3[6] & 0x7F) << 21) | ((id3[7] & 0x7F) << 14)
+                | ((id3[8] & 0x7F) << 7) | (id3[9] & 0x7F);
+        if (id3[5] & 0x10) {
+            tagSize += 10; // footer
+        }
+        mStream->advance(sizeof(id3) + tagSize);
+    }
+
+    uint8_t marker[4];
+    if (mStream->read(marker, sizeof(marker)) != sizeof(marker)
+            || memcmp(marker, "fLaC", sizeof(marker)) != 0) {
+        return false;
+    }
+
+    bool haveStreamInfo = false;
+    bool isLast = false;
+    while (!isLast) {
+        uint8_t header[4];
+        if (mStream->read(header, sizeof(header)) != sizeof(header)) {
+            __android_log_print(ANDROID_LOG_ERROR, TAG, "metadata cut off");
+            return false;
+        }
+        isLast = (header[0] & 0x80) != 0;
+        int type = header[0] & 0x7F;
+        auto length = static_cast<int>(readBigEndian(header + 1, 3));
+        int64_t nextBlockPos = mStream->getPos() + length;
+
+        if (type == kMetadataStreamInfo) {
+            haveStreamInfo = readStreamInfo(length);
+            if (!haveStreamInfo) {
+                return false;
+            }
+        } else if (type == kMetadataSeekTable) {
+            readSeekTable(length);
+        }
+        mStream->advance(nextBlockPos - mStream->getPos());
+    }
+
+    if (!haveStreamInfo) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "no STREAMINFO");
+        return false;
+    }
+
+    // We are now positioned at the first frame.
+    mAudioDataStartPos = mStream->getPos();
+    resetInput();
+    return true;
+}
+
+bool FlacStreamReader::readStreamInfo(int length) {
+    uint8_t info[kStreamInfoSize];
+    if (length < kStreamInfoSize || mStream->read(info, sizeof(info)) != sizeof(info)) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "STREAMINFO too short");
+        return false;
+    }
+    FlacBitReader reader(info, sizeof(info));
+    reader.readBits(16);    // minimum block size
+    mMaxBlockSize = reader.readBits(16);
+    reader.readBits(24);    // minimum frame size
+    mMaxFrameSize = reader.readBits(24);
+    mSampleRate = reader.readBits(20);
+    mNumChannels = reader.readBits(3) + 1;
+    mBitsPerSample = reader.readBits(5) + 1;
+    mTotalFrames = static_cast<int64_t>(reader.readBits(4)) << 32;
+    mTotalFrames |= reader.readBits(32);
+
+    if (mSampleRate == 0 || mMaxBlockSize < 16 || mBitsPerSample < 4
+            || mBitsPerSample > kMaxBitsPerSample || mNumChannels > kMaxChannels) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG,
+                            "unsupported stream, rate:%d channels:%d bits:%d block:%d",
+                            mSampleRate, mNumChannels, mBitsPerSample, mMaxBlockSize);
+        return false;
+    }
+    for (int channel = 0; channel < mNumChannels; channel++) {
+        mBlock.samples[channel].assign(mMaxBlockSize, 0);
+    }
+    return true;
+}
+
+void FlacStreamReader::readSeekTable(int length) {
+    std::vector<uint8_t> table(length - length % kSeekPointSize);
+    auto tableSize = static_cast<int32_t>(table.size());
+    if (mStream->read(table.data(), tableSize) != tableSize) {
+        return;
+    }
+    mSeekTable.clear();
+    for (size_t pos = 0; pos < table.size(); pos += kSeekPointSize) {
+        if (static_cast<uint64_t>(readBigEndian(&table[pos], 8)) == kPlaceholderSeekPoint) {
+            continue;
+        }
+        mSeekTable.push_back({ readBigEndian(&table[pos], 8), readBigEndian(&table[pos + 8], 8) });
+    }
+}
+
+// Data access
+void FlacStreamReader::positionToAudio() {
+    if (mAudioDataStartPos >= 0) {
+        mStream->setPos(mAudioDataStartPos);
+        resetInput();
+    }
+}
+
+void FlacStreamReader::resetInput() {
+    mInput.resize(std::max(kMinInputBytes, static_cast<size_t>(2 * mMaxFrameSize)));
+    mInputStart = 0;
+    mInputEnd = 0;
+    mEndOfStream = false;
+    mBlock.firstFrame = 0;
+    mBlock.numFrames = 0;
+    mBlock.position = 0;
+}
+
+bool FlacStreamReader::fillInput() {
+    if (mEndOfStream) {
+        return false;
+    }
+    if (mInputStart > 0) {
+        memmove(mInput.data(), mInput.data() + mInputStart, mInputEnd - mInputStart);
+        mInputEnd -= mInputStart;
+        mInputStart = 0;
+    } else if (mInputEnd == mInput.size()) {
+        // A frame bigger than the buffer.
+        if (mInput.size() >= kMaxInputBytes) {
+            return false;
+        }
+        mInput.resize(mInput.size() * 2);
+    }
+    auto numBytes = static_cast<int32_t>(
+            std::min<size_t>(mInput.size() - mInputEnd, INT32_MAX));
+    int32_t numRead = mStream->read(mInput.data() + mInputEnd, numBytes);
+    if (numRead <= 0) {
+        mEndOfStream = true;
+        return false;
+    }
+    mInputEnd += numRead;
+    return true;
+}
+
+bool FlacStreamReader::decodeNextFrame() {
+    while (true) {
+        const uint8_t *data = mInput.data() + mInputStart;
+        size_t numBytes = mInputEnd - mInputStart;
+        int frameBytes = decodeFrame(data, numBytes);
+        if (frameBytes > 0) {
+            mInputStart += frameBytes;
+            return true;
+        }
+        if (frameBytes < 0 && fillInput()) {
+            continue; // try again with the rest of the frame
+        }
+
+        // Not a frame, or one that is corrupt or cut off. Look for the next one.
+        size_t next = 1;
+        while (next + 1 < numBytes && !isFrameSync(data + next)) {
+            next++;
+        }
+        if (next + 1 < numBytes) {
+            mInputStart += next;
+        } else {
+            // Keep the last byte, it could be the start of a frame.
+            mInputStart += (numBytes > 0) ? numBytes - 1 : 0;
+            if (!fillInput()) {
+                return false;
+            }
+        }
+    }
+}
+
+int FlacStreamReader::decodeFrame(const uint8_t *data, size_t numBytes) {
+    FlacBitReader reader(data, numBytes);
+
+    // Frame header
+    if (reader.readBits(15) != 0x7FFC) {
+        return reader.isOverrun() ? -1 : 0;
+    }
+    bool variableBlockSize = reader.readBits(1) != 0;
+    int blockSizeCode = reader.readBits(4);
+    int sampleRateCode = reader.readBits(4);
+    int channelAssignment = reader.readBits(4);
+    int sampleSizeCode = reader.readBits(3);
+    reader.readBits(1);
+    int64_t number = reader.readUtf8();
+
+    int blockSize;
+    if (blockSizeCode == 0) {
+        return 0;
+    } else if (blockSizeCode == 1) {
+        blockSize = 192;
+    } else if (blockSizeCode <= 5) {
+        blockSize = 576 << (blockSizeCode - 2);
+    } else if (blockSizeCode == 6) {
+        blockSize = reader.readBits(8) + 1;
+    } else if (blockSizeCode == 7) {
+        blockSize = reader.readBits(16) + 1;
+    } else {
+        blockSize = 256 << (blockSizeCode - 8);
+    }
+
+    // The sample rate in the header is only a hint, STREAMINFO has the real one.
+    if (sampleRateCode == 12) {
+        reader.readBits(8);
+    } else if (sampleRateCode == 13 || sampleRateCode == 14) {
+        reader.readBits(16);
+    } else if (sampleRateCode == 15) {
+        return 0;
+    }
+
+    size_t headerBytes = reader.getBytePosition();
+    uint8_t headerCrc = reader.readBits(8);
+    if (reader.isOverrun()) {
+        return -1;
+    }
+    if (number < 0 || crc8(data, headerBytes) != headerCrc) {
+        return 0;
+    }
+
+    int bitsPerSample = (sampleSizeCode == 0) ? mBitsPerSample : kSampleSizes[sampleSizeCode];
+    int numChannels = (channelAssignment < kLeftSide) ? channelAssignment + 1 : 2;
+    if (bitsPerSample != mBitsPerSample || numChannels != mNumChannels
+            || channelAssignment > kMidSide) {
+        return 0;
+    }
+    if (blockSize > static_cast<int>(mBlock.samples[0].size())) {
+        // Bigger than STREAMINFO said.
+        for (int channel = 0; channel < mNumChannels; channel++) {
+            mBlock.samples[channel].resize(blockSize);
+        }
+    }
+
+    // Subframes. The side channel has one more bit to hold the difference.
+    for (int channel = 0; channel < numChannels; channel++) {
+        bool isSide = (channelAssignment == kLeftSide && channel == 1)
+                || (channelAssignment == kSideRight && channel == 0)
+                || (channelAssignment == kMidSide && channel == 1);
+        if (!decodeSubframe(reader, channel, blockSize, bitsPerSample + (isSide ? 1 : 0))) {
+            return reader.isOverrun() ? -1 : 0;
+        }
+    }
+
+    // Frame footer
+    reader.alignToByte();
+    size_t frameBytes = reader.getBytePosition();
+    uint16_t frameCrc = reader.readBits(16);
+    if (reader.isOverrun()) {
+        return -1;
+    }
+    if (crc16(data, frameBytes) != frameCrc) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "frame %lld failed CRC check",
+                            static_cast<long long>(number));
+        return 0;
+    }
+
+    int32_t *left = mBlock.samples[0].data();
+    int32_t *right = mBlock.samples[1].data();
+    switch (channelAssignment) {
+        case kLeftSide:
+            for (int i = 0; i < blockSize; i++) {
+                right[i] = left[i] - right[i];
+            }
+            break;
+
+        case kSideRight:
+            for (int i = 0; i < blockSize; i++) {
+                left[i] += right[i];
+            }
+            break;
+
+        case kMidSide:
+            for (int i = 0; i < blockSize; i++) {
+                int32_t side = right[i];
+                // The low bit of the mid channel was dropped, it is the same as that of side.
+                int32_t mid = static_cast<int32_t>(static_cast<uint32_t>(left[i]) << 1)
+                        | (side & 1);
+                left[i] = (mid + side) >> 1;
+                right[i] = (mid - side) >> 1;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    mBlock.firstFrame = variableBlockSize ? number : number * mMaxBlockSize;
+    mBlock.numFrames = blockSize;
+    mBlock.position = 0;
+    return static_cast<int>(frameBytes) + 2;
+}
+
+bool FlacStreamReader::decodeSubframe(FlacBitReader &reader, int channel, int blockSize,
+                                      int bitsPerSample) {
+    int32_t *samples = mBlock.samples[channel].data();
+
+    if (reader.readBits(1) != 0) {
+        return false;
+    }
+    int type = reader.readBits(6);
+    // Bits that are 0 in every sample are left out and shifted back in at the end.
+    int wastedBits = 0;
+    if (reader.readBits(1) != 0) {
+        wastedBits = reader.readUnary() + 1;
+        if (wastedBits >= bitsPerSample) {
+            return false;
+        }
+        bitsPerSample -= wastedBits;
+    }
+
+    if (type == 0) {
+        // CONSTANT
+        std::fill(samples, samples + blockSize, reader.readSigned(bitsPerSample));
+    } else if (type == 1) {
+        // VERBATIM
+        for (int i = 0; i < blockSize; i++) {
+            samples[i] = reader.readSigned(bitsPerSample);
+        }
+    } else if (type >= 8 && type <= 8 + kMaxFixedOrder) {
+        // FIXED
+        int order = type - 8;
+        if (order > blockSize) {
+            return false;
+        }
+        for (int i = 0; i < order; i++) {
+            samples[i] = reader.readSigned(bitsPerSample);
+        }
+        if (!decodeResidual(reader, samples, blockSize, order)) {
+            return false;
+        }
+        restoreFixed(samples, blockSize, order);
+    } else if (type >= 32) {
+        // LPC
+        int order = type - 31;
+        if (order > blockSize) {
+            return false;
+        }
+        for (int i = 0; i < order; i++) {
+            samples[i] = reader.readSigned(bitsPerSample);
+        }
+        int precision = reader.readBits(4) + 1;
+        int shift = reader.readSigned(5);
+        if (precision == 16 || shift < 0) {
+            return false;
+        }
+        int32_t coefficients[kMaxLpcOrder];
+        for (int i = 0; i < order; i++) {
+            coefficients[i] = reader.readSigned(precision);
+        }
+        if (!decodeResidual(reader, samples, blockSize, order)) {
+            return false;
+        }
+        // Whether the sum of the products can need more than 32 bits.
+        int orderBits = 31 - __builtin_clz(order);
+        bool wide = bitsPerSample + precision + orderBits > 32;
+        restoreLpc(samples, blockSize, coefficients, order, shift, wide);
+    } else {
+        return false;
+    }
+
+    if (wastedBits > 0) {
+        for (int i = 0; i < blockSize; i++) {
+            samples[i] = static_cast<int32_t>(static_cast<uint32_t>(samples[i]) << wastedBits);
+        }
+    }
+    return true;
+}
+
+bool FlacStreamReader::decodeResidual(FlacBitReader &reader, int32_t *residual, int blockSize,
+                                      int predictorOrder) {
+    int method = reader.readBits(2);
+    if (method > 1) {
+        return false;
+    }
+    int parameterBits = (method == 0) ? 4 : 5;
+    int escapeParameter = (1 << parameterBits) - 1;
+    int partitionOrder = reader.readBits(4);
+    int partitionSize = blockSize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blockSize || partitionSize < predictorOrder) {
+        return false;
+    }
+
+    // The first partition is shorter by the warm up samples.
+    int32_t *out = residual + predictorOrder;
+    int numPartitions = 1 << partitionOrder;
+    for (int partition = 0; partition < numPartitions; partition++) {
+        int count = (partition == 0) ? partitionSize - predictorOrder : partitionSize;
+        int parameter = reader.readBits(parameterBits);
+        if (parameter == escapeParameter) {
+            int numBits = reader.readBits(5);
+            for (int i = 0; i < count; i++) {
+                out[i] = reader.readSigned(numBits);
+            }
+        } else {
+            reader.readRice(out, count, parameter);
+        }
+        out += count;
+        if (reader.isOverrun()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FlacStreamReader::restoreFixed(int32_t *samples, int blockSize, int order) {
+    switch (order) {
+        case 1:
+            for (int i = 1; i < blockSize; i++) {
+                samples[i] += samples[i - 1];
+            }
+            break;
+
+        case 2:
+            for (int i = 2; i < blockSize; i++) {
+                samples[i] += 2 * samples[i - 1] - samples[i - 2];
+            }
+            break;
+
+        case 3:
+            for (int i = 3; i < blockSize; i++) {
+                samples[i] += 3 * (samples[i - 1] - samples[i - 2]) + samples[i - 3];
+            }
+            break;
+
+        case 4:
+            for (int i = 4; i < blockSize; i++) {
+                samples[i] += 4 * (samples[i - 1] + samples[i - 3]) - 6 * samples[i - 2]
+                        - samples[i - 4];
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void FlacStreamReader::restoreLpc(int32_t *samples, int blockSize, const int32_t *coefficients,
+                                  int order, int shift, bool wide) {
+    // Each sample needs the ones just restored, so the samples are done one at a time
+    // and the products within each prediction are done side by side. The coefficients are
+    // reversed and padded at the front to whole vectors, so they line up with the history
+    // in memory order.
+    int i = order;
+#if defined(FLAC_SIMD_NEON) || defined(FLAC_SIMD_SSE)
+    const int paddedOrder = (order + 3) & ~3;
+    alignas(16) int32_t reversed[kMaxLpcOrder] = {};
+    for (int j = 0; j < order; j++) {
+        reversed[paddedOrder - 1 - j] = coefficients[j];
+    }
+
+    // The padding reaches before the first sample until i is paddedOrder.
+    for (; i < std::min(paddedOrder, blockSize); i++) {
+        int64_t sum = 0;
+        for (int j = 0; j < order; j++) {
+            sum += static_cast<int64_t>(coefficients[j]) * samples[i - 1 - j];
+        }
+        samples[i] += static_cast<int32_t>(sum >> shift);
+    }
+#endif
+
+#if defined(FLAC_SIMD_NEON)
+    if (!wide) {
+        for (; i < blockSize; i++) {
+            const int32_t *history = samples + i - paddedOrder;
+            int32x4_t sum = vmulq_s32(vld1q_s32(reversed), vld1q_s32(history));
+            for (int j = 4; j < paddedOrder; j += 4) {
+                sum = vmlaq_s32(sum, vld1q_s32(reversed + j), vld1q_s32(history + j));
+            }
+            samples[i] += vaddvq_s32(sum) >> shift;
+        }
+    } else {
+        for (; i < blockSize; i++) {
+            const int32_t *history = samples + i - paddedOrder;
+            int64x2_t sumLow = vdupq_n_s64(0);
+            int64x2_t sumHigh = vdupq_n_s64(0);
+            for (int j = 0; j < paddedOrder; j += 4) {
+                int32x4_t c = vld1q_s32(reversed + j);
+                int32x4_t h = vld1q_s32(history + j);
+                sumLow = vmlal_s32(sumLow, vget_low_s32(c), vget_low_s32(h));
+                sumHigh = vmlal_high_s32(sumHigh, c, h);
+            }
+            samples[i] += static_cast<int32_t>(vaddvq_s64(vaddq_s64(sumLow, sumHigh)) >> shift);
+        }
+    }
+#elif defined(FLAC_SIMD_SSE)
+    if (!wide) {
+        for (; i < blockSize; i++) {
+            const int32_t *history = samples + i - paddedOrder;
+            __m128i sum = _mm_setzero_si128();
+            for (int j = 0; j < paddedOrder; j += 4) {
+                __m128i c = _mm_load_si128(reinterpret_cast<const __m128i *>(reversed + j));
+                __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(history + j));
+                sum = _mm_add_epi32(sum, _mm_mullo_epi32(c, h));
+            }
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+            samples[i] += _mm_cvtsi128_si32(sum) >> shift;
+        }
+    }
+#endif
+
+    // Scalar, and 64-bit sums on x86.
+    if (!wide) {
+        for (; i < blockSize; i++) {
+            uint32_t sum = 0;
+            for (int j = 0; j < order; j++) {
+                sum += static_cast<uint32_t>(coefficients[j])
+                        * static_cast<uint32_t>(samples[i - 1 - j]);
+            }
+            samples[i] += static_cast<int32_t>(sum) >> shift;
+        }
+    } else {
+        for (; i < blockSize; i++) {
+            int64_t sum = 0;
+            for (int j = 0; j < order; j++) {
+                sum += static_cast<int64_t>(coefficients[j]) * samples[i - 1 - j];
+            }
+            samples[i] += static_cast<int32_t>(sum >> shift);
+        }
+    }
+}
+
+bool FlacStreamReader::seekToFrame(int64_t frame) {
+    if (mAudioDataStartPos < 0 || frame < 0) {
+        return false;
+    }
+    int64_t blockEnd = mBlock.firstFrame + mBlock.numFrames;
+    if (mBlock.numFrames > 0 && frame >= mBlock.firstFrame && frame < blockEnd) {
+        mBlock.position = static_cast<int>(frame - mBlock.firstFrame);
+        return true;
+    }
+
+    // The last seek point at or before the frame.
+    auto point = std::upper_bound(mSeekTable.begin(), mSeekTable.end(), frame,
+            [](int64_t frame, const SeekPoint &point) { return frame < point.frame; });
+    int64_t pointFrame = 0;
+    int64_t pointOffset = 0;
+    if (point != mSeekTable.begin()) {
+        pointFrame = (point - 1)->frame;
+        pointOffset = (point - 1)->offset;
+    }
+
+    // Decoding on from here is quicker if the seek point is behind us anyway.
+    if (mBlock.numFrames == 0 || frame < blockEnd || pointFrame > blockEnd) {
+        mStream->setPos(mAudioDataStartPos + pointOffset);
+        resetInput();
+    }
+    while (decodeNextFrame()) {
+        if (frame < mBlock.firstFrame + mBlock.numFrames) {
+            mBlock.position = static_cast<int>(std::max<int64_t>(0, frame - mBlock.firstFrame));
+            return true;
+        }
+    }
+    mBlock.position = mBlock.numFrames;
+    return false;
+}
+
+template <typename T, typename Convert>
+int FlacStreamReader::readFrames(T *buff, int numFrames, Convert convert) {
+    if (mAudioDataStartPos < 0) {
+        return ERR_INVALID_STATE;
+    }
+
+    const int numChannels = mNumChannels;
+    int numFramesRead = 0;
+    while (numFramesRead < numFrames) {
+        if (mBlock.position == mBlock.numFrames && !decodeNextFrame()) {
+            break;
+        }
+        int count = std::min(numFrames - numFramesRead, mBlock.numFrames - mBlock.position);
+        T *out = buff + numFramesRead * numChannels;
+        if (numChannels == 2) {
+            const int32_t *left = mBlock.samples[0].data() + mBlock.position;
+            const int32_t *right = mBlock.samples[1].data() + mBlock.position;
+            for (int i = 0; i < count; i++) {
+                out[2 * i] = convert(left[i]);
+                out[2 * i + 1] = convert(right[i]);
+            }
+        } else {
+            for (int channel = 0; channel < numChannels; channel++) {
+                const int32_t *in = mBlock.samples[channel].data() + mBlock.position;
+                for (int i = 0; i < count; i++) {
+                    out[i * numChannels + channel] = convert(in[i]);
+                }
+            }
+        }
+        mBlock.position += count;
+        numFramesRead += count;
+    }
+
+    // Zero out any unread frames
+    if (numFramesRead < numFrames) {
+        memset(buff + (numFramesRead * numChannels), 0,
+               (numFrames - numFramesRead) * sizeof(buff[0]) * numChannels);
+    }
+
+    return numFramesRead;
+}
+
+int FlacStreamReader::getDataFloat(float *buff, int numFrames) {
+    const float scale = 1.0f / static_cast<float>(1 << (mBitsPerSample - 1));
+    return readFrames(buff, numFrames, [scale](int32_t sample) {
+        return static_cast<float>(sample) * scale;
+    });
+}
+
+int FlacStreamReader::getData16(int16_t *buff, int numFrames) {
+    // Left justify the samples in 16 bits, dropping the low bits of wider ones.
+    if (mBitsPerSample > 16) {
+        const int shift = mBitsPerSample - 16;
+        return readFrames(buff, numFrames, [shift](int32_t sample) {
+            return static_cast<int16_t>(sample >> shift);
+        });
+    }
+    const int shift = 16 - mBitsPerSample;
+    return readFrames(buff, numFrames, [shift](int32_t sample) {
+        return static_cast<int16_t>(static_cast<uint32_t>(sample) << shift);
+    });
+}
+
+} // namespace parselib
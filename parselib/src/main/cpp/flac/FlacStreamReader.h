@@ -0,0 +1,166 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_FLAC_FLACSTREAMREADER_H_
+#define _IO_FLAC_FLACSTREAMREADER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "decoder/AudioDecoder.h"
+
+/*
+ * FLAC format documentation can be found:
+ * https://xiph.org/flac/format.html
+ * RFC 9639
+ */
+namespace parselib {
+
+class FlacBitReader;
+class InputStream;
+
+/**
+ * Decodes a FLAC stream from an InputStream, with the same interface as WavStreamReader.
+ *
+ * Supports 8 to 24 bits per sample and up to 8 channels. Frames are decoded one at a time
+ * as getDataFloat() needs them, so the whole file never has to be in memory.
+ * seekToFrame() starts from the nearest SEEKTABLE point.
+ */
+class FlacStreamReader : public AudioDecoder {
+public:
+    FlacStreamReader(InputStream *stream);
+
+    virtual int getSampleRate() { return mSampleRate; }
+
+    virtual int64_t getNumSampleFrames() { return mTotalFrames; }
+
+    virtual int getNumChannels() { return mNumChannels; }
+
+    virtual int getSampleEncoding();
+
+    virtual int getBitsPerSample() { return mBitsPerSample; }
+
+    // The channel order FLAC defines for each channel count.
+    virtual uint32_t getChannelMask();
+
+    virtual int getNativeEncoding();
+
+    /**
+     * Read the metadata blocks.
+     * @return false if this is not a FLAC stream that can be decoded
+     */
+    virtual bool parse();
+
+    // Data access
+    virtual void positionToAudio();
+
+    /**
+     * Move so that the next read starts at the specified frame.
+     * @return false if the frame could not be reached
+     */
+    virtual bool seekToFrame(int64_t frame);
+
+    /**
+     * Read interleaved frames, scaled to -1.0 to 1.0.
+     * Any frames past the end of the stream are set to 0.
+     * @return number of frames read
+     */
+    virtual int getDataFloat(float *buff, int numFrames);
+
+    /**
+     * Read interleaved frames, shifted to 16 bits.
+     * Any frames past the end of the stream are set to 0.
+     * @return number of frames read
+     */
+    virtual int getData16(int16_t *buff, int numFrames);
+
+    static constexpr int kMaxChannels = 8;
+    static constexpr int kMaxBitsPerSample = 24;
+
+    // The AudioEncoding that samples of the specified size are reported as.
+    static int getEncodingForBits(int bitsPerSample);
+
+    // The speaker positions FLAC gives the channels, or 0 for more than kMaxChannels.
+    static uint32_t getDefaultChannelMask(int numChannels);
+
+protected:
+    InputStream *mStream;
+
+    // From the STREAMINFO block
+    int mSampleRate;
+    int mNumChannels;
+    int mBitsPerSample;
+    int64_t mTotalFrames;    /** 0 if the encoder did not know it */
+    int mMaxBlockSize;
+    int mMaxFrameSize;      /** bytes, 0 if not known */
+
+    struct SeekPoint {
+        int64_t frame;
+        int64_t offset;     /** from mAudioDataStartPos */
+    };
+    std::vector<SeekPoint> mSeekTable;
+
+    int64_t mAudioDataStartPos;
+
+private:
+    // Where a frame from the stream is decoded, and the part of it not read yet.
+    struct Block {
+        std::vector<int32_t> samples[kMaxChannels];
+        int64_t firstFrame = 0;
+        int numFrames = 0;
+        int position = 0;
+    };
+
+    // Copy decoded frames out of mBlock, converting each sample.
+    template <typename T, typename Convert>
+    int readFrames(T *buff, int numFrames, Convert convert);
+
+    bool readStreamInfo(int length);
+    void readSeekTable(int length);
+
+    /**
+     * Decode the next frame into mBlock.
+     * @return false at the end of the stream
+     */
+    bool decodeNextFrame();
+
+    // @return false if there are no more bytes in the stream
+    bool fillInput();
+    void resetInput();
+
+    /**
+     * @return number of bytes in the frame, 0 if the bytes at the start of the input are
+     * not a frame, or -1 if the input ends before the frame does
+     */
+    int decodeFrame(const uint8_t *data, size_t numBytes);
+    bool decodeSubframe(FlacBitReader &reader, int channel, int blockSize, int bitsPerSample);
+    bool decodeResidual(FlacBitReader &reader, int32_t *residual, int blockSize,
+                        int predictorOrder);
+    void restoreFixed(int32_t *samples, int blockSize, int order);
+    void restoreLpc(int32_t *samples, int blockSize, const int32_t *coefficients, int order,
+                    int shift, bool wide);
+
+    Block mBlock;
+
+    // Bytes read from the stream but not decoded yet.
+    std::vector<uint8_t> mInput;
+    size_t mInputStart = 0;
+    size_t mInputEnd = 0;
+    bool mEndOfStream = false;
+};
+
+} // namespace parselib
+
+#endif // _IO_FLAC_FLACSTREAMREADER_H_
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "AudioDirectoryScanner.h"
+
+namespace parselib {
+
+namespace {
+
+void listFiles(const std::string &directory, bool recursive, std::vector<std::string> &paths) {
+    DIR *dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    while (dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue; // this, the parent and hidden files
+        }
+        std::string path = directory + "/" + entry->d_name;
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN || type == DT_LNK) {
+            // Links to directories are not followed, in case they make a loop.
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0) {
+                continue;
+            }
+            type = S_ISREG(info.st_mode) ? DT_REG
+                    : (S_ISDIR(info.st_mode) && type == DT_UNKNOWN ? DT_DIR : DT_UNKNOWN);
+        }
+        if (type == DT_REG) {
+            paths.push_back(std::move(path));
+        } else if (type == DT_DIR && recursive) {
+            listFiles(path, recursive, paths);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * Decode the UTF-8 sequence that starts at value[i].
+ * @return the length of the sequence, or 0 if it is not valid UTF-8: a stray continuation
+ * byte, a truncated or overlong sequence, a surrogate or a value past U+10FFFF.
+ */
+size_t decodeUtf8(const std::string &value, size_t i, uint32_t *codePoint) {
+    auto c = static_cast<unsigned char>(value[i]);
+    size_t length;
+    uint32_t minimum;
+    if (c >= 0xC2 && c <= 0xDF) {
+        length = 2;
+        minimum = 0x80;
+        *codePoint = c & 0x1F;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        length = 3;
+        minimum = 0x800;
+        *codePoint = c & 0x0F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        length = 4;
+        minimum = 0x10000;
+        *codePoint = c & 0x07;
+    } else {
+        return 0;
+    }
+    if (i + length > value.size()) {
+        return 0;
+    }
+    for (size_t k = 1; k < length; k++) {
+        auto next = static_cast<unsigned char>(value[i + k]);
+        if ((next & 0xC0) != 0x80) {
+            return 0;
+        }
+        *codePoint = (*codePoint << 6) | (next & 0x3F);
+    }
+    if (*codePoint < minimum || *codePoint > 0x10FFFF
+            || (*codePoint >= 0xD800 && *codePoint <= 0xDFFF)) {
+        return 0;
+    }
+    return length;
+}
+
+/**
+ * File names are bytes, but the JSON goes to NewStringUTF(), which only takes modified
+ * UTF-8. Bytes that are not valid UTF-8 are replaced with U+FFFD, and characters past
+ * U+FFFF are escaped as surrogate pairs, so the result is plain ASCII apart from 2 and
+ * 3 byte sequences that are valid in both.
+ */
+void appendJsonString(std::string &json, const std::string &value) {
+    json += '"';
+    for (size_t i = 0; i < value.size(); i++) {
+        auto c = static_cast<unsigned char>(value[i]);
+        char escape[16];
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += static_cast<char>(c);
+        } else if (c < 0x20) {
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            json += escape;
+        } else if (c < 0x80) {
+            json += static_cast<char>(c);
+        } else {
+            uint32_t codePoint = 0;
+            size_t length = decodeUtf8(value, i, &codePoint);
+            if (length == 0) {
+                json += "\\ufffd";
+            } else if (codePoint >= 0x10000) {
+                codePoint -= 0x10000;
+                snprintf(escape, sizeof(escape), "\\u%04x\\u%04x",
+                         0xD800 + (codePoint >> 10), 0xDC00 + (codePoint & 0x3FF));
+                json += escape;
+                i += length - 1;
+            } else {
+                json.append(value, i, length);
+                i += length - 1;
+            }
+        }
+    }
+    json += '"';
+}
+
+} // namespace
+
+std::vector<AudioDirectoryScanner::Entry> AudioDirectoryScanner::scan(
+        const std::string &directory, bool recursive, int numThreads) {
+    std::vector<std::string> paths;
+    listFiles(directory, recursive, paths);
+    std::sort(paths.begin(), paths.end());
+
+    // Each file has its own slot, so the threads share nothing but the next index.
+    std::vector<Entry> entries(paths.size());
+    std::vector<char> found(paths.size(), 0);
+    std::atomic<size_t> nextIndex(0);
+    auto probeFiles = [&]() {
+        size_t index;
+        while ((index = nextIndex.fetch_add(1)) < paths.size()) {
+            if (AudioProbe::probeFile(paths[index].c_str(), &entries[index].info)) {
+                entries[index].path = std::move(paths[index]);
+                found[index] = 1;
+            }
+        }
+    };
+
+    numThreads = std::max(1, std::min<int>(numThreads, static_cast<int>(paths.size())));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < numThreads; i++) {
+        threads.emplace_back(probeFiles);
+    }
+    probeFiles();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    size_t numFound = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (found[i]) {
+            if (numFound != i) {
+                entries[numFound] = std::move(entries[i]);
+            }
+            numFound++;
+        }
+    }
+    entries.resize(numFound);
+    return entries;
+}
+
+std::string AudioDirectoryScanner::toJson(const std::vector<Entry> &entries) {
+    std::string json = "[";
+    char buffer[256];
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry &entry = entries[i];
+        const AudioProbeInfo &info = entry.info;
+        json += i == 0 ? "{\"path\":" : ",{\"path\":";
+        appendJsonString(json, entry.path);
+        snprintf(buffer, sizeof(buffer),
+                 ",\"format\":\"%s\",\"encoding\":%d,\"sampleRate\":%d,\"channels\":%d"
+                 ",\"bitsPerSample\":%d,\"frames\":%" PRId64 ",\"durationMillis\":%" PRId64
+                 ",\"channelMask\":%u,\"cues\":[",
+                 info.format.c_str(), info.encoding, info.sampleRate, info.numChannels,
+                 info.bitsPerSample, info.numFrames, info.getDurationMillis(), info.channelMask);
+        json += buffer;
+        for (size_t cue = 0; cue < info.cuePoints.size(); cue++) {
+            snprintf(buffer, sizeof(buffer), "%s{\"id\":%u,\"frame\":%" PRId64 "}",
+                     cue == 0 ? "" : ",", info.cuePoints[cue].id, info.cuePoints[cue].frame);
+            json += buffer;
+        }
+        json += "],\"loops\":[";
+        for (size_t loop = 0; loop < info.loops.size(); loop++) {
+            const AudioProbeInfo::Loop &l = info.loops[loop];
+            snprintf(buffer, sizeof(buffer),
+                     "%s{\"cueId\":%u,\"type\":%u,\"start\":%" PRId64 ",\"end\":%" PRId64
+                     ",\"playCount\":%u}",
+                     loop == 0 ? "" : ",", l.cueId, l.type, l.startFrame, l.endFrame, l.playCount);
+            json += buffer;
+        }
+        json += "]}";
+    }
+    json += "]";
+    return json;
+}
+
+} // namespace parselib
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_PROBE_AUDIODIRECTORYSCANNER_H_
+#define _IO_PROBE_AUDIODIRECTORYSCANNER_H_
+
+#include <string>
+#include <vector>
+
+#include "AudioProbe.h"
+
+namespace parselib {
+
+/**
+ * Probes every file in a directory with AudioProbe, on several threads at once.
+ */
+class AudioDirectoryScanner {
+public:
+    struct Entry {
+        std::string path;
+        AudioProbeInfo info;
+    };
+
+    static constexpr int kDefaultNumThreads = 4;
+
+    /**
+     * @param recursive whether to go into subdirectories
+     * @param numThreads how many files are probed at once
+     * @return The WAV and FLAC files found, sorted by path. Other files are left out.
+     */
+    static std::vector<Entry> scan(const std::string &directory, bool recursive,
+                                   int numThreads = kDefaultNumThreads);
+
+    /**
+     * @return A JSON array with an object per entry, for the UI.
+     */
+    static std::string toJson(const std::vector<Entry> &entries);
+};
+
+} // namespace parselib
+
+#endif // _IO_PROBE_AUDIODIRECTORYSCANNER_H_
@@ -0,0 +1,357 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "flac/FlacBitReader.h"
+#include "flac/FlacStreamReader.h"
+#include "wav/WavChunkHeader.h"
+#include "wav/WavFmtChunkHeader.h"
+
+#include "AudioProbe.h"
+
+namespace parselib {
+
+namespace {
+
+constexpr int kFlacStreamInfoSize = 34;
+constexpr int kFlacMetadataStreamInfo = 0;
+constexpr int kFlacMetadataCueSheet = 5;
+constexpr int kFlacMetadataInvalid = 127;
+
+// Sizes of the WAV 'cue ' and 'smpl' records, and of the 'smpl' fields before its loops.
+constexpr int kWavCuePointSize = 24;
+constexpr int kWavSampleLoopSize = 24;
+constexpr int kWavSamplerSize = 36;
+
+uint16_t getLittleEndian16(const uint8_t *data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t getLittleEndian32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint64_t getLittleEndian64(const uint8_t *data) {
+    return getLittleEndian32(data) | (static_cast<uint64_t>(getLittleEndian32(data + 4)) << 32);
+}
+
+uint64_t getBigEndian(const uint8_t *data, int numBytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < numBytes; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+bool hasTag(const uint8_t *data, const char *tag) {
+    return memcmp(data, tag, 4) == 0;
+}
+
+/**
+ * The part of the file that was last read. Fields outside it are read with another pread(),
+ * which for most files is never needed.
+ */
+class ProbeWindow {
+public:
+    explicit ProbeWindow(int fd) : mFd(fd) {}
+
+    // All of the data is in the window, so it is never read again.
+    ProbeWindow(const uint8_t *data, size_t numBytes)
+            : mData(data), mNumBytes(numBytes) {}
+
+    /**
+     * @return numBytes of the file from offset, or nullptr if the file ends first.
+     * Only valid until the next call.
+     */
+    const uint8_t *get(int64_t offset, int64_t numBytes) {
+        if (offset < 0 || numBytes < 0) {
+            return nullptr;
+        }
+        if (offset >= mOffset && offset + numBytes <= mOffset + mNumBytes) {
+            return mData + (offset - mOffset);
+        }
+        if (mFd < 0 || numBytes > AudioProbe::kMaxMetadataSize) {
+            return nullptr;
+        }
+        size_t size = std::max<size_t>(numBytes, AudioProbe::kReadSize);
+        if (mBuffer.size() < size) {
+            mBuffer.resize(size);
+        }
+        ssize_t numRead = pread64(mFd, mBuffer.data(), size, offset);
+        mData = mBuffer.data();
+        mOffset = offset;
+        mNumBytes = std::max<ssize_t>(numRead, 0);
+        return numBytes <= mNumBytes ? mData : nullptr;
+    }
+
+private:
+    int mFd = -1;
+    std::vector<uint8_t> mBuffer;
+    const uint8_t *mData = nullptr;
+    int64_t mOffset = 0;
+    int64_t mNumBytes = 0;
+};
+
+void readWavCuePoints(const uint8_t *chunk, int64_t size, AudioProbeInfo *info) {
+    int64_t numPoints = std::min<int64_t>(getLittleEndian32(chunk), (size - 4) / kWavCuePointSize);
+    for (int64_t i = 0; i < numPoints; i++) {
+        const uint8_t *point = chunk + 4 + i * kWavCuePointSize;
+        // The position in the 'data' chunk is the last field.
+        info->cuePoints.push_back({ getLittleEndian32(point), getLittleEndian32(point + 20) });
+    }
+}
+
+void readWavLoops(const uint8_t *chunk, int64_t size, AudioProbeInfo *info) {
+    int64_t numLoops = std::min<int64_t>(getLittleEndian32(chunk + 28),
+                                         (size - kWavSamplerSize) / kWavSampleLoopSize);
+    for (int64_t i = 0; i < numLoops; i++) {
+        const uint8_t *loop = chunk + kWavSamplerSize + i * kWavSampleLoopSize;
+        info->loops.push_back({ getLittleEndian32(loop), getLittleEndian32(loop + 4),
+                                getLittleEndian32(loop + 8), getLittleEndian32(loop + 12),
+                                getLittleEndian32(loop + 20) });
+    }
+}
+
+bool probeWav(ProbeWindow &window, AudioProbeInfo *info) {
+    const uint8_t *header = window.get(0, 12);
+    if (header == nullptr || !hasTag(header + 8, "WAVE")) {
+        return false;
+    }
+    bool isRf64 = hasTag(header, "RF64") || hasTag(header, "BW64");
+    if (!isRf64 && !hasTag(header, "RIFF")) {
+        return false;
+    }
+
+    // A file whose sizes were never filled in has to be walked until the audio.
+    uint32_t riffSize = getLittleEndian32(header + 4);
+    bool sizesKnown = riffSize != 0 && riffSize != WavChunkHeader::kSizeInDs64;
+    int64_t endPos = sizesKnown ? 8 + static_cast<int64_t>(riffSize) : INT64_MAX;
+
+    WavFmtChunkHeader fmt;
+    bool haveFmt = false;
+    int64_t dataSize = -1;
+    int64_t ds64DataSize = -1;
+    int64_t chunkPos = 12;
+    while (chunkPos + 8 <= endPos) {
+        const uint8_t *chunk = window.get(chunkPos, 8);
+        if (chunk == nullptr) {
+            break; // done
+        }
+        int64_t size = getLittleEndian32(chunk + 4);
+        const uint8_t *body;
+
+        if (hasTag(chunk, "ds64")) {
+            if (isRf64 && (body = window.get(chunkPos + 8, 16)) != nullptr) {
+                if (riffSize == WavChunkHeader::kSizeInDs64) {
+                    sizesKnown = true;
+                    uint64_t ds64RiffSize = getLittleEndian64(body);
+                    endPos = ds64RiffSize < static_cast<uint64_t>(INT64_MAX - 8)
+                            ? 8 + static_cast<int64_t>(ds64RiffSize) : INT64_MAX;
+                }
+                ds64DataSize = static_cast<int64_t>(getLittleEndian64(body + 8));
+            }
+        } else if (hasTag(chunk, "fmt ")) {
+            if (size < 16 || (body = window.get(chunkPos + 8, std::min<int64_t>(size, 40))) == nullptr) {
+                return false;
+            }
+            fmt.mEncodingId = getLittleEndian16(body);
+            fmt.mNumChannels = getLittleEndian16(body + 2);
+            fmt.mSampleRate = getLittleEndian32(body + 4);
+            fmt.mBlockAlign = getLittleEndian16(body + 12);
+            fmt.mSampleSize = getLittleEndian16(body + 14);
+            fmt.mExtraBytes = size >= 18 ? getLittleEndian16(body + 16) : 0;
+            if (fmt.mEncodingId == WavFmtChunkHeader::ENCODING_EXTENSIBLE
+                    && fmt.mExtraBytes >= WavFmtChunkHeader::kExtensibleSize
+                    && size >= 18 + WavFmtChunkHeader::kExtensibleSize) {
+                fmt.mValidBitsPerSample = getLittleEndian16(body + 18);
+                fmt.mChannelMask = getLittleEndian32(body + 20);
+                memcpy(fmt.mSubFormat, body + 24, sizeof(fmt.mSubFormat));
+            } else {
+                fmt.mExtraBytes = 0;
+            }
+            haveFmt = true;
+        } else if (hasTag(chunk, "data")) {
+            if (size == WavChunkHeader::kSizeInDs64 && ds64DataSize >= 0) {
+                size = ds64DataSize;
+            }
+            dataSize = size;
+            if (!sizesKnown) {
+                // Nothing after the audio can be found.
+                break;
+            }
+        } else if (hasTag(chunk, "cue ")) {
+            if (size >= 4 && (body = window.get(chunkPos + 8, size)) != nullptr) {
+                readWavCuePoints(body, size, info);
+            }
+        } else if (hasTag(chunk, "smpl")) {
+            if (size >= kWavSamplerSize && (body = window.get(chunkPos + 8, size)) != nullptr) {
+                readWavLoops(body, size, info);
+            }
+        }
+        if (size > INT64_MAX - 9 - chunkPos) {
+            break; // the end of the chunk does not fit in a position
+        }
+        chunkPos += 8 + size + (size & 1);
+    }
+
+    int bytesPerFrame = fmt.mNumChannels * (fmt.mSampleSize / 8);
+    if (!haveFmt || dataSize < 0 || bytesPerFrame <= 0) {
+        return false;
+    }
+    info->format = "wav";
+    info->encoding = fmt.getSampleEncoding();
+    info->sampleRate = fmt.mSampleRate;
+    info->numChannels = fmt.mNumChannels;
+    info->bitsPerSample = fmt.mSampleSize;
+    info->numFrames = dataSize / bytesPerFrame;
+    info->channelMask = fmt.mChannelMask;
+    return true;
+}
+
+void readFlacCueSheet(const uint8_t *block, int64_t length, AudioProbeInfo *info) {
+    // Catalog number, lead-in, flags and reserved bytes come before the tracks.
+    static constexpr int kTracksPos = 396;
+    static constexpr int kTrackSize = 36;
+    static constexpr int kIndexSize = 12;
+    if (length < kTracksPos) {
+        return;
+    }
+    int numTracks = block[kTracksPos - 1];
+    int64_t pos = kTracksPos;
+    for (int track = 0; track < numTracks && pos + kTrackSize <= length; track++) {
+        const uint8_t *header = block + pos;
+        int64_t offset = static_cast<int64_t>(getBigEndian(header, 8));
+        int number = header[8];
+        int numIndices = header[35];
+        pos += kTrackSize;
+
+        // The track starts at index 1, index 0 being the pregap.
+        int64_t startFrame = offset;
+        for (int index = 0; index < numIndices && pos + kIndexSize <= length; index++) {
+            if (block[pos + 8] == 1) {
+                startFrame = offset + static_cast<int64_t>(getBigEndian(block + pos, 8));
+            }
+            pos += kIndexSize;
+        }
+        // 170 (CD) or 255 is the lead-out, which is the end rather than a cue.
+        if (number != 170 && number != 255) {
+            info->cuePoints.push_back({ static_cast<uint32_t>(number), startFrame });
+        }
+    }
+}
+
+bool probeFlac(ProbeWindow &window, AudioProbeInfo *info) {
+    // Some taggers put an ID3v2 tag in front of the stream.
+    int64_t pos = 0;
+    const uint8_t *id3 = window.get(0, 10);
+    if (id3 != nullptr && memcmp(id3, "ID3", 3) == 0) {
+        int64_t tagSize = ((id3[6] & 0x7F) << 21) | ((id3[7] & 0x7F) << 14)
+                | ((id3[8] & 0x7F) << 7) | (id3[9] & 0x7F);
+        if (id3[5] & 0x10) {
+            tagSize += 10; // footer
+        }
+        pos = 10 + tagSize;
+    }
+    const uint8_t *marker = window.get(pos, 4);
+    if (marker == nullptr || !hasTag(marker, "fLaC")) {
+        return false;
+    }
+    pos += 4;
+
+    bool haveStreamInfo = false;
+    bool isLast = false;
+    while (!isLast) {
+        const uint8_t *header = window.get(pos, 4);
+        if (header == nullptr) {
+            break;
+        }
+        isLast = (header[0] & 0x80) != 0;
+        int type = header[0] & 0x7F;
+        auto length = static_cast<int64_t>(getBigEndian(header + 1, 3));
+        const uint8_t *block;
+
+        if (type == kFlacMetadataStreamInfo) {
+            if (length < kFlacStreamInfoSize
+                    || (block = window.get(pos + 4, kFlacStreamInfoSize)) == nullptr) {
+                return false;
+            }
+            FlacBitReader reader(block, kFlacStreamInfoSize);
+            reader.readBits(16);    // minimum block size
+            reader.readBits(16);    // maximum block size
+            reader.readBits(24);    // minimum frame size
+            reader.readBits(24);    // maximum frame size
+            info->sampleRate = reader.readBits(20);
+            info->numChannels = reader.readBits(3) + 1;
+            info->bitsPerSample = reader.readBits(5) + 1;
+            info->numFrames = static_cast<int64_t>(reader.readBits(4)) << 32;
+            info->numFrames |= reader.readBits(32);
+            haveStreamInfo = true;
+        } else if (type == kFlacMetadataCueSheet) {
+            if ((block = window.get(pos + 4, length)) != nullptr) {
+                readFlacCueSheet(block, length, info);
+            }
+        } else if (type == kFlacMetadataInvalid) {
+            break;
+        }
+        pos += 4 + length;
+    }
+
+    if (!haveStreamInfo || info->sampleRate == 0
+            || info->bitsPerSample > FlacStreamReader::kMaxBitsPerSample) {
+        return false;
+    }
+    info->format = "flac";
+    info->encoding = FlacStreamReader::getEncodingForBits(info->bitsPerSample);
+    info->channelMask = FlacStreamReader::getDefaultChannelMask(info->numChannels);
+    return true;
+}
+
+bool probe(ProbeWindow &window, AudioProbeInfo *info) {
+    *info = AudioProbeInfo();
+    if (probeWav(window, info)) {
+        return true;
+    }
+    *info = AudioProbeInfo();
+    return probeFlac(window, info);
+}
+
+} // namespace
+
+bool AudioProbe::probeFile(int fd, AudioProbeInfo *info) {
+    ProbeWindow window(fd);
+    return probe(window, info);
+}
+
+bool AudioProbe::probeFile(const char *path, AudioProbeInfo *info) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool result = probeFile(fd, info);
+    close(fd);
+    return result;
+}
+
+bool AudioProbe::probeMemory(const void *data, size_t numBytes, AudioProbeInfo *info) {
+    ProbeWindow window(static_cast<const uint8_t *>(data), numBytes);
+    return probe(window, info);
+}
+
+} // namespace parselib
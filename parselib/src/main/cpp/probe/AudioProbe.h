@@ -0,0 +1,92 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_PROBE_AUDIOPROBE_H_
+#define _IO_PROBE_AUDIOPROBE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace parselib {
+
+/**
+ * What AudioProbe found out about a file without decoding any of its audio.
+ */
+struct AudioProbeInfo {
+    // A cue point, from a WAV 'cue ' chunk or a FLAC CUESHEET track.
+    struct CuePoint {
+        uint32_t id;        /** the cue ID, or the track number for FLAC */
+        int64_t frame;
+    };
+
+    // A sample loop, from a WAV 'smpl' chunk.
+    struct Loop {
+        uint32_t cueId;
+        uint32_t type;      /** 0 forward, 1 alternating, 2 backward */
+        int64_t startFrame;
+        int64_t endFrame;   /** the last frame played, not the one after it */
+        uint32_t playCount; /** 0 for an endless loop */
+    };
+
+    std::string format;     /** as registered in AudioDecoderRegistry, "wav" or "flac" */
+    int encoding = -1;      /** AudioEncoding */
+    int sampleRate = 0;
+    int numChannels = 0;
+    int bitsPerSample = 0;
+    int64_t numFrames = 0;  /** 0 if the file does not say */
+    uint32_t channelMask = 0;
+    std::vector<CuePoint> cuePoints;
+    std::vector<Loop> loops;
+
+    int64_t getDurationMillis() const {
+        return sampleRate > 0 ? numFrames * 1000 / sampleRate : 0;
+    }
+};
+
+/**
+ * Reads the format, length, cue points and loops of a WAV or FLAC file from its headers.
+ *
+ * Unlike parsing with an AudioDecoder, nothing goes through InputStream. The start of the
+ * file is read with a single pread() and the chunks or metadata blocks are walked in
+ * that buffer. Another read is only needed for metadata that is further on, such as a
+ * 'cue ' chunk after the audio, so a library of thousands of files can be probed quickly.
+ */
+class AudioProbe {
+public:
+    // Bytes read from the file at a time.
+    static constexpr int32_t kReadSize = 4096;
+
+    // Metadata bigger than this is skipped.
+    static constexpr int32_t kMaxMetadataSize = 1 << 20;
+
+    /**
+     * Probe an open file, from its start. The file position is not changed.
+     * @return false if it is not a WAV or FLAC file that can be read
+     */
+    static bool probeFile(int fd, AudioProbeInfo *info);
+
+    static bool probeFile(const char *path, AudioProbeInfo *info);
+
+    /**
+     * Probe a file that is already in memory, for example an asset.
+     */
+    static bool probeMemory(const void *data, size_t numBytes, AudioProbeInfo *info);
+};
+
+} // namespace parselib
+
+#endif // _IO_PROBE_AUDIOPROBE_H_
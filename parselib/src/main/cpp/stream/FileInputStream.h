@@ -33,11 +33,11 @@ public:
 
     virtual int32_t peek(void *buff, int32_t numBytes);
 
-    virtual void advance(int32_t numBytes);
+    virtual void advance(int64_t numBytes);
 
-    virtual int32_t getPos();
+    virtual int64_t getPos();
 
-    virtual void setPos(int32_t pos);
+    virtual void setPos(int64_t pos);
 
 private:
     /** File handle of the data file to read from */
@@ -22,6 +22,7 @@ namespace parselib {
 
 /**
  * An interface declaration for a stream of bytes. Concrete implements for File and Memory Buffers
+ * Positions are 64-bit so that files over 2 GB, such as RF64 recordings, can be read.
  */
 class InputStream {
 public:
@@ -45,17 +46,24 @@ public:
     /**
      * Moves the read position forward the (positive) number of bytes specified.
      */
-    virtual void advance(int32_t numBytes) = 0;
+    virtual void advance(int64_t numBytes) = 0;
 
     /**
      * Returns the read position of the stream
      */
-    virtual int32_t getPos() = 0;
+    virtual int64_t getPos() = 0;
 
     /**
      * Sets the read position of the stream to the 0 or positive position.
      */
-    virtual void setPos(int32_t pos) = 0;
+    virtual void setPos(int64_t pos) = 0;
+
+    /**
+     * Lets a parser read the stream straight from memory, when all of it is in memory.
+     * Returns: The start of the stream, or nullptr if it is not one block of memory.
+     * numBytes is set to the length of the stream.
+     */
+    virtual const uint8_t *getView(int64_t * /*numBytes*/) { return nullptr; }
 };
 
 } // namespace parselib
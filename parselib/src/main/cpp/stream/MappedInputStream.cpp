@@ -0,0 +1,56 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <android/log.h>
+
+#include "MappedInputStream.h"
+
+static const char *TAG = "MappedInputStream";
+
+namespace parselib {
+
+MappedInputStream::MappedInputStream(int fd, int64_t offset, int64_t length)
+        : MemInputStream(nullptr, 0), mMapping(nullptr), mMappingSize(0) {
+    if (fd < 0 || offset < 0 || length <= 0) {
+        return;
+    }
+    // The mapping has to start on a page.
+    int64_t pageSize = sysconf(_SC_PAGESIZE);
+    int64_t mappingOffset = offset - (offset % pageSize);
+    size_t mappingSize = static_cast<size_t>(length + (offset - mappingOffset));
+    void *mapping = mmap64(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, mappingOffset);
+    if (mapping == MAP_FAILED) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "mmap of %lld bytes failed",
+                            (long long) length);
+        return;
+    }
+    // The data is normally decoded from start to end.
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+    mMapping = mapping;
+    mMappingSize = mappingSize;
+    setBuffer(static_cast<unsigned char *>(mapping) + (offset - mappingOffset), length);
+}
+
+MappedInputStream::~MappedInputStream() {
+    if (mMapping != nullptr) {
+        munmap(mMapping, mMappingSize);
+    }
+}
+
+} // namespace parselib
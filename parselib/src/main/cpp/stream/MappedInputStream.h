@@ -0,0 +1,53 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_STREAM_MAPPEDINPUTSTREAM_H_
+#define _IO_STREAM_MAPPEDINPUTSTREAM_H_
+
+#include <cstddef>
+
+#include "MemInputStream.h"
+
+namespace parselib {
+
+/**
+ * A MemInputStream over part of a file that is mapped into memory, for example an
+ * uncompressed asset in the APK as given by an AssetFileDescriptor.
+ * Nothing is copied. Pages are read from the file as they are used, and they are page
+ * cache rather than memory of the app, so they cost nothing once the stream is deleted.
+ */
+class MappedInputStream : public MemInputStream {
+public:
+    /**
+     * The caller still owns the file, which may be closed as soon as this returns.
+     * @param offset of the data in the file, need not be a multiple of the page size
+     * @param length of the data in bytes
+     */
+    MappedInputStream(int fd, int64_t offset, int64_t length);
+    virtual ~MappedInputStream();
+
+    /**
+     * Returns: false if the file could not be mapped, in which case the stream is empty.
+     */
+    bool isValid() const { return mMapping != nullptr; }
+
+private:
+    void *mMapping;
+    size_t mMappingSize;
+};
+
+} // namespace parselib
+
+#endif // _IO_STREAM_MAPPEDINPUTSTREAM_H_
@@ -21,8 +21,8 @@
 namespace parselib {
 
 int32_t MemInputStream::read(void *buff, int32_t numBytes) {
-    int32_t numAvail = mBufferLen - mPos;
-    numBytes = std::min(numBytes, numAvail);
+    int64_t numAvail = mBufferLen - mPos;
+    numBytes = static_cast<int32_t>(std::min<int64_t>(numBytes, numAvail));
 
     peek(buff, numBytes);
     mPos += numBytes;
@@ -30,25 +30,25 @@ int32_t MemInputStream::read(void *buff, int32_t numBytes) {
 }
 
 int32_t MemInputStream::peek(void *buff, int32_t numBytes) {
-    int32_t numAvail = mBufferLen - mPos;
-    numBytes = std::min(numBytes, numAvail);
+    int64_t numAvail = mBufferLen - mPos;
+    numBytes = static_cast<int32_t>(std::min<int64_t>(numBytes, numAvail));
     memcpy(buff, mBuffer + mPos, numBytes);
     return numBytes;
 }
 
-void MemInputStream::advance(int32_t numBytes) {
+void MemInputStream::advance(int64_t numBytes) {
     if (numBytes > 0) {
-        int32_t numAvail = mBufferLen - mPos;
+        int64_t numAvail = mBufferLen - mPos;
         mPos += std::min(numAvail, numBytes);
     }
 }
 
-int32_t MemInputStream::getPos() {
+int64_t MemInputStream::getPos() {
     return mPos;
 }
 
-void MemInputStream::setPos(int32_t pos) {
-    if (pos > 0) {
+void MemInputStream::setPos(int64_t pos) {
+    if (pos >= 0) {
         if (pos < mBufferLen) {
             mPos = pos;
         } else {
@@ -57,4 +57,9 @@ void MemInputStream::setPos(int32_t pos) {
     }
 }
 
+const uint8_t *MemInputStream::getView(int64_t *numBytes) {
+    *numBytes = mBufferLen;
+    return mBuffer;
+}
+
 } // namespace parselib
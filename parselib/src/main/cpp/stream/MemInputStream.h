@@ -26,28 +26,38 @@ namespace parselib {
 class MemInputStream : public InputStream {
 public:
     /** constructor. Caller is presumed to have allocated and filled the memory buffer */
-    MemInputStream(unsigned char *buff, int32_t len) : mBuffer(buff), mBufferLen(len), mPos(0) {}
+    MemInputStream(unsigned char *buff, int64_t len) : mBuffer(buff), mBufferLen(len), mPos(0) {}
     virtual ~MemInputStream() {}
 
     virtual int32_t read(void *buff, int32_t numBytes);
 
     virtual int32_t peek(void *buff, int32_t numBytes);
 
-    virtual void advance(int32_t numBytes);
+    virtual void advance(int64_t numBytes);
 
-    virtual int32_t getPos();
+    virtual int64_t getPos();
 
-    virtual void setPos(int32_t pos);
+    virtual void setPos(int64_t pos);
+
+    virtual const uint8_t *getView(int64_t *numBytes);
+
+protected:
+    /** For a subclass that only has the buffer after it is constructed */
+    void setBuffer(unsigned char *buff, int64_t len) {
+        mBuffer = buff;
+        mBufferLen = len;
+        mPos = 0;
+    }
 
 private:
     /** Points to the data buffer to stream from. */
     unsigned char *mBuffer;
 
     /** Total number of bytes in the memory buffer */
-    int32_t mBufferLen;
+    int64_t mBufferLen;
 
     /** The index of the next byte to read */
-    int32_t mPos;
+    int64_t mPos;
 };
 
 } // namespace parselib
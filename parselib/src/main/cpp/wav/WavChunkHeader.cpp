@@ -13,6 +13,9 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <string.h>
+
 #include "stream/InputStream.h"
 
 #include "WavChunkHeader.h"
@@ -23,7 +26,19 @@ const RiffID WavChunkHeader::RIFFID_DATA = makeRiffID('d', 'a', 't', 'a');
 
 void WavChunkHeader::read(InputStream *stream) {
     stream->read(&mChunkId, sizeof(mChunkId));
-    stream->read(&mChunkSize, sizeof(mChunkSize));
+    RiffUInt32 chunkSize = 0;
+    stream->read(&chunkSize, sizeof(chunkSize));
+    mChunkSize = chunkSize;
+}
+
+void WavChunkHeader::read(const uint8_t *data, int64_t numBytes) {
+    struct __attribute__((packed)) {
+        RiffID chunkId;
+        RiffUInt32 chunkSize;
+    } layout = {};
+    memcpy(&layout, data, std::min<int64_t>(numBytes, sizeof(layout)));
+    mChunkId = layout.chunkId;
+    mChunkSize = layout.chunkSize;
 }
 
 } // namespace parselib
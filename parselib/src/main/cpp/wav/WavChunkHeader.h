@@ -30,8 +30,12 @@ class WavChunkHeader {
 public:
     static const RiffID RIFFID_DATA;
 
+    // The 32-bit size of a chunk in an RF64 file whose real size is in the 'ds64' chunk.
+    static const RiffUInt32 kSizeInDs64 = 0xFFFFFFFF;
+
     RiffID mChunkId;
-    RiffInt32 mChunkSize;
+    // Read as an unsigned 32-bit value, 64 bits so it can be replaced from the 'ds64' chunk.
+    RiffInt64 mChunkSize;
 
     WavChunkHeader() : mChunkId(0), mChunkSize(0) {}
 
@@ -43,6 +47,15 @@ public:
      * as the first step. It may then read the fields specific to that chunk type.
      */
     virtual void read(InputStream *stream);
+
+    /**
+     * Reads the chunk straight from memory, which starts with the ID and size fields.
+     * Fields past numBytes, the end of the memory, are left as 0.
+     * Subclasses that override this MUST also call the super method first.
+     */
+    virtual void read(const uint8_t *data, int64_t numBytes);
+
+    virtual ~WavChunkHeader() {}
 };
 
 } // namespace parselib
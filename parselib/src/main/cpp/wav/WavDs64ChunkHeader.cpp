@@ -0,0 +1,102 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <string.h>
+
+#include "stream/InputStream.h"
+
+#include "WavDs64ChunkHeader.h"
+
+namespace parselib {
+
+const RiffID WavDs64ChunkHeader::RIFFID_DS64 = makeRiffID('d', 's', '6', '4');
+
+WavDs64ChunkHeader::WavDs64ChunkHeader() : WavChunkHeader(RIFFID_DS64) {
+    mRiffSize = 0;
+    mDataSize = 0;
+    mSampleCount = 0;
+}
+
+WavDs64ChunkHeader::WavDs64ChunkHeader(RiffID tag) : WavChunkHeader(tag) {
+    mRiffSize = 0;
+    mDataSize = 0;
+    mSampleCount = 0;
+}
+
+void WavDs64ChunkHeader::read(InputStream *stream) {
+    WavChunkHeader::read(stream);
+    stream->read(&mRiffSize, sizeof(mRiffSize));
+    stream->read(&mDataSize, sizeof(mDataSize));
+    stream->read(&mSampleCount, sizeof(mSampleCount));
+
+    RiffUInt32 tableLength = 0;
+    stream->read(&tableLength, sizeof(tableLength));
+    // Only read the entries that fit in the chunk.
+    RiffInt64 maxEntries = (mChunkSize - kFixedSize) / (sizeof(RiffID) + sizeof(RiffInt64));
+    for (RiffInt64 entry = 0; entry < tableLength && entry < maxEntries; entry++) {
+        RiffID chunkId = 0;
+        RiffInt64 chunkSize = 0;
+        stream->read(&chunkId, sizeof(chunkId));
+        stream->read(&chunkSize, sizeof(chunkSize));
+        mTable[chunkId] = chunkSize;
+    }
+}
+
+void WavDs64ChunkHeader::read(const uint8_t *data, int64_t numBytes) {
+    struct __attribute__((packed)) Layout {
+        RiffID chunkId;
+        RiffUInt32 chunkSize;
+        RiffInt64 riffSize;
+        RiffInt64 dataSize;
+        RiffInt64 sampleCount;
+        RiffUInt32 tableLength;
+    };
+    struct __attribute__((packed)) TableEntry {
+        RiffID chunkId;
+        RiffInt64 chunkSize;
+    };
+    static_assert(sizeof(Layout) == 8 + kFixedSize, "ds64 layout");
+
+    WavChunkHeader::read(data, numBytes);
+    Layout layout = {};
+    numBytes = std::min<int64_t>(numBytes, 8 + mChunkSize);
+    memcpy(&layout, data, std::min<int64_t>(numBytes, sizeof(layout)));
+    mRiffSize = layout.riffSize;
+    mDataSize = layout.dataSize;
+    mSampleCount = layout.sampleCount;
+
+    // Only read the entries that fit in the chunk.
+    mTable.clear();
+    RiffInt64 maxEntries = (numBytes - static_cast<int64_t>(sizeof(layout))) / sizeof(TableEntry);
+    for (RiffInt64 index = 0; index < layout.tableLength && index < maxEntries; index++) {
+        TableEntry entry;
+        memcpy(&entry, data + sizeof(layout) + index * sizeof(TableEntry), sizeof(entry));
+        mTable[entry.chunkId] = entry.chunkSize;
+    }
+}
+
+RiffInt64 WavDs64ChunkHeader::getChunkSize(RiffID chunkId, RiffInt64 chunkSize) const {
+    if (chunkSize != kSizeInDs64) {
+        return chunkSize;
+    }
+    if (chunkId == RIFFID_DATA) {
+        return mDataSize;
+    }
+    auto entry = mTable.find(chunkId);
+    return entry != mTable.end() ? entry->second : chunkSize;
+}
+
+} // namespace parselib
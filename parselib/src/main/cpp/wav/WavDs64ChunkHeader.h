@@ -0,0 +1,61 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_WAV_WAVDS64CHUNKHEADER_H_
+#define _IO_WAV_WAVDS64CHUNKHEADER_H_
+
+#include <map>
+
+#include "WavChunkHeader.h"
+
+namespace parselib {
+
+class InputStream;
+
+/**
+ * Encapsulates the 'ds64' chunk of an RF64 or BW64 file (EBU Tech 3306 and ITU-R BS.2088).
+ * It holds the 64-bit sizes of the RIFF and 'data' chunks, and of any other chunk, whose
+ * 32-bit size fields are then set to kSizeInDs64.
+ */
+class WavDs64ChunkHeader : public WavChunkHeader {
+public:
+    static const RiffID RIFFID_DS64;
+
+    // Size of the fields below, not counting the table.
+    static const int kFixedSize = 28;
+
+    RiffInt64 mRiffSize;
+    RiffInt64 mDataSize;
+    RiffInt64 mSampleCount;
+    // Sizes of chunks other than 'data' that are too big for 32 bits.
+    std::map<RiffID, RiffInt64> mTable;
+
+    WavDs64ChunkHeader();
+
+    WavDs64ChunkHeader(RiffID tag);
+
+    void read(InputStream *stream);
+
+    void read(const uint8_t *data, int64_t numBytes);
+
+    /**
+     * @return the 64-bit size of a chunk whose 32-bit size is kSizeInDs64
+     */
+    RiffInt64 getChunkSize(RiffID chunkId, RiffInt64 chunkSize) const;
+};
+
+} // namespace parselib
+
+#endif // _IO_WAV_WAVDS64CHUNKHEADER_H_
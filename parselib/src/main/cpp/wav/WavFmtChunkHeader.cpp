@@ -13,10 +13,14 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <string.h>
+
 #include <android/log.h>
 
 #include "stream/InputStream.h"
 
+#include "AudioEncoding.h"
 #include "WavFmtChunkHeader.h"
 
 static const char *TAG = "WavFmtChunkHeader";
@@ -25,6 +29,12 @@ namespace parselib {
 
 const RiffID WavFmtChunkHeader::RIFFID_FMT = makeRiffID('f', 'm', 't', ' ');
 
+// The subformat GUIDs of the standard encodings are this with the encoding ID in front,
+// for example KSDATAFORMAT_SUBTYPE_PCM is 00000001-0000-0010-8000-00aa00389b71.
+static const unsigned char kSubFormatGuidTail[14] = {
+        0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
 WavFmtChunkHeader::WavFmtChunkHeader() : WavChunkHeader(RIFFID_FMT) {
     mEncodingId = ENCODING_PCM;
     mNumChannels = 0;
@@ -33,6 +43,9 @@ WavFmtChunkHeader::WavFmtChunkHeader() : WavChunkHeader(RIFFID_FMT) {
     mBlockAlign = 0;
     mSampleSize = 0;
     mExtraBytes = 0;
+    mValidBitsPerSample = 0;
+    mChannelMask = 0;
+    memset(mSubFormat, 0, sizeof(mSubFormat));
 }
 
 WavFmtChunkHeader::WavFmtChunkHeader(RiffID tag) : WavChunkHeader(tag) {
@@ -43,6 +56,9 @@ WavFmtChunkHeader::WavFmtChunkHeader(RiffID tag) : WavChunkHeader(tag) {
     mBlockAlign = 0;
     mSampleSize = 0;
     mExtraBytes = 0;
+    mValidBitsPerSample = 0;
+    mChannelMask = 0;
+    memset(mSubFormat, 0, sizeof(mSubFormat));
 }
 
 void WavFmtChunkHeader::normalize() {
@@ -55,6 +71,44 @@ void WavFmtChunkHeader::normalize() {
     }
 }
 
+short WavFmtChunkHeader::getFormatCode() const {
+    if (mEncodingId != ENCODING_EXTENSIBLE) {
+        return mEncodingId;
+    }
+    if (mExtraBytes < kExtensibleSize
+            || memcmp(mSubFormat + 2, kSubFormatGuidTail, sizeof(kSubFormatGuidTail)) != 0) {
+        return ENCODING_EXTENSIBLE;
+    }
+    return (short) (mSubFormat[0] | (mSubFormat[1] << 8));
+}
+
+int WavFmtChunkHeader::getSampleEncoding() const {
+    // An extensible file gives the same encoding IDs in its subformat.
+    short formatCode = getFormatCode();
+    if (formatCode == ENCODING_PCM) {
+        switch (mSampleSize) {
+            case 8:
+                return AudioEncoding::PCM_8;
+
+            case 16:
+                return AudioEncoding::PCM_16;
+
+            case 24:
+                return AudioEncoding::PCM_24;
+
+            case 32:
+                return AudioEncoding::PCM_32;
+
+            default:
+                return AudioEncoding::INVALID;
+        }
+    } else if (formatCode == ENCODING_IEEE_FLOAT) {
+        return AudioEncoding::PCM_IEEEFLOAT;
+    }
+
+    return AudioEncoding::INVALID;
+}
+
 void WavFmtChunkHeader::read(InputStream *stream) {
     WavChunkHeader::read(stream);
     stream->read(&mEncodingId, sizeof(mEncodingId));
@@ -64,11 +118,69 @@ void WavFmtChunkHeader::read(InputStream *stream) {
     stream->read(&mBlockAlign, sizeof(mBlockAlign));
     stream->read(&mSampleSize, sizeof(mSampleSize));
 
-    if (mEncodingId != ENCODING_PCM && mEncodingId != ENCODING_IEEE_FLOAT) {
-        // only read this if NOT PCM
+    // A plain PCM chunk may stop here, anything else has the size of its extra fields next.
+    mExtraBytes = 0;
+    if (mChunkSize >= 18) {
         stream->read(&mExtraBytes, sizeof(mExtraBytes));
-    } else {
-        mExtraBytes = (short) (mChunkSize - 16);
+    }
+
+    mValidBitsPerSample = 0;
+    mChannelMask = 0;
+    memset(mSubFormat, 0, sizeof(mSubFormat));
+    if (mEncodingId == ENCODING_EXTENSIBLE && mExtraBytes >= kExtensibleSize
+            && mChunkSize >= 18 + kExtensibleSize) {
+        stream->read(&mValidBitsPerSample, sizeof(mValidBitsPerSample));
+        stream->read(&mChannelMask, sizeof(mChannelMask));
+        stream->read(mSubFormat, sizeof(mSubFormat));
+    } else if (mEncodingId == ENCODING_EXTENSIBLE) {
+        __android_log_print(ANDROID_LOG_INFO, TAG, "truncated extensible format, %d extra bytes",
+                            mExtraBytes);
+        mExtraBytes = 0;
+    }
+}
+
+void WavFmtChunkHeader::read(const uint8_t *data, int64_t numBytes) {
+    struct __attribute__((packed)) Layout {
+        RiffID chunkId;
+        RiffUInt32 chunkSize;
+        RiffInt16 encodingId;
+        RiffInt16 numChannels;
+        RiffInt32 sampleRate;
+        RiffInt32 aveBytesPerSecond;
+        RiffInt16 blockAlign;
+        RiffInt16 sampleSize;
+        RiffInt16 extraBytes;
+        RiffInt16 validBitsPerSample;
+        RiffUInt32 channelMask;
+        unsigned char subFormat[16];
+    };
+    static_assert(sizeof(Layout) == 8 + 18 + kExtensibleSize, "fmt layout");
+
+    WavChunkHeader::read(data, numBytes);
+    // Fields that are not in the chunk are left as 0.
+    Layout layout = {};
+    memcpy(&layout, data, std::min<int64_t>(std::min<int64_t>(numBytes, 8 + mChunkSize),
+                                            sizeof(layout)));
+    mEncodingId = layout.encodingId;
+    mNumChannels = layout.numChannels;
+    mSampleRate = layout.sampleRate;
+    mAveBytesPerSecond = layout.aveBytesPerSecond;
+    mBlockAlign = layout.blockAlign;
+    mSampleSize = layout.sampleSize;
+    mExtraBytes = layout.extraBytes;
+
+    mValidBitsPerSample = 0;
+    mChannelMask = 0;
+    memset(mSubFormat, 0, sizeof(mSubFormat));
+    if (mEncodingId == ENCODING_EXTENSIBLE && mExtraBytes >= kExtensibleSize
+            && mChunkSize >= 18 + kExtensibleSize && numBytes >= (int64_t) sizeof(layout)) {
+        mValidBitsPerSample = layout.validBitsPerSample;
+        mChannelMask = layout.channelMask;
+        memcpy(mSubFormat, layout.subFormat, sizeof(mSubFormat));
+    } else if (mEncodingId == ENCODING_EXTENSIBLE) {
+        __android_log_print(ANDROID_LOG_INFO, TAG, "truncated extensible format, %d extra bytes",
+                            mExtraBytes);
+        mExtraBytes = 0;
     }
 }
 
@@ -33,6 +33,11 @@ public:
     static const short ENCODING_PCM = 1;
     static const short ENCODING_ADPCM = 2; // Microsoft ADPCM Format
     static const short ENCODING_IEEE_FLOAT = 3; // samples from -1.0 -> 1.0
+    // WAVE_FORMAT_EXTENSIBLE, the real encoding is in the subformat
+    static const short ENCODING_EXTENSIBLE = (short) 0xFFFE;
+
+    // Size of the WAVE_FORMAT_EXTENSIBLE fields that follow mExtraBytes.
+    static const int kExtensibleSize = 22;
 
     RiffInt16 mEncodingId;  /** Microsoft WAV encoding ID (see above) */
     RiffInt16 mNumChannels;
@@ -42,13 +47,31 @@ public:
     RiffInt16 mSampleSize;
     RiffInt16 mExtraBytes;
 
+    // Only set for ENCODING_EXTENSIBLE, otherwise 0.
+    RiffInt16 mValidBitsPerSample;  /** bits of each mSampleSize container that are used */
+    RiffUInt32 mChannelMask;        /** speaker positions of the channels, 0 if not given */
+    unsigned char mSubFormat[16];   /** GUID, its first two bytes are an encoding ID */
+
     WavFmtChunkHeader();
 
     WavFmtChunkHeader(RiffID tag);
 
     void normalize();
 
+    /**
+     * @return the encoding ID, or for ENCODING_EXTENSIBLE the encoding ID of the subformat.
+     * Returns ENCODING_EXTENSIBLE if the subformat is not one of the standard ones.
+     */
+    short getFormatCode() const;
+
+    /**
+     * @return the AudioEncoding of the samples, from the format code and sample size.
+     */
+    int getSampleEncoding() const;
+
     void read(InputStream *stream);
+
+    void read(const uint8_t *data, int64_t numBytes);
 };
 
 } // namespace parselib
@@ -13,12 +13,16 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <string.h>
+
 #include "WavRIFFChunkHeader.h"
 #include "stream/InputStream.h"
 
 namespace parselib {
 
 const RiffID WavRIFFChunkHeader::RIFFID_RIFF = makeRiffID('R', 'I', 'F', 'F');
+const RiffID WavRIFFChunkHeader::RIFFID_RF64 = makeRiffID('R', 'F', '6', '4');
+const RiffID WavRIFFChunkHeader::RIFFID_BW64 = makeRiffID('B', 'W', '6', '4');
 const RiffID WavRIFFChunkHeader::RIFFID_WAVE = makeRiffID('W', 'A', 'V', 'E');
 
 WavRIFFChunkHeader::WavRIFFChunkHeader() : WavChunkHeader(RIFFID_RIFF) {
@@ -34,4 +38,13 @@ void WavRIFFChunkHeader::read(InputStream *stream) {
     stream->read(&mFormatId, sizeof(mFormatId));
 }
 
+void WavRIFFChunkHeader::read(const uint8_t *data, int64_t numBytes) {
+    WavChunkHeader::read(data, numBytes);
+    // The form type follows the ID and size.
+    mFormatId = 0;
+    if (numBytes >= 12) {
+        memcpy(&mFormatId, data + 8, sizeof(mFormatId));
+    }
+}
+
 } // namespace parselib
@@ -25,6 +25,9 @@ class InputStream;
 class WavRIFFChunkHeader : public WavChunkHeader {
 public:
     static const RiffID RIFFID_RIFF;
+    // Files over 4 GB, whose sizes are in a 'ds64' chunk.
+    static const RiffID RIFFID_RF64;
+    static const RiffID RIFFID_BW64;
 
     static const RiffID RIFFID_WAVE;
 
@@ -35,6 +38,8 @@ public:
     WavRIFFChunkHeader(RiffID tag);
 
     virtual void read(InputStream *stream);
+
+    virtual void read(const uint8_t *data, int64_t numBytes);
 };
 
 } // namespace parselib
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <algorithm>
+#include <cmath>
 #include <string.h>
 
 #include <android/log.h>
@@ -28,51 +29,47 @@
 
 static const char *TAG = "WavStreamReader";
 
-static constexpr int kConversionBufferFrames = 16;
+// About 8 KB of 32-bit samples per read.
+static constexpr int kConversionBufferSamples = 2048;
 
 namespace parselib {
 
 WavStreamReader::WavStreamReader(InputStream *stream) {
     mStream = stream;
 
-    mWavChunk = nullptr;
-    mFmtChunk = nullptr;
-    mDataChunk = nullptr;
+    mHasFmtChunk = false;
+    mHasDataChunk = false;
+    mHasDs64Chunk = false;
 
     mAudioDataStartPos = -1;
+    mNumChunks = 0;
 }
 
 int WavStreamReader::getSampleEncoding() {
-    if (mFmtChunk->mEncodingId == WavFmtChunkHeader::ENCODING_PCM) {
-        switch (mFmtChunk->mSampleSize) {
-            case 8:
-                return AudioEncoding::PCM_8;
-
-            case 16:
-                return AudioEncoding::PCM_16;
-
-            case 24:
-                return AudioEncoding::PCM_24;
-
-            case 32:
-                return AudioEncoding::PCM_32;
-
-            default:
-                return AudioEncoding::INVALID;
-        }
-    } else if (mFmtChunk->mEncodingId == WavFmtChunkHeader::ENCODING_IEEE_FLOAT) {
-        return AudioEncoding::PCM_IEEEFLOAT;
-    }
+    return mFmtChunk.getSampleEncoding();
+}
 
-    return AudioEncoding::INVALID;
+int WavStreamReader::getNativeEncoding() {
+    return getSampleEncoding() == AudioEncoding::PCM_16
+            ? AudioEncoding::PCM_16 : AudioEncoding::PCM_IEEEFLOAT;
 }
 
-void WavStreamReader::parse() {
-    RiffID tag;
+bool WavStreamReader::parse() {
+    static constexpr int kChunkHeaderSize = sizeof(RiffID) + sizeof(RiffUInt32);
+
+    // Nothing is read through the stream if it is all in memory.
+    int64_t viewSize = 0;
+    const uint8_t *view = mStream->getView(&viewSize);
 
+    int64_t chunkPos = mStream->getPos();
     while (true) {
-        int numRead = mStream->peek(&tag, sizeof(tag));
-        if (numRead <= 0) {
+        RiffID tag = 0;
+        if (view != nullptr) {
+            if (chunkPos >= viewSize) {
+                break; // done
+            }
+            memcpy(&tag, view + chunkPos, std::min<int64_t>(sizeof(tag), viewSize - chunkPos));
+        } else if (mStream->peek(&tag, sizeof(tag)) <= 0) {
             break; // done
         }
 
@@ -80,45 +77,138 @@ void WavStreamReader::parse() {
 //        __android_log_print(ANDROID_LOG_INFO, TAG, "[%c%c%c%c]",
 //                            tagStr[0], tagStr[1], tagStr[2], tagStr[3]);
 
-        std::shared_ptr<WavChunkHeader> chunk = nullptr;
-        if (tag == WavRIFFChunkHeader::RIFFID_RIFF) {
-            chunk = mWavChunk = std::make_shared<WavRIFFChunkHeader>(WavRIFFChunkHeader(tag));
-            mWavChunk->read(mStream);
-        } else if (tag == WavFmtChunkHeader::RIFFID_FMT) {
-            chunk = mFmtChunk = std::make_shared<WavFmtChunkHeader>(WavFmtChunkHeader(tag));
-            mFmtChunk->read(mStream);
-        } else if (tag == WavChunkHeader::RIFFID_DATA) {
-            chunk = mDataChunk = std::make_shared<WavChunkHeader>(WavChunkHeader(tag));
-            mDataChunk->read(mStream);
-            // We are now positioned at the start of the audio data.
-            mAudioDataStartPos = mStream->getPos();
-            mStream->advance(mDataChunk->mChunkSize);
+        RiffInt64 chunkSize;
+        int64_t nextChunkPos;
+        bool isLastChunk = false;
+        if (tag == WavRIFFChunkHeader::RIFFID_RIFF || tag == WavRIFFChunkHeader::RIFFID_RF64
+                || tag == WavRIFFChunkHeader::RIFFID_BW64) {
+            mWavChunk = WavRIFFChunkHeader(tag);
+            readChunk(mWavChunk, chunkPos, view, viewSize);
+            // The other chunks are inside this one.
+            chunkSize = mWavChunk.mChunkSize;
+            nextChunkPos = chunkPos + kChunkHeaderSize + sizeof(RiffID);
         } else {
-            chunk = std::make_shared<WavChunkHeader>(WavChunkHeader(tag));
-            chunk->read(mStream);
-            mStream->advance(chunk->mChunkSize); // skip the body
+            if (tag == WavDs64ChunkHeader::RIFFID_DS64) {
+                // Comes straight after the RF64 header, before the chunks it gives the sizes of.
+                mDs64Chunk = WavDs64ChunkHeader(tag);
+                readChunk(mDs64Chunk, chunkPos, view, viewSize);
+                mHasDs64Chunk = true;
+                if (mWavChunk.mChunkSize == WavChunkHeader::kSizeInDs64) {
+                    mWavChunk.mChunkSize = mDs64Chunk.mRiffSize;
+                }
+                chunkSize = mDs64Chunk.mChunkSize;
+            } else if (tag == WavFmtChunkHeader::RIFFID_FMT) {
+                mFmtChunk = WavFmtChunkHeader(tag);
+                readChunk(mFmtChunk, chunkPos, view, viewSize);
+                mHasFmtChunk = true;
+                chunkSize = mFmtChunk.mChunkSize;
+            } else if (tag == WavChunkHeader::RIFFID_DATA) {
+                mDataChunk = WavChunkHeader(tag);
+                readChunk(mDataChunk, chunkPos, view, viewSize);
+                if (mHasDs64Chunk) {
+                    mDataChunk.mChunkSize = mDs64Chunk.getChunkSize(tag, mDataChunk.mChunkSize);
+                }
+                mHasDataChunk = true;
+                // The audio data starts after the header.
+                mAudioDataStartPos = chunkPos + kChunkHeaderSize;
+                chunkSize = mDataChunk.mChunkSize;
+            } else {
+                WavChunkHeader chunk(tag);
+                readChunk(chunk, chunkPos, view, viewSize);
+                if (mHasDs64Chunk) {
+                    chunk.mChunkSize = mDs64Chunk.getChunkSize(tag, chunk.mChunkSize);
+                }
+                chunkSize = chunk.mChunkSize;
+            }
+            if (chunkSize < 0) {
+                break; // a broken 'ds64' size
+            }
+            // A chunk that runs past the end of the view, or whose end does not fit in a
+            // position, is the last one. Stop after it rather than step to a position that
+            // is not there.
+            int64_t maxChunkSize = (view != nullptr ? viewSize : INT64_MAX - 1)
+                    - chunkPos - kChunkHeaderSize;
+            isLastChunk = chunkSize > maxChunkSize;
+            // Chunks are padded to an even size.
+            nextChunkPos = isLastChunk
+                    ? -1 : chunkPos + kChunkHeaderSize + chunkSize + (chunkSize & 1);
         }
 
-        mChunkMap[tag] = chunk;
+        if (mNumChunks < kMaxChunks) {
+            mChunks[mNumChunks++] = { tag, chunkPos, chunkSize };
+        }
+        if (isLastChunk) {
+            break;
+        }
+        if (view == nullptr) {
+            mStream->advance(nextChunkPos - mStream->getPos());
+        }
+        chunkPos = nextChunkPos;
     }
 
-    if (mDataChunk != 0) {
+    if (mHasDataChunk) {
         mStream->setPos(mAudioDataStartPos);
     }
+    return mHasFmtChunk && mHasDataChunk;
+}
+
+void WavStreamReader::readChunk(WavChunkHeader &chunk, int64_t chunkPos, const uint8_t *view,
+                                int64_t viewSize) {
+    if (view != nullptr) {
+        chunk.read(view + chunkPos, viewSize - chunkPos);
+    } else {
+        chunk.read(mStream);
+    }
+}
+
+const WavStreamReader::ChunkLocation *WavStreamReader::findChunk(RiffID chunkId) const {
+    for (int index = 0; index < mNumChunks; index++) {
+        if (mChunks[index].mChunkId == chunkId) {
+            return &mChunks[index];
+        }
+    }
+    return nullptr;
 }
 
 // Data access
 void WavStreamReader::positionToAudio() {
-    if (mDataChunk != 0) {
+    if (mHasDataChunk) {
         mStream->setPos(mAudioDataStartPos);
     }
 }
 
+bool WavStreamReader::seekToFrame(int64_t frame) {
+    if (!mHasDataChunk || !mHasFmtChunk || frame < 0
+            || frame > getNumSampleFrames()) {
+        return false;
+    }
+    int bytesPerFrame = mFmtChunk.mNumChannels * (mFmtChunk.mSampleSize / 8);
+    mStream->setPos(mAudioDataStartPos + frame * bytesPerFrame);
+    return true;
+}
+
+int WavStreamReader::clampToData(int numFrames) {
+    // Chunks after the 'data' chunk are not audio.
+    int bytesPerFrame = mFmtChunk.mNumChannels * (mFmtChunk.mSampleSize / 8);
+    int64_t framesLeft =
+            (mAudioDataStartPos + mDataChunk.mChunkSize - mStream->getPos()) / bytesPerFrame;
+    return static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(numFrames, framesLeft)));
+}
+
+/**
+ * @return number of frames to convert at a time, so that a read is a few KB whatever the
+ * number of channels.
+ */
+static int framesPerConversion(int numChannels) {
+    return std::max(1, kConversionBufferSamples / numChannels);
+}
+
 /**
  * Read and convert samples in PCM8 format to float
  */
 int WavStreamReader::getDataFloat_PCM8(float *buff, int numFrames) {
-    int numChannels = mFmtChunk->mNumChannels;
+    int numChannels = mFmtChunk.mNumChannels;
+    int framesPerRead = framesPerConversion(numChannels);
 
     int buffOffset = 0;
     int totalFramesRead = 0;
@@ -127,10 +217,10 @@ int WavStreamReader::getDataFloat_PCM8(float *buff, int numFrames) {
     static constexpr float kSampleFullScale = (float)0x80;
     static constexpr float kInverseScale = 1.0f / kSampleFullScale;
 
-    u_int8_t readBuff[kConversionBufferFrames * numChannels];
+    u_int8_t readBuff[framesPerRead * numChannels];
     int framesLeft = numFrames;
     while (framesLeft > 0) {
-        int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
+        int framesThisRead = std::min(framesLeft, framesPerRead);
         //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
         int numFramesRead =
                 mStream->read(readBuff, framesThisRead *  kSampleSize * numChannels) /
@@ -138,11 +228,13 @@ int WavStreamReader::getDataFloat_PCM8(float *buff, int numFrames) {
         totalFramesRead += numFramesRead;
 
         // Convert & Scale
-        for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
+        int numSamples = numFramesRead * numChannels;
+        float *out = buff + buffOffset;
+        for (int offset = 0; offset < numSamples; offset++) {
             // PCM8 is unsigned, so we need to make it signed before scaling/converting
-            buff[buffOffset++] = ((float) readBuff[offset] - kSampleFullScale)
-                    * kInverseScale;
+            out[offset] = ((float) readBuff[offset] - kSampleFullScale) * kInverseScale;
         }
+        buffOffset += numSamples;
 
         if (numFramesRead < framesThisRead) {
             break; // none left
@@ -158,7 +250,8 @@ int WavStreamReader::getDataFloat_PCM8(float *buff, int numFrames) {
  * Read and convert samples in PCM16 format to float
  */
 int WavStreamReader::getDataFloat_PCM16(float *buff, int numFrames) {
-    int numChannels = mFmtChunk->mNumChannels;
+    int numChannels = mFmtChunk.mNumChannels;
+    int framesPerRead = framesPerConversion(numChannels);
 
     int buffOffset = 0;
     int totalFramesRead = 0;
@@ -167,10 +260,10 @@ int WavStreamReader::getDataFloat_PCM16(float *buff, int numFrames) {
     static constexpr float kSampleFullScale = (float) 0x8000;
     static constexpr float kInverseScale = 1.0f / kSampleFullScale;
 
-    int16_t readBuff[kConversionBufferFrames * numChannels];
+    int16_t readBuff[framesPerRead * numChannels];
     int framesLeft = numFrames;
     while (framesLeft > 0) {
-        int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
+        int framesThisRead = std::min(framesLeft, framesPerRead);
         //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
         int numFramesRead =
                 mStream->read(readBuff, framesThisRead * kSampleSize * numChannels) /
@@ -178,9 +271,12 @@ int WavStreamReader::getDataFloat_PCM16(float *buff, int numFrames) {
         totalFramesRead += numFramesRead;
 
         // Convert & Scale
-        for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
-            buff[buffOffset++] = (float) readBuff[offset] * kInverseScale;
+        int numSamples = numFramesRead * numChannels;
+        float *out = buff + buffOffset;
+        for (int offset = 0; offset < numSamples; offset++) {
+            out[offset] = (float) readBuff[offset] * kInverseScale;
         }
+        buffOffset += numSamples;
 
         if (numFramesRead < framesThisRead) {
             break; // none left
@@ -196,22 +292,44 @@ int WavStreamReader::getDataFloat_PCM16(float *buff, int numFrames) {
  * Read and convert samples in PCM24 format to float
  */
 int WavStreamReader::getDataFloat_PCM24(float *buff, int numFrames) {
-    int numChannels = mFmtChunk->mNumChannels;
-    int numSamples = numFrames * numChannels;
+    int numChannels = mFmtChunk.mNumChannels;
+    int framesPerRead = framesPerConversion(numChannels);
 
+    int buffOffset = 0;
+    int totalFramesRead = 0;
+
+    static constexpr int kSampleSize = 3;
     static constexpr float kSampleFullScale = (float) 0x80000000;
     static constexpr float kInverseScale = 1.0f / kSampleFullScale;
 
-    uint8_t buffer[3];
-    for(int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++) {
-        if (mStream->read(buffer, 3) < 3) {
-            break; // no more data
+    uint8_t readBuff[framesPerRead * numChannels * kSampleSize];
+    int framesLeft = numFrames;
+    while (framesLeft > 0) {
+        int framesThisRead = std::min(framesLeft, framesPerRead);
+        int numFramesRead =
+                mStream->read(readBuff, framesThisRead * kSampleSize * numChannels) /
+                (kSampleSize * numChannels);
+        totalFramesRead += numFramesRead;
+
+        // Convert & Scale. The bytes go into the top of an int32 so the sign comes along.
+        int numSamples = numFramesRead * numChannels;
+        float *out = buff + buffOffset;
+        const uint8_t *in = readBuff;
+        for (int offset = 0; offset < numSamples; offset++, in += kSampleSize) {
+            int32_t sample = (int32_t) (((uint32_t) in[0] << 8) | ((uint32_t) in[1] << 16)
+                    | ((uint32_t) in[2] << 24));
+            out[offset] = (float) sample * kInverseScale;
         }
-        int32_t sample = (buffer[0] << 8) | (buffer[1] << 16) | (buffer[2] << 24);
-        buff[sampleIndex] = (float)sample * kInverseScale;
+        buffOffset += numSamples;
+
+        if (numFramesRead < framesThisRead) {
+            break; // none left
+        }
+
+        framesLeft -= framesThisRead;
     }
 
-    return numFrames;
+    return totalFramesRead;
 }
 
 /**
@@ -219,7 +337,7 @@ int WavStreamReader::getDataFloat_PCM24(float *buff, int numFrames) {
  */
 int WavStreamReader::getDataFloat_Float32(float *buff, int numFrames) {
     // Turns out that WAV Float32 is just Android floats
-    int numChannels = mFmtChunk->mNumChannels;
+    int numChannels = mFmtChunk.mNumChannels;
 
     return mStream->read(buff, numFrames * sizeof(float) * numChannels) /
            (sizeof(float) * numChannels);
@@ -229,7 +347,8 @@ int WavStreamReader::getDataFloat_Float32(float *buff, int numFrames) {
  * Read and convert samples in PCM32 format to float
  */
 int WavStreamReader::getDataFloat_PCM32(float *buff, int numFrames) {
-    int numChannels = mFmtChunk->mNumChannels;
+    int numChannels = mFmtChunk.mNumChannels;
+    int framesPerRead = framesPerConversion(numChannels);
 
     int buffOffset = 0;
     int totalFramesRead = 0;
@@ -238,10 +357,10 @@ int WavStreamReader::getDataFloat_PCM32(float *buff, int numFrames) {
     static constexpr float kSampleFullScale = (float) 0x80000000;
     static constexpr float kInverseScale = 1.0f / kSampleFullScale;
 
-    int32_t readBuff[kConversionBufferFrames * numChannels];
+    int32_t readBuff[framesPerRead * numChannels];
     int framesLeft = numFrames;
     while (framesLeft > 0) {
-        int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
+        int framesThisRead = std::min(framesLeft, framesPerRead);
         //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
         int numFramesRead =
                 mStream->read(readBuff, framesThisRead *  kSampleSize* numChannels) /
@@ -249,9 +368,12 @@ int WavStreamReader::getDataFloat_PCM32(float *buff, int numFrames) {
         totalFramesRead += numFramesRead;
 
         // convert & Scale
-        for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
-            buff[buffOffset++] = (float) readBuff[offset] * kInverseScale;
+        int numSamples = numFramesRead * numChannels;
+        float *out = buff + buffOffset;
+        for (int offset = 0; offset < numSamples; offset++) {
+            out[offset] = (float) readBuff[offset] * kInverseScale;
         }
+        buffOffset += numSamples;
 
         if (numFramesRead < framesThisRead) {
             break; // none left
@@ -266,43 +388,40 @@ int WavStreamReader::getDataFloat_PCM32(float *buff, int numFrames) {
 int WavStreamReader::getDataFloat(float *buff, int numFrames) {
     // __android_log_print(ANDROID_LOG_INFO, TAG, "getData(%d)", numFrames);
 
-    if (mDataChunk == nullptr || mFmtChunk == nullptr) {
+    if (!mHasDataChunk || !mHasFmtChunk) {
         return ERR_INVALID_STATE;
     }
 
+    // Samples with fewer valid bits than their container are left justified with the
+    // rest zero, so they convert like a full sized sample.
     int numFramesRead = 0;
-    switch (mFmtChunk->mSampleSize) {
-        case 8:
-            numFramesRead = getDataFloat_PCM8(buff, numFrames);
+    switch (getSampleEncoding()) {
+        case AudioEncoding::PCM_8:
+            numFramesRead = getDataFloat_PCM8(buff, clampToData(numFrames));
             break;
 
-        case 16:
-            numFramesRead = getDataFloat_PCM16(buff, numFrames);
+        case AudioEncoding::PCM_16:
+            numFramesRead = getDataFloat_PCM16(buff, clampToData(numFrames));
             break;
 
-        case 24:
-            if (mFmtChunk->mEncodingId == WavFmtChunkHeader::ENCODING_PCM) {
-                numFramesRead = getDataFloat_PCM24(buff, numFrames);
-            } else {
-                __android_log_print(ANDROID_LOG_INFO, TAG, "invalid encoding:%d mSampleSize:%d",
-                                    mFmtChunk->mEncodingId, mFmtChunk->mSampleSize);
-            }
+        case AudioEncoding::PCM_24:
+            numFramesRead = getDataFloat_PCM24(buff, clampToData(numFrames));
             break;
 
-        case 32:
-            if (mFmtChunk->mEncodingId == WavFmtChunkHeader::ENCODING_PCM) {
-                numFramesRead = getDataFloat_PCM32(buff, numFrames);
-            } else if (mFmtChunk->mEncodingId == WavFmtChunkHeader::ENCODING_IEEE_FLOAT) {
-                numFramesRead = getDataFloat_Float32(buff, numFrames);
-            } else {
-                __android_log_print(ANDROID_LOG_INFO, TAG, "invalid encoding:%d mSampleSize:%d",
-                                    mFmtChunk->mEncodingId, mFmtChunk->mSampleSize);
-            }
+        case AudioEncoding::PCM_32:
+            numFramesRead = getDataFloat_PCM32(buff, clampToData(numFrames));
             break;
 
+        case AudioEncoding::PCM_IEEEFLOAT:
+            if (mFmtChunk.mSampleSize == 32) {
+                numFramesRead = getDataFloat_Float32(buff, clampToData(numFrames));
+                break;
+            }
+            [[fallthrough]];
+
         default:
             __android_log_print(ANDROID_LOG_INFO, TAG, "invalid encoding:%d mSampleSize:%d",
-                    mFmtChunk->mEncodingId, mFmtChunk->mSampleSize);
+                    mFmtChunk.getFormatCode(), mFmtChunk.mSampleSize);
             return ERR_INVALID_FORMAT;
     }
 
@@ -316,4 +435,45 @@ int WavStreamReader::getDataFloat(float *buff, int numFrames) {
     return numFramesRead;
 }
 
+int WavStreamReader::getData16(int16_t *buff, int numFrames) {
+    if (!mHasDataChunk || !mHasFmtChunk) {
+        return ERR_INVALID_STATE;
+    }
+
+    int numChannels = getNumChannels();
+    int numFramesRead = 0;
+    if (getSampleEncoding() == AudioEncoding::PCM_16) {
+        // No conversion at all.
+        numFramesRead = mStream->read(buff, clampToData(numFrames) * numChannels * sizeof(int16_t))
+                / (numChannels * sizeof(int16_t));
+    } else {
+        int framesPerRead = framesPerConversion(numChannels);
+        float readBuff[framesPerRead * numChannels];
+        while (numFramesRead < numFrames) {
+            int framesThisRead = std::min(numFrames - numFramesRead, framesPerRead);
+            int framesRead = getDataFloat(readBuff, framesThisRead);
+            if (framesRead < 0) {
+                return framesRead;
+            }
+            int16_t *out = buff + numFramesRead * numChannels;
+            for (int offset = 0; offset < framesRead * numChannels; offset++) {
+                float sample = std::round(readBuff[offset] * 32768.0f);
+                out[offset] = (int16_t) std::max(-32768.0f, std::min(32767.0f, sample));
+            }
+            numFramesRead += framesRead;
+            if (framesRead < framesThisRead) {
+                break; // none left
+            }
+        }
+    }
+
+    // Zero out any unread frames
+    if (numFramesRead < numFrames) {
+        memset(buff + (numFramesRead * numChannels), 0,
+                (numFrames - numFramesRead) * sizeof(buff[0]) * numChannels);
+    }
+
+    return numFramesRead;
+}
+
 } // namespace parselib
@@ -16,9 +16,10 @@
 #ifndef _IO_WAV_WAVSTREAMREADER_H_
 #define _IO_WAV_WAVSTREAMREADER_H_
 
-#include <map>
+#include "decoder/AudioDecoder.h"
 
 #include "AudioEncoding.h"
+#include "WavDs64ChunkHeader.h"
 #include "WavRIFFChunkHeader.h"
 #include "WavFmtChunkHeader.h"
 
@@ -26,51 +27,100 @@
  * WAV format documentation can be found:
  * http://soundfile.sapp.org/doc/WaveFormat/
  * https://web.archive.org/web/20090417165828/http://www.kk.iij4u.or.jp/~kondo/wave/mpidata.txt
+ * RF64 and BW64, for files over 4 GB, are described in EBU Tech 3306 and ITU-R BS.2088.
  */
 namespace parselib {
 
 class InputStream;
 
-class WavStreamReader {
+class WavStreamReader : public AudioDecoder {
 public:
     WavStreamReader(InputStream *stream);
 
-    int getSampleRate() { return mFmtChunk->mSampleRate; }
+    virtual int getSampleRate() { return mFmtChunk.mSampleRate; }
 
-    int getNumSampleFrames() {
-        return mDataChunk->mChunkSize / (mFmtChunk->mSampleSize / 8) / mFmtChunk->mNumChannels;
+    virtual int64_t getNumSampleFrames() {
+        return mDataChunk.mChunkSize / (mFmtChunk.mSampleSize / 8) / mFmtChunk.mNumChannels;
     }
 
-    int getNumChannels() { return mFmtChunk != 0 ? mFmtChunk->mNumChannels : 0; }
+    virtual int getNumChannels() { return mHasFmtChunk ? mFmtChunk.mNumChannels : 0; }
 
-    int getSampleEncoding();
+    virtual int getSampleEncoding();
 
-    int getBitsPerSample() { return mFmtChunk->mSampleSize; }
+    virtual int getBitsPerSample() { return mFmtChunk.mSampleSize; }
 
-    void parse();
+    // The bits of each sample that are used, which may be fewer than getBitsPerSample().
+    int getValidBitsPerSample() {
+        return mFmtChunk.mValidBitsPerSample != 0
+                ? mFmtChunk.mValidBitsPerSample : mFmtChunk.mSampleSize;
+    }
+
+    // Speaker positions of the channels as a WAVE_FORMAT_EXTENSIBLE channel mask,
+    // or 0 if the file does not give them.
+    virtual uint32_t getChannelMask() { return mHasFmtChunk ? mFmtChunk.mChannelMask : 0; }
+
+    virtual int getNativeEncoding();
+
+    /**
+     * Reads the chunk headers. A stream that is all in memory, such as a MemInputStream,
+     * is parsed straight from its InputStream::getView() without any stream reads.
+     * Returns: false if there is no 'fmt ' or 'data' chunk.
+     */
+    virtual bool parse();
+
+    // Where a chunk is in the stream.
+    struct ChunkLocation {
+        RiffID mChunkId;
+        int64_t mChunkPos;  /** of the chunk ID */
+        RiffInt64 mChunkSize;
+    };
+
+    // How many chunks parse() keeps the location of. The rest are skipped.
+    static constexpr int kMaxChunks = 32;
+
+    /**
+     * Returns: The first chunk with the ID, such as 'LIST', or nullptr if there is none.
+     */
+    const ChunkLocation *findChunk(RiffID chunkId) const;
+
+    int getNumChunks() const { return mNumChunks; }
+
+    const ChunkLocation *getChunks() const { return mChunks; }
 
     // Data access
-    void positionToAudio();
+    virtual void positionToAudio();
 
-    static constexpr int ERR_INVALID_FORMAT    = -1;
-    static constexpr int ERR_INVALID_STATE    = -2;
+    virtual bool seekToFrame(int64_t frame);
 
-    int getDataFloat(float *buff, int numFrames);
+    virtual int getDataFloat(float *buff, int numFrames);
 
-    // int getData16(short *buff, int numFramees);
+    virtual int getData16(int16_t *buff, int numFrames);
 
 protected:
     InputStream *mStream;
 
-    std::shared_ptr<WavRIFFChunkHeader> mWavChunk;
-    std::shared_ptr<WavFmtChunkHeader> mFmtChunk;
-    std::shared_ptr<WavChunkHeader> mDataChunk;
+    WavRIFFChunkHeader mWavChunk;
+    WavFmtChunkHeader mFmtChunk;
+    WavChunkHeader mDataChunk;
+    WavDs64ChunkHeader mDs64Chunk;
+    bool mHasFmtChunk;
+    bool mHasDataChunk;
+    bool mHasDs64Chunk;
 
-    long mAudioDataStartPos;
+    int64_t mAudioDataStartPos;
 
-    std::map<RiffID, std::shared_ptr<WavChunkHeader>> mChunkMap;
+    // Every chunk in the file up to kMaxChunks, in order.
+    ChunkLocation mChunks[kMaxChunks];
+    int mNumChunks;
 
 private:
+    // Read the chunk at chunkPos, from the view if there is one, otherwise from mStream.
+    void readChunk(WavChunkHeader &chunk, int64_t chunkPos, const uint8_t *view,
+                   int64_t viewSize);
+
+    // Limit a read to the frames left in the 'data' chunk.
+    int clampToData(int numFrames);
+
     /*
      * Individual Format Readers/Converters
      */
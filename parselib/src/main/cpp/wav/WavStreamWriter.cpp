@@ -0,0 +1,114 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "WavChunkHeader.h"
+#include "WavDs64ChunkHeader.h"
+#include "WavRIFFChunkHeader.h"
+#include "WavStreamWriter.h"
+
+namespace parselib {
+
+// Offsets from the start of the file.
+static constexpr int64_t kRiffSizePos = 4;
+static constexpr int64_t kJunkPos = 12;
+static constexpr int64_t kFmtPos = kJunkPos + 8 + WavDs64ChunkHeader::kFixedSize;
+static constexpr int64_t kDataPos = kFmtPos + 8 + 16;
+static constexpr int64_t kDataStartPos = kDataPos + 8;
+
+static const RiffID RIFFID_JUNK = makeRiffID('J', 'U', 'N', 'K');
+
+void WavStreamWriter::writeInt(uint64_t value, int numBytes) {
+    for (; numBytes > 0; --numBytes, value >>= 8) {
+        mStream.put(static_cast<char>(value & 0xFF));
+    }
+}
+
+void WavStreamWriter::writeId(RiffID id) {
+    writeInt(id, sizeof(id));
+}
+
+bool WavStreamWriter::writeHeader(int numChannels, int sampleRate, int bitsPerSample,
+                                  short encodingId) {
+    mHeaderPos = mStream.tellp();
+    mDataSize = 0;
+    mIsRF64 = false;
+    mBlockAlign = numChannels * (bitsPerSample / 8);
+
+    writeId(WavRIFFChunkHeader::RIFFID_RIFF);
+    writeInt(0, 4); // filled in by finish()
+    writeId(WavRIFFChunkHeader::RIFFID_WAVE);
+
+    // Room for a 'ds64' chunk without a table.
+    writeId(RIFFID_JUNK);
+    writeInt(WavDs64ChunkHeader::kFixedSize, 4);
+    for (int i = 0; i < WavDs64ChunkHeader::kFixedSize; i++) {
+        mStream.put(0);
+    }
+
+    writeId(WavFmtChunkHeader::RIFFID_FMT);
+    writeInt(16, 4);
+    writeInt(encodingId, 2);
+    writeInt(numChannels, 2);
+    writeInt(sampleRate, 4);
+    writeInt(static_cast<uint64_t>(sampleRate) * mBlockAlign, 4);
+    writeInt(mBlockAlign, 2);
+    writeInt(bitsPerSample, 2);
+
+    writeId(WavChunkHeader::RIFFID_DATA);
+    writeInt(0, 4); // filled in by finish()
+    return static_cast<bool>(mStream);
+}
+
+bool WavStreamWriter::write(const void *data, int64_t numBytes) {
+    mStream.write(static_cast<const char *>(data), numBytes);
+    mDataSize += numBytes;
+    return static_cast<bool>(mStream);
+}
+
+bool WavStreamWriter::finish() {
+    // Chunks are padded to an even size.
+    int64_t padding = mDataSize & 1;
+    if (padding != 0) {
+        mStream.put(0);
+    }
+    int64_t riffSize = kDataStartPos - 8 + mDataSize + padding;
+    mIsRF64 = riffSize > static_cast<int64_t>(WavChunkHeader::kSizeInDs64);
+
+    if (mIsRF64) {
+        mStream.seekp(mHeaderPos);
+        writeId(WavRIFFChunkHeader::RIFFID_RF64);
+        writeInt(WavChunkHeader::kSizeInDs64, 4);
+
+        mStream.seekp(mHeaderPos + kJunkPos);
+        writeId(WavDs64ChunkHeader::RIFFID_DS64);
+        writeInt(WavDs64ChunkHeader::kFixedSize, 4);
+        writeInt(riffSize, 8);
+        writeInt(mDataSize, 8);
+        writeInt(mBlockAlign > 0 ? mDataSize / mBlockAlign : 0, 8);
+        writeInt(0, 4); // no table
+
+        mStream.seekp(mHeaderPos + kDataPos + 4);
+        writeInt(WavChunkHeader::kSizeInDs64, 4);
+    } else {
+        mStream.seekp(mHeaderPos + kRiffSizePos);
+        writeInt(riffSize, 4);
+        mStream.seekp(mHeaderPos + kDataPos + 4);
+        writeInt(mDataSize, 4);
+    }
+    mStream.seekp(0, std::ios::end);
+    return static_cast<bool>(mStream.flush());
+}
+
+} // namespace parselib
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_WAV_WAVSTREAMWRITER_H_
+#define _IO_WAV_WAVSTREAMWRITER_H_
+
+#include <cstdint>
+#include <ostream>
+
+#include "WavFmtChunkHeader.h"
+
+namespace parselib {
+
+/**
+ * Writes a WAV file to a seekable stream, for example a std::ofstream opened in binary mode.
+ *
+ * The chunk sizes are filled in by finish(). A file that has grown beyond what the 32-bit
+ * sizes can hold is turned into an RF64 file then. The 'ds64' chunk that this needs is
+ * reserved up front as a 'JUNK' chunk, which readers skip, so the audio never has to move.
+ */
+class WavStreamWriter {
+public:
+    WavStreamWriter(std::ostream &stream) : mStream(stream) {}
+
+    /**
+     * Write the headers. Must be called first, at the start of the stream.
+     *
+     * @param encodingId WavFmtChunkHeader::ENCODING_PCM or ENCODING_IEEE_FLOAT
+     * @return false if the stream failed
+     */
+    bool writeHeader(int numChannels, int sampleRate, int bitsPerSample,
+                     short encodingId = WavFmtChunkHeader::ENCODING_PCM);
+
+    /**
+     * Append little endian samples to the 'data' chunk.
+     *
+     * @return false if the stream failed
+     */
+    bool write(const void *data, int64_t numBytes);
+
+    /**
+     * Fill in the sizes. The stream is left at the end of the file.
+     *
+     * @return false if the stream failed
+     */
+    bool finish();
+
+    int64_t getDataSize() const { return mDataSize; }
+
+    // True if finish() had to write an RF64 file.
+    bool isRF64() const { return mIsRF64; }
+
+private:
+    void writeInt(uint64_t value, int numBytes);
+    void writeId(RiffID id);
+
+    std::ostream &mStream;
+    int64_t mHeaderPos = 0;
+    int64_t mDataSize = 0;
+    int mBlockAlign = 0;
+    bool mIsRF64 = false;
+};
+
+} // namespace parselib
+
+#endif // _IO_WAV_WAVSTREAMWRITER_H_
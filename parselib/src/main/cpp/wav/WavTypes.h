@@ -16,6 +16,8 @@
 #ifndef __WAVTYPES_H__
 #define __WAVTYPES_H__
 
+#include <cstdint>
+
 namespace parselib {
 
 /*
@@ -23,6 +25,8 @@ namespace parselib {
  */
 typedef unsigned int RiffID;    // A "four character code" (i.e. FOURCC)
 typedef int RiffInt32;          // A 32-bit signed integer
+typedef unsigned int RiffUInt32; // A 32-bit unsigned integer, for sizes
+typedef int64_t RiffInt64;      // A 64-bit signed integer, for RF64 sizes
 typedef short RiffInt16;        // A 16-bit signed integer
 
 /*
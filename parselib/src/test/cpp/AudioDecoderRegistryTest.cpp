@@ -0,0 +1,222 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks that AudioDecoderRegistry picks the decoder by the magic bytes, falls back to the
+ * next matching format when parse() fails, and lets an application add its own formats.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "FlacTestWriter.h"
+#include "decoder/AudioDecoderRegistry.h"
+#include "flac/FlacStreamReader.h"
+#include "stream/MemInputStream.h"
+#include "wav/WavStreamReader.h"
+
+using namespace parselib;
+
+namespace {
+
+int sFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            sFailures++; \
+        } \
+    } while (false)
+
+void appendInt(std::vector<uint8_t> &bytes, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        bytes.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void appendId(std::vector<uint8_t> &bytes, const char *id) {
+    bytes.insert(bytes.end(), id, id + 4);
+}
+
+// A 16-bit stereo WAV file of a ramp.
+std::vector<uint8_t> wavFile(const char *riffId, int numFrames) {
+    std::vector<uint8_t> bytes;
+    appendId(bytes, riffId);
+    appendInt(bytes, 36 + numFrames * 4, 4);
+    appendId(bytes, "WAVE");
+    appendId(bytes, "fmt ");
+    appendInt(bytes, 16, 4);
+    appendInt(bytes, 1, 2);         // PCM
+    appendInt(bytes, 2, 2);         // channels
+    appendInt(bytes, 48000, 4);
+    appendInt(bytes, 48000 * 4, 4);
+    appendInt(bytes, 4, 2);
+    appendInt(bytes, 16, 2);
+    appendId(bytes, "data");
+    appendInt(bytes, numFrames * 4, 4);
+    for (int i = 0; i < numFrames * 2; i++) {
+        appendInt(bytes, static_cast<uint16_t>(i * 64), 2);
+    }
+    return bytes;
+}
+
+std::vector<uint8_t> flacFile(int id3Size) {
+    flactest::Options options;
+    options.id3Size = id3Size;
+    return flactest::encode(flactest::makeSignal(2, 4096, 16, options.blockSize), options);
+}
+
+// A decoder for a made up format, whose parse() succeeds if told so.
+class FakeDecoder : public AudioDecoder {
+public:
+    FakeDecoder(parselib::InputStream *stream, bool parses) : mStream(stream), mParses(parses) {}
+
+    bool parse() override {
+        uint8_t header[8];
+        mStream->read(header, sizeof(header));
+        return mParses;
+    }
+    int getSampleRate() override { return 1234; }
+    int getNumChannels() override { return 1; }
+    int64_t getNumSampleFrames() override { return 0; }
+    int getBitsPerSample() override { return 16; }
+    int getSampleEncoding() override { return 0; }
+    int getNativeEncoding() override { return 0; }
+    void positionToAudio() override {}
+    bool seekToFrame(int64_t frame) override { return frame == 0; }
+    int getDataFloat(float *, int) override { return 0; }
+    int getData16(int16_t *, int) override { return 0; }
+
+private:
+    parselib::InputStream *mStream;
+    bool mParses;
+};
+
+// The stream is declared first, so it outlives the decoder.
+struct Opened {
+    std::unique_ptr<MemInputStream> stream;
+    std::unique_ptr<AudioDecoder> decoder;
+};
+
+Opened open(std::vector<uint8_t> &bytes) {
+    Opened opened;
+    opened.stream.reset(new MemInputStream(bytes.data(), static_cast<int64_t>(bytes.size())));
+    opened.decoder = AudioDecoderRegistry::createDecoder(opened.stream.get());
+    return opened;
+}
+
+void checkBuiltInFormats() {
+    printf("built in formats\n");
+    for (const char *riffId : {"RIFF", "RF64", "BW64"}) {
+        std::vector<uint8_t> bytes = wavFile(riffId, 100);
+        CHECK(AudioDecoderRegistry::sniff(bytes.data(), static_cast<int>(bytes.size())) == "wav");
+        // Without a 'ds64' chunk, RF64 and BW64 use the 32-bit sizes.
+        Opened opened = open(bytes);
+        AudioDecoder *decoder = opened.decoder.get();
+        CHECK(dynamic_cast<WavStreamReader *>(decoder) != nullptr);
+        if (decoder != nullptr) {
+            CHECK(decoder->getSampleRate() == 48000);
+            CHECK(decoder->getNumSampleFrames() == 100);
+            int16_t frame[2];
+            CHECK(decoder->getData16(frame, 1) == 1);
+            CHECK(frame[0] == 0 && frame[1] == 64);
+        }
+    }
+
+    for (int id3Size : {0, 300}) {
+        std::vector<uint8_t> bytes = flacFile(id3Size);
+        CHECK(AudioDecoderRegistry::sniff(bytes.data(), static_cast<int>(bytes.size()))
+                == "flac");
+        Opened opened = open(bytes);
+        CHECK(dynamic_cast<FlacStreamReader *>(opened.decoder.get()) != nullptr);
+        CHECK(opened.decoder != nullptr && opened.decoder->getNumSampleFrames() == 4096);
+    }
+}
+
+void checkUnknownFormats() {
+    printf("unknown formats\n");
+
+    // An MP3 with an ID3v2 tag looks like FLAC until the tag has been skipped.
+    std::vector<uint8_t> mp3 = {'I', 'D', '3', 4, 0, 0, 0, 0, 0, 10};
+    mp3.resize(mp3.size() + 10, 0);
+    mp3.insert(mp3.end(), {0xFF, 0xFB, 0x90, 0x64});
+    mp3.resize(mp3.size() + 400, 0);
+    CHECK(AudioDecoderRegistry::sniff(mp3.data(), static_cast<int>(mp3.size())) == "flac");
+    Opened opened = open(mp3);
+    CHECK(opened.decoder == nullptr);
+    CHECK(opened.stream->getPos() == 0);
+
+    std::vector<uint8_t> avi = wavFile("RIFF", 10);
+    memcpy(&avi[8], "AVI ", 4);
+    CHECK(AudioDecoderRegistry::sniff(avi.data(), static_cast<int>(avi.size())) == "");
+    CHECK(open(avi).decoder == nullptr);
+
+    // Too short to hold any of the magics.
+    std::vector<uint8_t> tiny = {'f', 'L', 'a'};
+    CHECK(AudioDecoderRegistry::sniff(tiny.data(), static_cast<int>(tiny.size())) == "");
+    CHECK(open(tiny).decoder == nullptr);
+    std::vector<uint8_t> empty(1);
+    CHECK(open(empty).decoder == nullptr);
+}
+
+void checkRegisteredFormats() {
+    printf("registered formats\n");
+
+    AudioDecoderRegistry::registerDecoder("fake", {{0, "FAKE"}, {6, "v1"}},
+            [](parselib::InputStream *stream) {
+                return std::unique_ptr<AudioDecoder>(new FakeDecoder(stream, true));
+            });
+    std::vector<uint8_t> fake = {'F', 'A', 'K', 'E', 0, 0, 'v', '1', 0, 0};
+    CHECK(AudioDecoderRegistry::sniff(fake.data(), static_cast<int>(fake.size())) == "fake");
+    CHECK(dynamic_cast<FakeDecoder *>(open(fake).decoder.get()) != nullptr);
+    fake[7] = '2';
+    CHECK(AudioDecoderRegistry::sniff(fake.data(), static_cast<int>(fake.size())) == "");
+
+    // A later format is tried first. When its parse() fails, the stream is put back for
+    // the built in decoder.
+    int numCreated = 0;
+    AudioDecoderRegistry::registerDecoder("flac-override", {{0, "fLaC"}},
+            [&numCreated](parselib::InputStream *stream) {
+                numCreated++;
+                return std::unique_ptr<AudioDecoder>(new FakeDecoder(stream, false));
+            });
+    std::vector<uint8_t> flac = flacFile(0);
+    CHECK(AudioDecoderRegistry::sniff(flac.data(), static_cast<int>(flac.size()))
+            == "flac-override");
+    Opened opened = open(flac);
+    CHECK(numCreated == 1);
+    CHECK(dynamic_cast<FlacStreamReader *>(opened.decoder.get()) != nullptr);
+    CHECK(opened.decoder != nullptr && opened.decoder->getNumSampleFrames() == 4096);
+}
+
+} // namespace
+
+int main() {
+    checkBuiltInFormats();
+    checkUnknownFormats();
+    checkRegisteredFormats();
+
+    if (sFailures > 0) {
+        printf("%d checks failed\n", sFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
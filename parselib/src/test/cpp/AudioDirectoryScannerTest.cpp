@@ -0,0 +1,75 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks that AudioDirectoryScanner::toJson() turns any file name into a string that
+ * NewStringUTF() accepts: modified UTF-8 with no 4 byte sequences and no invalid bytes.
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "probe/AudioDirectoryScanner.h"
+
+using namespace parselib;
+
+namespace {
+
+int sFailures = 0;
+
+// The JSON string written for a file name.
+std::string pathJson(const std::string &path) {
+    AudioDirectoryScanner::Entry entry;
+    entry.path = path;
+    std::string json = AudioDirectoryScanner::toJson({entry});
+    size_t start = json.find(':') + 1;
+    size_t end = json.find(",\"format\"");
+    return json.substr(start, end - start);
+}
+
+void check(const char *name, const std::string &path, const std::string &expected) {
+    std::string actual = pathJson(path);
+    if (actual != expected) {
+        fprintf(stderr, "%s: got %s, expected %s\n", name, actual.c_str(), expected.c_str());
+        sFailures++;
+    }
+}
+
+} // namespace
+
+int main() {
+    check("ascii", "/a/b.wav", "\"/a/b.wav\"");
+    check("escapes", "a\"b\\c\n", "\"a\\\"b\\\\c\\u000a\"");
+    check("2 and 3 bytes", "caf\xC3\xA9 \xE2\x82\xAC", "\"caf\xC3\xA9 \xE2\x82\xAC\"");
+    check("4 bytes", "\xF0\x9F\x8E\xB5.wav", "\"\\ud83c\\udfb5.wav\"");
+    check("latin-1", "caf\xE9.wav", "\"caf\\ufffd.wav\"");
+    check("stray continuation", "\x80x", "\"\\ufffdx\"");
+    check("truncated", "x\xE2\x82", "\"x\\ufffd\\ufffd\"");
+    check("truncated 4 bytes", "\xF0\x9F\x8E", "\"\\ufffd\\ufffd\\ufffd\"");
+    check("overlong", "\xC0\xAF", "\"\\ufffd\\ufffd\"");
+    check("overlong 3 bytes", "\xE0\x80\xAF", "\"\\ufffd\\ufffd\\ufffd\"");
+    check("surrogate", "\xED\xA0\x80", "\"\\ufffd\\ufffd\\ufffd\"");
+    check("past U+10FFFF", "\xF4\x90\x80\x80", "\"\\ufffd\\ufffd\\ufffd\\ufffd\"");
+    check("bad lead byte", "\xFF", "\"\\ufffd\"");
+
+    if (sFailures > 0) {
+        printf("%d checks failed\n", sFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
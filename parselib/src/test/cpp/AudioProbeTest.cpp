@@ -0,0 +1,350 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Probes WAV, RF64 and FLAC files with AudioProbe, from memory, from a path and from an open
+ * file, and checks what it finds against the headers that were written and against what
+ * the decoders report.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "FlacTestWriter.h"
+#include "flac/FlacStreamReader.h"
+#include "probe/AudioProbe.h"
+#include "stream/MemInputStream.h"
+#include "wav/AudioEncoding.h"
+#include "wav/WavStreamReader.h"
+
+using namespace parselib;
+
+namespace {
+
+int sFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            sFailures++; \
+        } \
+    } while (false)
+
+void appendInt(std::vector<uint8_t> &bytes, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        bytes.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void appendId(std::vector<uint8_t> &bytes, const char *id) {
+    bytes.insert(bytes.end(), id, id + 4);
+}
+
+/**
+ * 24-bit 5.1 WAVE_FORMAT_EXTENSIBLE with 'cue ' and 'smpl' chunks after the audio, so
+ * probing a file needs a second read.
+ */
+std::vector<uint8_t> extensibleWavFile(int numFrames) {
+    std::vector<uint8_t> bytes;
+    appendId(bytes, "RIFF");
+    appendInt(bytes, 0, 4);         // filled in at the end
+    appendId(bytes, "WAVE");
+    appendId(bytes, "fmt ");
+    appendInt(bytes, 40, 4);
+    appendInt(bytes, 0xFFFE, 2);    // WAVE_FORMAT_EXTENSIBLE
+    appendInt(bytes, 6, 2);
+    appendInt(bytes, 96000, 4);
+    appendInt(bytes, 96000 * 18, 4);
+    appendInt(bytes, 18, 2);
+    appendInt(bytes, 24, 2);
+    appendInt(bytes, 22, 2);        // extension size
+    appendInt(bytes, 24, 2);        // valid bits
+    appendInt(bytes, 0x3F, 4);      // channel mask
+    const uint8_t kPcmGuid[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                                  0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+    bytes.insert(bytes.end(), kPcmGuid, kPcmGuid + 16);
+    appendId(bytes, "data");
+    appendInt(bytes, numFrames * 18, 4);
+    bytes.resize(bytes.size() + numFrames * 18);
+
+    appendId(bytes, "cue ");
+    appendInt(bytes, 4 + 2 * 24, 4);
+    appendInt(bytes, 2, 4);
+    for (uint32_t id : {1, 2}) {
+        appendInt(bytes, id, 4);
+        appendInt(bytes, 0, 4);     // position in the playlist
+        appendId(bytes, "data");
+        appendInt(bytes, 0, 4);     // chunk start
+        appendInt(bytes, 0, 4);     // block start
+        appendInt(bytes, id * 1000, 4);
+    }
+
+    appendId(bytes, "smpl");
+    appendInt(bytes, 36 + 24, 4);
+    bytes.resize(bytes.size() + 28, 0);
+    appendInt(bytes, 1, 4);         // loops
+    appendInt(bytes, 0, 4);         // sampler data
+    appendInt(bytes, 2, 4);         // cue ID
+    appendInt(bytes, 0, 4);         // forward
+    appendInt(bytes, 2000, 4);
+    appendInt(bytes, 2999, 4);
+    appendInt(bytes, 0, 4);         // fraction
+    appendInt(bytes, 3, 4);         // play count
+
+    uint32_t riffSize = static_cast<uint32_t>(bytes.size() - 8);
+    for (int i = 0; i < 4; i++) {
+        bytes[4 + i] = static_cast<uint8_t>(riffSize >> (i * 8));
+    }
+    return bytes;
+}
+
+// An RF64 header for 6 GB of 16-bit stereo, without the audio.
+std::vector<uint8_t> rf64File() {
+    const uint64_t dataSize = 6000000000;
+    std::vector<uint8_t> bytes;
+    appendId(bytes, "RF64");
+    appendInt(bytes, 0xFFFFFFFF, 4);
+    appendId(bytes, "WAVE");
+    appendId(bytes, "ds64");
+    appendInt(bytes, 28, 4);
+    appendInt(bytes, dataSize + 72, 8);     // RIFF size
+    appendInt(bytes, dataSize, 8);
+    appendInt(bytes, dataSize / 4, 8);      // sample count
+    appendInt(bytes, 0, 4);                 // table entries
+    appendId(bytes, "fmt ");
+    appendInt(bytes, 16, 4);
+    appendInt(bytes, 1, 2);
+    appendInt(bytes, 2, 2);
+    appendInt(bytes, 48000, 4);
+    appendInt(bytes, 48000 * 4, 4);
+    appendInt(bytes, 4, 2);
+    appendInt(bytes, 16, 2);
+    appendId(bytes, "data");
+    appendInt(bytes, 0xFFFFFFFF, 4);
+    bytes.resize(bytes.size() + 1024);
+    return bytes;
+}
+
+void appendBigEndian(std::vector<uint8_t> &bytes, uint64_t value, int numBytes) {
+    for (int i = numBytes - 1; i >= 0; i--) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+/**
+ * A CUESHEET block with two tracks and the lead-out. The second track has a pregap, so its
+ * cue is at index 1 rather than at the start of the track.
+ */
+std::vector<uint8_t> flacCueSheet(uint64_t numFrames) {
+    std::vector<uint8_t> block(395, 0);    // catalog number, lead-in, flags and reserved
+    block.push_back(3);
+    struct Track { uint64_t offset; int number; std::vector<std::pair<uint64_t, int>> indices; };
+    const Track tracks[] = {
+            {0, 1, {{0, 1}}},
+            {88200, 2, {{0, 0}, {588, 1}}},
+            {numFrames, 170, {}}};
+    for (const Track &track : tracks) {
+        appendBigEndian(block, track.offset, 8);
+        block.push_back(static_cast<uint8_t>(track.number));
+        block.resize(block.size() + 26, 0);    // ISRC, flags and reserved
+        block.push_back(static_cast<uint8_t>(track.indices.size()));
+        for (auto &index : track.indices) {
+            appendBigEndian(block, index.first, 8);
+            block.push_back(static_cast<uint8_t>(index.second));
+            block.resize(block.size() + 3, 0);
+        }
+    }
+    return block;
+}
+
+std::vector<uint8_t> flacFile(int numChannels, int bitsPerSample, int id3Size,
+                              bool cueSheet) {
+    flactest::Options options;
+    options.bitsPerSample = bitsPerSample;
+    options.id3Size = id3Size;
+    options.seekTable = true;
+    const size_t numFrames = 100000;
+    std::vector<uint8_t> bytes = flactest::encode(
+            flactest::makeSignal(numChannels, numFrames, bitsPerSample, options.blockSize),
+            options);
+    if (cueSheet) {
+        // After STREAMINFO, which is never the last block here.
+        size_t pos = (id3Size > 0 ? 10 + id3Size : 0) + 4 + 4 + 34;
+        std::vector<uint8_t> block = flacCueSheet(numFrames);
+        std::vector<uint8_t> header = {5};
+        appendBigEndian(header, block.size(), 3);
+        block.insert(block.begin(), header.begin(), header.end());
+        bytes.insert(bytes.begin() + pos, block.begin(), block.end());
+    }
+    return bytes;
+}
+
+/**
+ * Probe the bytes from memory, from a path and from an open file, which must all agree.
+ */
+bool probeAll(const std::vector<uint8_t> &bytes, AudioProbeInfo *info) {
+    bool inMemory = AudioProbe::probeMemory(bytes.data(), bytes.size(), info);
+
+    char path[] = "/tmp/audio_probe_test_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return inMemory;
+    }
+    CHECK(write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()));
+    lseek(fd, 5, SEEK_SET);
+
+    AudioProbeInfo fromFd;
+    CHECK(AudioProbe::probeFile(fd, &fromFd) == inMemory);
+    CHECK(lseek(fd, 0, SEEK_CUR) == 5);
+    AudioProbeInfo fromPath;
+    CHECK(AudioProbe::probeFile(path, &fromPath) == inMemory);
+    close(fd);
+    unlink(path);
+
+    for (const AudioProbeInfo *other : {&fromFd, &fromPath}) {
+        CHECK(other->format == info->format);
+        CHECK(other->sampleRate == info->sampleRate);
+        CHECK(other->numChannels == info->numChannels);
+        CHECK(other->bitsPerSample == info->bitsPerSample);
+        CHECK(other->numFrames == info->numFrames);
+        CHECK(other->channelMask == info->channelMask);
+        CHECK(other->cuePoints.size() == info->cuePoints.size());
+        CHECK(other->loops.size() == info->loops.size());
+    }
+    return inMemory;
+}
+
+void checkWav() {
+    printf("WAV\n");
+    const int numFrames = 2000;     // more than AudioProbe::kReadSize of audio
+    std::vector<uint8_t> bytes = extensibleWavFile(numFrames);
+    AudioProbeInfo info;
+    CHECK(probeAll(bytes, &info));
+    CHECK(info.format == "wav");
+    CHECK(info.encoding == AudioEncoding::PCM_24);
+    CHECK(info.sampleRate == 96000);
+    CHECK(info.numChannels == 6);
+    CHECK(info.bitsPerSample == 24);
+    CHECK(info.numFrames == numFrames);
+    CHECK(info.channelMask == 0x3F);
+    CHECK(info.cuePoints.size() == 2);
+    if (info.cuePoints.size() == 2) {
+        CHECK(info.cuePoints[0].id == 1 && info.cuePoints[0].frame == 1000);
+        CHECK(info.cuePoints[1].id == 2 && info.cuePoints[1].frame == 2000);
+    }
+    CHECK(info.loops.size() == 1);
+    if (info.loops.size() == 1) {
+        const AudioProbeInfo::Loop &loop = info.loops[0];
+        CHECK(loop.cueId == 2 && loop.type == 0 && loop.playCount == 3);
+        CHECK(loop.startFrame == 2000 && loop.endFrame == 2999);
+    }
+
+    MemInputStream stream(bytes.data(), static_cast<int64_t>(bytes.size()));
+    WavStreamReader reader(&stream);
+    CHECK(reader.parse());
+    CHECK(reader.getNumSampleFrames() == info.numFrames);
+    CHECK(reader.getChannelMask() == info.channelMask);
+    CHECK(reader.getSampleEncoding() == info.encoding);
+}
+
+void checkRf64() {
+    printf("RF64\n");
+    AudioProbeInfo info;
+    CHECK(probeAll(rf64File(), &info));
+    CHECK(info.format == "wav");
+    CHECK(info.encoding == AudioEncoding::PCM_16);
+    CHECK(info.numFrames == 1500000000);
+    CHECK(info.getDurationMillis() == 31250000);
+}
+
+void checkFlac() {
+    struct Case { int numChannels; int bitsPerSample; int id3Size; bool cueSheet; };
+    for (const Case &test : {Case{2, 16, 0, false}, Case{6, 24, 5000, true},
+                             Case{1, 12, 0, true}}) {
+        printf("FLAC, %d channels, %d bits\n", test.numChannels, test.bitsPerSample);
+        std::vector<uint8_t> bytes = flacFile(test.numChannels, test.bitsPerSample,
+                                              test.id3Size, test.cueSheet);
+        AudioProbeInfo info;
+        CHECK(probeAll(bytes, &info));
+        CHECK(info.format == "flac");
+        CHECK(info.sampleRate == 44100);
+        CHECK(info.numChannels == test.numChannels);
+        CHECK(info.bitsPerSample == test.bitsPerSample);
+        CHECK(info.numFrames == 100000);
+
+        MemInputStream stream(bytes.data(), static_cast<int64_t>(bytes.size()));
+        FlacStreamReader reader(&stream);
+        CHECK(reader.parse());
+        CHECK(reader.getNumSampleFrames() == info.numFrames);
+        CHECK(reader.getChannelMask() == info.channelMask);
+        CHECK(reader.getSampleEncoding() == info.encoding);
+
+        if (test.cueSheet) {
+            CHECK(info.cuePoints.size() == 2);
+            if (info.cuePoints.size() == 2) {
+                CHECK(info.cuePoints[0].id == 1 && info.cuePoints[0].frame == 0);
+                CHECK(info.cuePoints[1].id == 2 && info.cuePoints[1].frame == 88200 + 588);
+            }
+        } else {
+            CHECK(info.cuePoints.empty());
+        }
+    }
+}
+
+void checkNotAudio() {
+    printf("not audio\n");
+    AudioProbeInfo info;
+    std::vector<uint8_t> mp3 = {'I', 'D', '3', 4, 0, 0, 0, 0, 0, 10};
+    mp3.resize(mp3.size() + 10, 0);
+    mp3.insert(mp3.end(), {0xFF, 0xFB, 0x90, 0x64});
+    mp3.resize(mp3.size() + 400, 0);
+    CHECK(!probeAll(mp3, &info));
+
+    // Cut off in STREAMINFO.
+    std::vector<uint8_t> flac = flacFile(2, 16, 0, false);
+    flac.resize(20);
+    CHECK(!probeAll(flac, &info));
+
+    std::vector<uint8_t> wav = extensibleWavFile(10);
+    memcpy(&wav[12], "junk", 4);    // no 'fmt '
+    CHECK(!probeAll(wav, &info));
+
+    CHECK(!AudioProbe::probeFile("/nonexistent/audio_probe_test.wav", &info));
+}
+
+} // namespace
+
+int main() {
+    checkWav();
+    checkRf64();
+    checkFlac();
+    checkNotAudio();
+
+    if (sFailures > 0) {
+        printf("%d checks failed\n", sFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Encodes generated audio with FlacTestWriter.h and checks that FlacStreamReader gives
+ * back exactly the same samples, from the start and after seeking, for 8 to 24 bits and
+ * 1 to 8 channels.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "FlacTestWriter.h"
+#include "flac/FlacStreamReader.h"
+#include "stream/MemInputStream.h"
+
+using namespace parselib;
+
+namespace {
+
+int sFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            sFailures++; \
+        } \
+    } while (false)
+
+// Counts the bytes read, to tell whether a seek used the SEEKTABLE.
+class CountingInputStream : public MemInputStream {
+public:
+    CountingInputStream(std::vector<uint8_t> &bytes)
+            : MemInputStream(bytes.data(), static_cast<int64_t>(bytes.size())) {}
+
+    int32_t read(void *buff, int32_t numBytes) override {
+        int32_t numRead = MemInputStream::read(buff, numBytes);
+        mBytesRead += numRead > 0 ? numRead : 0;
+        return numRead;
+    }
+
+    int64_t mBytesRead = 0;
+};
+
+// Compare numFrames decoded from the current position with the source, sample for sample.
+bool matches(FlacStreamReader &reader, const std::vector<std::vector<int32_t>> &channels,
+             int bitsPerSample, int64_t firstFrame, int numFrames) {
+    const int numChannels = static_cast<int>(channels.size());
+    const float scale = 1.0f / static_cast<float>(1 << (bitsPerSample - 1));
+    std::vector<float> buffer(numFrames * numChannels);
+    int numRead = reader.getDataFloat(buffer.data(), numFrames);
+    if (numRead != numFrames) {
+        fprintf(stderr, "read %d of %d frames at %lld\n", numRead, numFrames,
+                static_cast<long long>(firstFrame));
+        return false;
+    }
+    for (int i = 0; i < numFrames; i++) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            float expected = static_cast<float>(channels[channel][firstFrame + i]) * scale;
+            if (buffer[i * numChannels + channel] != expected) {
+                fprintf(stderr, "frame %lld channel %d: %f, expected %f\n",
+                        static_cast<long long>(firstFrame + i), channel,
+                        buffer[i * numChannels + channel], expected);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void checkRoundTrip(int numChannels, int bitsPerSample, const flactest::Options &baseOptions) {
+    printf("%d channels, %d bits%s%s\n", numChannels, bitsPerSample,
+           baseOptions.seekTable ? ", SEEKTABLE" : "", baseOptions.id3Size > 0 ? ", ID3" : "");
+    flactest::Options options = baseOptions;
+    options.bitsPerSample = bitsPerSample;
+    // Not a whole number of blocks, so the last one is short.
+    const size_t numFrames = 40 * options.blockSize + 300;
+    auto channels = flactest::makeSignal(numChannels, numFrames, bitsPerSample,
+                                         options.blockSize);
+    std::vector<uint8_t> bytes = flactest::encode(channels, options);
+
+    MemInputStream stream(bytes.data(), static_cast<int64_t>(bytes.size()));
+    FlacStreamReader reader(&stream);
+    CHECK(reader.parse());
+    CHECK(reader.getSampleRate() == options.sampleRate);
+    CHECK(reader.getNumChannels() == numChannels);
+    CHECK(reader.getBitsPerSample() == bitsPerSample);
+    CHECK(reader.getNumSampleFrames() == static_cast<int64_t>(numFrames));
+
+    // Odd sized reads, so they straddle the frames.
+    size_t position = 0;
+    while (position < numFrames) {
+        int count = static_cast<int>(std::min<size_t>(777, numFrames - position));
+        CHECK(matches(reader, channels, bitsPerSample, position, count));
+        position += count;
+    }
+
+    // Past the end there is only silence.
+    float tail[16] = {1.0f};
+    CHECK(reader.getDataFloat(tail, 1) == 0);
+
+    if (bitsPerSample <= 16) {
+        reader.seekToFrame(0);
+        std::vector<int16_t> buffer(options.blockSize * numChannels);
+        CHECK(reader.getData16(buffer.data(), options.blockSize) == options.blockSize);
+        bool same = true;
+        for (int i = 0; i < options.blockSize * numChannels; i++) {
+            int32_t sample = channels[i % numChannels][i / numChannels];
+            same = same
+                    && buffer[i] == static_cast<int16_t>(sample * (1 << (16 - bitsPerSample)));
+        }
+        CHECK(same);
+    }
+
+    std::mt19937 random(numChannels * 100 + bitsPerSample);
+    for (int i = 0; i < 50; i++) {
+        int64_t frame = random() % (numFrames - 100);
+        CHECK(reader.seekToFrame(frame));
+        CHECK(matches(reader, channels, bitsPerSample, frame, 100));
+    }
+    CHECK(!reader.seekToFrame(numFrames + 1));
+}
+
+// With a SEEKTABLE, a seek near the end reads a fraction of the file, without it all of it.
+void checkSeekTableIsUsed() {
+    printf("seek cost\n");
+    auto channels = flactest::makeSignal(2, 200 * 1024, 16, 1024);
+    const int64_t target = 199 * 1024 + 10;
+    for (bool seekTable : {false, true}) {
+        flactest::Options options;
+        options.seekTable = seekTable;
+        std::vector<uint8_t> bytes = flactest::encode(channels, options);
+        CountingInputStream stream(bytes);
+        FlacStreamReader reader(&stream);
+        CHECK(reader.parse());
+        stream.mBytesRead = 0;
+        CHECK(reader.seekToFrame(target));
+        CHECK(matches(reader, channels, 16, target, 500));
+        if (seekTable) {
+            CHECK(stream.mBytesRead < static_cast<int64_t>(bytes.size()) / 10);
+        } else {
+            CHECK(stream.mBytesRead > static_cast<int64_t>(bytes.size()) / 2);
+        }
+    }
+}
+
+// A damaged frame must be refused, not decoded into noise.
+void checkCorruptFrame() {
+    printf("corrupt frame\n");
+    auto channels = flactest::makeSignal(1, 4096, 16, 1024);
+    flactest::Options options;
+    std::vector<uint8_t> bytes = flactest::encode(channels, options);
+    bytes[bytes.size() - 100] ^= 0x10;      // in one of the last frames
+    MemInputStream stream(bytes.data(), static_cast<int64_t>(bytes.size()));
+    FlacStreamReader reader(&stream);
+    CHECK(reader.parse());
+    std::vector<float> buffer(4096);
+    CHECK(reader.getDataFloat(buffer.data(), 4096) < 4096);
+}
+
+} // namespace
+
+int main() {
+    flactest::Options plain;
+    flactest::Options seekable;
+    seekable.seekTable = true;
+    flactest::Options tagged;
+    tagged.seekTable = true;
+    tagged.id3Size = 1000;
+    tagged.blockSize = 4096;
+
+    checkRoundTrip(1, 8, plain);
+    checkRoundTrip(1, 16, plain);
+    checkRoundTrip(2, 16, plain);
+    checkRoundTrip(2, 16, seekable);
+    checkRoundTrip(2, 24, seekable);
+    checkRoundTrip(2, 20, tagged);
+    checkRoundTrip(3, 12, plain);
+    checkRoundTrip(6, 16, tagged);
+    checkRoundTrip(8, 24, seekable);
+    checkSeekTableIsUsed();
+    checkCorruptFrame();
+
+    if (sFailures > 0) {
+        printf("%d checks failed\n", sFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,410 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _TEST_FLACTESTWRITER_H_
+#define _TEST_FLACTESTWRITER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * A FLAC encoder for the host tests, written for coverage rather than compression.
+ * The frames take turns at every subframe type (CONSTANT when a block allows it,
+ * VERBATIM, FIXED of order 0 to 4 and LPC of order 1 to 8), every stereo decorrelation,
+ * both Rice codings and escaped partitions. Blocks whose samples share trailing zero
+ * bits are written with wasted bits.
+ */
+namespace flactest {
+
+struct Options {
+    int sampleRate = 44100;
+    int bitsPerSample = 16;
+    int blockSize = 1024;
+    bool seekTable = false;     // a point every 4 frames, plus a placeholder
+    int id3Size = 0;            // bytes of ID3v2 tag in front of the stream, 0 for none
+};
+
+class BitWriter {
+public:
+    void writeBits(uint64_t value, int numBits) {
+        for (int bit = numBits - 1; bit >= 0; bit--) {
+            mCurrent = static_cast<uint8_t>((mCurrent << 1) | ((value >> bit) & 1));
+            if (++mNumBits == 8) {
+                bytes.push_back(mCurrent);
+                mCurrent = 0;
+                mNumBits = 0;
+            }
+        }
+    }
+
+    void writeSigned(int64_t value, int numBits) {
+        writeBits(static_cast<uint64_t>(value) & ((uint64_t(1) << numBits) - 1), numBits);
+    }
+
+    void writeUnary(uint32_t zeros) {
+        for (uint32_t i = 0; i < zeros; i++) {
+            writeBits(0, 1);
+        }
+        writeBits(1, 1);
+    }
+
+    void alignToByte() {
+        while (mNumBits != 0) {
+            writeBits(0, 1);
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+
+private:
+    uint8_t mCurrent = 0;
+    int mNumBits = 0;
+};
+
+inline uint8_t crc8(const uint8_t *data, size_t numBytes) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < numBytes; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+inline uint16_t crc16(const uint8_t *data, size_t numBytes) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < numBytes; i++) {
+        crc ^= static_cast<uint16_t>(data[i] << 8);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+inline int signedBitsFor(int64_t value) {
+    int bits = 1;
+    while (value < -(int64_t(1) << (bits - 1)) || value >= (int64_t(1) << (bits - 1))) {
+        bits++;
+    }
+    return bits;
+}
+
+// Rice coded partitions of the residual, escaping the first partition of some frames.
+inline void writeResidual(BitWriter &writer, const std::vector<int64_t> &residual,
+                          int blockSize, int order, int frameIndex) {
+    bool rice2 = frameIndex % 3 == 2;
+    int parameterBits = rice2 ? 5 : 4;
+    int escape = (1 << parameterBits) - 1;
+    int partitionOrder = 0;
+    while (partitionOrder < 3 && blockSize % (2 << partitionOrder) == 0
+            && (blockSize >> (partitionOrder + 1)) >= order) {
+        partitionOrder++;
+    }
+    writer.writeBits(rice2 ? 1 : 0, 2);
+    writer.writeBits(partitionOrder, 4);
+    int partitionSize = blockSize >> partitionOrder;
+    size_t index = 0;
+    for (int partition = 0; partition < (1 << partitionOrder); partition++) {
+        int count = partition == 0 ? partitionSize - order : partitionSize;
+        if (partition == 0 && frameIndex % 5 == 1) {
+            int bits = 1;
+            for (int i = 0; i < count; i++) {
+                bits = std::max(bits, signedBitsFor(residual[index + i]));
+            }
+            writer.writeBits(escape, parameterBits);
+            writer.writeBits(bits, 5);
+            for (int i = 0; i < count; i++) {
+                writer.writeSigned(residual[index++], bits);
+            }
+            continue;
+        }
+        uint64_t sum = 0;
+        for (int i = 0; i < count; i++) {
+            sum += std::llabs(residual[index + i]);
+        }
+        uint64_t mean = count > 0 ? sum / count : 0;
+        int parameter = 0;
+        while (parameter < escape - 1 && (mean >> (parameter + 1)) > 0) {
+            parameter++;
+        }
+        writer.writeBits(parameter, parameterBits);
+        for (int i = 0; i < count; i++) {
+            int64_t value = residual[index++];
+            uint64_t folded = value >= 0 ? uint64_t(value) << 1 : ((uint64_t(-value) << 1) - 1);
+            writer.writeUnary(static_cast<uint32_t>(folded >> parameter));
+            writer.writeBits(folded, parameter);
+        }
+    }
+}
+
+inline void writeSubframe(BitWriter &writer, const std::vector<int64_t> &samples,
+                          int bitsPerSample, int frameIndex) {
+    const int blockSize = static_cast<int>(samples.size());
+    bool constant = std::all_of(samples.begin(), samples.end(),
+                                [&](int64_t s) { return s == samples[0]; });
+    int wastedBits = 0;
+    if (!constant) {
+        int64_t allBits = 0;
+        for (int64_t s : samples) {
+            allBits |= s;
+        }
+        while (wastedBits < bitsPerSample - 1 && ((allBits >> wastedBits) & 1) == 0) {
+            wastedBits++;
+        }
+    }
+    std::vector<int64_t> shifted(samples);
+    for (int64_t &s : shifted) {
+        s >>= wastedBits;
+    }
+    const int bits = bitsPerSample - wastedBits;
+
+    int kind = frameIndex % 3;  // 0 FIXED, 1 LPC, 2 VERBATIM
+    int fixedOrder = std::min((frameIndex / 3) % 5, blockSize);
+    int lpcOrder = std::min(1 + (frameIndex / 3) % 8, blockSize - 1);
+    if (lpcOrder < 1) {
+        kind = 2;
+    }
+    int type = constant ? 0 : kind == 2 ? 1 : kind == 0 ? 8 + fixedOrder : 32 + lpcOrder - 1;
+    writer.writeBits(0, 1);
+    writer.writeBits(type, 6);
+    writer.writeBits(wastedBits > 0 ? 1 : 0, 1);
+    if (wastedBits > 0) {
+        writer.writeUnary(wastedBits - 1);
+    }
+
+    if (constant) {
+        writer.writeSigned(samples[0], bitsPerSample);
+    } else if (kind == 2) {
+        for (int64_t s : shifted) {
+            writer.writeSigned(s, bits);
+        }
+    } else if (kind == 0) {
+        for (int i = 0; i < fixedOrder; i++) {
+            writer.writeSigned(shifted[i], bits);
+        }
+        static const int kFixed[5][4] = {
+                {0, 0, 0, 0}, {1, 0, 0, 0}, {2, -1, 0, 0}, {3, -3, 1, 0}, {4, -6, 4, -1}};
+        std::vector<int64_t> residual;
+        for (int i = fixedOrder; i < blockSize; i++) {
+            int64_t prediction = 0;
+            for (int j = 0; j < fixedOrder; j++) {
+                prediction += kFixed[fixedOrder][j] * shifted[i - 1 - j];
+            }
+            residual.push_back(shifted[i] - prediction);
+        }
+        writeResidual(writer, residual, blockSize, fixedOrder, frameIndex);
+    } else {
+        constexpr int kPrecision = 12;
+        constexpr int kShift = 10;
+        std::vector<int> coefficients(lpcOrder);
+        for (int j = 0; j < lpcOrder; j++) {
+            coefficients[j] = j == 0 ? 1900 : (j % 2 ? -300 : 150) / j;
+        }
+        for (int i = 0; i < lpcOrder; i++) {
+            writer.writeSigned(shifted[i], bits);
+        }
+        writer.writeBits(kPrecision - 1, 4);
+        writer.writeSigned(kShift, 5);
+        for (int c : coefficients) {
+            writer.writeSigned(c, kPrecision);
+        }
+        std::vector<int64_t> residual;
+        for (int i = lpcOrder; i < blockSize; i++) {
+            int64_t sum = 0;
+            for (int j = 0; j < lpcOrder; j++) {
+                sum += coefficients[j] * shifted[i - 1 - j];
+            }
+            residual.push_back(shifted[i] - (sum >> kShift));
+        }
+        writeResidual(writer, residual, blockSize, lpcOrder, frameIndex);
+    }
+}
+
+inline void writeFrameNumber(std::vector<uint8_t> &bytes, uint64_t number) {
+    if (number < 0x80) {
+        bytes.push_back(static_cast<uint8_t>(number));
+        return;
+    }
+    int numExtra = 1;
+    while (number >= (uint64_t(1) << (5 * numExtra + 6))) {
+        numExtra++;
+    }
+    bytes.push_back(static_cast<uint8_t>((0xFF00 >> (numExtra + 1))
+            | (number >> (6 * numExtra))));
+    for (int i = numExtra - 1; i >= 0; i--) {
+        bytes.push_back(static_cast<uint8_t>(0x80 | ((number >> (6 * i)) & 0x3F)));
+    }
+}
+
+inline std::vector<uint8_t> encodeFrame(const std::vector<std::vector<int32_t>> &channels,
+                                        size_t start, int blockSize, int frameIndex,
+                                        const Options &options) {
+    const int numChannels = static_cast<int>(channels.size());
+    // Independent, left/side, right/side and mid/side in turn.
+    int stereoMode = numChannels == 2 ? frameIndex % 4 : 0;
+    int assignment = stereoMode == 0 ? numChannels - 1 : 7 + stereoMode;
+
+    std::vector<uint8_t> header = {0xFF, 0xF8, 0x70, static_cast<uint8_t>(assignment << 4)};
+    writeFrameNumber(header, frameIndex);
+    header.push_back(static_cast<uint8_t>((blockSize - 1) >> 8));
+    header.push_back(static_cast<uint8_t>(blockSize - 1));
+    header.push_back(crc8(header.data(), header.size()));
+
+    BitWriter writer;
+    writer.bytes = header;
+    std::vector<std::vector<int64_t>> subframes(numChannels, std::vector<int64_t>(blockSize));
+    for (int i = 0; i < blockSize; i++) {
+        for (int channel = 0; channel < numChannels; channel++) {
+            subframes[channel][i] = channels[channel][start + i];
+        }
+        if (stereoMode != 0) {
+            int64_t left = channels[0][start + i];
+            int64_t right = channels[1][start + i];
+            int64_t side = left - right;
+            if (stereoMode == 1) {
+                subframes[1][i] = side;
+            } else if (stereoMode == 2) {
+                subframes[0][i] = side;
+            } else {
+                subframes[0][i] = (left + right) >> 1;
+                subframes[1][i] = side;
+            }
+        }
+    }
+    for (int channel = 0; channel < numChannels; channel++) {
+        bool isSide = (stereoMode == 1 && channel == 1) || (stereoMode == 2 && channel == 0)
+                || (stereoMode == 3 && channel == 1);
+        writeSubframe(writer, subframes[channel], options.bitsPerSample + (isSide ? 1 : 0),
+                      frameIndex);
+    }
+    writer.alignToByte();
+    uint16_t crc = crc16(writer.bytes.data(), writer.bytes.size());
+    writer.writeBits(crc, 16);
+    return writer.bytes;
+}
+
+inline void appendBigEndian(std::vector<uint8_t> &bytes, uint64_t value, int numBytes) {
+    for (int i = numBytes - 1; i >= 0; i--) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+/**
+ * Encode non-interleaved samples, one vector per channel, as a FLAC stream.
+ */
+inline std::vector<uint8_t> encode(const std::vector<std::vector<int32_t>> &channels,
+                                   const Options &options) {
+    const int numChannels = static_cast<int>(channels.size());
+    const size_t numFrames = channels[0].size();
+
+    std::vector<uint8_t> audio;
+    std::vector<std::pair<uint64_t, uint64_t>> seekPoints;
+    int frameIndex = 0;
+    for (size_t start = 0; start < numFrames; start += options.blockSize, frameIndex++) {
+        int blockSize = static_cast<int>(std::min<size_t>(options.blockSize, numFrames - start));
+        if (frameIndex % 4 == 0) {
+            seekPoints.push_back({start, audio.size()});
+        }
+        std::vector<uint8_t> frame = encodeFrame(channels, start, blockSize, frameIndex, options);
+        audio.insert(audio.end(), frame.begin(), frame.end());
+    }
+
+    std::vector<uint8_t> bytes;
+    if (options.id3Size > 0) {
+        bytes = {'I', 'D', '3', 4, 0, 0};
+        for (int shift = 21; shift >= 0; shift -= 7) {
+            bytes.push_back(static_cast<uint8_t>((options.id3Size >> shift) & 0x7F));
+        }
+        bytes.resize(bytes.size() + options.id3Size, 0);
+    }
+    bytes.insert(bytes.end(), {'f', 'L', 'a', 'C'});
+
+    bytes.push_back(0);     // STREAMINFO
+    appendBigEndian(bytes, 34, 3);
+    BitWriter info;
+    info.writeBits(options.blockSize, 16);
+    info.writeBits(options.blockSize, 16);
+    info.writeBits(0, 24);  // frame sizes not known
+    info.writeBits(0, 24);
+    info.writeBits(options.sampleRate, 20);
+    info.writeBits(numChannels - 1, 3);
+    info.writeBits(options.bitsPerSample - 1, 5);
+    info.writeBits(numFrames, 36);
+    bytes.insert(bytes.end(), info.bytes.begin(), info.bytes.end());
+    bytes.resize(bytes.size() + 16, 0);     // no MD5
+
+    if (options.seekTable) {
+        bytes.push_back(3);
+        appendBigEndian(bytes, 18 * (seekPoints.size() + 1), 3);
+        for (auto &point : seekPoints) {
+            appendBigEndian(bytes, point.first, 8);
+            appendBigEndian(bytes, point.second, 8);
+            appendBigEndian(bytes, options.blockSize, 2);
+        }
+        appendBigEndian(bytes, UINT64_MAX, 8);  // placeholder
+        appendBigEndian(bytes, 0, 8);
+        appendBigEndian(bytes, 0, 2);
+    }
+    bytes.push_back(0x80 | 1);  // the last block is PADDING
+    appendBigEndian(bytes, 16, 3);
+    bytes.resize(bytes.size() + 16, 0);
+
+    bytes.insert(bytes.end(), audio.begin(), audio.end());
+    return bytes;
+}
+
+/**
+ * Sines of a different pitch on each channel with some noise. Some blocks are silent, some
+ * hold a DC value and some have their low bits cleared, so the encoder writes CONSTANT
+ * subframes and wasted bits as well.
+ */
+inline std::vector<std::vector<int32_t>> makeSignal(int numChannels, size_t numFrames,
+                                                    int bitsPerSample, int blockSize) {
+    const int32_t maxValue = (1 << (bitsPerSample - 1)) - 1;
+    const int32_t minValue = -(1 << (bitsPerSample - 1));
+    uint32_t random = 12345;
+    std::vector<std::vector<int32_t>> channels(numChannels, std::vector<int32_t>(numFrames));
+    for (int channel = 0; channel < numChannels; channel++) {
+        for (size_t i = 0; i < numFrames; i++) {
+            random = random * 1664525 + 1013904223;
+            int block = static_cast<int>(i / blockSize);
+            double sine = std::sin(i * 0.01 * (channel + 1));
+            int32_t noise = static_cast<int32_t>(random >> 16) % std::max(2, maxValue >> 6);
+            int64_t value = static_cast<int64_t>(0.8 * maxValue * sine) + noise;
+            if (block % 7 == 3) {
+                value = 0;
+            } else if (block % 7 == 5) {
+                value = maxValue / 3 * (channel % 2 ? -1 : 1);
+            } else if (block % 7 == 6) {
+                value &= ~int64_t(3);
+            } else if (block % 11 == 9) {
+                value = (i % 2) ? maxValue : minValue;  // full scale
+            }
+            channels[channel][i] = static_cast<int32_t>(
+                    std::max<int64_t>(minValue, std::min<int64_t>(maxValue, value)));
+        }
+    }
+    return channels;
+}
+
+} // namespace flactest
+
+#endif // _TEST_FLACTESTWRITER_H_
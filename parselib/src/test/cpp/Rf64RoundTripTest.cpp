@@ -0,0 +1,294 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Writes WAV files of more than 4 GB with WavStreamWriter and reads them back with
+ * WavStreamReader and AudioProbe, checking the 64-bit sizes and positions on the way.
+ * The silent parts of the files are left as holes, so on a file system with sparse files
+ * the test needs a few MB of disk and runs in seconds.
+ *
+ * Usage: rf64_round_trip_test [directory for the files, /tmp by default]
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "probe/AudioProbe.h"
+#include "stream/FileInputStream.h"
+#include "wav/WavStreamReader.h"
+#include "wav/WavStreamWriter.h"
+
+using namespace parselib;
+
+namespace {
+
+int sFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            sFailures++; \
+        } \
+    } while (false)
+
+constexpr int kNumChannels = 8;
+constexpr int kSampleRate = 48000;
+constexpr int64_t kBytesPerFrame = kNumChannels * sizeof(float);
+constexpr int64_t kFourGB = int64_t(1) << 32;
+
+/**
+ * An unbuffered stream buffer over a file that seeks over blocks of zeros instead of
+ * writing them, which leaves holes in the file.
+ */
+class SparseFileBuffer : public std::streambuf {
+public:
+    explicit SparseFileBuffer(int fd) : mFd(fd) {}
+
+protected:
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        char value = traits_type::to_char_type(c);
+        return ::write(mFd, &value, 1) == 1 ? c : traits_type::eof();
+    }
+
+    std::streamsize xsputn(const char *data, std::streamsize numBytes) override {
+        bool isZero = true;
+        for (std::streamsize i = 0; i < numBytes && isZero; i++) {
+            isZero = data[i] == 0;
+        }
+        if (isZero) {
+            return lseek(mFd, numBytes, SEEK_CUR) < 0 ? 0 : numBytes;
+        }
+        std::streamsize written = 0;
+        while (written < numBytes) {
+            ssize_t result = ::write(mFd, data + written, numBytes - written);
+            if (result <= 0) {
+                break;
+            }
+            written += result;
+        }
+        return written;
+    }
+
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction,
+                     std::ios_base::openmode) override {
+        int whence = direction == std::ios_base::beg ? SEEK_SET
+                     : direction == std::ios_base::cur ? SEEK_CUR : SEEK_END;
+        off_t position = lseek(mFd, offset, whence);
+        return position < 0 ? pos_type(off_type(-1)) : pos_type(position);
+    }
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode mode) override {
+        return seekoff(off_type(position), std::ios_base::beg, mode);
+    }
+
+private:
+    int mFd;
+};
+
+// The value of the first sample of a frame that is not silent.
+float markerFor(int64_t frame) {
+    return static_cast<float>(frame % 1000 + 1) / 1024.0f;
+}
+
+/**
+ * Write numFrames of silence with markers at some frames, then read the markers back.
+ */
+void checkRoundTrip(const std::string &path, int64_t numFrames, bool expectRF64) {
+    printf("%s: %lld frames, %.2f GB\n", path.c_str(), static_cast<long long>(numFrames),
+           numFrames * kBytesPerFrame / 1e9);
+    // The first frame, the first one past 4 GB of audio if there is one, and the last.
+    std::vector<int64_t> markers = {0, numFrames - 1};
+    if (kFourGB / kBytesPerFrame + 1 < numFrames - 1) {
+        markers.push_back(kFourGB / kBytesPerFrame + 1);
+    }
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    {
+        SparseFileBuffer buffer(fd);
+        std::ostream stream(&buffer);
+        WavStreamWriter writer(stream);
+        CHECK(writer.writeHeader(kNumChannels, kSampleRate, 32,
+                                 WavFmtChunkHeader::ENCODING_IEEE_FLOAT));
+        constexpr int64_t kBlockFrames = 1 << 16;
+        std::vector<float> block(kBlockFrames * kNumChannels);
+        for (int64_t frame = 0; frame < numFrames; frame += kBlockFrames) {
+            int64_t blockFrames = std::min(kBlockFrames, numFrames - frame);
+            std::fill(block.begin(), block.end(), 0.0f);
+            for (int64_t marker : markers) {
+                if (marker >= frame && marker < frame + blockFrames) {
+                    block[(marker - frame) * kNumChannels] = markerFor(marker);
+                }
+            }
+            CHECK(writer.write(block.data(), blockFrames * kBytesPerFrame));
+        }
+        CHECK(writer.finish());
+        CHECK(writer.isRF64() == expectRF64);
+    }
+
+    struct stat status;
+    CHECK(fstat(fd, &status) == 0);
+    printf("  size %lld bytes, %lld on disk\n", static_cast<long long>(status.st_size),
+           static_cast<long long>(status.st_blocks) * 512);
+
+    lseek(fd, 0, SEEK_SET);
+    FileInputStream stream(fd);
+    WavStreamReader reader(&stream);
+    CHECK(reader.parse());
+    CHECK(reader.getNumSampleFrames() == numFrames);
+    CHECK(reader.getNumChannels() == kNumChannels);
+    CHECK(reader.getSampleRate() == kSampleRate);
+    float frame[kNumChannels];
+    for (int64_t marker : markers) {
+        CHECK(reader.seekToFrame(marker));
+        CHECK(reader.getDataFloat(frame, 1) == 1);
+        CHECK(frame[0] == markerFor(marker));
+    }
+    // A frame that is in a hole.
+    CHECK(reader.seekToFrame(numFrames / 2 + 7));
+    CHECK(reader.getDataFloat(frame, 1) == 1);
+    CHECK(frame[0] == 0.0f);
+
+    AudioProbeInfo info;
+    CHECK(AudioProbe::probeFile(fd, &info));
+    CHECK(info.format == "wav");
+    CHECK(info.numFrames == numFrames);
+    CHECK(info.numChannels == kNumChannels);
+    close(fd);
+    unlink(path.c_str());
+}
+
+void appendInt(std::vector<uint8_t> &bytes, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        bytes.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void appendId(std::vector<uint8_t> &bytes, const char *id) {
+    bytes.insert(bytes.end(), id, id + 4);
+}
+
+/**
+ * A BW64 file with a 5 GB chunk before the audio, whose size is only in the 'ds64' table.
+ * WavStreamWriter never writes one of those.
+ */
+void checkDs64Table(const std::string &path) {
+    printf("%s: 5 GB 'axml' chunk before 6 GB of audio\n", path.c_str());
+    const int64_t numFrames = (int64_t(6) << 30) / kBytesPerFrame;
+    const int64_t dataSize = numFrames * kBytesPerFrame;
+    const int64_t axmlSize = int64_t(5) << 30;
+
+    std::vector<uint8_t> header;
+    appendId(header, "BW64");
+    appendInt(header, 0xFFFFFFFF, 4);
+    appendId(header, "WAVE");
+    appendId(header, "ds64");
+    appendInt(header, WavDs64ChunkHeader::kFixedSize + 12, 4);
+    size_t riffSizePos = header.size();
+    appendInt(header, 0, 8);    // RIFF size, filled in below
+    appendInt(header, dataSize, 8);
+    appendInt(header, numFrames, 8);
+    appendInt(header, 1, 4);    // table entries
+    appendId(header, "axml");
+    appendInt(header, axmlSize, 8);
+    appendId(header, "fmt ");
+    appendInt(header, 16, 4);
+    appendInt(header, WavFmtChunkHeader::ENCODING_IEEE_FLOAT, 2);
+    appendInt(header, kNumChannels, 2);
+    appendInt(header, kSampleRate, 4);
+    appendInt(header, kSampleRate * kBytesPerFrame, 4);
+    appendInt(header, kBytesPerFrame, 2);
+    appendInt(header, 32, 2);
+    appendId(header, "axml");
+    appendInt(header, 0xFFFFFFFF, 4);
+    int64_t axmlPos = header.size();
+    int64_t dataPos = axmlPos + axmlSize;
+    int64_t fileSize = dataPos + 8 + dataSize;
+    uint64_t riffSize = fileSize - 8;
+    memcpy(&header[riffSizePos], &riffSize, sizeof(riffSize));
+
+    std::vector<uint8_t> dataHeader;
+    appendId(dataHeader, "data");
+    appendInt(dataHeader, 0xFFFFFFFF, 4);
+    float first[kNumChannels] = {0.25f};
+    float last[kNumChannels] = {-0.125f};
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    CHECK(pwrite(fd, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size()));
+    CHECK(pwrite(fd, dataHeader.data(), dataHeader.size(), dataPos) == 8);
+    CHECK(pwrite(fd, first, sizeof(first), dataPos + 8) == sizeof(first));
+    CHECK(pwrite(fd, last, sizeof(last), fileSize - sizeof(last)) == sizeof(last));
+
+    FileInputStream stream(fd);
+    WavStreamReader reader(&stream);
+    CHECK(reader.parse());
+    CHECK(reader.getNumSampleFrames() == numFrames);
+    const WavStreamReader::ChunkLocation *axml = reader.findChunk(makeRiffID('a', 'x', 'm', 'l'));
+    CHECK(axml != nullptr && axml->mChunkSize == axmlSize);
+    float frame[kNumChannels];
+    CHECK(reader.seekToFrame(0));
+    CHECK(reader.getDataFloat(frame, 1) == 1 && frame[0] == first[0]);
+    CHECK(reader.seekToFrame(numFrames - 1));
+    CHECK(reader.getDataFloat(frame, 1) == 1 && frame[0] == last[0]);
+
+    AudioProbeInfo info;
+    CHECK(AudioProbe::probeFile(fd, &info));
+    CHECK(info.numFrames == numFrames);
+    close(fd);
+    unlink(path.c_str());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string directory = argc > 1 ? argv[1] : "/tmp";
+
+    checkRoundTrip(directory + "/rf64_small.wav", 1000, false);
+    // Either side of the largest RIFF size. WavStreamWriter starts the audio 80 bytes in.
+    int64_t largestRiffFrames = (int64_t(0xFFFFFFFF) - (80 - 8)) / kBytesPerFrame;
+    checkRoundTrip(directory + "/rf64_riff.wav", largestRiffFrames, false);
+    checkRoundTrip(directory + "/rf64_limit.wav", largestRiffFrames + 1, true);
+    checkRoundTrip(directory + "/rf64_big.wav", (int64_t(5) << 30) / kBytesPerFrame + 12345,
+                   true);
+    checkDs64Table(directory + "/rf64_table.wav");
+
+    if (sFailures > 0) {
+        printf("%d checks failed\n", sFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Feeds WAV files with impossible chunk sizes to WavStreamReader and AudioProbe. They must
+ * stop at the bad chunk instead of stepping to a position past the end of the file or
+ * overflowing it. Build with -fsanitize=address,undefined to see the difference.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "probe/AudioProbe.h"
+#include "stream/FileInputStream.h"
+#include "stream/MemInputStream.h"
+#include "wav/WavStreamReader.h"
+
+using namespace parselib;
+
+namespace {
+
+int sFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            sFailures++; \
+        } \
+    } while (false)
+
+void appendInt(std::vector<uint8_t> &bytes, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        bytes.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void appendId(std::vector<uint8_t> &bytes, const char *id) {
+    bytes.insert(bytes.end(), id, id + 4);
+}
+
+void appendFmt(std::vector<uint8_t> &bytes) {
+    appendId(bytes, "fmt ");
+    appendInt(bytes, 16, 4);
+    appendInt(bytes, 1, 2);         // PCM
+    appendInt(bytes, 2, 2);         // channels
+    appendInt(bytes, 48000, 4);
+    appendInt(bytes, 48000 * 4, 4);
+    appendInt(bytes, 4, 2);
+    appendInt(bytes, 16, 2);
+}
+
+/**
+ * A 100 byte RF64 file whose 'ds64' table gives a 'JUNK' chunk a size of nearly 2^63.
+ */
+std::vector<uint8_t> hugeTableEntryFile() {
+    std::vector<uint8_t> bytes;
+    appendId(bytes, "RF64");
+    appendInt(bytes, 0xFFFFFFFF, 4);
+    appendId(bytes, "WAVE");
+    appendId(bytes, "ds64");
+    appendInt(bytes, WavDs64ChunkHeader::kFixedSize + 12, 4);
+    appendInt(bytes, 92, 8);        // RIFF size
+    appendInt(bytes, 0, 8);         // data size
+    appendInt(bytes, 0, 8);         // sample count
+    appendInt(bytes, 1, 4);         // table entries
+    appendId(bytes, "JUNK");
+    appendInt(bytes, 0x7FFFFFFFFFFFFFF0, 8);
+    appendId(bytes, "JUNK");
+    appendInt(bytes, 0xFFFFFFFF, 4);
+    bytes.resize(100);
+    return bytes;
+}
+
+/**
+ * An RF64 file whose 'ds64' gives the 'data' chunk the largest possible size.
+ */
+std::vector<uint8_t> hugeDataSizeFile() {
+    std::vector<uint8_t> bytes;
+    appendId(bytes, "RF64");
+    appendInt(bytes, 0xFFFFFFFF, 4);
+    appendId(bytes, "WAVE");
+    appendId(bytes, "ds64");
+    appendInt(bytes, WavDs64ChunkHeader::kFixedSize, 4);
+    appendInt(bytes, INT64_MAX - 8, 8);     // RIFF size
+    appendInt(bytes, INT64_MAX, 8);         // data size
+    appendInt(bytes, 0, 8);                 // sample count
+    appendInt(bytes, 0, 4);                 // table entries
+    appendFmt(bytes);
+    appendId(bytes, "data");
+    appendInt(bytes, 0xFFFFFFFF, 4);
+    bytes.resize(bytes.size() + 64);
+    return bytes;
+}
+
+// Parse from memory, where WavStreamReader walks the view, and from a file.
+void checkParse(const char *name, const std::vector<uint8_t> &bytes, bool expectParsed) {
+    printf("%s\n", name);
+    MemInputStream memStream(const_cast<uint8_t *>(bytes.data()),
+                             static_cast<int64_t>(bytes.size()));
+    WavStreamReader memReader(&memStream);
+    CHECK(memReader.parse() == expectParsed);
+
+    char path[] = "/tmp/wav_malformed_test_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+    unlink(path);
+    CHECK(write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size()));
+    lseek(fd, 0, SEEK_SET);
+    FileInputStream fileStream(fd);
+    WavStreamReader fileReader(&fileStream);
+    CHECK(fileReader.parse() == expectParsed);
+    CHECK(fileReader.getNumChunks() == memReader.getNumChunks());
+    close(fd);
+}
+
+} // namespace
+
+int main() {
+    std::vector<uint8_t> tableFile = hugeTableEntryFile();
+    checkParse("ds64 table entry near 2^63", tableFile, false);
+    AudioProbeInfo info;
+    CHECK(!AudioProbe::probeMemory(tableFile.data(), tableFile.size(), &info));
+
+    std::vector<uint8_t> dataFile = hugeDataSizeFile();
+    checkParse("ds64 data size of INT64_MAX", dataFile, true);
+    info = AudioProbeInfo();
+    CHECK(AudioProbe::probeMemory(dataFile.data(), dataFile.size(), &info));
+    CHECK(info.numFrames == INT64_MAX / 4);
+
+    if (sFailures > 0) {
+        printf("%d checks failed\n", sFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures how long WavStreamReader::parse() takes for files with few and many chunks,
+ * from a MemInputStream (parsed from InputStream::getView()) and from a FileInputStream.
+ * The files are generated, so nothing has to be downloaded.
+ *
+ * Usage: wav_parse_benchmark [iterations]
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "stream/FileInputStream.h"
+#include "stream/MemInputStream.h"
+#include "wav/WavStreamReader.h"
+
+using namespace parselib;
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+void appendInt(Bytes &bytes, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) {
+        bytes.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void appendId(Bytes &bytes, const char *id) {
+    bytes.insert(bytes.end(), id, id + 4);
+}
+
+// A chunk, padded to an even size.
+Bytes chunk(const char *id, const Bytes &payload) {
+    Bytes bytes;
+    appendId(bytes, id);
+    appendInt(bytes, payload.size(), 4);
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+    if (payload.size() % 2 != 0) {
+        bytes.push_back(0);
+    }
+    return bytes;
+}
+
+Bytes text(const std::string &value) {
+    return Bytes(value.c_str(), value.c_str() + value.size() + 1);
+}
+
+Bytes concat(std::initializer_list<Bytes> parts) {
+    Bytes bytes;
+    for (const Bytes &part : parts) {
+        bytes.insert(bytes.end(), part.begin(), part.end());
+    }
+    return bytes;
+}
+
+Bytes fmtChunk(int numChannels, int sampleRate, int bitsPerSample) {
+    Bytes payload;
+    int blockAlign = numChannels * bitsPerSample / 8;
+    appendInt(payload, 1, 2);   // PCM
+    appendInt(payload, numChannels, 2);
+    appendInt(payload, sampleRate, 4);
+    appendInt(payload, sampleRate * blockAlign, 4);
+    appendInt(payload, blockAlign, 2);
+    appendInt(payload, bitsPerSample, 2);
+    return chunk("fmt ", payload);
+}
+
+Bytes listInfoChunk() {
+    Bytes payload;
+    appendId(payload, "INFO");
+    for (const char *id : {"INAM", "IART", "ICMT", "ICRD", "IGNR", "ISFT", "IPRD", "ITRK"}) {
+        Bytes entry = chunk(id, text("Some text value here"));
+        payload.insert(payload.end(), entry.begin(), entry.end());
+    }
+    return chunk("LIST", payload);
+}
+
+Bytes bextChunk() {
+    Bytes payload(602, 0);
+    for (int i = 0; i < 4; i++) {
+        const char *history = "coding history\r\n";
+        payload.insert(payload.end(), history, history + strlen(history));
+    }
+    return chunk("bext", payload);
+}
+
+Bytes ixmlChunk() {
+    std::string xml = "<BWFXML>";
+    for (int i = 0; i < 300; i++) {
+        xml += "<X>y</X>";
+    }
+    xml += "</BWFXML>";
+    return chunk("iXML", Bytes(xml.begin(), xml.end()));
+}
+
+Bytes cueChunk(int numPoints) {
+    Bytes payload;
+    appendInt(payload, numPoints, 4);
+    for (int i = 0; i < numPoints; i++) {
+        appendInt(payload, i, 4);          // ID
+        appendInt(payload, i * 100, 4);    // position
+        appendId(payload, "data");
+        appendInt(payload, 0, 4);
+        appendInt(payload, 0, 4);
+        appendInt(payload, i * 100, 4);    // sample offset
+    }
+    return chunk("cue ", payload);
+}
+
+Bytes dataChunk(int numFrames, int numChannels, int bitsPerSample) {
+    return chunk("data", Bytes(static_cast<size_t>(numFrames) * numChannels * bitsPerSample / 8));
+}
+
+Bytes riffFile(const Bytes &chunks) {
+    Bytes bytes;
+    appendId(bytes, "RIFF");
+    appendInt(bytes, 4 + chunks.size(), 4);
+    appendId(bytes, "WAVE");
+    bytes.insert(bytes.end(), chunks.begin(), chunks.end());
+    return bytes;
+}
+
+// An RF64 file whose 32-bit sizes are all in the 'ds64' chunk.
+Bytes rf64File(const Bytes &beforeData, const Bytes &afterData, int numFrames,
+               int numChannels, int bitsPerSample) {
+    int64_t dataSize = static_cast<int64_t>(numFrames) * numChannels * bitsPerSample / 8;
+    Bytes ds64;
+    appendInt(ds64, 0, 8);  // RIFF size, filled in below
+    appendInt(ds64, dataSize, 8);
+    appendInt(ds64, numFrames, 8);
+    appendInt(ds64, 0, 4);  // no table
+    Bytes data;
+    appendId(data, "data");
+    appendInt(data, 0xFFFFFFFF, 4);
+    data.resize(data.size() + dataSize);
+
+    Bytes chunks = concat({chunk("ds64", ds64), fmtChunk(numChannels, 48000, bitsPerSample),
+                           beforeData, data, afterData});
+    Bytes bytes;
+    appendId(bytes, "RF64");
+    appendInt(bytes, 0xFFFFFFFF, 4);
+    appendId(bytes, "WAVE");
+    bytes.insert(bytes.end(), chunks.begin(), chunks.end());
+    uint64_t riffSize = bytes.size() - 8;
+    memcpy(&bytes[20], &riffSize, sizeof(riffSize));  // ds64 is little endian, as is the host
+    return bytes;
+}
+
+struct TestFile {
+    const char *name;
+    Bytes bytes;
+};
+
+std::vector<TestFile> makeFiles() {
+    Bytes extraChunks;
+    for (int i = 0; i < 20; i++) {
+        char id[5];
+        snprintf(id, sizeof(id), "x%03d", i);
+        Bytes extra = chunk(id, Bytes(i * 3 + 1));
+        extraChunks.insert(extraChunks.end(), extra.begin(), extra.end());
+    }
+    return {
+            {"3 chunks", riffFile(concat({fmtChunk(2, 48000, 16), dataChunk(48000, 2, 16)}))},
+            {"30 chunks", riffFile(concat({chunk("JUNK", Bytes(28)), bextChunk(), ixmlChunk(),
+                                           listInfoChunk(), extraChunks,
+                                           fmtChunk(2, 48000, 16), dataChunk(48000, 2, 16),
+                                           cueChunk(50), listInfoChunk()}))},
+            {"RF64", rf64File(concat({bextChunk(), ixmlChunk(), listInfoChunk()}),
+                              listInfoChunk(), 48000, 2, 24)},
+    };
+}
+
+double nanosPerParse(parselib::InputStream &stream, int iterations, int64_t *checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        stream.setPos(0);
+        WavStreamReader reader(&stream);
+        reader.parse();
+        *checksum += reader.getNumSampleFrames() + reader.getNumChunks();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    if (iterations <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    // Reading a file is much slower, so it gets fewer iterations.
+    int fileIterations = std::max(1, iterations / 10);
+    int64_t checksum = 0;
+
+    printf("%-10s %8s %12s %12s\n", "file", "chunks", "memory ns", "file ns");
+    for (const TestFile &file : makeFiles()) {
+        MemInputStream memStream(const_cast<unsigned char *>(file.bytes.data()),
+                                 static_cast<int64_t>(file.bytes.size()));
+        WavStreamReader reader(&memStream);
+        if (!reader.parse()) {
+            fprintf(stderr, "%s did not parse\n", file.name);
+            return 1;
+        }
+        double memoryNanos = nanosPerParse(memStream, iterations, &checksum);
+
+        char path[] = "/tmp/wav_parse_benchmark_XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0 || write(fd, file.bytes.data(), file.bytes.size())
+                != static_cast<ssize_t>(file.bytes.size())) {
+            fprintf(stderr, "cannot write %s\n", path);
+            return 1;
+        }
+        unlink(path);
+        FileInputStream fileStream(fd);
+        double fileNanos = nanosPerParse(fileStream, fileIterations, &checksum);
+        close(fd);
+
+        printf("%-10s %8d %12.0f %12.0f\n", file.name, reader.getNumChunks(), memoryNanos,
+               fileNanos);
+    }
+    // Keeps the parsing from being optimized away.
+    fprintf(stderr, "checksum %lld\n", static_cast<long long>(checksum));
+    return 0;
+}
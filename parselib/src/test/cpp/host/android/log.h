@@ -0,0 +1,49 @@
+/*
+ * Copyright 2019 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HOST_ANDROID_LOG_H_
+#define _HOST_ANDROID_LOG_H_
+
+// Just enough of the NDK log API to build parselib on a host. Messages go to stderr.
+
+#include <cstdarg>
+#include <cstdio>
+
+enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+};
+
+inline int __android_log_print(int priority, const char *tag, const char *format, ...) {
+    if (priority < ANDROID_LOG_WARN) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%s: ", tag);
+    int result = vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return result;
+}
+
+#endif // _HOST_ANDROID_LOG_H_